@@ -0,0 +1,84 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+// The lock free atom is opt-in, it is the one being measured here.
+#define IMMER_LOCK_FREE_ATOM 1
+
+#include <immer/atom.hpp>
+#include <immer/vector.hpp>
+
+#include <nonius.h++>
+
+#include <thread>
+#include <vector>
+
+NONIUS_PARAM(N, std::size_t{1000})
+
+namespace {
+
+// Deriving from `refcount_policy` makes the atom fall back to the spinlock
+// based implementation, which we use as a baseline.
+struct locked_refcount_policy : immer::refcount_policy
+{
+    using refcount_policy::refcount_policy;
+};
+
+using lock_free_memory = immer::default_memory_policy;
+using locked_memory =
+    immer::memory_policy<immer::default_heap_policy,
+                         locked_refcount_policy,
+                         immer::spinlock_policy>;
+
+template <typename Memory, unsigned Threads>
+auto benchmark_load()
+{
+    return [](nonius::chronometer meter) {
+        using vector_t = immer::vector<unsigned, Memory>;
+        using atom_t   = immer::atom<vector_t, Memory>;
+
+        auto n = meter.param<N>();
+        auto v = vector_t{};
+        for (auto i = 0u; i < n; ++i)
+            v = std::move(v).push_back(i);
+        atom_t a{v};
+
+        meter.measure([&] {
+            auto threads = std::vector<std::thread>{};
+            for (auto t = 0u; t < Threads; ++t)
+                threads.emplace_back([&] {
+                    auto c = 0u;
+                    for (auto i = 0u; i < n; ++i)
+                        c += a.load()->size();
+                    volatile auto r = c;
+                    (void) r;
+                });
+            for (auto& t : threads)
+                t.join();
+        });
+    };
+}
+
+} // anonymous namespace
+
+// clang-format off
+
+NONIUS_BENCHMARK("lock-free/1",  benchmark_load<lock_free_memory, 1>())
+NONIUS_BENCHMARK("lock-free/2",  benchmark_load<lock_free_memory, 2>())
+NONIUS_BENCHMARK("lock-free/4",  benchmark_load<lock_free_memory, 4>())
+NONIUS_BENCHMARK("lock-free/8",  benchmark_load<lock_free_memory, 8>())
+NONIUS_BENCHMARK("lock-free/16", benchmark_load<lock_free_memory, 16>())
+NONIUS_BENCHMARK("lock-free/32", benchmark_load<lock_free_memory, 32>())
+NONIUS_BENCHMARK("lock-free/64", benchmark_load<lock_free_memory, 64>())
+
+NONIUS_BENCHMARK("locked/1",     benchmark_load<locked_memory, 1>())
+NONIUS_BENCHMARK("locked/2",     benchmark_load<locked_memory, 2>())
+NONIUS_BENCHMARK("locked/4",     benchmark_load<locked_memory, 4>())
+NONIUS_BENCHMARK("locked/8",     benchmark_load<locked_memory, 8>())
+NONIUS_BENCHMARK("locked/16",    benchmark_load<locked_memory, 16>())
+NONIUS_BENCHMARK("locked/32",    benchmark_load<locked_memory, 32>())
+NONIUS_BENCHMARK("locked/64",    benchmark_load<locked_memory, 64>())
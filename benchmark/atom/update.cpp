@@ -0,0 +1,96 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/atom.hpp>
+#include <immer/map.hpp>
+
+#include <nonius.h++>
+
+#include <thread>
+#include <vector>
+
+NONIUS_PARAM(N, std::size_t{1000})
+
+namespace {
+
+struct update_fn
+{
+    template <typename T>
+    using atom = immer::atom<T>;
+
+    template <typename Atom, typename Fn>
+    auto operator()(Atom& a, Fn&& fn)
+    {
+        return a.update(std::forward<Fn>(fn));
+    }
+};
+
+struct update_combining_fn
+{
+    template <typename T>
+    using atom = immer::
+        atom<T, immer::default_memory_policy, immer::flat_combining_policy>;
+
+    template <typename Atom, typename Fn>
+    auto operator()(Atom& a, Fn&& fn)
+    {
+        return a.update_combining(std::forward<Fn>(fn));
+    }
+};
+
+template <typename UpdateFn, unsigned Threads>
+auto benchmark_update()
+{
+    return [](nonius::chronometer meter) {
+        using map_t  = immer::map<unsigned, unsigned>;
+        using atom_t = typename UpdateFn::template atom<map_t>;
+
+        auto n = meter.param<N>();
+        auto m = map_t{};
+        for (auto i = 0u; i < n; ++i)
+            m = std::move(m).set(i, 0u);
+
+        meter.measure([&] {
+            atom_t a{m};
+            auto threads = std::vector<std::thread>{};
+            for (auto t = 0u; t < Threads; ++t)
+                threads.emplace_back([&, t] {
+                    for (auto i = 0u; i < n / Threads; ++i) {
+                        auto k = (i * Threads + t) % n;
+                        UpdateFn{}(a, [&](auto m) {
+                            return std::move(m).update(
+                                k, [](auto x) { return x + 1; });
+                        });
+                    }
+                });
+            for (auto& t : threads)
+                t.join();
+            return a.load();
+        });
+    };
+}
+
+} // anonymous namespace
+
+// clang-format off
+
+NONIUS_BENCHMARK("update/1",            benchmark_update<update_fn, 1>())
+NONIUS_BENCHMARK("update/2",            benchmark_update<update_fn, 2>())
+NONIUS_BENCHMARK("update/4",            benchmark_update<update_fn, 4>())
+NONIUS_BENCHMARK("update/8",            benchmark_update<update_fn, 8>())
+NONIUS_BENCHMARK("update/16",           benchmark_update<update_fn, 16>())
+NONIUS_BENCHMARK("update/32",           benchmark_update<update_fn, 32>())
+NONIUS_BENCHMARK("update/64",           benchmark_update<update_fn, 64>())
+
+NONIUS_BENCHMARK("update_combining/1",  benchmark_update<update_combining_fn, 1>())
+NONIUS_BENCHMARK("update_combining/2",  benchmark_update<update_combining_fn, 2>())
+NONIUS_BENCHMARK("update_combining/4",  benchmark_update<update_combining_fn, 4>())
+NONIUS_BENCHMARK("update_combining/8",  benchmark_update<update_combining_fn, 8>())
+NONIUS_BENCHMARK("update_combining/16", benchmark_update<update_combining_fn, 16>())
+NONIUS_BENCHMARK("update_combining/32", benchmark_update<update_combining_fn, 32>())
+NONIUS_BENCHMARK("update_combining/64", benchmark_update<update_combining_fn, 64>())
@@ -0,0 +1,118 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+// Measure the lock free atom, which is opt-in.
+#define IMMER_LOCK_FREE_ATOM 1
+
+#include "contention.hpp"
+
+#include <immer/atom.hpp>
+
+#include <memory>
+#include <type_traits>
+
+/*
+ * Threads sharing an atom, where some percentage of the operations are
+ * loads and the rest write with `store()`, `update()` or
+ * `update_combining()`.  With `refcount_policy`, loads contend on the
+ * count of the current box, and writes on the atom itself.
+ */
+
+namespace {
+
+enum write_kind
+{
+    store,
+    update,
+    combining
+};
+
+template <class Memory, write_kind Write>
+using atom_t = immer::atom<std::uint64_t,
+                           Memory,
+                           std::conditional_t<Write == combining,
+                                              immer::flat_combining_policy,
+                                              immer::no_combining_policy>>;
+
+template <write_kind Write>
+using write_t = std::integral_constant<write_kind, Write>;
+
+template <class Atom>
+void write(Atom& a, std::size_t i, write_t<store>)
+{
+    a.store(std::uint64_t{i});
+}
+
+template <class Atom>
+void write(Atom& a, std::size_t, write_t<update>)
+{
+    a.update([](auto x) { return x + 1; });
+}
+
+template <class Atom>
+void write(Atom& a, std::size_t, write_t<combining>)
+{
+    a.update_combining([](auto x) { return x + 1; });
+}
+
+template <class Memory, unsigned Reads, write_kind Write>
+contention_body mixed(const contention_config& cfg, unsigned)
+{
+    auto a   = std::make_shared<atom_t<Memory, Write>>();
+    auto ops = cfg.ops;
+    return [=](unsigned t) {
+        auto r = std::uint64_t{};
+        for (auto i = std::size_t{}; i < ops; ++i) {
+            if (scramble(i * 64 + t) % 100 < Reads)
+                r += a->load().get();
+            else
+                write(*a, i, write_t<Write>{});
+        }
+        consume(r);
+    };
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    // clang-format off
+    return run_contention(argc, argv, "contention-atom", {
+        {"load/def",                   mixed<def_memory, 100, store>},
+        {"load/basic",                 mixed<basic_memory, 100, store>},
+        {"load/safe",                  mixed<safe_memory, 100, store>},
+        {"store/90r/def",              mixed<def_memory, 90, store>},
+        {"store/90r/basic",            mixed<basic_memory, 90, store>},
+        {"store/90r/safe",             mixed<safe_memory, 90, store>},
+        {"store/50r/def",              mixed<def_memory, 50, store>},
+        {"store/50r/basic",            mixed<basic_memory, 50, store>},
+        {"store/50r/safe",             mixed<safe_memory, 50, store>},
+        {"store/0r/def",               mixed<def_memory, 0, store>},
+        {"store/0r/basic",             mixed<basic_memory, 0, store>},
+        {"store/0r/safe",              mixed<safe_memory, 0, store>},
+        {"update/90r/def",             mixed<def_memory, 90, update>},
+        {"update/90r/basic",           mixed<basic_memory, 90, update>},
+        {"update/90r/safe",            mixed<safe_memory, 90, update>},
+        {"update/50r/def",             mixed<def_memory, 50, update>},
+        {"update/50r/basic",           mixed<basic_memory, 50, update>},
+        {"update/50r/safe",            mixed<safe_memory, 50, update>},
+        {"update/0r/def",              mixed<def_memory, 0, update>},
+        {"update/0r/basic",            mixed<basic_memory, 0, update>},
+        {"update/0r/safe",             mixed<safe_memory, 0, update>},
+        {"update_combining/90r/def",   mixed<def_memory, 90, combining>},
+        {"update_combining/90r/basic", mixed<basic_memory, 90, combining>},
+        {"update_combining/90r/safe",  mixed<safe_memory, 90, combining>},
+        {"update_combining/50r/def",   mixed<def_memory, 50, combining>},
+        {"update_combining/50r/basic", mixed<basic_memory, 50, combining>},
+        {"update_combining/50r/safe",  mixed<safe_memory, 50, combining>},
+        {"update_combining/0r/def",    mixed<def_memory, 0, combining>},
+        {"update_combining/0r/basic",  mixed<basic_memory, 0, combining>},
+        {"update_combining/0r/safe",   mixed<safe_memory, 0, combining>},
+    });
+    // clang-format on
+}
@@ -0,0 +1,274 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include "benchmark/driver.hpp"
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <regex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/*
+ * Contention benchmarks.  Every workload is run with 1, 2, 4... threads up
+ * to the maximum, each thread doing the same number of operations, and the
+ * throughput of all of them together is reported next to the scaling
+ * efficiency, that is, the throughput divided by the number of threads
+ * times the throughput of one thread.  A workload that scales perfectly
+ * keeps an efficiency of 1, and one that is serialized by some shared
+ * cache line drops to `1 / threads` or below.
+ *
+ * The threads wait on a common start line, so that they all run at the
+ * same time, and the clock stops once the last of them is done.
+ */
+
+namespace {
+
+/*
+ * Keeps the results computed by the threads alive, so that the compiler
+ * does not drop the operations that produced them.
+ */
+void consume(std::uint64_t x)
+{
+    static std::atomic<std::uint64_t> sink{0};
+    sink.fetch_add(x, std::memory_order_relaxed);
+}
+
+struct contention_config
+{
+    std::size_t n      = 1000;
+    std::size_t ops    = 100000;
+    unsigned threads   = std::max(std::thread::hardware_concurrency(), 1u);
+    unsigned samples   = 5;
+    std::string filter = ".*";
+    std::string format = "text";
+    std::string output = "";
+    std::string suite  = "contention";
+    bool list          = false;
+};
+
+/*
+ * What every thread runs, given its index.  It does `cfg.ops` operations.
+ */
+using contention_body = std::function<void(unsigned)>;
+
+using contention_prepare =
+    std::function<contention_body(const contention_config&, unsigned)>;
+
+/*
+ * A workload prepares the shared state for a sample with some number of
+ * threads, and returns the body of the threads, which owns that state.
+ * Workloads that are only correct on one thread, like those using the
+ * unsafe heaps, set `max_threads`.
+ */
+struct contention_workload
+{
+    std::string name;
+    contention_prepare prepare;
+    unsigned max_threads = 0;
+};
+
+using contention_clock = std::chrono::steady_clock;
+
+/*
+ * Returns the seconds that `threads` threads took running `body`.
+ */
+double run_threads(unsigned threads, const contention_body& body)
+{
+    std::atomic<unsigned> ready{0};
+    std::atomic<bool> go{false};
+    auto ts = std::vector<std::thread>{};
+    for (auto t = 0u; t < threads; ++t)
+        ts.emplace_back([&, t] {
+            ready.fetch_add(1);
+            while (!go.load(std::memory_order_acquire))
+                std::this_thread::yield();
+            body(t);
+        });
+    while (ready.load() < threads)
+        std::this_thread::yield();
+    auto t0 = contention_clock::now();
+    go.store(true, std::memory_order_release);
+    for (auto& t : ts)
+        t.join();
+    auto t1 = contention_clock::now();
+    return std::chrono::duration<double>(t1 - t0).count();
+}
+
+struct contention_result
+{
+    unsigned threads;
+    double mean_s;
+    double low_s;
+    double high_s;
+    double ops_per_s;
+    double efficiency;
+};
+
+/*
+ * Times `cfg.samples` runs, returning the seconds per operation of all the
+ * threads together, that is, the inverse of the throughput, and the
+ * confidence interval of its mean.
+ */
+contention_result measure_contention(const contention_config& cfg,
+                                     const contention_workload& w,
+                                     unsigned threads)
+{
+    auto runs    = std::max(cfg.samples, 1u);
+    auto samples = std::vector<double>{};
+    for (auto i = 0u; i < runs; ++i) {
+        auto body = w.prepare(cfg, threads);
+        samples.push_back(run_threads(threads, body) / (cfg.ops * threads));
+    }
+    auto stats = summarize(samples);
+    return {threads, stats.mean, stats.low, stats.high, 1. / stats.mean, 0};
+}
+
+void report_contention(std::ostream& os,
+                       const contention_config& cfg,
+                       const std::string& name,
+                       const contention_result& r)
+{
+    if (cfg.format == "json") {
+        json_line{os}
+            .field("suite", cfg.suite)
+            .field("benchmark", name)
+            .begin("params")
+            .field("N", cfg.n)
+            .field("ops", cfg.ops)
+            .field("threads", r.threads)
+            .end()
+            .field("samples", cfg.samples)
+            .field("mean_s", r.mean_s)
+            .field("mean_low_s", r.low_s)
+            .field("mean_high_s", r.high_s)
+            .field("ops_per_s", r.ops_per_s)
+            .field("efficiency", r.efficiency);
+    } else {
+        os << std::left << std::setw(40) << name << std::right
+           << std::setw(8) << r.threads << std::setprecision(2)
+           << std::fixed << std::setw(12) << r.ops_per_s * 1e-6
+           << std::setw(10) << r.mean_s * 1e9 << std::setw(12)
+           << r.efficiency << "\n";
+    }
+}
+
+void contention_usage(const char* name)
+{
+    std::cerr
+        << "usage: " << name << " [options]\n"
+        << "  -p N:<size>     size of the shared containers (1000)\n"
+        << "  -n <ops>        operations done by every thread (100000)\n"
+        << "  -t <threads>    maximum number of threads (all the cores)\n"
+        << "  -s <samples>    runs averaged per number of threads (5)\n"
+        << "  -f <regex>      only run the matching workloads\n"
+        << "  -r text|json    output format (text)\n"
+        << "  -o <file>       write the results to a file\n"
+        << "  -l              list the workloads\n"
+        << "throughput is in millions of operations per second, and ns/op "
+           "is its inverse\n";
+}
+
+/*
+ * The numbers of threads to try: the powers of two below the maximum, and
+ * the maximum itself.
+ */
+std::vector<unsigned> thread_counts(unsigned max)
+{
+    auto r = std::vector<unsigned>{};
+    for (auto t = 1u; t < max; t *= 2)
+        r.push_back(t);
+    r.push_back(std::max(max, 1u));
+    return r;
+}
+
+int run_contention(int argc,
+                   char** argv,
+                   const std::string& suite,
+                   const std::vector<contention_workload>& workloads)
+{
+    auto cfg  = contention_config{};
+    cfg.suite = suite;
+    auto args = driver_args{argc, argv, contention_usage};
+    while (args.next()) {
+        auto& arg = args.arg();
+        if (arg == "-p")
+            args.param("N", cfg.n);
+        else if (arg == "-n")
+            cfg.ops = std::stoul(args.value());
+        else if (arg == "-t")
+            cfg.threads = std::stoul(args.value());
+        else if (arg == "-s")
+            cfg.samples = std::stoul(args.value());
+        else if (arg == "-f")
+            cfg.filter = args.value();
+        else if (arg == "-r")
+            cfg.format = args.value();
+        else if (arg == "-o")
+            cfg.output = args.value();
+        else if (arg == "-l")
+            cfg.list = true;
+        else
+            return args.usage();
+    }
+
+    auto filter = std::regex{cfg.filter};
+    if (cfg.list) {
+        for (auto& w : workloads)
+            if (std::regex_search(w.name, filter))
+                std::cout << w.name << "\n";
+        return 0;
+    }
+
+    auto file = std::ofstream{};
+    if (!cfg.output.empty())
+        file.open(cfg.output);
+    auto& os = cfg.output.empty() ? std::cout : file;
+
+    if (cfg.format != "json")
+        os << "N: " << cfg.n << ", ops: " << cfg.ops
+           << ", samples: " << cfg.samples << "\n"
+           << std::left << std::setw(40) << "workload" << std::right
+           << std::setw(8) << "threads" << std::setw(12) << "Mops/s"
+           << std::setw(10) << "ns/op" << std::setw(12) << "efficiency"
+           << "\n";
+    for (auto& w : workloads)
+        if (std::regex_search(w.name, filter)) {
+            auto base = 0.;
+            for (auto t : thread_counts(cfg.threads)) {
+                if (w.max_threads && t > w.max_threads)
+                    break;
+                auto r = measure_contention(cfg, w, t);
+                if (t == 1)
+                    base = r.ops_per_s;
+                r.efficiency = r.ops_per_s / (t * base);
+                report_contention(os, cfg, w.name, r);
+            }
+        }
+    return 0;
+}
+
+} // namespace
+
+/*
+ * Adds an entry for `fn<Memory>` for every thread safe memory policy.
+ */
+#define IMMER_CONTENTION_POLICIES(name, fn)                                    \
+    {name "/def", fn<def_memory>}, {name "/basic", fn<basic_memory>},          \
+        {name "/safe", fn<safe_memory>}
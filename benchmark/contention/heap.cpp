@@ -0,0 +1,175 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include "contention.hpp"
+
+#include <immer/heap/cpp_heap.hpp>
+#include <immer/heap/free_list_heap.hpp>
+#include <immer/heap/free_list_node.hpp>
+#include <immer/heap/heap_policy.hpp>
+#include <immer/heap/thread_local_free_list_heap.hpp>
+#include <immer/heap/unsafe_free_list_heap.hpp>
+
+#include <memory>
+
+/*
+ * Allocating and freeing nodes from several threads.  The global
+ * `free_list_heap` is shared by all of them, the `thread_local` one keeps a
+ * list per thread, and `safe` is what `free_list_heap_policy` builds, a
+ * thread local list in front of the global one.  The unsafe list is only
+ * run on one thread, as a baseline.
+ *
+ * In the `cross` workloads every thread frees the nodes allocated by the
+ * previous one, like when a snapshot built by a writer is dropped by a
+ * reader, so the free lists keep getting nodes from other threads.
+ */
+
+namespace {
+
+constexpr auto node_size  = std::size_t{64};
+constexpr auto list_limit = std::size_t{1024};
+
+using cpp_heap = immer::cpp_heap;
+using free_list_heap =
+    immer::with_free_list_node<immer::free_list_heap<node_size,
+                                                     list_limit,
+                                                     immer::cpp_heap>>;
+using thread_local_heap = immer::with_free_list_node<
+    immer::thread_local_free_list_heap<node_size,
+                                       list_limit,
+                                       immer::cpp_heap>>;
+using safe_heap = immer::free_list_heap_policy<
+    immer::cpp_heap>::optimized<node_size>::type;
+using unsafe_heap =
+    immer::with_free_list_node<immer::unsafe_free_list_heap<node_size,
+                                                            list_limit,
+                                                            immer::cpp_heap>>;
+
+/*
+ * Writes to the node, as it would be initialized.
+ */
+void* touch(void* p, std::size_t v)
+{
+    *static_cast<std::size_t*>(p) = v;
+    return p;
+}
+
+/*
+ * Every thread allocates a batch of nodes and frees them in reverse order,
+ * which is how the nodes of a short lived version come and go.
+ */
+template <typename Heap>
+contention_body alloc(const contention_config& cfg, unsigned)
+{
+    constexpr auto batch = std::size_t{32};
+    auto ops             = cfg.ops;
+    return [=](unsigned) {
+        void* nodes[batch];
+        for (auto i = std::size_t{}; i < ops; i += batch) {
+            auto count = std::min(batch, ops - i);
+            for (auto j = std::size_t{}; j < count; ++j)
+                nodes[j] = touch(Heap::allocate(node_size), i + j);
+            for (auto j = count; j-- > 0;)
+                Heap::deallocate(node_size, nodes[j]);
+        }
+    };
+}
+
+/*
+ * Single producer, single consumer queue through which a thread hands its
+ * nodes to the next one.
+ */
+struct handoff
+{
+    static constexpr std::size_t capacity = 256;
+
+    std::atomic<std::size_t> head{0};
+    char pad0[64];
+    std::atomic<std::size_t> tail{0};
+    char pad1[64];
+    void* slots[capacity];
+
+    bool push(void* p)
+    {
+        auto t = tail.load(std::memory_order_relaxed);
+        if (t - head.load(std::memory_order_acquire) == capacity)
+            return false;
+        slots[t % capacity] = p;
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    void* pop()
+    {
+        auto h = head.load(std::memory_order_relaxed);
+        if (h == tail.load(std::memory_order_acquire))
+            return nullptr;
+        auto p = slots[h % capacity];
+        head.store(h + 1, std::memory_order_release);
+        return p;
+    }
+};
+
+/*
+ * Every thread allocates nodes, passes them to the next thread, and frees
+ * the ones it gets from the previous thread.  A thread that can not pass a
+ * node frees what it got first, so the ring never blocks.  On one thread,
+ * the nodes go through the queue back to the same thread.
+ */
+template <typename Heap>
+contention_body alloc_cross(const contention_config& cfg, unsigned threads)
+{
+    auto queues = std::make_shared<std::vector<handoff>>(threads);
+    auto ops    = cfg.ops;
+    return [=](unsigned t) {
+        auto& out  = (*queues)[t];
+        auto& in   = (*queues)[(t + threads - 1) % threads];
+        auto freed = std::size_t{};
+        auto drain = [&] {
+            while (auto p = in.pop()) {
+                Heap::deallocate(node_size, p);
+                ++freed;
+            }
+        };
+        for (auto i = std::size_t{}; i < ops; ++i) {
+            auto p = touch(Heap::allocate(node_size), i);
+            while (!out.push(p)) {
+                drain();
+                std::this_thread::yield();
+            }
+            if (auto q = in.pop()) {
+                Heap::deallocate(node_size, q);
+                ++freed;
+            }
+        }
+        while (freed < ops) {
+            drain();
+            std::this_thread::yield();
+        }
+    };
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    // clang-format off
+    return run_contention(argc, argv, "contention-heap", {
+        {"alloc/cpp",                  alloc<cpp_heap>},
+        {"alloc/free_list",            alloc<free_list_heap>},
+        {"alloc/thread_local",         alloc<thread_local_heap>},
+        {"alloc/safe",                 alloc<safe_heap>},
+        {"alloc/unsafe",               alloc<unsafe_heap>, 1},
+        {"alloc/cross/cpp",            alloc_cross<cpp_heap>},
+        {"alloc/cross/free_list",      alloc_cross<free_list_heap>},
+        {"alloc/cross/thread_local",   alloc_cross<thread_local_heap>},
+        {"alloc/cross/safe",           alloc_cross<safe_heap>},
+        {"alloc/cross/unsafe",         alloc_cross<unsafe_heap>, 1},
+    });
+    // clang-format on
+}
@@ -0,0 +1,243 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include "contention.hpp"
+
+#include <immer/map.hpp>
+#include <immer/map_transient.hpp>
+#include <immer/pin.hpp>
+#include <immer/vector.hpp>
+#include <immer/vector_transient.hpp>
+
+#include <memory>
+
+/*
+ * Readers sharing one snapshot.  Copying a container only touches the
+ * reference count of its root, but when every thread copies the same
+ * snapshot, all of them write to that one cache line.  The `owned`
+ * workloads give every thread its own snapshot instead, which is the best
+ * that the shared ones can do, and the `pinned` ones pin the shared
+ * snapshot and copy the `pinned` handle, which does not write any count.
+ */
+
+namespace {
+
+template <class Memory>
+using vector_t = immer::vector<unsigned, Memory>;
+
+template <class Memory>
+using map_t = immer::map<unsigned,
+                         unsigned,
+                         std::hash<unsigned>,
+                         std::equal_to<unsigned>,
+                         Memory>;
+
+template <class Memory>
+vector_t<Memory> make_vector(std::size_t n)
+{
+    auto v = vector_t<Memory>{}.transient();
+    for (auto i = 0u; i < n; ++i)
+        v.push_back(i);
+    return v.persistent();
+}
+
+template <class Memory>
+map_t<Memory> make_map(std::size_t n)
+{
+    auto m = map_t<Memory>{}.transient();
+    for (auto i = 0u; i < n; ++i)
+        m.set(i, i);
+    return m.persistent();
+}
+
+enum sharing
+{
+    shared,
+    pinned,
+    owned
+};
+
+/*
+ * A pinned snapshot is handed to the threads as a `pinned` handle, which
+ * they copy instead of the container.  `deref()` gives the container behind
+ * either.
+ */
+template <typename T>
+const T& deref(const T& x)
+{
+    return x;
+}
+
+template <typename T>
+const T& deref(const immer::pinned<T>& x)
+{
+    return *x;
+}
+
+/*
+ * One snapshot for all the threads, or one for each of them.  The pinned
+ * snapshot is unpinned once the threads, and their copies, are gone.
+ */
+template <typename T>
+struct snapshots
+{
+    std::vector<T> values;
+
+    template <typename Make>
+    snapshots(Make make, std::size_t n, unsigned count)
+    {
+        for (auto i = 0u; i < count; ++i)
+            values.push_back(make(n));
+    }
+
+    const T& get(unsigned t) const { return values[t % values.size()]; }
+};
+
+template <typename T>
+struct snapshots<immer::pinned<T>>
+{
+    immer::pinned<T> value;
+
+    template <typename Make>
+    snapshots(Make make, std::size_t n, unsigned)
+        : value{immer::pin(make(n))}
+    {
+    }
+
+    ~snapshots() { immer::unpin(value); }
+
+    const immer::pinned<T>& get(unsigned) const { return value; }
+};
+
+/*
+ * Every thread adds up `op(snapshot, i)` for its operations.
+ */
+template <typename T, sharing Mode, typename Make, typename Op>
+contention_body snapshot_body(const contention_config& cfg,
+                              unsigned threads,
+                              Make make,
+                              Op op)
+{
+    using handle_t = std::conditional_t<Mode == pinned, immer::pinned<T>, T>;
+
+    auto count = Mode == owned ? threads : 1u;
+    auto s     = std::make_shared<snapshots<handle_t>>(make, cfg.n, count);
+    auto ops   = cfg.ops;
+    return [=](unsigned t) {
+        auto& v = s->get(t);
+        auto r  = std::uint64_t{};
+        for (auto i = std::size_t{}; i < ops; ++i)
+            r += op(v, i);
+        consume(r);
+    };
+}
+
+/*
+ * Takes a copy of the snapshot, as a reader that is handed the current
+ * version does, and drops it.
+ */
+template <class Memory, sharing Mode>
+contention_body vector_copy(const contention_config& cfg, unsigned threads)
+{
+    return snapshot_body<vector_t<Memory>, Mode>(
+        cfg, threads, make_vector<Memory>, [](auto& v, auto i) {
+            auto c = v;
+            return deref(c).size();
+        });
+}
+
+/*
+ * Takes a copy and reads an element of it.
+ */
+template <class Memory, sharing Mode>
+contention_body vector_read(const contention_config& cfg, unsigned threads)
+{
+    return snapshot_body<vector_t<Memory>, Mode>(
+        cfg, threads, make_vector<Memory>, [](auto& v, auto i) {
+            auto c  = v;
+            auto& x = deref(c);
+            return x[scramble(i) % x.size()];
+        });
+}
+
+/*
+ * Derives a new version from the snapshot, which also increments the
+ * counts of the nodes that both share, and drops it.
+ */
+template <class Memory, sharing Mode>
+contention_body vector_update(const contention_config& cfg, unsigned threads)
+{
+    return snapshot_body<vector_t<Memory>, Mode>(
+        cfg, threads, make_vector<Memory>, [](auto& v, auto i) {
+            auto& x = deref(v);
+            auto c  = x.set(scramble(i) % x.size(), i);
+            return c.size();
+        });
+}
+
+template <class Memory, sharing Mode>
+contention_body map_copy(const contention_config& cfg, unsigned threads)
+{
+    return snapshot_body<map_t<Memory>, Mode>(
+        cfg, threads, make_map<Memory>, [](auto& m, auto i) {
+            auto c = m;
+            return deref(c).size();
+        });
+}
+
+template <class Memory, sharing Mode>
+contention_body map_read(const contention_config& cfg, unsigned threads)
+{
+    return snapshot_body<map_t<Memory>, Mode>(
+        cfg, threads, make_map<Memory>, [](auto& m, auto i) {
+            auto c  = m;
+            auto& x = deref(c);
+            return x.count(scramble(i) % x.size());
+        });
+}
+
+template <class Memory, sharing Mode>
+contention_body map_update(const contention_config& cfg, unsigned threads)
+{
+    return snapshot_body<map_t<Memory>, Mode>(
+        cfg, threads, make_map<Memory>, [](auto& m, auto i) {
+            auto& x = deref(m);
+            auto c  = x.set(scramble(i) % x.size(), i);
+            return c.size();
+        });
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    // clang-format off
+    return run_contention(argc, argv, "contention-refcount", {
+        {"vector/copy/shared",         vector_copy<def_memory, shared>},
+        {"vector/copy/pinned",         vector_copy<def_memory, pinned>},
+        {"vector/copy/owned",          vector_copy<def_memory, owned>},
+        {"vector/read/shared",         vector_read<def_memory, shared>},
+        {"vector/read/pinned",         vector_read<def_memory, pinned>},
+        {"vector/read/owned",          vector_read<def_memory, owned>},
+        {"vector/update/shared/def",   vector_update<def_memory, shared>},
+        {"vector/update/shared/basic", vector_update<basic_memory, shared>},
+        {"vector/update/shared/safe",  vector_update<safe_memory, shared>},
+        {"vector/update/owned/def",    vector_update<def_memory, owned>},
+        {"map/copy/shared",            map_copy<def_memory, shared>},
+        {"map/copy/pinned",            map_copy<def_memory, pinned>},
+        {"map/copy/owned",             map_copy<def_memory, owned>},
+        {"map/read/shared",            map_read<def_memory, shared>},
+        {"map/read/pinned",            map_read<def_memory, pinned>},
+        {"map/read/owned",             map_read<def_memory, owned>},
+        {"map/update/shared/def",      map_update<def_memory, shared>},
+        {"map/update/shared/basic",    map_update<basic_memory, shared>},
+        {"map/update/shared/safe",     map_update<safe_memory, shared>},
+        {"map/update/owned/def",       map_update<def_memory, owned>},
+    });
+    // clang-format on
+}
@@ -0,0 +1,245 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/memory_policy.hpp>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <ostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+/*
+ * Helpers shared by the benchmark drivers that do not use the nonius
+ * runner, or that report with their own nonius reporter: the standalone,
+ * latency, contention, replay and persist suites.  They all read their
+ * options the same way and print the same JSON lines, which
+ * `tools/compare-benchmarks.py` compares between runs.
+ */
+
+namespace {
+
+template <typename Heap = immer::cpp_heap>
+using basic_memory_t = immer::memory_policy<immer::heap_policy<Heap>,
+                                            immer::refcount_policy,
+                                            immer::default_lock_policy>;
+
+template <typename Heap = immer::cpp_heap>
+using safe_memory_t =
+    immer::memory_policy<immer::free_list_heap_policy<Heap>,
+                         immer::refcount_policy,
+                         immer::default_lock_policy>;
+
+template <typename Heap = immer::cpp_heap>
+using unsafe_memory_t =
+    immer::memory_policy<immer::unsafe_free_list_heap_policy<Heap>,
+                         immer::unsafe_refcount_policy,
+                         immer::default_lock_policy>;
+
+using def_memory    = immer::default_memory_policy;
+using basic_memory  = basic_memory_t<>;
+using safe_memory   = safe_memory_t<>;
+using unsafe_memory = unsafe_memory_t<>;
+
+/*
+ * Spreads the keys of the hash based containers over the whole range, in an
+ * order that is the same in every run.
+ */
+std::uint64_t scramble(std::uint64_t x)
+{
+    x += 0x9e3779b97f4a7c15u;
+    x = (x ^ (x >> 30)) * 0xbf58476d1ce4e5b9u;
+    x = (x ^ (x >> 27)) * 0x94d049bb133111ebu;
+    return x ^ (x >> 31);
+}
+
+std::string json_quote(const std::string& str)
+{
+    auto os = std::ostringstream{};
+    os << std::quoted(str, '"', '\\');
+    return os.str();
+}
+
+/*
+ * Writes one JSON object on a line of `os`, field by field.  Objects can be
+ * nested with `begin()` and `end()`, and the line is finished when the
+ * writer is destroyed.
+ */
+class json_line
+{
+public:
+    explicit json_line(std::ostream& os)
+        : os_{os}
+    {
+        os_ << std::setprecision(9) << "{";
+    }
+
+    ~json_line() { os_ << "}\n"; }
+
+    json_line(const json_line&)            = delete;
+    json_line& operator=(const json_line&) = delete;
+
+    template <typename T>
+    json_line& field(const std::string& name, const T& value)
+    {
+        key(name) << value;
+        return *this;
+    }
+
+    json_line& field(const std::string& name, const std::string& value)
+    {
+        key(name) << json_quote(value);
+        return *this;
+    }
+
+    json_line& field(const std::string& name, const char* value)
+    {
+        return field(name, std::string{value});
+    }
+
+    /*
+     * Writes a value that is already JSON, like a formatted object.
+     */
+    json_line& raw(const std::string& name, const std::string& json)
+    {
+        key(name) << json;
+        return *this;
+    }
+
+    json_line& begin(const std::string& name)
+    {
+        key(name) << "{";
+        first_ = true;
+        return *this;
+    }
+
+    json_line& end()
+    {
+        os_ << "}";
+        first_ = false;
+        return *this;
+    }
+
+private:
+    std::ostream& key(const std::string& name)
+    {
+        os_ << (first_ ? "" : ", ") << json_quote(name) << ": ";
+        first_ = false;
+        return os_;
+    }
+
+    std::ostream& os_;
+    bool first_ = true;
+};
+
+/*
+ * The mean of some samples and its 95% confidence interval, from the
+ * Student's t distribution, since drivers take only a few samples.  With a
+ * single sample the interval is empty.
+ */
+struct sample_stats
+{
+    double mean = 0;
+    double low  = 0;
+    double high = 0;
+};
+
+sample_stats summarize(const std::vector<double>& xs)
+{
+    static const double t95[] = {12.706, 4.303, 3.182, 2.776, 2.571,
+                                 2.447,  2.365, 2.306, 2.262, 2.228,
+                                 2.201,  2.179, 2.160, 2.145, 2.131,
+                                 2.120,  2.110, 2.101, 2.093, 2.086};
+    auto r = sample_stats{};
+    if (xs.empty())
+        return r;
+    for (auto x : xs)
+        r.mean += x / xs.size();
+    r.low = r.high = r.mean;
+    if (xs.size() < 2)
+        return r;
+    auto var = 0.;
+    for (auto x : xs)
+        var += (x - r.mean) * (x - r.mean) / (xs.size() - 1);
+    auto df     = xs.size() - 1;
+    auto t      = df <= 20 ? t95[df - 1] : 1.96;
+    auto margin = t * std::sqrt(var / xs.size());
+    r.low       = r.mean - margin;
+    r.high      = r.mean + margin;
+    return r;
+}
+
+/*
+ * Walks the command line of a driver.  `value()` returns the argument of the
+ * current option, and prints the usage and exits when there is none.
+ */
+class driver_args
+{
+public:
+    using usage_fn = void (*)(const char*);
+
+    driver_args(int argc, char** argv, usage_fn usage)
+        : argc_{argc}
+        , argv_{argv}
+        , usage_{usage}
+    {
+    }
+
+    bool next()
+    {
+        if (++i_ >= argc_)
+            return false;
+        arg_ = argv_[i_];
+        return true;
+    }
+
+    const std::string& arg() const { return arg_; }
+
+    std::string value()
+    {
+        if (i_ + 1 >= argc_) {
+            usage_(argv_[0]);
+            std::exit(1);
+        }
+        return argv_[++i_];
+    }
+
+    /*
+     * Reads `-p <name>:<value>`, leaving `n` alone for other parameters.
+     */
+    void param(const std::string& name, std::size_t& n)
+    {
+        auto v = value();
+        if (v.compare(0, name.size() + 1, name + ":") == 0)
+            n = std::stoul(v.substr(name.size() + 1));
+    }
+
+    /*
+     * Prints the usage for an unknown option, returning the exit status.
+     */
+    int usage() const
+    {
+        usage_(argv_[0]);
+        return arg_ == "-h" ? 0 : 1;
+    }
+
+private:
+    int argc_;
+    char** argv_;
+    usage_fn usage_;
+    int i_ = 0;
+    std::string arg_;
+};
+
+} // namespace
@@ -0,0 +1,64 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include "common.hpp"
+
+#include <immer/box.hpp>
+#include <immer/vector.hpp>
+#include <immer/vector_transient.hpp>
+
+#include <cereal/types/string.hpp>
+
+namespace {
+
+// Binary pools can not store boxes, so these are only saved as JSON.
+struct item
+{
+    immer::box<std::string> text;
+
+    template <class Archive>
+    void serialize(Archive& ar)
+    {
+        ar(CEREAL_NVP(text));
+    }
+};
+
+struct traits
+{
+    using container_t = immer::vector<item>;
+    using policy_t = pools_policy<container_t, immer::box<std::string>>;
+
+    static item make_item(std::uint64_t x)
+    {
+        return {std::string(16, 'a') + std::to_string(x)};
+    }
+
+    static container_t make(std::size_t n)
+    {
+        auto t = container_t{}.transient();
+        for (auto i = std::size_t{}; i < n; ++i)
+            t.push_back(make_item(i));
+        return std::move(t).persistent();
+    }
+
+    template <class Rng>
+    static container_t change(container_t v, const sweep& p, Rng& rng)
+    {
+        auto t     = std::move(v).transient();
+        auto index = std::uniform_int_distribution<std::size_t>{0, p.size - 1};
+        for (auto i = p.changes(); i > 0; --i)
+            t.set(index(rng), make_item(rng()));
+        return std::move(t).persistent();
+    }
+};
+
+} // namespace
+
+NONIUS_BENCHMARK("json/save", json_save<traits>)
+NONIUS_BENCHMARK("json/save-streamed", json_save_streamed<traits>)
+NONIUS_BENCHMARK("json/load", json_load<traits>)
@@ -0,0 +1,364 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#ifndef IMMER_BENCHMARK_SUITE
+#define IMMER_BENCHMARK_SUITE "persist"
+#endif
+
+#include "benchmark/driver.hpp"
+#include "benchmark/json_reporter.hpp"
+
+#include <immer/extra/persist/binary/buffer.hpp>
+#include <immer/extra/persist/binary/save.hpp>
+#include <immer/extra/persist/cereal/load.hpp>
+#include <immer/extra/persist/cereal/save.hpp>
+#include <immer/extra/persist/transform.hpp>
+
+#include <boost/hana.hpp>
+#include <cereal/types/vector.hpp>
+#include <nonius.h++>
+
+#include <algorithm>
+#include <cstdint>
+#include <iomanip>
+#include <optional>
+#include <random>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <vector>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <sys/resource.h>
+#endif
+
+/*
+ * Every benchmark saves or loads a document with `roots` versions of a
+ * container of `N` elements.  Each version is derived from the previous one
+ * by changing `100 - shared` percent of its elements, so that `shared`
+ * controls how much structure the pools can share between the roots.
+ *
+ * Besides the time, the `persist-json` reporter prints the size of the
+ * output, the throughput, the number of nodes in the pools and the peak
+ * resident memory, one JSON object per benchmark and set of parameters.
+ * The peak memory is the one of the whole process, so it is only
+ * meaningful when running one benchmark per process, for example with
+ * `-f binary/load`.
+ */
+
+NONIUS_PARAM(N, std::size_t{1000})
+NONIUS_PARAM(roots, std::size_t{4})
+NONIUS_PARAM(shared, std::size_t{90})
+
+namespace {
+
+struct sweep
+{
+    std::size_t size;
+    std::size_t roots;
+    std::size_t shared;
+
+    auto tie() const { return std::tie(size, roots, shared); }
+
+    friend bool operator==(const sweep& a, const sweep& b)
+    {
+        return a.tie() == b.tie();
+    }
+
+    static sweep from(const nonius::chronometer& meter)
+    {
+        return {meter.param<N>(),
+                std::max(meter.param<::roots>(), std::size_t{1}),
+                std::min(meter.param<::shared>(), std::size_t{100})};
+    }
+
+    std::size_t changes() const { return size * (100 - shared) / 100; }
+};
+
+template <class Container>
+struct root
+{
+    Container value;
+
+    template <class Archive>
+    void serialize(Archive& ar)
+    {
+        ar(CEREAL_NVP(value));
+    }
+};
+
+template <class Container>
+struct document
+{
+    std::vector<root<Container>> versions;
+
+    template <class Archive>
+    void serialize(Archive& ar)
+    {
+        ar(CEREAL_NVP(versions));
+    }
+};
+
+template <class... Pooled>
+struct pools_policy
+    : immer::persist::demangled_names_t
+    , immer::persist::value0_serialize_t
+{
+    template <class T>
+    auto get_pool_types(const T&) const
+    {
+        return boost::hana::tuple_t<Pooled...>;
+    }
+};
+
+template <typename T,
+          typename MemoryPolicy,
+          immer::detail::rbts::bits_t B,
+          immer::detail::rbts::bits_t BL>
+std::size_t
+count_nodes(const immer::persist::rbts::output_pool<T, MemoryPolicy, B, BL>& p)
+{
+    return p.leaves.size() + p.inners.size();
+}
+
+template <class Container>
+std::size_t
+count_nodes(const immer::persist::champ::container_output_pool<Container>& p)
+{
+    return p.nodes.inners.size();
+}
+
+template <class T, class MemoryPolicy>
+std::size_t
+count_nodes(const immer::persist::box::output_pool<T, MemoryPolicy>& p)
+{
+    return p.boxes.size();
+}
+
+template <class Pools>
+std::size_t count_nodes(const Pools& pools)
+{
+    auto result = std::size_t{};
+    boost::hana::for_each(pools.storage(), [&](const auto& pair) {
+        result += count_nodes(boost::hana::second(pair));
+    });
+    return result;
+}
+
+/*
+ * Peak resident memory of the process in bytes, or 0 when unknown.
+ */
+std::size_t peak_rss()
+{
+#if defined(__unix__) || defined(__APPLE__)
+    auto usage = rusage{};
+    if (getrusage(RUSAGE_SELF, &usage) != 0)
+        return 0;
+#if defined(__APPLE__)
+    return static_cast<std::size_t>(usage.ru_maxrss);
+#else
+    return static_cast<std::size_t>(usage.ru_maxrss) * 1024;
+#endif
+#else
+    return 0;
+#endif
+}
+
+/*
+ * What the benchmark that is running measured, besides the time.  The peak
+ * memory is taken after the measurements, before the analysis of nonius
+ * allocates its own.
+ */
+struct run_metrics
+{
+    std::size_t bytes    = 0;
+    std::size_t nodes    = 0;
+    std::size_t peak_rss = 0;
+};
+
+run_metrics& current_metrics()
+{
+    static auto metrics = run_metrics{};
+    return metrics;
+}
+
+/*
+ * The document for some parameters, and its saved forms, which are only
+ * computed once for all the samples of the benchmarks that need them.
+ * `Traits` provides the `container_t` and `policy_t` types and the `make()`
+ * and `change()` functions that generate the versions.
+ */
+template <class Traits>
+struct fixture
+{
+    using container_t = typename Traits::container_t;
+    using policy_t    = typename Traits::policy_t;
+
+    sweep params;
+    document<container_t> doc;
+    std::size_t nodes = 0;
+    std::optional<std::string> json_;
+    std::optional<immer::persist::binary::buffer> binary_;
+    std::vector<immer::persist::container_id> ids_;
+
+    explicit fixture(sweep p)
+        : params{p}
+    {
+        auto rng   = std::mt19937_64{42};
+        auto value = Traits::make(params.size);
+        for (auto i = std::size_t{}; i < params.roots; ++i) {
+            if (i > 0)
+                value = Traits::change(value, params, rng);
+            doc.versions.push_back({value});
+        }
+        nodes = count_nodes(immer::persist::get_output_pools(doc, policy_t{}));
+    }
+
+    static fixture& get(const nonius::chronometer& meter)
+    {
+        static auto instance = std::optional<fixture>{};
+        const auto p         = sweep::from(meter);
+        if (!instance || !(instance->params == p))
+            instance.emplace(p);
+        return *instance;
+    }
+
+    const std::string& json()
+    {
+        if (!json_)
+            json_ = immer::persist::cereal_save_with_pools(doc, policy_t{});
+        return *json_;
+    }
+
+    const immer::persist::binary::buffer& binary()
+    {
+        if (!binary_) {
+            auto os     = std::ostringstream{};
+            auto writer = immer::persist::binary::writer<container_t>{os};
+            for (const auto& v : doc.versions)
+                ids_.push_back(writer.add(v.value));
+            writer.finish();
+            binary_ = immer::persist::binary::buffer{std::string_view{
+                os.str()}};
+        }
+        return *binary_;
+    }
+
+    const std::vector<immer::persist::container_id>& ids()
+    {
+        binary();
+        return ids_;
+    }
+};
+
+template <class Traits>
+void json_save(nonius::chronometer meter)
+{
+    using policy_t = typename Traits::policy_t;
+    auto& f        = fixture<Traits>::get(meter);
+    current_metrics() = {f.json().size(), f.nodes};
+    meter.measure([&] {
+        return immer::persist::cereal_save_with_pools(f.doc, policy_t{});
+    });
+    current_metrics().peak_rss = peak_rss();
+}
+
+template <class Traits>
+void json_save_streamed(nonius::chronometer meter)
+{
+    using policy_t = typename Traits::policy_t;
+    auto& f        = fixture<Traits>::get(meter);
+    current_metrics() = {f.json().size(), f.nodes};
+    meter.measure([&] {
+        auto os = std::ostringstream{};
+        immer::persist::cereal_save_with_streamed_pools(os, f.doc, policy_t{});
+        return os.tellp();
+    });
+    current_metrics().peak_rss = peak_rss();
+}
+
+template <class Traits>
+void json_load(nonius::chronometer meter)
+{
+    using policy_t   = typename Traits::policy_t;
+    using document_t = document<typename Traits::container_t>;
+    auto& f          = fixture<Traits>::get(meter);
+    const auto& json = f.json();
+    current_metrics() = {json.size(), f.nodes};
+    meter.measure([&] {
+        return immer::persist::cereal_load_with_pools<document_t>(json,
+                                                                  policy_t{});
+    });
+    current_metrics().peak_rss = peak_rss();
+}
+
+template <class Traits>
+void binary_save(nonius::chronometer meter)
+{
+    using container_t = typename Traits::container_t;
+    auto& f           = fixture<Traits>::get(meter);
+    current_metrics() = {f.binary().size(), f.nodes};
+    meter.measure([&] {
+        auto os     = std::ostringstream{};
+        auto writer = immer::persist::binary::writer<container_t>{os};
+        for (const auto& v : f.doc.versions)
+            writer.add(v.value);
+        writer.finish();
+        return os.tellp();
+    });
+    current_metrics().peak_rss = peak_rss();
+}
+
+template <class Traits>
+void binary_load(nonius::chronometer meter)
+{
+    using container_t = typename Traits::container_t;
+    auto& f           = fixture<Traits>::get(meter);
+    const auto bytes  = f.binary().bytes();
+    const auto& ids   = f.ids();
+    current_metrics() = {bytes.size(), f.nodes};
+    meter.measure([&] {
+        auto loader = immer::persist::binary::loader<container_t>{bytes};
+        auto result = std::vector<container_t>{};
+        for (auto id : ids)
+            result.push_back(loader.load(id));
+        return result;
+    });
+    current_metrics().peak_rss = peak_rss();
+}
+
+struct persist_json_reporter : json_reporter
+{
+private:
+    std::string description() override
+    {
+        return "outputs one JSON object per benchmark, with the size, "
+               "throughput, pool nodes and peak memory of persist "
+               "benchmarks";
+    }
+
+    void start() override { current_metrics() = {}; }
+
+    void fields(json_line& line, const analysis_t& analysis) override
+    {
+        const auto& metrics = current_metrics();
+        const auto mean     = analysis.mean.point.count();
+        const auto mbps =
+            mean > 0 ? static_cast<double>(metrics.bytes) / mean / 1e6 : 0.;
+        line.field("bytes", metrics.bytes)
+            .field("mb_per_s", mbps)
+            .field("nodes", metrics.nodes)
+            .field("peak_rss_bytes", metrics.peak_rss);
+    }
+};
+
+NONIUS_REPORTER("persist-json", persist_json_reporter);
+
+} // namespace
@@ -0,0 +1,54 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include "common.hpp"
+
+#include <immer/flex_vector.hpp>
+#include <immer/flex_vector_transient.hpp>
+
+namespace {
+
+struct traits
+{
+    using container_t = immer::flex_vector<std::uint64_t>;
+    using policy_t    = pools_policy<container_t>;
+
+    // Concatenating chunks of uneven sizes produces relaxed nodes.
+    static container_t make(std::size_t n)
+    {
+        auto rng   = std::mt19937_64{7};
+        auto chunk = std::uniform_int_distribution<std::size_t>{1, 1000};
+        auto r     = container_t{};
+        for (auto i = std::size_t{}; i < n;) {
+            auto t   = container_t{}.transient();
+            auto end = std::min(n, i + chunk(rng));
+            for (; i < end; ++i)
+                t.push_back(i);
+            r = std::move(r) + std::move(t).persistent();
+        }
+        return r;
+    }
+
+    template <class Rng>
+    static container_t change(container_t v, const sweep& p, Rng& rng)
+    {
+        auto t     = std::move(v).transient();
+        auto index = std::uniform_int_distribution<std::size_t>{0, p.size - 1};
+        for (auto i = p.changes(); i > 0; --i)
+            t.set(index(rng), rng());
+        return std::move(t).persistent();
+    }
+};
+
+} // namespace
+
+NONIUS_BENCHMARK("json/save", json_save<traits>)
+NONIUS_BENCHMARK("json/save-streamed", json_save_streamed<traits>)
+NONIUS_BENCHMARK("json/load", json_load<traits>)
+NONIUS_BENCHMARK("binary/save", binary_save<traits>)
+NONIUS_BENCHMARK("binary/load", binary_load<traits>)
@@ -0,0 +1,46 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include "common.hpp"
+
+#include <immer/map.hpp>
+#include <immer/map_transient.hpp>
+
+namespace {
+
+struct traits
+{
+    using container_t = immer::map<std::uint64_t, std::uint64_t>;
+    using policy_t    = pools_policy<container_t>;
+
+    static container_t make(std::size_t n)
+    {
+        auto t = container_t{}.transient();
+        for (auto i = std::size_t{}; i < n; ++i)
+            t.set(scramble(i), i);
+        return std::move(t).persistent();
+    }
+
+    template <class Rng>
+    static container_t change(container_t v, const sweep& p, Rng& rng)
+    {
+        auto t     = std::move(v).transient();
+        auto index = std::uniform_int_distribution<std::size_t>{0, p.size - 1};
+        for (auto i = p.changes(); i > 0; --i)
+            t.set(scramble(index(rng)), rng());
+        return std::move(t).persistent();
+    }
+};
+
+} // namespace
+
+NONIUS_BENCHMARK("json/save", json_save<traits>)
+NONIUS_BENCHMARK("json/save-streamed", json_save_streamed<traits>)
+NONIUS_BENCHMARK("json/load", json_load<traits>)
+NONIUS_BENCHMARK("binary/save", binary_save<traits>)
+NONIUS_BENCHMARK("binary/load", binary_load<traits>)
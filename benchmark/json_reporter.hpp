@@ -0,0 +1,95 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include "benchmark/driver.hpp"
+
+#include <nonius.h++>
+
+#include <sstream>
+#include <string>
+
+/*
+ * The nonius reporter of the standalone and persist suites, printing one
+ * JSON object per benchmark and set of parameters, which
+ * `tools/compare-benchmarks.py` compares between runs.  The suite of each
+ * object is the name of the executable, which the build passes in
+ * `IMMER_BENCHMARK_SUITE`.  Suites that measure more than the time derive
+ * from it, resetting their metrics in `start()` and printing them in
+ * `fields()`.
+ */
+
+#ifndef IMMER_BENCHMARK_SUITE
+#error "define the name of the suite in IMMER_BENCHMARK_SUITE"
+#endif
+
+namespace {
+
+struct json_reporter : nonius::reporter
+{
+protected:
+    using analysis_t = nonius::sample_analysis<nonius::fp_seconds>;
+
+    virtual void start() {}
+    virtual void fields(json_line&, const analysis_t&) {}
+
+    std::string current;
+
+private:
+    std::string description() override
+    {
+        return "outputs one JSON object per benchmark, to compare runs with "
+               "tools/compare-benchmarks.py";
+    }
+
+    void do_params_start(const nonius::parameters& params) override
+    {
+        auto os    = std::ostringstream{};
+        auto first = true;
+        os << "{";
+        for (const auto& p : params) {
+            auto v = std::ostringstream{};
+            v << p.second;
+            os << (first ? "" : ", ") << json_quote(p.first) << ": "
+               << v.str();
+            first = false;
+        }
+        os << "}";
+        current_params = os.str();
+    }
+
+    void do_benchmark_start(const std::string& name) override
+    {
+        current = name;
+        start();
+    }
+
+    void do_analysis_complete(const analysis_t& analysis) override
+    {
+        json_line line{report_stream()};
+        line.field("suite", IMMER_BENCHMARK_SUITE)
+            .field("benchmark", current)
+            .raw("params", current_params)
+            .field("samples", analysis.samples.size())
+            .field("mean_s", analysis.mean.point.count())
+            .field("mean_low_s", analysis.mean.lower_bound.count())
+            .field("mean_high_s", analysis.mean.upper_bound.count())
+            .field("stddev_s", analysis.standard_deviation.point.count());
+        fields(line, analysis);
+    }
+
+    void do_benchmark_failure(std::exception_ptr) override
+    {
+        error_stream() << current << " failed to run successfully\n";
+    }
+
+    std::string current_params = "{}";
+};
+
+} // namespace
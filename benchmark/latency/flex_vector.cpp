@@ -0,0 +1,128 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include "latency.hpp"
+
+#include <immer/flex_vector.hpp>
+#include <immer/flex_vector_transient.hpp>
+
+namespace {
+
+template <class Memory>
+using flex_vector_t = immer::flex_vector<unsigned, Memory>;
+
+template <class Memory>
+flex_vector_t<Memory> make(std::size_t n)
+{
+    auto v = flex_vector_t<Memory>{}.transient();
+    for (auto i = 0u; i < n; ++i)
+        v.push_back(i);
+    return v.persistent();
+}
+
+template <class Memory>
+latency_histogram push_front(const latency_config& cfg)
+{
+    return measure_latency(
+        cfg,
+        [&] { return flex_vector_t<Memory>{}; },
+        [&](auto v, auto i) { return std::move(v).push_front(i); });
+}
+
+/*
+ * Moves a random prefix to the back, which keeps the size but makes the
+ * tree more and more relaxed, so that concatenation has to rebalance.
+ */
+template <class Memory>
+latency_histogram rotate(const latency_config& cfg)
+{
+    auto n = std::max(cfg.n, std::size_t{1});
+    return measure_latency(
+        cfg,
+        [&] { return make<Memory>(n); },
+        [&](auto v, auto i) {
+            auto k = scramble(i) % n;
+            return v.drop(k) + v.take(k);
+        });
+}
+
+template <class Memory>
+latency_histogram insert_erase(const latency_config& cfg)
+{
+    auto n = std::max(cfg.n, std::size_t{1});
+    return measure_latency(
+        cfg,
+        [&] { return make<Memory>(n); },
+        [&](auto v, auto i) {
+            auto k = scramble(i) % n;
+            return i % 2 ? std::move(v).erase(k) : std::move(v).insert(k, i);
+        });
+}
+
+template <class Memory>
+latency_histogram update_relaxed(const latency_config& cfg)
+{
+    auto n = std::max(cfg.n, std::size_t{1});
+    return measure_latency(
+        cfg,
+        [&] {
+            auto v = flex_vector_t<Memory>{};
+            for (auto i = 0u; i < n; ++i)
+                v = std::move(v).push_front(i);
+            return v;
+        },
+        [&](auto v, auto i) { return std::move(v).set(scramble(i) % n, i); });
+}
+
+template <class Memory>
+latency_histogram update_history(const latency_config& cfg)
+{
+    auto n = std::max(cfg.n, std::size_t{1});
+    return measure_latency(
+        cfg,
+        [&] { return history<flex_vector_t<Memory>>{make<Memory>(n), 64}; },
+        [&](auto h, auto i) {
+            auto v = h.last().set(scramble(i) % n, i);
+            return std::move(h).push(std::move(v));
+        });
+}
+
+/*
+ * Grows the vector to `N` elements from the front and then drops it as a
+ * whole, which is where freeing the relaxed tree shows.
+ */
+template <class Memory>
+latency_histogram release(const latency_config& cfg)
+{
+    auto n = std::max(cfg.n, std::size_t{1});
+    return measure_latency(
+        cfg,
+        [&] { return flex_vector_t<Memory>{}; },
+        [&](auto v, auto i) {
+            return i % n == n - 1 ? flex_vector_t<Memory>{}
+                                  : std::move(v).push_front(i);
+        });
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    return run_latency(
+        argc,
+        argv,
+        "flex_vector",
+        {
+            IMMER_LATENCY_POLICIES("push_front", push_front),
+            IMMER_LATENCY_POLICIES("rotate", rotate),
+            IMMER_LATENCY_POLICIES("insert_erase", insert_erase),
+            IMMER_LATENCY_POLICIES("update/relaxed", update_relaxed),
+            IMMER_LATENCY_POLICIES("update/history", update_history),
+            IMMER_LATENCY_POLICIES("release", release),
+        });
+}
@@ -0,0 +1,352 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include "benchmark/driver.hpp"
+#include "benchmark/perf_counters.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <regex>
+#include <sstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+/*
+ * Latency benchmarks.  Unlike the nonius benchmarks, which report the mean
+ * time of a batch of operations, these time every operation on its own and
+ * keep the times in a histogram, so that the rare expensive operations show
+ * in the percentiles.  An operation takes the previous version of the state
+ * and returns the new one, and the previous version is destroyed before the
+ * clock stops, so the cost of freeing nodes is charged to the operation
+ * that released them.
+ *
+ * Every timing includes the cost of reading the clock, some tens of
+ * nanoseconds, which is also reported as `clock_ns`.
+ *
+ * With `-c`, the hardware counters of `perf_counters.hpp` are also counted
+ * around all the operations of a workload, and reported per operation.
+ * They include the reading of the clock too.
+ */
+
+namespace {
+
+/*
+ * Histogram of nanoseconds in the style of HdrHistogram: values are
+ * grouped by their highest bit, and every group is split in
+ * `2^(precision_bits - 1)` buckets, so that every value is counted with a
+ * relative error below `2^-(precision_bits - 1)`.
+ */
+class latency_histogram
+{
+public:
+    static constexpr unsigned precision_bits = 8;
+    static constexpr std::uint64_t sub_count = std::uint64_t{1}
+                                               << precision_bits;
+    static constexpr std::uint64_t half_count = sub_count / 2;
+
+    void record(std::uint64_t ns)
+    {
+        auto idx = index(ns);
+        if (idx >= counts_.size())
+            counts_.resize(idx + 1);
+        ++counts_[idx];
+        ++count_;
+        sum_ += ns;
+        max_ = std::max(max_, ns);
+    }
+
+    std::uint64_t count() const { return count_; }
+    std::uint64_t max() const { return max_; }
+    double mean() const { return count_ ? double(sum_) / count_ : 0.; }
+
+    /*
+     * Returns the smallest recorded value, rounded up to its bucket, that is
+     * greater than or equal to `p` percent of the values.
+     */
+    std::uint64_t percentile(double p) const
+    {
+        if (!count_)
+            return 0;
+        auto rank = std::uint64_t(p / 100. * count_ + 0.5);
+        rank      = std::min(std::max(rank, std::uint64_t{1}), count_);
+        auto seen = std::uint64_t{};
+        for (auto i = std::size_t{}; i < counts_.size(); ++i) {
+            seen += counts_[i];
+            if (seen >= rank)
+                return std::min(highest(i), max_);
+        }
+        return max_;
+    }
+
+private:
+    static unsigned msb(std::uint64_t x)
+    {
+        auto r = 0u;
+        while (x >>= 1)
+            ++r;
+        return r;
+    }
+
+    static std::size_t index(std::uint64_t v)
+    {
+        if (v < sub_count)
+            return v;
+        auto shift = msb(v) - (precision_bits - 1);
+        auto sub   = v >> shift;
+        return sub_count + (shift - 1) * half_count + (sub - half_count);
+    }
+
+    static std::uint64_t highest(std::size_t idx)
+    {
+        if (idx < sub_count)
+            return idx;
+        auto shift = (idx - sub_count) / half_count + 1;
+        auto sub   = (idx - sub_count) % half_count + half_count;
+        return ((sub + 1) << shift) - 1;
+    }
+
+    std::vector<std::uint64_t> counts_;
+    std::uint64_t count_ = 0;
+    std::uint64_t sum_   = 0;
+    std::uint64_t max_   = 0;
+};
+
+using latency_clock = std::chrono::steady_clock;
+
+std::uint64_t elapsed_ns(latency_clock::time_point a,
+                         latency_clock::time_point b)
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(b - a).count();
+}
+
+struct latency_config
+{
+    std::size_t n           = 1000;
+    std::size_t ops         = 100000;
+    std::string filter      = ".*";
+    std::string format      = "text";
+    std::string output      = "";
+    std::string suite       = "latency";
+    bool list               = false;
+    perf_counters* counters = nullptr;
+};
+
+/*
+ * Keeps the last `size` versions alive, like an undo history would, so that
+ * every new version drops the oldest one and the nodes only it used.
+ */
+template <typename T>
+struct history
+{
+    std::vector<T> versions;
+    std::size_t next = 0;
+
+    history(T init, std::size_t size)
+        : versions(std::max(size, std::size_t{1}), init)
+    {}
+
+    const T& last() const
+    {
+        return versions[(next + versions.size() - 1) % versions.size()];
+    }
+
+    history push(T v) &&
+    {
+        versions[next] = std::move(v);
+        next           = (next + 1) % versions.size();
+        return std::move(*this);
+    }
+};
+
+/*
+ * Times `cfg.ops` calls of `s = op(std::move(s), i)`, starting from
+ * `s = init()`.
+ */
+template <typename Init, typename Op>
+latency_histogram
+measure_latency(const latency_config& cfg, Init&& init, Op&& op)
+{
+    auto h = latency_histogram{};
+    auto s = init();
+    if (cfg.counters)
+        cfg.counters->start();
+    for (auto i = std::size_t{}; i < cfg.ops; ++i) {
+        auto t0 = latency_clock::now();
+        s       = op(std::move(s), i);
+        auto t1 = latency_clock::now();
+        h.record(elapsed_ns(t0, t1));
+    }
+    if (cfg.counters)
+        cfg.counters->stop();
+    return h;
+}
+
+/*
+ * A workload gets the configuration and returns the histogram of its
+ * operations.
+ */
+using latency_workload =
+    std::pair<std::string,
+              std::function<latency_histogram(const latency_config&)>>;
+
+std::uint64_t clock_cost()
+{
+    auto h = latency_histogram{};
+    for (auto i = 0; i < 10000; ++i) {
+        auto t0 = latency_clock::now();
+        auto t1 = latency_clock::now();
+        h.record(elapsed_ns(t0, t1));
+    }
+    return h.percentile(50);
+}
+
+void report_latency(std::ostream& os,
+                    const latency_config& cfg,
+                    const std::string& name,
+                    const latency_histogram& h,
+                    std::uint64_t clock_ns)
+{
+    static const double percentiles[] = {50, 90, 99, 99.9, 99.99};
+    static const char* labels[]       = {"p50", "p90", "p99", "p999", "p9999"};
+    if (cfg.format == "json") {
+        json_line line{os};
+        line.field("suite", cfg.suite)
+            .field("benchmark", name)
+            .begin("params")
+            .field("N", cfg.n)
+            .field("ops", cfg.ops)
+            .end()
+            .field("samples", h.count())
+            .field("mean_s", h.mean() * 1e-9);
+        for (auto i = 0u; i < 5u; ++i)
+            line.field(std::string{labels[i]} + "_s",
+                       h.percentile(percentiles[i]) * 1e-9);
+        line.field("max_s", h.max() * 1e-9).field("clock_ns", clock_ns);
+        if (cfg.counters && cfg.counters->any_available()) {
+            line.begin("counters");
+            for (auto i = std::size_t{}; i < perf_counters::count; ++i)
+                if (cfg.counters->available(i))
+                    line.field(perf_counters::name(i),
+                               double(cfg.counters->value(i)) / h.count());
+            line.end();
+        }
+    } else {
+        os << std::left << std::setw(32) << name << std::right
+           << std::setprecision(1) << std::fixed << std::setw(10)
+           << h.mean();
+        for (auto i = 0u; i < 5u; ++i)
+            os << std::setw(10) << h.percentile(percentiles[i]);
+        os << std::setw(12) << h.max() << "\n";
+        if (cfg.counters && cfg.counters->any_available()) {
+            os << "    per op:";
+            for (auto i = std::size_t{}; i < perf_counters::count; ++i)
+                if (cfg.counters->available(i))
+                    os << " " << perf_counters::name(i) << "="
+                       << double(cfg.counters->value(i)) / h.count();
+            os << "\n";
+        }
+    }
+}
+
+void latency_usage(const char* name)
+{
+    std::cerr
+        << "usage: " << name << " [options]\n"
+        << "  -p N:<size>     size of the initial containers (1000)\n"
+        << "  -n <ops>        operations timed per workload (100000)\n"
+        << "  -f <regex>      only run the matching workloads\n"
+        << "  -r text|json    output format (text)\n"
+        << "  -o <file>       write the results to a file\n"
+        << "  -c              count hardware events per operation\n"
+        << "  -l              list the workloads\n"
+        << "times are in nanoseconds, and include about clock_ns of "
+           "timing overhead\n";
+}
+
+int run_latency(int argc,
+                char** argv,
+                const std::string& suite,
+                const std::vector<latency_workload>& workloads)
+{
+    auto cfg  = latency_config{};
+    cfg.suite = suite;
+    perf_counters counters;
+    auto args = driver_args{argc, argv, latency_usage};
+    while (args.next()) {
+        auto& arg = args.arg();
+        if (arg == "-p")
+            args.param("N", cfg.n);
+        else if (arg == "-n")
+            cfg.ops = std::stoul(args.value());
+        else if (arg == "-f")
+            cfg.filter = args.value();
+        else if (arg == "-r")
+            cfg.format = args.value();
+        else if (arg == "-o")
+            cfg.output = args.value();
+        else if (arg == "-l")
+            cfg.list = true;
+        else if (arg == "-c")
+            cfg.counters = &counters;
+        else
+            return args.usage();
+    }
+
+    auto filter = std::regex{cfg.filter};
+    if (cfg.list) {
+        for (auto& w : workloads)
+            if (std::regex_search(w.first, filter))
+                std::cout << w.first << "\n";
+        return 0;
+    }
+
+    auto file = std::ofstream{};
+    if (!cfg.output.empty())
+        file.open(cfg.output);
+    auto& os = cfg.output.empty() ? std::cout : file;
+
+    if (cfg.counters && !cfg.counters->any_available())
+        std::cerr << "hardware counters are not available, ignoring -c\n";
+
+    auto clock_ns = clock_cost();
+    if (cfg.format != "json") {
+        os << "N: " << cfg.n << ", ops: " << cfg.ops
+           << ", clock_ns: " << clock_ns << "\n"
+           << std::left << std::setw(32) << "workload" << std::right
+           << std::setw(10) << "mean";
+        for (auto l : {"p50", "p90", "p99", "p999", "p9999"})
+            os << std::setw(10) << l;
+        os << std::setw(12) << "max"
+           << "\n";
+    }
+    for (auto& w : workloads)
+        if (std::regex_search(w.first, filter)) {
+            counters.reset();
+            auto h = w.second(cfg);
+            report_latency(os, cfg, w.first, h, clock_ns);
+        }
+    return 0;
+}
+
+} // namespace
+
+/*
+ * Adds an entry for `fn<Memory>` for every memory policy.
+ */
+#define IMMER_LATENCY_POLICIES(name, fn)                                       \
+    {name "/def", fn<def_memory>}, {name "/basic", fn<basic_memory>},          \
+        {name "/unsafe", fn<unsafe_memory>}
@@ -0,0 +1,126 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include "latency.hpp"
+
+#include <immer/map.hpp>
+#include <immer/map_transient.hpp>
+
+namespace {
+
+template <class Memory>
+using map_t = immer::map<std::uint64_t,
+                         std::uint64_t,
+                         std::hash<std::uint64_t>,
+                         std::equal_to<std::uint64_t>,
+                         Memory>;
+
+template <class Memory>
+map_t<Memory> make(std::size_t n)
+{
+    auto v = map_t<Memory>{}.transient();
+    for (auto i = 0u; i < n; ++i)
+        v.set(scramble(i), i);
+    return v.persistent();
+}
+
+template <class Memory>
+latency_histogram insert(const latency_config& cfg)
+{
+    return measure_latency(
+        cfg,
+        [&] { return map_t<Memory>{}; },
+        [&](auto v, auto i) { return v.set(scramble(i), i); });
+}
+
+template <class Memory>
+latency_histogram insert_move(const latency_config& cfg)
+{
+    return measure_latency(
+        cfg,
+        [&] { return map_t<Memory>{}; },
+        [&](auto v, auto i) { return std::move(v).set(scramble(i), i); });
+}
+
+/*
+ * Erases the oldest key and inserts a new one, so that the map keeps its
+ * `N` elements.
+ */
+template <class Memory>
+latency_histogram window(const latency_config& cfg)
+{
+    auto n = cfg.n;
+    return measure_latency(
+        cfg,
+        [&] { return make<Memory>(n); },
+        [&](auto v, auto i) {
+            return std::move(v).erase(scramble(i)).set(scramble(i + n), i);
+        });
+}
+
+template <class Memory>
+latency_histogram update_move(const latency_config& cfg)
+{
+    auto n = std::max(cfg.n, std::size_t{1});
+    return measure_latency(
+        cfg,
+        [&] { return make<Memory>(n); },
+        [&](auto v, auto i) {
+            return std::move(v).update(scramble(i % n),
+                                       [](auto x) { return x + 1; });
+        });
+}
+
+template <class Memory>
+latency_histogram update_history(const latency_config& cfg)
+{
+    auto n = std::max(cfg.n, std::size_t{1});
+    return measure_latency(
+        cfg,
+        [&] { return history<map_t<Memory>>{make<Memory>(n), 64}; },
+        [&](auto h, auto i) {
+            auto v = h.last().update(scramble(i % n),
+                                     [](auto x) { return x + 1; });
+            return std::move(h).push(std::move(v));
+        });
+}
+
+/*
+ * Grows the map to `N` elements and then drops it as a whole, which is
+ * where freeing the trie shows.
+ */
+template <class Memory>
+latency_histogram release(const latency_config& cfg)
+{
+    auto n = std::max(cfg.n, std::size_t{1});
+    return measure_latency(
+        cfg,
+        [&] { return map_t<Memory>{}; },
+        [&](auto v, auto i) {
+            return i % n == n - 1 ? map_t<Memory>{}
+                                  : std::move(v).set(scramble(i), i);
+        });
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    return run_latency(
+        argc,
+        argv,
+        "map",
+        {
+            IMMER_LATENCY_POLICIES("insert", insert),
+            IMMER_LATENCY_POLICIES("insert/move", insert_move),
+            IMMER_LATENCY_POLICIES("window", window),
+            IMMER_LATENCY_POLICIES("update/move", update_move),
+            IMMER_LATENCY_POLICIES("update/history", update_history),
+            IMMER_LATENCY_POLICIES("release", release),
+        });
+}
@@ -0,0 +1,112 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include "latency.hpp"
+
+#include <immer/vector.hpp>
+#include <immer/vector_transient.hpp>
+
+namespace {
+
+template <class Memory>
+using vector_t = immer::vector<unsigned, Memory>;
+
+template <class Memory>
+vector_t<Memory> make(std::size_t n)
+{
+    auto v = vector_t<Memory>{}.transient();
+    for (auto i = 0u; i < n; ++i)
+        v.push_back(i);
+    return v.persistent();
+}
+
+template <class Memory>
+latency_histogram push_back(const latency_config& cfg)
+{
+    return measure_latency(
+        cfg,
+        [&] { return vector_t<Memory>{}; },
+        [&](auto v, auto i) { return v.push_back(i); });
+}
+
+template <class Memory>
+latency_histogram push_back_move(const latency_config& cfg)
+{
+    return measure_latency(
+        cfg,
+        [&] { return vector_t<Memory>{}; },
+        [&](auto v, auto i) { return std::move(v).push_back(i); });
+}
+
+template <class Memory>
+latency_histogram update(const latency_config& cfg)
+{
+    auto n = cfg.n;
+    return measure_latency(
+        cfg,
+        [&] { return make<Memory>(n); },
+        [&](auto v, auto i) { return v.set(scramble(i) % n, i); });
+}
+
+template <class Memory>
+latency_histogram update_move(const latency_config& cfg)
+{
+    auto n = cfg.n;
+    return measure_latency(
+        cfg,
+        [&] { return make<Memory>(n); },
+        [&](auto v, auto i) { return std::move(v).set(scramble(i) % n, i); });
+}
+
+template <class Memory>
+latency_histogram update_history(const latency_config& cfg)
+{
+    auto n = cfg.n;
+    return measure_latency(
+        cfg,
+        [&] { return history<vector_t<Memory>>{make<Memory>(n), 64}; },
+        [&](auto h, auto i) {
+            auto v = h.last().set(scramble(i) % n, i);
+            return std::move(h).push(std::move(v));
+        });
+}
+
+/*
+ * Grows the vector to `N` elements and then drops it as a whole, which is
+ * where freeing the tree shows.
+ */
+template <class Memory>
+latency_histogram release(const latency_config& cfg)
+{
+    auto n = std::max(cfg.n, std::size_t{1});
+    return measure_latency(
+        cfg,
+        [&] { return vector_t<Memory>{}; },
+        [&](auto v, auto i) {
+            return i % n == n - 1 ? vector_t<Memory>{}
+                                  : std::move(v).push_back(i);
+        });
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    return run_latency(
+        argc,
+        argv,
+        "vector",
+        {
+            IMMER_LATENCY_POLICIES("push_back", push_back),
+            IMMER_LATENCY_POLICIES("push_back/move", push_back_move),
+            IMMER_LATENCY_POLICIES("update", update),
+            IMMER_LATENCY_POLICIES("update/move", update_move),
+            IMMER_LATENCY_POLICIES("update/history", update_history),
+            IMMER_LATENCY_POLICIES("release", release),
+        });
+}
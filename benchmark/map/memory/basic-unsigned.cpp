@@ -0,0 +1,5 @@
+#define IMMER_BENCHMARK_MEMORY_UNSIGNED 1
+
+#include "memory.hpp"
+
+int main() { return main_basic(); }
@@ -0,0 +1,300 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+//
+// These are the map and table counterparts of `benchmark/set/memory`.  As
+// those, they are meant to be run inside valgrind's massif tool.  Every
+// container maps the key to an `unsigned`, or to an entry holding the key
+// and the `unsigned` in the case of `immer::table`, so that the footprint
+// of their layouts can be compared.
+//
+
+#include "benchmark/table/entry.hpp"
+
+#include <immer/map.hpp>
+#include <immer/map_transient.hpp>
+#include <immer/table.hpp>
+#include <immer/table_transient.hpp>
+#include <map>
+#include <unordered_map>
+
+#include <boost/core/demangle.hpp>
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+#include <valgrind/valgrind.h>
+
+struct generate_string_short
+{
+    static constexpr auto char_set =
+        "_-0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+    static constexpr auto max_length = 15;
+    static constexpr auto min_length = 4;
+
+    auto operator()() const
+    {
+        auto engine = std::default_random_engine{42};
+        auto dist   = std::uniform_int_distribution<unsigned>{};
+        auto gen    = std::bind(dist, engine);
+
+        return [=]() mutable {
+            auto len = gen() % (max_length - min_length) + min_length;
+            auto str = std::string(len, ' ');
+            std::generate_n(str.begin(), len, [&] {
+                return char_set[gen() % sizeof(char_set)];
+            });
+            return str;
+        };
+    }
+};
+
+struct generate_string_long
+{
+    static constexpr auto char_set =
+        "_-0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+    static constexpr auto max_length = 256;
+    static constexpr auto min_length = 32;
+
+    auto operator()() const
+    {
+        auto engine = std::default_random_engine{42};
+        auto dist   = std::uniform_int_distribution<unsigned>{};
+        auto gen    = std::bind(dist, engine);
+
+        return [=]() mutable {
+            auto len = gen() % (max_length - min_length) + min_length;
+            auto str = std::string(len, ' ');
+            std::generate_n(str.begin(), len, [&] {
+                return char_set[gen() % sizeof(char_set)];
+            });
+            return str;
+        };
+    }
+};
+
+struct generate_unsigned
+{
+    auto operator()() const
+    {
+        auto engine = std::default_random_engine{42};
+        auto dist   = std::uniform_int_distribution<unsigned>{};
+        auto gen    = std::bind(dist, engine);
+        return gen;
+    }
+};
+
+/*
+ * Inserts the key `k` with value `v` in the immutable map or table `m`.
+ */
+template <typename K,
+          typename T,
+          typename Hash,
+          typename Equal,
+          typename MP,
+          immer::detail::hamts::bits_t B>
+auto insert(immer::map<K, T, Hash, Equal, MP, B> m, K k, unsigned v)
+{
+    return std::move(m).set(std::move(k), v);
+}
+
+template <typename T,
+          typename KeyFn,
+          typename Hash,
+          typename Equal,
+          typename MP,
+          immer::detail::hamts::bits_t B,
+          typename K>
+auto insert(immer::table<T, KeyFn, Hash, Equal, MP, B> m, K k, unsigned v)
+{
+    return std::move(m).insert({std::move(k), v});
+}
+
+namespace basic_params {
+constexpr auto N = 1 << 20;
+
+void take_snapshot(std::size_t i)
+{
+    std::cerr << "  snapshot " << i << " / " << N << std::endl;
+}
+} // namespace basic_params
+
+template <typename Generator, typename Map>
+auto benchmark_memory_basic_std()
+{
+    using namespace basic_params;
+
+    std::cerr << "running... " << boost::core::demangle(typeid(Map).name())
+              << std::endl;
+
+    auto g = Generator{}();
+    auto v = Map{};
+
+    take_snapshot(0);
+    for (auto i = 0u; i < N; ++i) {
+        v.insert({g(), i});
+    }
+    take_snapshot(N);
+
+    volatile auto dont_optimize_ = v.size();
+    return dont_optimize_;
+}
+
+template <typename Generator, typename Map>
+auto benchmark_memory_basic()
+{
+    using namespace basic_params;
+
+    std::cerr << "running... " << boost::core::demangle(typeid(Map).name())
+              << std::endl;
+
+    auto g = Generator{}();
+    auto v = Map{};
+
+    take_snapshot(0);
+    for (auto i = 0u; i < N; ++i) {
+        v = insert(std::move(v), g(), i);
+    }
+    take_snapshot(N);
+
+    volatile auto dont_optimize_ = v.size();
+    return dont_optimize_;
+}
+
+namespace exp_params {
+constexpr auto N = 1 << 20;
+constexpr auto E = 2;
+
+void take_snapshot(std::size_t i)
+{
+    std::cerr << "  snapshot " << i << " / " << N << std::endl;
+}
+} // namespace exp_params
+
+template <typename Generator, typename Map>
+auto benchmark_memory_exp_std()
+{
+    using namespace exp_params;
+
+    std::cerr << "running... " << boost::core::demangle(typeid(Map).name())
+              << std::endl;
+
+    auto rs = std::vector<Map>{};
+    auto g  = Generator{}();
+    auto v  = Map{};
+
+    take_snapshot(0);
+    for (auto i = 0u, n = 1u; i < N; ++i) {
+        if (i == n) {
+            rs.push_back(v);
+            n *= E;
+            take_snapshot(i);
+        }
+        v.insert({g(), i});
+    }
+    take_snapshot(N);
+
+    volatile auto dont_optimize_ = rs.data();
+    return dont_optimize_;
+}
+
+template <typename Generator, typename Map>
+auto benchmark_memory_exp()
+{
+    using namespace exp_params;
+
+    std::cerr << "running... " << boost::core::demangle(typeid(Map).name())
+              << std::endl;
+
+    auto rs = std::vector<Map>{};
+    auto g  = Generator{}();
+    auto v  = Map{};
+
+    take_snapshot(0);
+    for (auto i = 0u, n = 1u; i < N; ++i) {
+        if (i == n) {
+            rs.push_back(v);
+            n *= E;
+            take_snapshot(i);
+        }
+        v = insert(std::move(v), g(), i);
+    }
+    take_snapshot(N);
+
+    volatile auto dont_optimize_ = rs.data();
+    return dont_optimize_;
+}
+
+#if IMMER_BENCHMARK_MEMORY_STRING_SHORT
+using generator__ = generate_string_short;
+using t__         = std::string;
+#elif IMMER_BENCHMARK_MEMORY_STRING_LONG
+using generator__ = generate_string_long;
+using t__         = std::string;
+#elif IMMER_BENCHMARK_MEMORY_UNSIGNED
+using generator__ = generate_unsigned;
+using t__         = unsigned;
+#else
+#error "choose some type!"
+#endif
+
+using def_memory = immer::default_memory_policy;
+
+template <immer::detail::hamts::bits_t B>
+using map_t = immer::
+    map<t__, unsigned, std::hash<t__>, std::equal_to<t__>, def_memory, B>;
+
+template <immer::detail::hamts::bits_t B>
+using table_t = immer::table<table_entry<t__>,
+                             immer::table_key_fn,
+                             std::hash<t__>,
+                             std::equal_to<t__>,
+                             def_memory,
+                             B>;
+
+int main_basic()
+{
+    benchmark_memory_basic_std<generator__, std::map<t__, unsigned>>();
+    benchmark_memory_basic_std<generator__,
+                               std::unordered_map<t__, unsigned>>();
+
+    benchmark_memory_basic<generator__, map_t<3>>();
+    benchmark_memory_basic<generator__, map_t<4>>();
+    benchmark_memory_basic<generator__, map_t<5>>();
+    benchmark_memory_basic<generator__, map_t<6>>();
+
+    benchmark_memory_basic<generator__, table_t<3>>();
+    benchmark_memory_basic<generator__, table_t<4>>();
+    benchmark_memory_basic<generator__, table_t<5>>();
+    benchmark_memory_basic<generator__, table_t<6>>();
+
+    return 0;
+}
+
+int main_exp()
+{
+    benchmark_memory_exp_std<generator__, std::map<t__, unsigned>>();
+    benchmark_memory_exp_std<generator__, std::unordered_map<t__, unsigned>>();
+
+    benchmark_memory_exp<generator__, map_t<3>>();
+    benchmark_memory_exp<generator__, map_t<4>>();
+    benchmark_memory_exp<generator__, map_t<5>>();
+    benchmark_memory_exp<generator__, map_t<6>>();
+
+    benchmark_memory_exp<generator__, table_t<3>>();
+    benchmark_memory_exp<generator__, table_t<4>>();
+    benchmark_memory_exp<generator__, table_t<5>>();
+    benchmark_memory_exp<generator__, table_t<6>>();
+
+    return 0;
+}
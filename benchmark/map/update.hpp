@@ -0,0 +1,133 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include "benchmark/config.hpp"
+
+#include <boost/container/flat_map.hpp>
+#include <immer/map.hpp>
+#include <immer/map_transient.hpp>
+#include <map>
+#include <unordered_map>
+
+namespace {
+
+template <typename Generator, typename Map>
+auto benchmark_update_mut_std()
+{
+    return [](nonius::chronometer meter) {
+        auto n  = meter.param<N>();
+        auto g  = Generator{}(n);
+        auto v_ = [&] {
+            auto v = Map{};
+            for (auto i = 0u; i < n; ++i)
+                v.insert(typename Map::value_type{g[i], i});
+            return v;
+        }();
+        measure(meter, [&] {
+            auto v = v_;
+            for (auto i = 0u; i < n; ++i)
+                ++v[g[i]];
+            return v;
+        });
+    };
+}
+
+template <typename Generator, typename Map>
+auto benchmark_update()
+{
+    return [](nonius::chronometer meter) {
+        auto n  = meter.param<N>();
+        auto g  = Generator{}(n);
+        auto v_ = [&] {
+            auto v = Map{}.transient();
+            for (auto i = 0u; i < n; ++i)
+                v.set(g[i], i);
+            return v.persistent();
+        }();
+        measure(meter, [&] {
+            auto v = v_;
+            for (auto i = 0u; i < n; ++i)
+                v = v.update(g[i], [](auto x) { return x + 1; });
+            return v;
+        });
+    };
+}
+
+template <typename Generator, typename Map>
+auto benchmark_update_move()
+{
+    return [](nonius::chronometer meter) {
+        auto n  = meter.param<N>();
+        auto g  = Generator{}(n);
+        auto v_ = [&] {
+            auto v = Map{}.transient();
+            for (auto i = 0u; i < n; ++i)
+                v.set(g[i], i);
+            return v.persistent();
+        }();
+        measure(meter, [&] {
+            auto v = v_;
+            for (auto i = 0u; i < n; ++i)
+                v = std::move(v).update(g[i], [](auto x) { return x + 1; });
+            return v;
+        });
+    };
+}
+
+template <typename Generator, typename Map>
+auto benchmark_update_tran()
+{
+    return [](nonius::chronometer meter) {
+        auto n  = meter.param<N>();
+        auto g  = Generator{}(n);
+        auto v_ = [&] {
+            auto v = Map{}.transient();
+            for (auto i = 0u; i < n; ++i)
+                v.set(g[i], i);
+            return v.persistent();
+        }();
+        measure(meter, [&] {
+            auto v = v_.transient();
+            for (auto i = 0u; i < n; ++i)
+                v.update(g[i], [](auto x) { return x + 1; });
+            return v.persistent();
+        });
+    };
+}
+
+/*
+ * Calls `update_if_exists` with keys that are in the map when `Hit` is
+ * true, and with keys that are not otherwise.  A miss should leave the map
+ * untouched and not allocate.
+ */
+template <typename Generator, typename Map, bool Hit>
+auto benchmark_update_if_exists_move()
+{
+    return [](nonius::chronometer meter) {
+        auto n  = meter.param<N>();
+        auto g  = Generator{}(n * 2);
+        auto k  = Hit ? 0u : n;
+        auto v_ = [&] {
+            auto v = Map{}.transient();
+            for (auto i = 0u; i < n; ++i)
+                v.set(g[i], i);
+            return v.persistent();
+        }();
+        measure(meter, [&] {
+            auto v = v_;
+            for (auto i = 0u; i < n; ++i)
+                v = std::move(v).update_if_exists(
+                    g[k + i], [](auto x) { return x + 1; });
+            return v;
+        });
+    };
+}
+
+} // namespace
@@ -0,0 +1,217 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define IMMER_BENCHMARK_HAS_PERF_EVENTS 1
+#else
+#define IMMER_BENCHMARK_HAS_PERF_EVENTS 0
+#endif
+
+/*
+ * Hardware performance counters, read with Linux' `perf_event_open`.  Only
+ * user space is counted, so that they work with the default
+ * `kernel.perf_event_paranoid` setting.  Every counter is opened on its own,
+ * and the ones that can not be opened, because the machine has no such
+ * event, because the process is not allowed to, or because this is not
+ * Linux, are reported as unavailable and skipped.  When there are more
+ * counters than the CPU can hold, the kernel multiplexes them and the values
+ * are scaled to the time they were enabled.
+ *
+ * Threads started while counting are counted too, but the kernel only adds
+ * the events of a child thread to the counter when that thread exits.  The
+ * threads of a measurement must thus be joined before `stop()`, and threads
+ * that outlive it are not counted at all.
+ *
+ * Setting `IMMER_BENCHMARK_COUNTERS=0` in the environment disables them.
+ */
+
+namespace {
+
+class perf_counters
+{
+public:
+    static constexpr std::size_t count = 7;
+
+    static const char* name(std::size_t i)
+    {
+        static const char* names[count] = {"cycles",
+                                           "instructions",
+                                           "branch_misses",
+                                           "l1d_misses",
+                                           "llc_misses",
+                                           "dtlb_misses",
+                                           "cache_references"};
+        return names[i];
+    }
+
+    perf_counters()
+    {
+        fds_.fill(-1);
+        values_.fill(0);
+#if IMMER_BENCHMARK_HAS_PERF_EVENTS
+        auto env = std::getenv("IMMER_BENCHMARK_COUNTERS");
+        if (env && std::string{env} == "0")
+            return;
+        for (auto i = std::size_t{}; i < count; ++i)
+            fds_[i] = open(i);
+#endif
+    }
+
+    ~perf_counters()
+    {
+#if IMMER_BENCHMARK_HAS_PERF_EVENTS
+        for (auto fd : fds_)
+            if (fd >= 0)
+                ::close(fd);
+#endif
+    }
+
+    perf_counters(const perf_counters&)            = delete;
+    perf_counters& operator=(const perf_counters&) = delete;
+
+    bool available(std::size_t i) const { return fds_[i] >= 0; }
+
+    bool any_available() const
+    {
+        for (auto i = std::size_t{}; i < count; ++i)
+            if (available(i))
+                return true;
+        return false;
+    }
+
+    /*
+     * Starts counting, from where the last `stop()` left.
+     */
+    void start()
+    {
+#if IMMER_BENCHMARK_HAS_PERF_EVENTS
+        for (auto i = std::size_t{}; i < count; ++i)
+            if (fds_[i] >= 0) {
+                read(i, start_[i]);
+                ::ioctl(fds_[i], PERF_EVENT_IOC_ENABLE, 0);
+            }
+#endif
+    }
+
+    /*
+     * Stops counting and adds the events since `start()` to the totals.
+     */
+    void stop()
+    {
+#if IMMER_BENCHMARK_HAS_PERF_EVENTS
+        for (auto i = std::size_t{}; i < count; ++i)
+            if (fds_[i] >= 0) {
+                ::ioctl(fds_[i], PERF_EVENT_IOC_DISABLE, 0);
+                auto end = reading{};
+                read(i, end);
+                auto enabled = end.enabled - start_[i].enabled;
+                auto running = end.running - start_[i].running;
+                auto value   = end.value - start_[i].value;
+                if (running && running < enabled)
+                    value = std::uint64_t(double(value) * enabled / running);
+                values_[i] += value;
+            }
+#endif
+    }
+
+    void reset() { values_.fill(0); }
+
+    std::uint64_t value(std::size_t i) const { return values_[i]; }
+
+private:
+    struct reading
+    {
+        std::uint64_t value   = 0;
+        std::uint64_t enabled = 0;
+        std::uint64_t running = 0;
+    };
+
+#if IMMER_BENCHMARK_HAS_PERF_EVENTS
+    static int open(std::size_t i)
+    {
+        auto cache = [](std::uint64_t id, std::uint64_t op, std::uint64_t r) {
+            return id | (op << 8) | (r << 16);
+        };
+        auto attr = perf_event_attr{};
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size           = sizeof(attr);
+        attr.disabled       = 1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv     = 1;
+        attr.inherit        = 1;
+        attr.read_format =
+            PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        switch (i) {
+        case 0:
+            attr.type   = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CPU_CYCLES;
+            break;
+        case 1:
+            attr.type   = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_INSTRUCTIONS;
+            break;
+        case 2:
+            attr.type   = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_BRANCH_MISSES;
+            break;
+        case 3:
+            attr.type   = PERF_TYPE_HW_CACHE;
+            attr.config = cache(PERF_COUNT_HW_CACHE_L1D,
+                                PERF_COUNT_HW_CACHE_OP_READ,
+                                PERF_COUNT_HW_CACHE_RESULT_MISS);
+            break;
+        case 4:
+            attr.type   = PERF_TYPE_HW_CACHE;
+            attr.config = cache(PERF_COUNT_HW_CACHE_LL,
+                                PERF_COUNT_HW_CACHE_OP_READ,
+                                PERF_COUNT_HW_CACHE_RESULT_MISS);
+            break;
+        case 5:
+            attr.type   = PERF_TYPE_HW_CACHE;
+            attr.config = cache(PERF_COUNT_HW_CACHE_DTLB,
+                                PERF_COUNT_HW_CACHE_OP_READ,
+                                PERF_COUNT_HW_CACHE_RESULT_MISS);
+            break;
+        default:
+            attr.type   = PERF_TYPE_HARDWARE;
+            attr.config = PERF_COUNT_HW_CACHE_REFERENCES;
+            break;
+        }
+        return static_cast<int>(
+            ::syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0));
+    }
+
+    void read(std::size_t i, reading& r) const
+    {
+        std::uint64_t buf[3] = {};
+        if (::read(fds_[i], buf, sizeof(buf)) == sizeof(buf)) {
+            r.value   = buf[0];
+            r.enabled = buf[1];
+            r.running = buf[2];
+        }
+    }
+#endif
+
+    std::array<int, count> fds_;
+    std::array<std::uint64_t, count> values_;
+    std::array<reading, count> start_;
+};
+
+} // namespace
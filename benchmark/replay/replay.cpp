@@ -0,0 +1,416 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include "trace.hpp"
+
+#include <immer/algorithm.hpp>
+#include <immer/box.hpp>
+#include <immer/flex_vector.hpp>
+#include <immer/heap/stats_heap.hpp>
+#include <immer/map.hpp>
+
+#include <algorithm>
+#include <chrono>
+#include <fstream>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <regex>
+#include <type_traits>
+#include <utility>
+
+/*
+ * Replays traces of updates to an application state, see `trace.hpp`,
+ * against several combinations of containers and memory policies.  The
+ * state is a `map<std::string, E>` of entities, where `E` is a small
+ * record or a `box` of it, and a `flex_vector` of events.  Retained
+ * snapshots are copies of the whole state.
+ *
+ * Every operation is timed on its own, and the report gives the
+ * throughput and the mean time of every kind of operation, which includes
+ * reading the clock.  The memory used by the nodes is counted with a
+ * `stats_heap` under the memory policy, so it is what the policy takes
+ * from the system, and it is reported for the first replay only, since
+ * the later ones reuse the nodes kept in the free lists.
+ */
+
+namespace {
+
+/*
+ * Every configuration allocates through its own heap, so that the free
+ * lists of one do not serve the nodes of another.
+ */
+template <int Tag>
+struct replay_heap : immer::cpp_heap
+{};
+
+template <int Tag>
+using counted_heap = immer::stats_heap<replay_heap<Tag>>;
+
+/*
+ * The `def` configurations use the same heap as the default memory policy,
+ * a free list, but on top of the counted heap.
+ */
+template <int Tag, template <typename> class Memory, bool Boxed>
+struct config
+{
+    using heap                  = counted_heap<Tag>;
+    using memory                = Memory<heap>;
+    static constexpr bool boxed = Boxed;
+};
+
+struct record
+{
+    std::int64_t value;
+    std::uint64_t revision;
+};
+
+bool operator==(const record& a, const record& b)
+{
+    return a.value == b.value && a.revision == b.revision;
+}
+
+bool operator!=(const record& a, const record& b) { return !(a == b); }
+
+std::int64_t value_of(const record& r) { return r.value; }
+
+template <typename Memory>
+std::int64_t value_of(const immer::box<record, Memory>& b)
+{
+    return b->value;
+}
+
+record updated(const record& r, std::int64_t v) { return {v, r.revision + 1}; }
+
+template <typename Memory>
+immer::box<record, Memory> updated(const immer::box<record, Memory>& b,
+                                   std::int64_t v)
+{
+    return b.update([&](const record& r) { return updated(r, v); });
+}
+
+template <typename Memory, bool Boxed>
+struct store
+{
+    using entity_t =
+        std::conditional_t<Boxed, immer::box<record, Memory>, record>;
+    using entities_t = immer::map<std::string,
+                                  entity_t,
+                                  std::hash<std::string>,
+                                  std::equal_to<std::string>,
+                                  Memory>;
+    using log_t      = immer::flex_vector<std::int64_t, Memory>;
+
+    entities_t entities;
+    log_t log;
+};
+
+/*
+ * Applies an operation, adding what it reads to `check` so that it is not
+ * optimized away.
+ */
+template <typename Store>
+void apply(Store& s,
+           std::vector<Store>& snapshots,
+           const trace& t,
+           const trace_op& op,
+           std::uint64_t& check)
+{
+    using entity_t = typename Store::entity_t;
+    switch (op.kind) {
+    case op_kind::insert:
+        s.entities = std::move(s.entities)
+                         .set(t.keys[op.key], entity_t{record{op.a, 0}});
+        break;
+    case op_kind::update:
+        s.entities =
+            std::move(s.entities)
+                .update_if_exists(t.keys[op.key], [&](const entity_t& e) {
+                    return updated(e, op.a);
+                });
+        break;
+    case op_kind::erase:
+        s.entities = std::move(s.entities).erase(t.keys[op.key]);
+        break;
+    case op_kind::read:
+        if (auto p = s.entities.find(t.keys[op.key]))
+            check += value_of(*p);
+        break;
+    case op_kind::push:
+        s.log = std::move(s.log).push_back(op.a);
+        break;
+    case op_kind::slice: {
+        auto to   = std::min(std::size_t(op.b), s.log.size());
+        auto from = std::min(std::size_t(op.a), to);
+        s.log     = std::move(s.log).take(to).drop(from);
+        break;
+    }
+    case op_kind::concat:
+        s.log = std::move(s.log) + snapshots[op.a].log;
+        break;
+    case op_kind::diff: {
+        auto count = [&](auto&&...) { ++check; };
+        immer::diff(snapshots[op.a].entities,
+                    s.entities,
+                    immer::make_differ(count, count, count));
+        break;
+    }
+    case op_kind::snapshot:
+        snapshots[op.a] = s;
+        break;
+    case op_kind::release:
+        snapshots[op.a] = Store{};
+        break;
+    default:
+        break;
+    }
+}
+
+constexpr auto op_count = std::size_t(op_kind::count);
+
+struct replay_result
+{
+    double seconds                 = 0;
+    double by_op_seconds[op_count] = {};
+    std::size_t by_op[op_count]    = {};
+    std::size_t allocations        = 0;
+    std::size_t bytes_allocated    = 0;
+    std::int64_t peak_bytes        = 0;
+    std::int64_t final_bytes       = 0;
+    std::uint64_t check            = 0;
+};
+
+using replay_clock = std::chrono::steady_clock;
+
+template <typename Config>
+replay_result replay(const trace& t)
+{
+    using heap    = typename Config::heap;
+    using store_t = store<typename Config::memory, Config::boxed>;
+
+    auto r    = replay_result{};
+    auto base = heap::stats();
+    auto live = [&] {
+        auto s = heap::stats();
+        return std::int64_t(s.bytes_allocated - base.bytes_allocated) -
+               std::int64_t(s.bytes_deallocated - base.bytes_deallocated);
+    };
+
+    auto s         = store_t{};
+    auto snapshots = std::vector<store_t>(t.snapshots);
+    for (auto& op : t.ops) {
+        auto t0 = replay_clock::now();
+        apply(s, snapshots, t, op, r.check);
+        auto t1 = replay_clock::now();
+        auto k  = std::size_t(op.kind);
+        r.by_op_seconds[k] += std::chrono::duration<double>(t1 - t0).count();
+        r.by_op[k] += 1;
+        r.peak_bytes = std::max(r.peak_bytes, live());
+    }
+    for (auto k = std::size_t{}; k < op_count; ++k)
+        r.seconds += r.by_op_seconds[k];
+
+    auto end          = heap::stats();
+    r.allocations     = end.allocations - base.allocations;
+    r.bytes_allocated = end.bytes_allocated - base.bytes_allocated;
+    r.final_bytes     = live();
+    return r;
+}
+
+using replay_config =
+    std::pair<std::string, std::function<replay_result(const trace&)>>;
+
+struct replay_options
+{
+    unsigned samples     = 3;
+    std::string filter   = ".*";
+    std::string format   = "text";
+    std::string output   = "";
+    bool list            = false;
+    std::size_t generate = 0;
+    std::size_t keys     = 10000;
+};
+
+/*
+ * Reports the mean of the samples, with the memory of the first one.
+ */
+void report_replay(std::ostream& os,
+                   const replay_options& opts,
+                   const std::string& name,
+                   const trace& t,
+                   const std::vector<replay_result>& rs)
+{
+    auto n       = double(std::max(t.ops.size(), std::size_t{1}));
+    auto samples = std::vector<double>{};
+    for (auto& r : rs)
+        samples.push_back(r.seconds / n);
+    auto stats = summarize(samples);
+    auto mean  = stats.mean;
+    auto by_op = [&](std::size_t k) {
+        auto s = 0.;
+        for (auto& r : rs)
+            s += r.by_op_seconds[k] / rs.size();
+        return rs.front().by_op[k] ? s / rs.front().by_op[k] : 0.;
+    };
+    auto& first = rs.front();
+    if (opts.format == "json") {
+        json_line line{os};
+        line.field("suite", "replay")
+            .field("benchmark", name)
+            .begin("params")
+            .field("ops", t.ops.size())
+            .end()
+            .field("samples", rs.size())
+            .field("mean_s", mean)
+            .field("mean_low_s", stats.low)
+            .field("mean_high_s", stats.high)
+            .field("ops_per_s", 1. / mean)
+            .field("allocations", first.allocations)
+            .field("bytes_allocated", first.bytes_allocated)
+            .field("peak_bytes", first.peak_bytes)
+            .field("final_bytes", first.final_bytes)
+            .begin("by_op");
+        for (auto k = std::size_t{}; k < op_count; ++k)
+            if (first.by_op[k])
+                line.begin(op_names[k])
+                    .field("count", first.by_op[k])
+                    .field("mean_s", by_op(k))
+                    .end();
+        line.end();
+    } else {
+        os << std::left << std::setw(32) << name << std::right
+           << std::setprecision(2) << std::fixed << std::setw(10)
+           << 1e-6 / mean << std::setw(10) << mean * 1e9 << std::setw(10)
+           << first.allocations / n << std::setw(12)
+           << first.peak_bytes / 1024. << std::setw(12)
+           << first.final_bytes / 1024. << "\n";
+        for (auto k = std::size_t{}; k < op_count; ++k)
+            if (first.by_op[k])
+                os << "    " << std::left << std::setw(10) << op_names[k]
+                   << std::right << std::setw(10) << first.by_op[k]
+                   << " ops" << std::setw(10) << by_op(k) * 1e9
+                   << " ns/op\n";
+    }
+}
+
+void replay_usage(const char* name)
+{
+    std::cerr
+        << "usage: " << name << " [options] <trace>...\n"
+        << "       " << name << " -g <ops> [-k <keys>] [-o <file>]\n"
+        << "  -s <samples>    replays of every trace (3)\n"
+        << "  -f <regex>      only run the matching configurations\n"
+        << "  -r text|json    output format (text)\n"
+        << "  -o <file>       write the results to a file\n"
+        << "  -l              list the configurations\n"
+        << "  -g <ops>        write a synthetic trace instead\n"
+        << "  -k <keys>       entities in the synthetic trace (10000)\n"
+        << "the text output has the throughput in Mops/s, ns/op, "
+           "allocations per op, and the peak\nand final memory in KiB\n";
+}
+
+std::string trace_name(const std::string& path)
+{
+    auto begin = path.find_last_of('/');
+    begin      = begin == std::string::npos ? 0 : begin + 1;
+    auto end   = path.find('.', begin);
+    return path.substr(begin, end == std::string::npos ? end : end - begin);
+}
+
+} // namespace
+
+int main(int argc, char** argv)
+{
+    // clang-format off
+    auto configs = std::vector<replay_config>{
+        {"map/def",        replay<config<0, safe_memory_t,   false>>},
+        {"map/basic",      replay<config<1, basic_memory_t,  false>>},
+        {"map/unsafe",     replay<config<2, unsafe_memory_t, false>>},
+        {"map-box/def",    replay<config<3, safe_memory_t,   true>>},
+        {"map-box/basic",  replay<config<4, basic_memory_t,  true>>},
+        {"map-box/unsafe", replay<config<5, unsafe_memory_t, true>>},
+    };
+    // clang-format on
+
+    auto opts   = replay_options{};
+    auto traces = std::vector<std::string>{};
+    auto args   = driver_args{argc, argv, replay_usage};
+    while (args.next()) {
+        auto& arg = args.arg();
+        if (arg == "-s")
+            opts.samples = std::stoul(args.value());
+        else if (arg == "-f")
+            opts.filter = args.value();
+        else if (arg == "-r")
+            opts.format = args.value();
+        else if (arg == "-o")
+            opts.output = args.value();
+        else if (arg == "-l")
+            opts.list = true;
+        else if (arg == "-g")
+            opts.generate = std::stoul(args.value());
+        else if (arg == "-k")
+            opts.keys = std::stoul(args.value());
+        else if (arg.empty() || arg[0] == '-')
+            return args.usage();
+        else
+            traces.push_back(arg);
+    }
+
+    auto file = std::ofstream{};
+    if (!opts.output.empty())
+        file.open(opts.output);
+    auto& os = opts.output.empty() ? std::cout : file;
+
+    if (opts.generate) {
+        generate_trace(os, opts.generate, std::max(opts.keys, std::size_t{1}));
+        return 0;
+    }
+
+    auto filter = std::regex{opts.filter};
+    if (opts.list) {
+        for (auto& c : configs)
+            if (std::regex_search(c.first, filter))
+                std::cout << c.first << "\n";
+        return 0;
+    }
+    if (traces.empty()) {
+        replay_usage(argv[0]);
+        return 1;
+    }
+
+    if (opts.format != "json")
+        os << std::left << std::setw(32) << "trace/config" << std::right
+           << std::setw(10) << "Mops/s" << std::setw(10) << "ns/op"
+           << std::setw(10) << "allocs" << std::setw(12) << "peak"
+           << std::setw(12) << "final"
+           << "\n";
+    for (auto& path : traces) {
+        auto t  = trace{};
+        auto is = std::ifstream{path};
+        if (!is) {
+            std::cerr << path << ": can not open the trace\n";
+            return 1;
+        }
+        try {
+            t = read_trace(is);
+        } catch (const std::exception& err) {
+            std::cerr << path << ": " << err.what() << "\n";
+            return 1;
+        }
+        for (auto& c : configs)
+            if (std::regex_search(c.first, filter)) {
+                auto rs = std::vector<replay_result>{};
+                for (auto i = 0u; i < std::max(opts.samples, 1u); ++i)
+                    rs.push_back(c.second(t));
+                auto name = trace_name(path) + "/" + c.first;
+                report_replay(os, opts, name, t, rs);
+            }
+    }
+    return 0;
+}
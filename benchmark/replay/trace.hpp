@@ -0,0 +1,205 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include "benchmark/driver.hpp"
+
+#include <algorithm>
+#include <cstdint>
+#include <istream>
+#include <ostream>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+/*
+ * Traces of updates to an application state, in the style of a redux
+ * store: a map of entities by key and a log of events.  A trace is a text
+ * file with one operation per line, and `#` starting a comment:
+ *
+ *     insert <key> <value>     add or replace the entity <key>
+ *     update <key> <value>     change the entity <key>, if it exists
+ *     erase <key>              remove the entity <key>
+ *     read <key>               look up the entity <key>
+ *     push <value>             append an event to the log
+ *     slice <from> <to>        keep the events in [from, to) of the log
+ *     concat <id>              append the log of snapshot <id>
+ *     diff <id>                compare the entities with snapshot <id>
+ *     snapshot <id>            keep the current state as snapshot <id>
+ *     release <id>             drop snapshot <id>
+ *
+ * Keys are any word, so real traces can be anonymized by renaming them,
+ * values are integers, and snapshots are numbered from 0.  Replacing a
+ * snapshot releases the previous one with the same number.
+ */
+
+namespace {
+
+enum class op_kind
+{
+    insert,
+    update,
+    erase,
+    read,
+    push,
+    slice,
+    concat,
+    diff,
+    snapshot,
+    release,
+    count
+};
+
+const char* op_names[] = {"insert",
+                          "update",
+                          "erase",
+                          "read",
+                          "push",
+                          "slice",
+                          "concat",
+                          "diff",
+                          "snapshot",
+                          "release"};
+
+struct trace_op
+{
+    op_kind kind;
+    std::uint32_t key;
+    std::int64_t a;
+    std::int64_t b;
+};
+
+/*
+ * A parsed trace, where the keys are stored once and referred to by their
+ * index, so that parsing is not part of the replay.
+ */
+struct trace
+{
+    std::vector<std::string> keys;
+    std::vector<trace_op> ops;
+    std::size_t snapshots = 0;
+};
+
+trace read_trace(std::istream& is)
+{
+    auto t      = trace{};
+    auto index  = std::unordered_map<std::string, std::uint32_t>{};
+    auto line   = std::string{};
+    auto lineno = std::size_t{};
+    auto key    = [&](std::istream& s) {
+        auto k = std::string{};
+        s >> k;
+        auto it = index.find(k);
+        if (it != index.end())
+            return it->second;
+        auto i = static_cast<std::uint32_t>(t.keys.size());
+        t.keys.push_back(k);
+        index.emplace(std::move(k), i);
+        return i;
+    };
+    while (std::getline(is, line)) {
+        ++lineno;
+        auto s    = std::istringstream{line.substr(0, line.find('#'))};
+        auto name = std::string{};
+        if (!(s >> name))
+            continue;
+        auto op = trace_op{op_kind::count, 0, 0, 0};
+        for (auto i = 0u; i < unsigned(op_kind::count); ++i)
+            if (name == op_names[i])
+                op.kind = op_kind(i);
+        switch (op.kind) {
+        case op_kind::insert:
+        case op_kind::update:
+            op.key = key(s);
+            s >> op.a;
+            break;
+        case op_kind::erase:
+        case op_kind::read:
+            op.key = key(s);
+            break;
+        case op_kind::slice:
+            s >> op.a >> op.b;
+            break;
+        case op_kind::push:
+        case op_kind::concat:
+        case op_kind::diff:
+        case op_kind::snapshot:
+        case op_kind::release:
+            s >> op.a;
+            break;
+        default:
+            throw std::runtime_error{"line " + std::to_string(lineno) +
+                                     ": unknown operation " + name};
+        }
+        if (!s || op.a < 0 || op.b < 0)
+            throw std::runtime_error{"line " + std::to_string(lineno) +
+                                     ": bad arguments to " + name};
+        if (op.kind >= op_kind::concat)
+            t.snapshots = std::max(t.snapshots, std::size_t(op.a) + 1);
+        t.ops.push_back(op);
+    }
+    return t;
+}
+
+/*
+ * Writes a synthetic trace of `n` operations over `keys` entities: mostly
+ * reads, updates of a few hot entities and events, with a snapshot kept
+ * every few operations, like an undo history of 64 versions, and the
+ * occasional diff against an older version, as a view would do to find
+ * what to render.
+ */
+void generate_trace(std::ostream& os, std::size_t n, std::size_t keys)
+{
+    auto snapshots = std::size_t{64};
+    auto taken     = std::size_t{};
+    auto key       = [&](std::uint64_t r) {
+        // a quarter of the operations go to 1% of the entities
+        auto hot = keys / 100 + 1;
+        return (r & 3) ? r % keys : r % hot;
+    };
+    auto old = [&](std::uint64_t r) {
+        return taken ? (taken - 1 - r % std::min(taken, snapshots)) %
+                           snapshots
+                     : 0;
+    };
+    os << "# " << n << " operations over " << keys << " entities\n";
+    for (auto i = std::size_t{}; i < keys / 2; ++i)
+        os << "insert e" << i << " " << i << "\n";
+    os << "snapshot 0\n";
+    taken = 1;
+    for (auto i = std::size_t{}; i < n; ++i) {
+        auto r    = scramble(i);
+        auto kind = r % 1000;
+        r /= 1000;
+        if (kind < 350)
+            os << "read e" << key(r) << "\n";
+        else if (kind < 600)
+            os << "update e" << key(r) << " " << i << "\n";
+        else if (kind < 680)
+            os << "insert e" << key(r) << " " << i << "\n";
+        else if (kind < 700)
+            os << "erase e" << key(r) << "\n";
+        else if (kind < 900)
+            os << "push " << i << "\n";
+        else if (kind < 905)
+            os << "slice " << r % 64 << " " << 1024 + r % 1024 << "\n";
+        else if (kind < 908)
+            os << "concat " << old(r) << "\n";
+        else if (kind < 920)
+            os << "diff " << old(r) << "\n";
+        else if (kind < 995)
+            os << "snapshot " << taken++ % snapshots << "\n";
+        else
+            os << "release " << old(r) << "\n";
+    }
+}
+
+} // namespace
@@ -0,0 +1,105 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include "common.hpp"
+
+#include <immer/algorithm.hpp>
+#include <immer/array.hpp>
+#include <immer/array_transient.hpp>
+
+namespace {
+
+template <class Memory>
+using array_t = immer::array<unsigned, Memory>;
+
+template <class Memory>
+array_t<Memory> make(std::size_t n)
+{
+    auto v = array_t<Memory>{}.transient();
+    for (auto i = 0u; i < n; ++i)
+        v.push_back(i);
+    return v.persistent();
+}
+
+template <class Memory>
+void push_back(nonius::chronometer meter)
+{
+    auto n = meter.param<N>();
+    measure(meter, n, [&] {
+        auto v = array_t<Memory>{};
+        for (auto i = 0u; i < n; ++i)
+            v = v.push_back(i);
+        return v;
+    });
+}
+
+template <class Memory>
+void push_back_move(nonius::chronometer meter)
+{
+    auto n = meter.param<N>();
+    measure(meter, n, [&] {
+        auto v = array_t<Memory>{};
+        for (auto i = 0u; i < n; ++i)
+            v = std::move(v).push_back(i);
+        return v;
+    });
+}
+
+template <class Memory>
+void push_back_transient(nonius::chronometer meter)
+{
+    auto n = meter.param<N>();
+    measure(meter, n, [&] { return make<Memory>(n); });
+}
+
+template <class Memory>
+void access(nonius::chronometer meter)
+{
+    auto n = meter.param<N>();
+    auto v = make<Memory>(n);
+    measure(meter, n, [&] {
+        auto r = 0u;
+        for (auto i = 0u; i < n; ++i)
+            r += v[scramble(i) % n];
+        return r;
+    });
+}
+
+template <class Memory>
+void iterate(nonius::chronometer meter)
+{
+    auto n = meter.param<N>();
+    auto v = make<Memory>(n);
+    measure(meter, n, [&] {
+        auto r = 0u;
+        immer::for_each(v, [&](auto x) { r += x; });
+        return r;
+    });
+}
+
+template <class Memory>
+void update_move(nonius::chronometer meter)
+{
+    auto n = meter.param<N>();
+    auto v = make<Memory>(n);
+    measure(meter, n, [&] {
+        auto r = v;
+        for (auto i = 0u; i < n; ++i)
+            r = std::move(r).set(scramble(i) % n, i);
+        return r;
+    });
+}
+
+} // namespace
+
+IMMER_BENCHMARK_POLICIES("push_back", push_back)
+IMMER_BENCHMARK_POLICIES("push_back/move", push_back_move)
+IMMER_BENCHMARK_POLICIES("push_back/transient", push_back_transient)
+IMMER_BENCHMARK_POLICIES("access", access)
+IMMER_BENCHMARK_POLICIES("iterate", iterate)
+IMMER_BENCHMARK_POLICIES("update/move", update_move)
@@ -0,0 +1,117 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include "common.hpp"
+
+#include <immer/atom.hpp>
+#include <immer/box.hpp>
+
+#include <thread>
+#include <vector>
+
+namespace {
+
+template <class Memory>
+using atom_t = immer::atom<std::uint64_t, Memory>;
+
+template <class Memory>
+using combining_atom_t =
+    immer::atom<std::uint64_t, Memory, immer::flat_combining_policy>;
+
+template <class Memory>
+void load(nonius::chronometer meter)
+{
+    auto n = meter.param<N>();
+    atom_t<Memory> a{42u};
+    measure(meter, n, [&] {
+        auto r = std::uint64_t{};
+        for (auto i = 0u; i < n; ++i)
+            r += a.load().get();
+        return r;
+    });
+}
+
+template <class Memory>
+void store(nonius::chronometer meter)
+{
+    auto n = meter.param<N>();
+    atom_t<Memory> a;
+    measure(meter, n, [&] {
+        for (auto i = 0u; i < n; ++i)
+            a.store(std::uint64_t{i});
+    });
+}
+
+template <class Memory>
+void update(nonius::chronometer meter)
+{
+    auto n = meter.param<N>();
+    atom_t<Memory> a;
+    measure(meter, n, [&] {
+        for (auto i = 0u; i < n; ++i)
+            a.update([](auto x) { return x + 1; });
+    });
+}
+
+/*
+ * Updates from several threads at once, which is where the atom has to
+ * retry or combine its updates.  These are not registered for
+ * `unsafe_memory`, whose reference counts can not be shared between threads.
+ */
+template <class Memory>
+void update_contended(nonius::chronometer meter)
+{
+    constexpr auto threads = 4u;
+    auto n                 = meter.param<N>();
+    measure(meter, n, [&] {
+        atom_t<Memory> a;
+        auto ts = std::vector<std::thread>{};
+        for (auto t = 0u; t < threads; ++t)
+            ts.emplace_back([&] {
+                for (auto i = 0u; i < n / threads; ++i)
+                    a.update([](auto x) { return x + 1; });
+            });
+        for (auto& t : ts)
+            t.join();
+        return a.load();
+    });
+}
+
+template <class Memory>
+void update_combining_contended(nonius::chronometer meter)
+{
+    constexpr auto threads = 4u;
+    auto n                 = meter.param<N>();
+    measure(meter, n, [&] {
+        combining_atom_t<Memory> a;
+        auto ts = std::vector<std::thread>{};
+        for (auto t = 0u; t < threads; ++t)
+            ts.emplace_back([&] {
+                for (auto i = 0u; i < n / threads; ++i)
+                    a.update_combining([](auto x) { return x + 1; });
+            });
+        for (auto& t : ts)
+            t.join();
+        return a.load();
+    });
+}
+
+} // namespace
+
+IMMER_BENCHMARK_POLICIES("load", load)
+IMMER_BENCHMARK_POLICIES("store", store)
+IMMER_BENCHMARK_POLICIES("update", update)
+
+// clang-format off
+
+NONIUS_BENCHMARK("update/contended/def",             update_contended<def_memory>)
+NONIUS_BENCHMARK("update/contended/basic",           update_contended<basic_memory>)
+NONIUS_BENCHMARK("update/contended/safe",            update_contended<safe_memory>)
+NONIUS_BENCHMARK("update_combining/contended/def",   update_combining_contended<def_memory>)
+NONIUS_BENCHMARK("update_combining/contended/basic", update_combining_contended<basic_memory>)
+NONIUS_BENCHMARK("update_combining/contended/safe",  update_combining_contended<safe_memory>)
@@ -0,0 +1,92 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include "common.hpp"
+
+#include <immer/box.hpp>
+
+#include <vector>
+
+namespace {
+
+template <class Memory>
+using box_t = immer::box<std::uint64_t, Memory>;
+
+template <class Memory>
+void make(nonius::chronometer meter)
+{
+    auto n = meter.param<N>();
+    measure(meter, n, [&] {
+        auto r = std::uint64_t{};
+        for (auto i = 0u; i < n; ++i)
+            r += box_t<Memory>{i}.get();
+        return r;
+    });
+}
+
+template <class Memory>
+void copy(nonius::chronometer meter)
+{
+    auto n = meter.param<N>();
+    auto b = box_t<Memory>{42u};
+    measure(meter, n, [&] {
+        auto r = std::uint64_t{};
+        for (auto i = 0u; i < n; ++i) {
+            auto c = b;
+            r += c.get();
+        }
+        return r;
+    });
+}
+
+template <class Memory>
+void update(nonius::chronometer meter)
+{
+    auto n = meter.param<N>();
+    measure(meter, n, [&] {
+        auto b = box_t<Memory>{0u};
+        for (auto i = 0u; i < n; ++i)
+            b = b.update([](auto x) { return x + 1; });
+        return b;
+    });
+}
+
+template <class Memory>
+void update_move(nonius::chronometer meter)
+{
+    auto n = meter.param<N>();
+    measure(meter, n, [&] {
+        auto b = box_t<Memory>{0u};
+        for (auto i = 0u; i < n; ++i)
+            b = std::move(b).update([](auto x) { return x + 1; });
+        return b;
+    });
+}
+
+template <class Memory>
+void access(nonius::chronometer meter)
+{
+    auto n  = meter.param<N>();
+    auto bs = std::vector<box_t<Memory>>{};
+    for (auto i = 0u; i < n; ++i)
+        bs.emplace_back(i);
+    measure(meter, n, [&] {
+        auto r = std::uint64_t{};
+        for (auto i = 0u; i < n; ++i)
+            r += bs[scramble(i) % n].get();
+        return r;
+    });
+}
+
+} // namespace
+
+IMMER_BENCHMARK_POLICIES("make", make)
+IMMER_BENCHMARK_POLICIES("copy", copy)
+IMMER_BENCHMARK_POLICIES("update", update)
+IMMER_BENCHMARK_POLICIES("update/move", update_move)
+IMMER_BENCHMARK_POLICIES("access", access)
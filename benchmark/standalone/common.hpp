@@ -0,0 +1,99 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#ifndef IMMER_BENCHMARK_SUITE
+#define IMMER_BENCHMARK_SUITE "standalone"
+#endif
+
+#include "benchmark/driver.hpp"
+#include "benchmark/json_reporter.hpp"
+#include "benchmark/perf_counters.hpp"
+
+#include <nonius.h++>
+
+#include <cstdint>
+
+/*
+ * These benchmarks only depend on immer and nonius, unlike the ones in the
+ * rest of `benchmark/`, which compare against other libraries.  Every
+ * benchmark is registered once per memory policy, as `<name>/<policy>`, and
+ * the `json` reporter prints one JSON object per benchmark and set of
+ * parameters, see `benchmark/json_reporter.hpp`.
+ *
+ * When the hardware counters in `perf_counters.hpp` are available, the
+ * `json` reporter also prints the events per operation, counted over all
+ * the runs of the benchmark.  Every benchmark tells `measure()` how many
+ * operations one run does.
+ */
+
+NONIUS_PARAM(N, std::size_t{1000})
+
+namespace {
+
+perf_counters& counters()
+{
+    static perf_counters c;
+    return c;
+}
+
+std::uint64_t& counted_ops()
+{
+    static std::uint64_t ops = 0;
+    return ops;
+}
+
+/*
+ * Measures `fn`, that does `ops` operations, counting hardware events
+ * around it.  The counters are started and stopped outside of the timed
+ * region.
+ */
+template <typename Fn>
+void measure(nonius::chronometer& meter, std::size_t ops, Fn&& fn)
+{
+    counters().start();
+    meter.measure(std::forward<Fn>(fn));
+    counters().stop();
+    counted_ops() += ops * meter.runs();
+}
+
+struct counters_json_reporter : json_reporter
+{
+private:
+    void start() override
+    {
+        counters().reset();
+        counted_ops() = 0;
+    }
+
+    void fields(json_line& line, const analysis_t&) override
+    {
+        if (counters().any_available() && counted_ops()) {
+            line.begin("counters");
+            for (auto i = std::size_t{}; i < perf_counters::count; ++i)
+                if (counters().available(i))
+                    line.field(perf_counters::name(i),
+                               double(counters().value(i)) / counted_ops());
+            line.end();
+        }
+    }
+};
+
+NONIUS_REPORTER("json", counters_json_reporter);
+
+} // namespace
+
+/*
+ * Registers `fn<Memory>` for every memory policy.
+ */
+#define IMMER_BENCHMARK_POLICIES(name, fn)                                     \
+    NONIUS_BENCHMARK(name "/def", fn<def_memory>)                              \
+    NONIUS_BENCHMARK(name "/basic", fn<basic_memory>)                          \
+    NONIUS_BENCHMARK(name "/safe", fn<safe_memory>)                            \
+    NONIUS_BENCHMARK(name "/unsafe", fn<unsafe_memory>)
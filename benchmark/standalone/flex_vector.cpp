@@ -0,0 +1,156 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include "common.hpp"
+
+#include <immer/algorithm.hpp>
+#include <immer/flex_vector.hpp>
+#include <immer/flex_vector_transient.hpp>
+
+namespace {
+
+template <class Memory>
+using flex_vector_t = immer::flex_vector<unsigned, Memory>;
+
+template <class Memory>
+flex_vector_t<Memory> make(std::size_t n)
+{
+    auto v = flex_vector_t<Memory>{}.transient();
+    for (auto i = 0u; i < n; ++i)
+        v.push_back(i);
+    return v.persistent();
+}
+
+template <class Memory>
+void push_back(nonius::chronometer meter)
+{
+    auto n = meter.param<N>();
+    measure(meter, n, [&] {
+        auto v = flex_vector_t<Memory>{};
+        for (auto i = 0u; i < n; ++i)
+            v = std::move(v).push_back(i);
+        return v;
+    });
+}
+
+template <class Memory>
+void push_front(nonius::chronometer meter)
+{
+    auto n = meter.param<N>();
+    measure(meter, n, [&] {
+        auto v = flex_vector_t<Memory>{};
+        for (auto i = 0u; i < n; ++i)
+            v = std::move(v).push_front(i);
+        return v;
+    });
+}
+
+template <class Memory>
+void access(nonius::chronometer meter)
+{
+    auto n = meter.param<N>();
+    auto v = make<Memory>(n);
+    measure(meter, n, [&] {
+        auto r = 0u;
+        for (auto i = 0u; i < n; ++i)
+            r += v[scramble(i) % n];
+        return r;
+    });
+}
+
+template <class Memory>
+void access_relaxed(nonius::chronometer meter)
+{
+    auto n = meter.param<N>();
+    auto v = flex_vector_t<Memory>{};
+    for (auto i = 0u; i < n; ++i)
+        v = std::move(v).push_front(i);
+    measure(meter, n, [&] {
+        auto r = 0u;
+        for (auto i = 0u; i < n; ++i)
+            r += v[scramble(i) % n];
+        return r;
+    });
+}
+
+template <class Memory>
+void iterate(nonius::chronometer meter)
+{
+    auto n = meter.param<N>();
+    auto v = make<Memory>(n);
+    measure(meter, n, [&] {
+        auto r = 0u;
+        immer::for_each(v, [&](auto x) { r += x; });
+        return r;
+    });
+}
+
+template <class Memory>
+void update_move(nonius::chronometer meter)
+{
+    auto n = meter.param<N>();
+    auto v = make<Memory>(n);
+    measure(meter, n, [&] {
+        auto r = v;
+        for (auto i = 0u; i < n; ++i)
+            r = std::move(r).set(scramble(i) % n, i);
+        return r;
+    });
+}
+
+template <class Memory>
+void concat(nonius::chronometer meter)
+{
+    auto n = meter.param<N>();
+    auto v = make<Memory>(n);
+    measure(meter, 10, [&] {
+        auto r = flex_vector_t<Memory>{};
+        for (auto i = 0u; i < 10u; ++i)
+            r = std::move(r) + v;
+        return r;
+    });
+}
+
+template <class Memory>
+void drop(nonius::chronometer meter)
+{
+    auto n = meter.param<N>();
+    auto v = make<Memory>(n);
+    auto step = 1 + n / 100;
+    measure(meter, (n + step - 1) / step, [&] {
+        auto r = 0u;
+        for (auto i = 0u; i < n; i += step)
+            r += v.drop(i).size();
+        return r;
+    });
+}
+
+template <class Memory>
+void insert(nonius::chronometer meter)
+{
+    auto n = meter.param<N>();
+    auto v = make<Memory>(n);
+    measure(meter, 100, [&] {
+        auto r = v;
+        for (auto i = 0u; i < 100u; ++i)
+            r = std::move(r).insert(scramble(i) % r.size(), i);
+        return r;
+    });
+}
+
+} // namespace
+
+IMMER_BENCHMARK_POLICIES("push_back", push_back)
+IMMER_BENCHMARK_POLICIES("push_front", push_front)
+IMMER_BENCHMARK_POLICIES("access", access)
+IMMER_BENCHMARK_POLICIES("access/relaxed", access_relaxed)
+IMMER_BENCHMARK_POLICIES("iterate", iterate)
+IMMER_BENCHMARK_POLICIES("update/move", update_move)
+IMMER_BENCHMARK_POLICIES("concat", concat)
+IMMER_BENCHMARK_POLICIES("drop", drop)
+IMMER_BENCHMARK_POLICIES("insert", insert)
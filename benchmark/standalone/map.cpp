@@ -0,0 +1,137 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include "common.hpp"
+
+#include <immer/algorithm.hpp>
+#include <immer/map.hpp>
+#include <immer/map_transient.hpp>
+
+namespace {
+
+template <class Memory>
+using map_t = immer::map<std::uint64_t,
+                         std::uint64_t,
+                         std::hash<std::uint64_t>,
+                         std::equal_to<std::uint64_t>,
+                         Memory>;
+
+template <class Memory>
+map_t<Memory> make(std::size_t n)
+{
+    auto v = map_t<Memory>{}.transient();
+    for (auto i = 0u; i < n; ++i)
+        v.set(scramble(i), i);
+    return v.persistent();
+}
+
+template <class Memory>
+void insert(nonius::chronometer meter)
+{
+    auto n = meter.param<N>();
+    measure(meter, n, [&] {
+        auto v = map_t<Memory>{};
+        for (auto i = 0u; i < n; ++i)
+            v = v.set(scramble(i), i);
+        return v;
+    });
+}
+
+template <class Memory>
+void insert_move(nonius::chronometer meter)
+{
+    auto n = meter.param<N>();
+    measure(meter, n, [&] {
+        auto v = map_t<Memory>{};
+        for (auto i = 0u; i < n; ++i)
+            v = std::move(v).set(scramble(i), i);
+        return v;
+    });
+}
+
+template <class Memory>
+void insert_transient(nonius::chronometer meter)
+{
+    auto n = meter.param<N>();
+    measure(meter, n, [&] { return make<Memory>(n); });
+}
+
+template <class Memory>
+void access(nonius::chronometer meter)
+{
+    auto n = meter.param<N>();
+    auto v = make<Memory>(n);
+    measure(meter, n, [&] {
+        auto r = std::uint64_t{};
+        for (auto i = 0u; i < n; ++i)
+            r += v.count(scramble(n - i - 1));
+        return r;
+    });
+}
+
+template <class Memory>
+void access_missing(nonius::chronometer meter)
+{
+    auto n = meter.param<N>();
+    auto v = make<Memory>(n);
+    measure(meter, n, [&] {
+        auto r = std::uint64_t{};
+        for (auto i = 0u; i < n; ++i)
+            r += v.count(scramble(n + i));
+        return r;
+    });
+}
+
+template <class Memory>
+void iterate(nonius::chronometer meter)
+{
+    auto n = meter.param<N>();
+    auto v = make<Memory>(n);
+    measure(meter, n, [&] {
+        auto r = std::uint64_t{};
+        immer::for_each(v, [&](auto&& x) { r += x.second; });
+        return r;
+    });
+}
+
+template <class Memory>
+void update_move(nonius::chronometer meter)
+{
+    auto n = meter.param<N>();
+    auto v = make<Memory>(n);
+    measure(meter, n, [&] {
+        auto r = v;
+        for (auto i = 0u; i < n; ++i)
+            r = std::move(r).update(scramble(i), [](auto x) { return x + 1; });
+        return r;
+    });
+}
+
+template <class Memory>
+void erase_move(nonius::chronometer meter)
+{
+    auto n = meter.param<N>();
+    auto v = make<Memory>(n);
+    measure(meter, n, [&] {
+        auto r = v;
+        for (auto i = 0u; i < n; ++i)
+            r = std::move(r).erase(scramble(i));
+        return r;
+    });
+}
+
+} // namespace
+
+IMMER_BENCHMARK_POLICIES("insert", insert)
+IMMER_BENCHMARK_POLICIES("insert/move", insert_move)
+IMMER_BENCHMARK_POLICIES("insert/transient", insert_transient)
+IMMER_BENCHMARK_POLICIES("access", access)
+IMMER_BENCHMARK_POLICIES("access/missing", access_missing)
+IMMER_BENCHMARK_POLICIES("iterate", iterate)
+IMMER_BENCHMARK_POLICIES("update/move", update_move)
+IMMER_BENCHMARK_POLICIES("erase/move", erase_move)
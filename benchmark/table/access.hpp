@@ -0,0 +1,126 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include "benchmark/config.hpp"
+#include "benchmark/table/entry.hpp"
+
+#include <immer/table.hpp>
+#include <immer/table_transient.hpp>
+#include <map>
+#include <unordered_map>
+
+namespace {
+
+template <typename T = unsigned>
+auto make_generator_ranged(std::size_t runs)
+{
+    assert(runs > 0);
+    auto engine = std::default_random_engine{13};
+    auto dist   = std::uniform_int_distribution<T>{0, (T) runs - 1};
+    auto r      = std::vector<T>(runs);
+    std::generate_n(r.begin(), runs, std::bind(dist, engine));
+    return r;
+}
+
+template <typename Generator, typename Table>
+auto benchmark_find_std()
+{
+    return [](nonius::chronometer meter) {
+        auto n  = meter.param<N>();
+        auto g1 = Generator{}(n);
+        auto g2 = make_generator_ranged(n);
+
+        auto v = Table{};
+        for (auto i = 0u; i < n; ++i)
+            v.insert(make_entry<Table>(g1[i], i));
+
+        measure(meter, [&] {
+            auto c = 0u;
+            for (auto i = 0u; i < n; ++i) {
+                auto it = v.find(g1[g2[i]]);
+                c += it != v.end() ? it->second.value : 0u;
+            }
+            volatile auto r = c;
+            return r;
+        });
+    };
+}
+
+template <typename Generator, typename Table>
+auto benchmark_find()
+{
+    return [](nonius::chronometer meter) {
+        auto n  = meter.param<N>();
+        auto g1 = Generator{}(n);
+        auto g2 = make_generator_ranged(n);
+
+        auto v = Table{};
+        for (auto i = 0u; i < n; ++i)
+            v = v.insert({g1[i], i});
+
+        measure(meter, [&] {
+            auto c = 0u;
+            for (auto i = 0u; i < n; ++i) {
+                auto p = v.find(g1[g2[i]]);
+                c += p ? p->value : 0u;
+            }
+            volatile auto r = c;
+            return r;
+        });
+    };
+}
+
+template <typename Generator, typename Table>
+auto benchmark_find_miss_std()
+{
+    return [](nonius::chronometer meter) {
+        auto n  = meter.param<N>();
+        auto g1 = Generator{}(n * 2);
+
+        auto v = Table{};
+        for (auto i = 0u; i < n; ++i)
+            v.insert(make_entry<Table>(g1[i], i));
+
+        measure(meter, [&] {
+            auto c = 0u;
+            for (auto i = 0u; i < n; ++i) {
+                auto it = v.find(g1[n + i]);
+                c += it != v.end() ? it->second.value : 0u;
+            }
+            volatile auto r = c;
+            return r;
+        });
+    };
+}
+
+template <typename Generator, typename Table>
+auto benchmark_find_miss()
+{
+    return [](nonius::chronometer meter) {
+        auto n  = meter.param<N>();
+        auto g1 = Generator{}(n * 2);
+
+        auto v = Table{};
+        for (auto i = 0u; i < n; ++i)
+            v = v.insert({g1[i], i});
+
+        measure(meter, [&] {
+            auto c = 0u;
+            for (auto i = 0u; i < n; ++i) {
+                auto p = v.find(g1[n + i]);
+                c += p ? p->value : 0u;
+            }
+            volatile auto r = c;
+            return r;
+        });
+    };
+}
+
+} // namespace
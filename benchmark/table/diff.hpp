@@ -0,0 +1,103 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include "benchmark/config.hpp"
+#include "benchmark/table/entry.hpp"
+
+#include <immer/algorithm.hpp>
+#include <immer/table.hpp>
+#include <immer/table_transient.hpp>
+
+namespace {
+
+/*
+ * Diffs a table with `N` elements against a version of it where a tenth of
+ * the keys were updated, a tenth erased and as many new ones inserted.
+ * Thanks to structural sharing, this should be proportional to the number
+ * of changes and not to `N`.
+ */
+template <typename Generator, typename Table>
+auto benchmark_diff()
+{
+    return [](nonius::chronometer meter) {
+        auto n = meter.param<N>();
+        auto d = n / 10 + 1;
+        auto g = Generator{}(n + d);
+
+        auto v = [&] {
+            auto v = Table{}.transient();
+            for (auto i = 0u; i < n; ++i)
+                v.insert({g[i], i});
+            return v.persistent();
+        }();
+        auto w = [&] {
+            auto w = v.transient();
+            for (auto i = 0u; i < d; ++i) {
+                w.update(g[i], increment{});
+                w.erase(g[n - i - 1]);
+                w.insert({g[n + i], i});
+            }
+            return w.persistent();
+        }();
+
+        measure(meter, [&] {
+            auto c = 0u;
+            immer::diff(
+                v,
+                w,
+                [&](auto&& x) { c += x.value; },
+                [&](auto&& x) { c -= x.value; },
+                [&](auto&& x, auto&& y) { c += y.value - x.value; });
+            volatile auto r = c;
+            return r;
+        });
+    };
+}
+
+/*
+ * The same, when the second version was built from scratch, so that the
+ * tables do not share any structure.
+ */
+template <typename Generator, typename Table>
+auto benchmark_diff_unshared()
+{
+    return [](nonius::chronometer meter) {
+        auto n = meter.param<N>();
+        auto d = n / 10 + 1;
+        auto g = Generator{}(n + d);
+
+        auto v = [&] {
+            auto v = Table{}.transient();
+            for (auto i = 0u; i < n; ++i)
+                v.insert({g[i], i});
+            return v.persistent();
+        }();
+        auto w = [&] {
+            auto w = Table{}.transient();
+            for (auto i = static_cast<unsigned>(d); i < n + d; ++i)
+                w.insert({g[i], i});
+            return w.persistent();
+        }();
+
+        measure(meter, [&] {
+            auto c = 0u;
+            immer::diff(
+                v,
+                w,
+                [&](auto&& x) { c += x.value; },
+                [&](auto&& x) { c -= x.value; },
+                [&](auto&& x, auto&& y) { c += y.value - x.value; });
+            volatile auto r = c;
+            return r;
+        });
+    };
+}
+
+} // namespace
@@ -0,0 +1,81 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <utility>
+
+namespace {
+
+/*
+ * The values of the table benchmarks.  The `std` containers they are
+ * compared against map the key to the whole entry, so that both store the
+ * same data.
+ */
+template <typename K>
+struct table_entry
+{
+    K id;
+    unsigned value;
+
+    friend bool operator==(const table_entry& a, const table_entry& b)
+    {
+        return a.id == b.id && a.value == b.value;
+    }
+    friend bool operator!=(const table_entry& a, const table_entry& b)
+    {
+        return !(a == b);
+    }
+};
+
+struct increment
+{
+    template <typename T>
+    T operator()(T x) const
+    {
+        ++x.value;
+        return x;
+    }
+};
+
+template <typename K>
+table_entry<K> make_entry_impl(K k, unsigned v, table_entry<K>*)
+{
+    return {std::move(k), v};
+}
+
+template <typename K, typename Pair>
+Pair make_entry_impl(K k, unsigned v, Pair*)
+{
+    return {k, {k, v}};
+}
+
+/*
+ * Builds the `value_type` of `Container` for key `k`, which is either the
+ * entry itself or a pair of the key and the entry.
+ */
+template <typename Container, typename K>
+typename Container::value_type make_entry(K k, unsigned v)
+{
+    using value_t = typename Container::value_type;
+    return make_entry_impl(std::move(k), v, static_cast<value_t*>(nullptr));
+}
+
+template <typename K>
+const table_entry<K>& entry_of(const table_entry<K>& x)
+{
+    return x;
+}
+
+template <typename K, typename T>
+const T& entry_of(const std::pair<K, T>& x)
+{
+    return x.second;
+}
+
+} // namespace
@@ -0,0 +1,69 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include "benchmark/config.hpp"
+#include "benchmark/table/entry.hpp"
+
+#include <immer/table.hpp>
+#include <immer/table_transient.hpp>
+#include <map>
+#include <unordered_map>
+
+namespace {
+
+template <typename Generator, typename Table>
+auto benchmark_insert_mut_std()
+{
+    return [](nonius::chronometer meter) {
+        auto n = meter.param<N>();
+        auto g = Generator{}(n);
+
+        measure(meter, [&] {
+            auto v = Table{};
+            for (auto i = 0u; i < n; ++i)
+                v.insert(make_entry<Table>(g[i], i));
+            return v;
+        });
+    };
+}
+
+template <typename Generator, typename Table>
+auto benchmark_insert()
+{
+    return [](nonius::chronometer meter) {
+        auto n = meter.param<N>();
+        auto g = Generator{}(n);
+
+        measure(meter, [&] {
+            auto v = Table{};
+            for (auto i = 0u; i < n; ++i)
+                v = v.insert({g[i], i});
+            return v;
+        });
+    };
+}
+
+template <typename Generator, typename Table>
+auto benchmark_insert_move()
+{
+    return [](nonius::chronometer meter) {
+        auto n = meter.param<N>();
+        auto g = Generator{}(n);
+
+        measure(meter, [&] {
+            auto v = Table{};
+            for (auto i = 0u; i < n; ++i)
+                v = std::move(v).insert({g[i], i});
+            return v;
+        });
+    };
+}
+
+} // namespace
@@ -0,0 +1,87 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include "benchmark/config.hpp"
+#include "benchmark/table/entry.hpp"
+
+#include <immer/algorithm.hpp>
+#include <immer/table.hpp>
+#include <numeric>
+#include <map>
+#include <unordered_map>
+
+namespace {
+
+struct iter_step
+{
+    template <typename Entry>
+    unsigned operator()(unsigned x, const Entry& y) const
+    {
+        return x + entry_of(y).value;
+    }
+};
+
+template <typename Generator, typename Table>
+auto benchmark_access_std_iter()
+{
+    return [](nonius::chronometer meter) {
+        auto n  = meter.param<N>();
+        auto g1 = Generator{}(n);
+
+        auto v = Table{};
+        for (auto i = 0u; i < n; ++i)
+            v.insert(make_entry<Table>(g1[i], i));
+
+        measure(meter, [&] {
+            volatile auto c =
+                std::accumulate(v.begin(), v.end(), 0u, iter_step{});
+            return c;
+        });
+    };
+}
+
+template <typename Generator, typename Table>
+auto benchmark_access_reduce()
+{
+    return [](nonius::chronometer meter) {
+        auto n  = meter.param<N>();
+        auto g1 = Generator{}(n);
+
+        auto v = Table{};
+        for (auto i = 0u; i < n; ++i)
+            v = v.insert({g1[i], i});
+
+        measure(meter, [&] {
+            volatile auto c = immer::accumulate(v, 0u, iter_step{});
+            return c;
+        });
+    };
+}
+
+template <typename Generator, typename Table>
+auto benchmark_access_iter()
+{
+    return [](nonius::chronometer meter) {
+        auto n  = meter.param<N>();
+        auto g1 = Generator{}(n);
+
+        auto v = Table{};
+        for (auto i = 0u; i < n; ++i)
+            v = v.insert({g1[i], i});
+
+        measure(meter, [&] {
+            volatile auto c =
+                std::accumulate(v.begin(), v.end(), 0u, iter_step{});
+            return c;
+        });
+    };
+}
+
+} // namespace
@@ -9,9 +9,16 @@
 #pragma once
 
 #include <immer/box.hpp>
+#include <immer/detail/util.hpp>
 #include <immer/refcount/no_refcount_policy.hpp>
+#include <immer/refcount/refcount_policy.hpp>
 
 #include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <exception>
+#include <stdexcept>
+#include <thread>
 #include <type_traits>
 
 namespace immer {
@@ -79,6 +86,150 @@ private:
     box_type impl_;
 };
 
+/*!
+ * Lock free atom for boxes using the thread-safe `refcount_policy`.
+ *
+ * It uses *split reference counting*: the holder pointer is packed together
+ * with a *local* count of readers in a single atomic word.  A reader first
+ * bumps the local count, which keeps the holder alive while it takes a proper
+ * reference on it, and then gives the local count back.  When a writer swaps
+ * the pointer away, it transfers the local count of the previous holder into
+ * its reference count, and the readers that are still in flight release it
+ * from there instead.
+ *
+ * Loading thus never blocks on writers nor on other readers, and only touches
+ * the atom word and the reference count of the current holder.
+ *
+ * The count lives in the upper 16 bits of the word, so holders must be at
+ * addresses below 2^48.  Every holder is checked before it is stored, and
+ * `std::runtime_error` is thrown when it does not fit.
+ */
+template <typename T, typename MemoryPolicy>
+struct split_refcount_atom_impl
+{
+    using box_type      = box<T, MemoryPolicy>;
+    using value_type    = T;
+    using memory_policy = MemoryPolicy;
+    using holder_t      = typename box_type::holder;
+    using word_t        = std::uint64_t;
+
+    static constexpr auto count_shift  = 48u;
+    static constexpr word_t count_one  = word_t{1} << count_shift;
+    static constexpr word_t count_mask = ~(count_one - 1);
+
+    static_assert(sizeof(holder_t*) <= sizeof(word_t),
+                  "split_refcount_atom_impl needs to fit a pointer in 64 bit");
+
+    split_refcount_atom_impl(const split_refcount_atom_impl&) = delete;
+    split_refcount_atom_impl(split_refcount_atom_impl&&)      = delete;
+    split_refcount_atom_impl&
+    operator=(const split_refcount_atom_impl&) = delete;
+    split_refcount_atom_impl& operator=(split_refcount_atom_impl&&) = delete;
+
+    split_refcount_atom_impl(box_type b)
+        : impl_{release(std::move(b))}
+    {
+    }
+
+    ~split_refcount_atom_impl()
+    {
+        auto word = impl_.load(std::memory_order_acquire);
+        assert((word & count_mask) == 0);
+        adopt(word);
+    }
+
+    box_type load() const
+    {
+        auto word = impl_.fetch_add(count_one, std::memory_order_acquire);
+        auto p    = to_holder(word);
+        p->inc();
+        word += count_one;
+        while (true) {
+            if (to_holder(word) != p || (word & count_mask) == 0) {
+                // A writer replaced the holder and moved our local count into
+                // its reference count, give it back from there.
+                auto last = p->dec();
+                assert(!last);
+                (void) last;
+                break;
+            }
+            if (impl_.compare_exchange_weak(word,
+                                            word - count_one,
+                                            std::memory_order_release,
+                                            std::memory_order_relaxed))
+                break;
+        }
+        return box_type{p};
+    }
+
+    void store(box_type b) { exchange(std::move(b)); }
+
+    box_type exchange(box_type b)
+    {
+        auto word = impl_.exchange(release(std::move(b)),
+                                   std::memory_order_acq_rel);
+        return adopt(word);
+    }
+
+    template <typename Fn>
+    box_type update(Fn&& fn)
+    {
+        while (true) {
+            auto oldv = load();
+            auto newv = oldv.update(fn);
+            auto word = impl_.load(std::memory_order_relaxed);
+            auto next = to_word(newv.impl_);
+            // The reference for the atom must be taken before publishing,
+            // since it may be swapped away as soon as it is visible.
+            newv.impl_->inc();
+            while (to_holder(word) == oldv.impl_) {
+                if (impl_.compare_exchange_weak(word,
+                                                next,
+                                                std::memory_order_acq_rel,
+                                                std::memory_order_relaxed)) {
+                    adopt(word);
+                    return newv;
+                }
+            }
+            newv.impl_->dec();
+        }
+    }
+
+private:
+    static holder_t* to_holder(word_t word)
+    {
+        return reinterpret_cast<holder_t*>(word & ~count_mask);
+    }
+
+    static word_t to_word(holder_t* p)
+    {
+        auto word = reinterpret_cast<word_t>(p);
+        if (word & count_mask)
+            IMMER_THROW(std::runtime_error{
+                "split_refcount_atom_impl: pointer does not fit in 48 bits"});
+        return word;
+    }
+
+    static word_t release(box_type b)
+    {
+        auto word = to_word(b.impl_);
+        b.impl_   = nullptr;
+        return word;
+    }
+
+    // Takes ownership of the reference held by the atom for the holder in
+    // `word`, accounting for the readers that are still in flight.
+    static box_type adopt(word_t word)
+    {
+        auto p = to_holder(word);
+        for (auto n = word >> count_shift; n; --n)
+            p->inc();
+        return box_type{p};
+    }
+
+    mutable std::atomic<word_t> impl_;
+};
+
 template <typename T, typename MemoryPolicy>
 struct gc_atom_impl
 {
@@ -121,6 +272,167 @@ private:
     std::atomic<typename box_type::holder*> impl_;
 };
 
+/*!
+ * Implements *flat combining* of updates on top of an atom implementation.
+ *
+ * Every caller publishes its update function in a lock-free list of pending
+ * requests. Whoever manages to take the combiner lock applies all pending
+ * functions in a single pass and publishes the final value with just one
+ * update of the underlying atom, while the other callers wait for their
+ * request to be served.
+ */
+template <typename T, typename MemoryPolicy>
+struct atom_combiner
+{
+    using box_type = box<T, MemoryPolicy>;
+    using lock_t   = typename MemoryPolicy::lock;
+
+    struct request
+    {
+        request* next = nullptr;
+        void* fn      = nullptr;
+        T (*apply)(void*, T&&);
+        box_type* result = nullptr;
+        std::exception_ptr error;
+        std::atomic<bool> done{false};
+        aligned_storage_for<box_type> storage;
+
+        ~request()
+        {
+            if (result)
+                detail::destroy_at(result);
+        }
+
+        void set_result(box_type b)
+        {
+            if (result)
+                *result = std::move(b);
+            else
+                result = new (&storage) box_type{std::move(b)};
+        }
+    };
+
+    template <typename Impl, typename Fn>
+    box_type update(Impl& impl, Fn&& fn)
+    {
+        using fn_t = std::remove_reference_t<Fn>;
+
+        request r;
+        r.fn =
+            const_cast<void*>(static_cast<const void*>(std::addressof(fn)));
+        r.apply = [](void* fn, T&& v) -> T {
+            return (*static_cast<fn_t*>(fn))(std::move(v));
+        };
+
+        r.next = pending_.load(std::memory_order_relaxed);
+        while (!pending_.compare_exchange_weak(
+            r.next, &r, std::memory_order_release, std::memory_order_relaxed))
+            ;
+
+        for (auto k = 0u; !r.done.load(std::memory_order_acquire); ++k) {
+            if (lock_.try_lock()) {
+                combine(impl);
+                lock_.unlock();
+            } else if (k >= 16) {
+                std::this_thread::yield();
+            }
+        }
+
+        if (r.error)
+            std::rethrow_exception(r.error);
+        return std::move(*r.result);
+    }
+
+private:
+    template <typename Impl>
+    void combine(Impl& impl)
+    {
+        auto head = pending_.exchange(nullptr, std::memory_order_acquire);
+        if (!head)
+            return;
+
+        // Requests were pushed in a stack, reverse them to serve them in
+        // arrival order.
+        auto reqs = static_cast<request*>(nullptr);
+        while (head) {
+            auto next  = head->next;
+            head->next = reqs;
+            reqs       = head;
+            head       = next;
+        }
+
+        IMMER_TRY {
+            auto last      = static_cast<request*>(nullptr);
+            auto published = impl.update([&](const T& old) {
+                auto v     = T{old};
+                auto saved = &old;
+                last       = nullptr;
+                for (auto r = reqs; r; r = r->next) {
+                    r->error = nullptr;
+                    // Materialize the result of the previous request before
+                    // its value is handed over to the next function.
+                    if (last) {
+                        last->set_result(box_type{v});
+                        saved = &last->result->get();
+                        last  = nullptr;
+                    }
+                    IMMER_TRY {
+                        v    = r->apply(r->fn, std::move(v));
+                        last = r;
+                    }
+                    IMMER_CATCH (...) {
+                        r->error = std::current_exception();
+                        v        = *saved;
+                    }
+                }
+                return v;
+            });
+            if (last)
+                last->set_result(std::move(published));
+        }
+        IMMER_CATCH (...) {
+            for (auto r = reqs; r; r = r->next)
+                r->error = std::current_exception();
+        }
+
+        while (reqs) {
+            auto next = reqs->next;
+            reqs->done.store(true, std::memory_order_release);
+            reqs = next;
+        }
+    }
+
+    lock_t lock_;
+    std::atomic<request*> pending_{nullptr};
+};
+
+} // namespace detail
+
+/*!
+ * Combining policy of an `atom` that does not support
+ * `atom::update_combining()`, so that it does not pay for it.
+ */
+struct no_combining_policy
+{};
+
+/*!
+ * Combining policy of an `atom` that supports `atom::update_combining()`.
+ */
+struct flat_combining_policy
+{};
+
+namespace detail {
+
+template <typename T, typename MemoryPolicy, typename CombiningPolicy>
+struct atom_combining_base
+{};
+
+template <typename T, typename MemoryPolicy>
+struct atom_combining_base<T, MemoryPolicy, flat_combining_policy>
+{
+    atom_combiner<T, MemoryPolicy> combiner_;
+};
+
 } // namespace detail
 
 /*!
@@ -145,10 +457,20 @@ private:
  *    ``std::atomic_share_ptr`` may require further synchronization, in
  *    particular when invoking non-const methods.
  *
+ * .. note:: When ``IMMER_LOCK_FREE_ATOM=1`` is defined and the memory policy
+ *    uses the thread-safe ``refcount_policy``, ``load()`` is lock-free and
+ *    does not contend with other readers on a lock.  This requires boxes to
+ *    be allocated at addresses below 2^48, which is not the case with 5-level
+ *    paging, 52 bit virtual addresses or tagged pointers, so it is disabled
+ *    by default.
+ *
  * @endrst
  */
-template <typename T, typename MemoryPolicy = default_memory_policy>
+template <typename T,
+          typename MemoryPolicy    = default_memory_policy,
+          typename CombiningPolicy = no_combining_policy>
 class atom
+    : detail::atom_combining_base<T, MemoryPolicy, CombiningPolicy>
 {
 public:
     using box_type      = box<T, MemoryPolicy>;
@@ -223,6 +545,39 @@ public:
         return impl_.update(std::forward<Fn>(fn));
     }
 
+    /*!
+     * Like `update()`, but contending updates are *combined*: they are
+     * queued, and a single thread applies all of them in one pass and
+     * publishes the final value at once.  Returns the value resulting from
+     * applying `fn`, which includes the updates applied before it in the
+     * batch.  The current value is passed to `fn` as an r-value.
+     *
+     * @rst
+     *
+     * This avoids most of the wasted work of ``update()`` when many threads
+     * write to the same atom, since functions are never evaluated on a value
+     * that turns out to be stale because of other combined updates.  The
+     * function might still be reevaluated when it races with other methods
+     * of the atom, so it must be pure too.
+     *
+     * If ``fn`` throws, the exception is propagated to its caller and the
+     * rest of the batch is applied as if it had never been called.
+     *
+     * This is only available when the atom uses the
+     * :cpp:class:`immer::flat_combining_policy`, so that other atoms do not
+     * carry the state needed to combine updates.
+     *
+     * @endrst
+     */
+    template <typename Fn>
+    box_type update_combining(Fn&& fn)
+    {
+        static_assert(
+            std::is_same<CombiningPolicy, flat_combining_policy>::value,
+            "update_combining() requires an atom with flat_combining_policy");
+        return this->combiner_.update(impl_, std::forward<Fn>(fn));
+    }
+
 private:
     struct get_refcount_atom_impl
     {
@@ -233,6 +588,15 @@ private:
         };
     };
 
+    struct get_split_refcount_atom_impl
+    {
+        template <typename U, typename MP>
+        struct apply
+        {
+            using type = detail::split_refcount_atom_impl<U, MP>;
+        };
+    };
+
     struct get_gc_atom_impl
     {
         template <typename U, typename MP>
@@ -243,13 +607,20 @@ private:
     };
 
     // If we are using "real" garbage collection (we assume this when we use
-    // `no_refcount_policy`), we just store the pointer in an atomic.  If we use
-    // reference counting, we rely on the reference counting spinlock.
+    // `no_refcount_policy`), we just store the pointer in an atomic.  With the
+    // thread-safe `refcount_policy` and `IMMER_LOCK_FREE_ATOM` enabled, we use
+    // split reference counting to avoid locking on reads.  Otherwise, we rely
+    // on the reference counting lock.
     using impl_t = typename std::conditional_t<
         std::is_same<typename MemoryPolicy::refcount,
                      no_refcount_policy>::value,
         get_gc_atom_impl,
-        get_refcount_atom_impl>::template apply<T, MemoryPolicy>::type;
+        std::conditional_t<
+            IMMER_LOCK_FREE_ATOM &&
+                std::is_same<typename MemoryPolicy::refcount,
+                             refcount_policy>::value,
+            get_split_refcount_atom_impl,
+            get_refcount_atom_impl>>::template apply<T, MemoryPolicy>::type;
 
     impl_t impl_;
 };
@@ -23,6 +23,9 @@ struct gc_atom_impl;
 template <typename U, typename MP>
 struct refcount_atom_impl;
 
+template <typename U, typename MP>
+struct split_refcount_atom_impl;
+
 } // namespace detail
 
 /*!
@@ -37,6 +40,7 @@ class box
 {
     friend struct detail::gc_atom_impl<T, MemoryPolicy>;
     friend struct detail::refcount_atom_impl<T, MemoryPolicy>;
+    friend struct detail::split_refcount_atom_impl<T, MemoryPolicy>;
 
     struct holder : MemoryPolicy::refcount
     {
@@ -0,0 +1,236 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/algorithm.hpp>
+#include <immer/array.hpp>
+#include <immer/box.hpp>
+#include <immer/flex_vector.hpp>
+#include <immer/flex_vector_transient.hpp>
+#include <immer/map.hpp>
+#include <immer/set.hpp>
+#include <immer/table.hpp>
+#include <immer/vector.hpp>
+#include <immer/vector_transient.hpp>
+
+#include <cassert>
+#include <type_traits>
+
+namespace immer {
+
+namespace detail {
+
+/*!
+ * Copies the inner node `node`, at `shift`, and the last node under it, all
+ * the way down, into nodes of their exact size.  It holds `n` elements.
+ */
+template <typename Node>
+Node* pack_inner(Node* node, rbts::shift_t shift, std::size_t n)
+{
+    assert(!node->relaxed());
+    auto count = static_cast<rbts::count_t>(((n - 1) >> shift) + 1);
+    auto last  = n - (std::size_t{count - 1} << shift);
+    auto dst   = Node::copy_inner_n(count, node, count);
+    auto& edge = dst->inner()[count - 1];
+    if (shift == Node::bits_leaf) {
+        auto m = static_cast<rbts::count_t>(last);
+        edge   = Node::copy_leaf_n(m, edge, m);
+    } else {
+        edge = pack_inner(edge, shift - Node::bits, last);
+    }
+    return dst;
+}
+
+template <typename Container>
+Container pack_right_edge(Container c, std::true_type)
+{
+    return c;
+}
+
+/*!
+ * Without reference counting, nodes are never mutated in place after they
+ * are shared, so they need no headroom.  The nodes of a tree built by
+ * appending are full, except for those on its right edge and the tail,
+ * which are copied into nodes of their exact size.  The originals are left
+ * to the collector.
+ */
+template <typename Container>
+Container pack_right_edge(Container c, std::false_type)
+{
+    using impl_t = std::decay_t<decltype(c.impl())>;
+    using node_t = std::decay_t<decltype(*c.impl().root)>;
+
+    const auto& impl = c.impl();
+    auto root        = impl.root;
+    if (impl.tail_offset())
+        root = pack_inner(impl.root, impl.shift, impl.tail_offset());
+    auto ts   = static_cast<rbts::count_t>(impl.tail_size());
+    auto tail = ts ? node_t::copy_leaf_n(ts, impl.tail, ts) : impl.tail;
+    return impl_t{impl.size, impl.shift, root, tail};
+}
+
+/*!
+ * Packs the nodes of `c` when its memory policy does not keep headroom in
+ * them.
+ */
+template <typename Container>
+Container pack_right_edge(Container c)
+{
+    using node_t = std::decay_t<decltype(*c.impl().root)>;
+    return pack_right_edge(
+        std::move(c), std::integral_constant<bool, node_t::keep_headroom>{});
+}
+
+} // namespace detail
+
+/**
+ * @defgroup compaction
+ * @{
+ */
+
+/*!
+ * Returns a container equal to `c` whose nodes have all been allocated
+ * anew, one after the other, in the order in which they are traversed.
+ *
+ * @rst
+ *
+ * A long lived container that was built by many updates has its nodes
+ * spread all over the heap, next to nodes of other containers that have
+ * long been freed.  Compacting it brings the nodes that are read together
+ * closer in memory, which makes iterating it faster, at the cost of
+ * copying it once:
+ *
+ * - The nodes of a ``map``, ``set`` or ``table`` are copied depth first,
+ *   so that every inner node is followed by its values and then its
+ *   children.  The shape of the tree does not change.
+ *
+ * - A ``vector`` or ``flex_vector`` is rebuilt by appending its elements
+ *   in order, so its leaves are allocated in order too.  For a
+ *   ``flex_vector`` that has been sliced, concatenated or had elements
+ *   inserted, this also replaces its relaxed nodes, which may be half
+ *   empty, by a dense tree without size tables.  With reference counting,
+ *   its nodes keep their headroom, since any node with a single reference
+ *   may be mutated in place by a transient.  Without it, for example with a
+ *   ``gc_heap``, the nodes on the right edge of the tree, which are the only
+ *   ones that are not full, are allocated with their exact size.
+ *
+ * - An ``array`` or a ``box`` are just copied, since they are made of a
+ *   single node.
+ *
+ * .. warning:: The result shares no nodes with ``c``, nor with any other
+ *    version of it.  Compacting one of many versions that share most of
+ *    their nodes makes them use more memory, not less.  Use
+ *    :cpp:func:`immer::memory_usage` to find out how much of a container
+ *    is shared before compacting it.
+ *
+ * .. note:: Whether the nodes end up next to each other depends on the
+ *    heap.  The free lists of the default heap hand out the nodes that
+ *    were freed last first, so it is best to compact before releasing the
+ *    old version, and to release it afterwards.
+ *
+ * @endrst
+ */
+template <typename T,
+          typename MemoryPolicy,
+          detail::rbts::bits_t B,
+          detail::rbts::bits_t BL>
+vector<T, MemoryPolicy, B, BL>
+compact(const vector<T, MemoryPolicy, B, BL>& c)
+{
+    auto t = vector<T, MemoryPolicy, B, BL>{}.transient();
+    for_each_chunk(c, [&](auto first, auto last) {
+        for (; first != last; ++first)
+            t.push_back(*first);
+    });
+    return detail::pack_right_edge(std::move(t).persistent());
+}
+
+/*!
+ * Compacts the flex vector `c`. @see compact
+ */
+template <typename T,
+          typename MemoryPolicy,
+          detail::rbts::bits_t B,
+          detail::rbts::bits_t BL>
+flex_vector<T, MemoryPolicy, B, BL>
+compact(const flex_vector<T, MemoryPolicy, B, BL>& c)
+{
+    auto t = flex_vector<T, MemoryPolicy, B, BL>{}.transient();
+    for_each_chunk(c, [&](auto first, auto last) {
+        for (; first != last; ++first)
+            t.push_back(*first);
+    });
+    return detail::pack_right_edge(std::move(t).persistent());
+}
+
+/*!
+ * Compacts the array `c`. @see compact
+ */
+template <typename T, typename MemoryPolicy>
+array<T, MemoryPolicy> compact(const array<T, MemoryPolicy>& c)
+{
+    return {c.begin(), c.end()};
+}
+
+/*!
+ * Compacts the map `c`. @see compact
+ */
+template <typename K,
+          typename T,
+          typename Hash,
+          typename Equal,
+          typename MemoryPolicy,
+          detail::hamts::bits_t B>
+map<K, T, Hash, Equal, MemoryPolicy, B>
+compact(const map<K, T, Hash, Equal, MemoryPolicy, B>& c)
+{
+    return c.impl().compact();
+}
+
+/*!
+ * Compacts the set `c`. @see compact
+ */
+template <typename T,
+          typename Hash,
+          typename Equal,
+          typename MemoryPolicy,
+          detail::hamts::bits_t B>
+set<T, Hash, Equal, MemoryPolicy, B>
+compact(const set<T, Hash, Equal, MemoryPolicy, B>& c)
+{
+    return c.impl().compact();
+}
+
+/*!
+ * Compacts the table `c`. @see compact
+ */
+template <typename T,
+          typename KeyFn,
+          typename Hash,
+          typename Equal,
+          typename MemoryPolicy,
+          detail::hamts::bits_t B>
+table<T, KeyFn, Hash, Equal, MemoryPolicy, B>
+compact(const table<T, KeyFn, Hash, Equal, MemoryPolicy, B>& c)
+{
+    return c.impl().compact();
+}
+
+/*!
+ * Compacts the box `c`. @see compact
+ */
+template <typename T, typename MemoryPolicy>
+box<T, MemoryPolicy> compact(const box<T, MemoryPolicy>& c)
+{
+    return box<T, MemoryPolicy>{c.get()};
+}
+
+/** @} */ // group: compaction
+
+} // namespace immer
@@ -80,6 +80,10 @@
 #define IMMER_DEBUG_STATS 0
 #endif
 
+#ifndef IMMER_ENABLE_NODE_STATS
+#define IMMER_ENABLE_NODE_STATS 0
+#endif
+
 #ifndef IMMER_DEBUG_DEEP_CHECK
 #define IMMER_DEBUG_DEEP_CHECK 0
 #endif
@@ -127,6 +131,15 @@
 #endif
 #endif
 
+// The lock free atom packs a pointer and a counter in a single 64 bit word,
+// relying on user space addresses fitting in the lower 48 bits.  That does
+// not hold with 5-level paging, 52 bit virtual addresses or tagged pointers,
+// so it has to be enabled explicitly.  When enabled, storing a pointer that
+// does not fit throws `std::runtime_error`.
+#ifndef IMMER_LOCK_FREE_ATOM
+#define IMMER_LOCK_FREE_ATOM 0
+#endif
+
 #ifndef IMMER_THROW_ON_INVALID_STATE
 #define IMMER_THROW_ON_INVALID_STATE 0
 #endif
@@ -12,6 +12,7 @@
 #include <immer/detail/combine_standard_layout.hpp>
 #include <immer/detail/type_traits.hpp>
 #include <immer/detail/util.hpp>
+#include <immer/node_stats.hpp>
 
 #include <cstddef>
 #include <limits>
@@ -56,18 +57,22 @@ struct node
 
     bool can_mutate(edit_t e) const
     {
-        return refs().unique() || ownee().can_mutate(e);
+        return IMMER_NODE_STATS_TRANSIENT(refs().unique() ||
+                                          ownee().can_mutate(e));
     }
 
     static void delete_n(node_t* p, size_t sz, size_t cap)
     {
         detail::destroy_n(p->data(), sz);
+        IMMER_NODE_STATS_FREED(array);
         heap::deallocate(sizeof_n(cap), p);
     }
 
     static node_t* make_n(size_t n)
     {
-        return new (heap::allocate(sizeof_n(n))) node_t{};
+        auto p = new (heap::allocate(sizeof_n(n))) node_t{};
+        IMMER_NODE_STATS_ALLOCATED(array);
+        return p;
     }
 
     static node_t* make_e(edit_t e, size_t n)
@@ -85,6 +90,7 @@ struct node
             return p;
         }
         IMMER_CATCH (...) {
+            IMMER_NODE_STATS_FREED(array);
             heap::deallocate(sizeof_n(n), p);
             IMMER_RETHROW;
         }
@@ -102,6 +108,7 @@ struct node
             return p;
         }
         IMMER_CATCH (...) {
+            IMMER_NODE_STATS_FREED(array);
             heap::deallocate(sizeof_n(n), p);
             IMMER_RETHROW;
         }
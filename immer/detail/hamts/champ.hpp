@@ -197,6 +197,58 @@ struct champ
             node_t::delete_deep(root, 0);
     }
 
+    /*!
+     * Copies the node and everything under it, depth first, so that every
+     * inner node is followed in memory by its values and its children.
+     */
+    static node_t* do_compact(const node_t* src, count_t depth)
+    {
+        if (depth < max_depth<hash_t, B>) {
+            auto n                         = src->children_count();
+            auto nv                        = src->data_count();
+            auto dst                       = node_t::make_inner_n(n, nv);
+            dst->impl.d.data.inner.datamap = src->datamap();
+            dst->impl.d.data.inner.nodemap = src->nodemap();
+            if (nv) {
+                IMMER_TRY {
+                    detail::uninitialized_copy(
+                        src->values(), src->values() + nv, dst->values());
+                }
+                IMMER_CATCH (...) {
+                    node_t::deallocate_inner(dst, n, nv);
+                    IMMER_RETHROW;
+                }
+            }
+            auto i = count_t{};
+            IMMER_TRY {
+                for (; i < n; ++i)
+                    dst->children()[i] =
+                        do_compact(src->children()[i], depth + 1);
+            }
+            IMMER_CATCH (...) {
+                while (i--)
+                    node_t::delete_deep(dst->children()[i], depth + 1);
+                node_t::delete_inner(dst);
+                IMMER_RETHROW;
+            }
+            return dst;
+        } else {
+            auto n   = src->collision_count();
+            auto dst = node_t::make_collision_n(n);
+            IMMER_TRY {
+                detail::uninitialized_copy(
+                    src->collisions(), src->collisions() + n, dst->collisions());
+            }
+            IMMER_CATCH (...) {
+                node_t::deallocate_collision(dst, n);
+                IMMER_RETHROW;
+            }
+            return dst;
+        }
+    }
+
+    champ compact() const { return {do_compact(root, 0), size}; }
+
     std::size_t do_check_champ(node_t* node,
                                count_t depth,
                                size_t path_hash,
@@ -628,6 +680,7 @@ struct champ
 
     champ add(T v) const
     {
+        IMMER_NODE_STATS_OPERATION();
         auto hash     = Hash{}(v);
         auto res      = do_add(root, std::move(v), hash, 0);
         auto new_size = size + (res.added ? 1 : 0);
@@ -841,6 +894,7 @@ struct champ
               typename Fn>
     champ update(const K& k, Fn&& fn) const
     {
+        IMMER_NODE_STATS_OPERATION();
         auto hash = Hash{}(k);
         auto res  = do_update<Project, Default, Combine>(
             root, k, std::forward<Fn>(fn), hash, 0);
@@ -906,6 +960,7 @@ struct champ
     template <typename Project, typename Combine, typename K, typename Fn>
     champ update_if_exists(const K& k, Fn&& fn) const
     {
+        IMMER_NODE_STATS_OPERATION();
         auto hash = Hash{}(k);
         auto res  = do_update_if_exists<Project, Combine>(
             root, k, std::forward<Fn>(fn), hash, 0);
@@ -1280,6 +1335,7 @@ struct champ
     template <typename K>
     champ sub(const K& k) const
     {
+        IMMER_NODE_STATS_OPERATION();
         auto hash = Hash{}(k);
         auto res  = do_sub(root, k, hash, 0);
         switch (res.kind) {
@@ -12,6 +12,7 @@
 #include <immer/detail/combine_standard_layout.hpp>
 #include <immer/detail/hamts/bits.hpp>
 #include <immer/detail/util.hpp>
+#include <immer/node_stats.hpp>
 
 #include <cassert>
 #include <cstddef>
@@ -205,7 +206,8 @@ struct node
     static ownee_t& ownee(values_t* x) { return get<ownee_t>(*x); }
     static bool can_mutate(values_t* x, edit_t e)
     {
-        return refs(x).unique() || ownee(x).can_mutate(e);
+        return IMMER_NODE_STATS_TRANSIENT(refs(x).unique() ||
+                                          ownee(x).can_mutate(e));
     }
 
     static refs_t& refs(const node_t* x)
@@ -220,7 +222,8 @@ struct node
 
     bool can_mutate(edit_t e) const
     {
-        return refs(this).unique() || ownee(this).can_mutate(e);
+        return IMMER_NODE_STATS_TRANSIENT(refs(this).unique() ||
+                                          ownee(this).can_mutate(e));
     }
     bool can_mutate_values(edit_t e) const
     {
@@ -245,6 +248,7 @@ struct node
     {
         assert(n <= branches<B>);
         auto m = heap::allocate(sizeof_inner_n(n));
+        IMMER_NODE_STATS_ALLOCATED(champ_inner);
         return make_inner_n_into(m, sizeof_inner_n(n), n);
     }
 
@@ -266,6 +270,7 @@ struct node
             IMMER_TRY {
                 p->impl.d.data.inner.values =
                     new (heap::allocate(sizeof_values_n(nv))) values_t{};
+                IMMER_NODE_STATS_ALLOCATED(champ_values);
             }
             IMMER_CATCH (...) {
                 deallocate_inner(p, n);
@@ -333,6 +338,7 @@ struct node
     {
         auto m = heap::allocate(sizeof_collision_n(n));
         auto p = new (m) node_t;
+        IMMER_NODE_STATS_ALLOCATED(collision);
 #if IMMER_TAGGED_NODE
         p->impl.d.kind = node_t::kind_t::collision;
 #endif
@@ -344,6 +350,7 @@ struct node
     {
         auto m = heap::allocate(sizeof_collision_n(2));
         auto p = new (m) node_t;
+        IMMER_NODE_STATS_ALLOCATED(collision);
 #if IMMER_TAGGED_NODE
         p->impl.d.kind = node_t::kind_t::collision;
 #endif
@@ -368,7 +375,7 @@ struct node
 
     T* ensure_mutable_values(edit_t e)
     {
-        assert(can_mutate(e));
+        assert(refs(this).unique() || ownee(this).can_mutate(e));
         auto old = impl.d.data.inner.values;
         if (node_t::can_mutate(old, e))
             return values();
@@ -378,6 +385,7 @@ struct node
             auto dst   = (T*) &nxt->d.buffer;
             auto src   = values();
             ownee(nxt) = e;
+            IMMER_NODE_STATS_ALLOCATED(champ_values);
             IMMER_TRY {
                 detail::uninitialized_copy(src, src + nv, dst);
             }
@@ -1126,25 +1134,27 @@ struct node
 
     static void deallocate_values(values_t* p, count_t n)
     {
+        IMMER_NODE_STATS_FREED(champ_values);
         heap::deallocate(node_t::sizeof_values_n(n), p);
     }
 
     static void deallocate_collision(node_t* p, count_t n)
     {
+        IMMER_NODE_STATS_FREED(collision);
         heap::deallocate(node_t::sizeof_collision_n(n), p);
     }
 
     static void deallocate_inner(node_t* p, count_t n)
     {
+        IMMER_NODE_STATS_FREED(champ_inner);
         heap::deallocate(node_t::sizeof_inner_n(n), p);
     }
 
     static void deallocate_inner(node_t* p, count_t n, count_t nv)
     {
         assert(nv);
-        heap::deallocate(node_t::sizeof_values_n(nv),
-                         p->impl.d.data.inner.values);
-        heap::deallocate(node_t::sizeof_inner_n(n), p);
+        deallocate_values(p->impl.d.data.inner.values, nv);
+        deallocate_inner(p, n);
     }
 };
 
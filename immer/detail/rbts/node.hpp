@@ -13,6 +13,7 @@
 #include <immer/detail/rbts/bits.hpp>
 #include <immer/detail/util.hpp>
 #include <immer/heap/tags.hpp>
+#include <immer/node_stats.hpp>
 
 #include <cassert>
 #include <cstddef>
@@ -214,6 +215,7 @@ struct node
     {
         assert(n <= branches<B>);
         auto m = heap::allocate(sizeof_inner_n(n));
+        IMMER_NODE_STATS_ALLOCATED(inner);
         return make_inner_n_into(m, sizeof_inner_n(n), n);
     }
 
@@ -221,6 +223,7 @@ struct node
     {
         auto m                       = heap::allocate(max_sizeof_inner);
         auto p                       = new (m) node_t;
+        IMMER_NODE_STATS_ALLOCATED(inner);
         ownee(p)                     = e;
         p->impl.d.data.inner.relaxed = nullptr;
 #if IMMER_TAGGED_NODE
@@ -248,6 +251,7 @@ struct node
         auto p                       = new (mp) node_t;
         auto r                       = new (mr) relaxed_t;
         r->d.count                   = 0;
+        IMMER_NODE_STATS_ALLOCATED(relaxed);
         p->impl.d.data.inner.relaxed = r;
 #if IMMER_TAGGED_NODE
         p->impl.d.kind = node_t::kind_t::inner;
@@ -262,6 +266,7 @@ struct node
             [&](auto) {
                 auto p =
                     new (heap::allocate(node_t::sizeof_inner_r_n(n))) node_t;
+                IMMER_NODE_STATS_ALLOCATED(relaxed);
                 assert(r->d.count >= n);
                 node_t::refs(r).inc();
                 p->impl.d.data.inner.relaxed = r;
@@ -290,6 +295,7 @@ struct node
         auto p   = new (mp) node_t;
         auto r   = new (mr) relaxed_t;
         ownee(p) = e;
+        IMMER_NODE_STATS_ALLOCATED(relaxed);
         static_if<!embed_relaxed>([&](auto) { node_t::ownee(r) = e; });
         r->d.count                   = 0;
         p->impl.d.data.inner.relaxed = r;
@@ -306,6 +312,7 @@ struct node
             [&](auto) {
                 auto p =
                     new (heap::allocate(node_t::max_sizeof_inner_r)) node_t;
+                IMMER_NODE_STATS_ALLOCATED(relaxed);
                 node_t::refs(r).inc();
                 p->impl.d.data.inner.relaxed = r;
                 node_t::ownee(p)             = e;
@@ -331,6 +338,7 @@ struct node
     {
         assert(n <= branches<BL>);
         auto m = heap::allocate(sizeof_leaf_n(n));
+        IMMER_NODE_STATS_ALLOCATED(leaf);
         return make_leaf_n_into(m, sizeof_leaf_n(n), n);
     }
 
@@ -338,6 +346,7 @@ struct node
     {
         auto p   = new (heap::allocate(max_sizeof_leaf)) node_t;
         ownee(p) = e;
+        IMMER_NODE_STATS_ALLOCATED(leaf);
 #if IMMER_TAGGED_NODE
         p->impl.d.kind = node_t::kind_t::leaf;
 #endif
@@ -464,6 +473,7 @@ struct node
             new (p->leaf()) T{std::forward<U>(x)};
         }
         IMMER_CATCH (...) {
+            IMMER_NODE_STATS_FREED(leaf);
             heap::deallocate(node_t::sizeof_leaf_n(n), p);
             IMMER_RETHROW;
         }
@@ -478,6 +488,7 @@ struct node
             new (p->leaf()) T{std::forward<U>(x)};
         }
         IMMER_CATCH (...) {
+            IMMER_NODE_STATS_FREED(leaf);
             heap::deallocate(node_t::max_sizeof_leaf, p);
             IMMER_RETHROW;
         }
@@ -495,6 +506,7 @@ struct node
                 n->inner()[0] = make_path(shift - B, node);
             }
             IMMER_CATCH (...) {
+                IMMER_NODE_STATS_FREED(inner);
                 heap::deallocate(node_t::sizeof_inner_n(1), n);
                 IMMER_RETHROW;
             }
@@ -513,6 +525,7 @@ struct node
                 n->inner()[0] = make_path_e(e, shift - B, node);
             }
             IMMER_CATCH (...) {
+                IMMER_NODE_STATS_FREED(inner);
                 heap::deallocate(node_t::max_sizeof_inner, n);
                 IMMER_RETHROW;
             }
@@ -661,6 +674,7 @@ struct node
                 src->leaf(), src->leaf() + n, dst->leaf());
         }
         IMMER_CATCH (...) {
+            IMMER_NODE_STATS_FREED(leaf);
             heap::deallocate(node_t::sizeof_leaf_n(n), dst);
             IMMER_RETHROW;
         }
@@ -676,6 +690,7 @@ struct node
                 src->leaf(), src->leaf() + n, dst->leaf());
         }
         IMMER_CATCH (...) {
+            IMMER_NODE_STATS_FREED(leaf);
             heap::deallocate(node_t::max_sizeof_leaf, dst);
             IMMER_RETHROW;
         }
@@ -692,6 +707,7 @@ struct node
                 src->leaf(), src->leaf() + n, dst->leaf());
         }
         IMMER_CATCH (...) {
+            IMMER_NODE_STATS_FREED(leaf);
             heap::deallocate(node_t::sizeof_leaf_n(allocn), dst);
             IMMER_RETHROW;
         }
@@ -708,6 +724,7 @@ struct node
                 src1->leaf(), src1->leaf() + n1, dst->leaf());
         }
         IMMER_CATCH (...) {
+            IMMER_NODE_STATS_FREED(leaf);
             heap::deallocate(node_t::sizeof_leaf_n(n1 + n2), dst);
             IMMER_RETHROW;
         }
@@ -717,6 +734,7 @@ struct node
         }
         IMMER_CATCH (...) {
             detail::destroy_n(dst->leaf(), n1);
+            IMMER_NODE_STATS_FREED(leaf);
             heap::deallocate(node_t::sizeof_leaf_n(n1 + n2), dst);
             IMMER_RETHROW;
         }
@@ -734,6 +752,7 @@ struct node
                 src1->leaf(), src1->leaf() + n1, dst->leaf());
         }
         IMMER_CATCH (...) {
+            IMMER_NODE_STATS_FREED(leaf);
             heap::deallocate(max_sizeof_leaf, dst);
             IMMER_RETHROW;
         }
@@ -743,6 +762,7 @@ struct node
         }
         IMMER_CATCH (...) {
             detail::destroy_n(dst->leaf(), n1);
+            IMMER_NODE_STATS_FREED(leaf);
             heap::deallocate(max_sizeof_leaf, dst);
             IMMER_RETHROW;
         }
@@ -758,6 +778,7 @@ struct node
                 src->leaf() + idx, src->leaf() + last, dst->leaf());
         }
         IMMER_CATCH (...) {
+            IMMER_NODE_STATS_FREED(leaf);
             heap::deallocate(max_sizeof_leaf, dst);
             IMMER_RETHROW;
         }
@@ -773,6 +794,7 @@ struct node
                 src->leaf() + idx, src->leaf() + last, dst->leaf());
         }
         IMMER_CATCH (...) {
+            IMMER_NODE_STATS_FREED(leaf);
             heap::deallocate(node_t::sizeof_leaf_n(last - idx), dst);
             IMMER_RETHROW;
         }
@@ -788,6 +810,7 @@ struct node
         }
         IMMER_CATCH (...) {
             detail::destroy_n(dst->leaf(), n);
+            IMMER_NODE_STATS_FREED(leaf);
             heap::deallocate(node_t::sizeof_leaf_n(n + 1), dst);
             IMMER_RETHROW;
         }
@@ -798,6 +821,7 @@ struct node
     {
         IMMER_ASSERT_TAGGED(p->kind() == kind_t::inner);
         assert(!p->relaxed());
+        IMMER_NODE_STATS_FREED(inner);
         heap::deallocate(ownee(p).owned() ? node_t::max_sizeof_inner
                                           : node_t::sizeof_inner_n(n),
                          p);
@@ -807,6 +831,7 @@ struct node
     {
         IMMER_ASSERT_TAGGED(p->kind() == kind_t::inner);
         assert(!p->relaxed());
+        IMMER_NODE_STATS_FREED(inner);
         heap::deallocate(node_t::max_sizeof_inner, p);
     }
 
@@ -830,6 +855,7 @@ struct node
                                      : node_t::sizeof_relaxed_n(n),
                                  r);
         });
+        IMMER_NODE_STATS_FREED(relaxed);
         heap::deallocate(ownee(p).owned() ? node_t::max_sizeof_inner_r
                                           : node_t::sizeof_inner_r_n(n),
                          p);
@@ -844,6 +870,7 @@ struct node
             if (node_t::refs(r).dec())
                 heap::deallocate(node_t::max_sizeof_relaxed, r);
         });
+        IMMER_NODE_STATS_FREED(relaxed);
         heap::deallocate(node_t::max_sizeof_inner_r, p);
     }
 
@@ -851,6 +878,7 @@ struct node
     {
         IMMER_ASSERT_TAGGED(p->kind() == kind_t::leaf);
         detail::destroy_n(p->leaf(), n);
+        IMMER_NODE_STATS_FREED(leaf);
         heap::deallocate(ownee(p).owned() ? node_t::max_sizeof_leaf
                                           : node_t::sizeof_leaf_n(n),
                          p);
@@ -858,7 +886,8 @@ struct node
 
     bool can_mutate(edit_t e) const
     {
-        return refs(this).unique() || ownee(this).can_mutate(e);
+        return IMMER_NODE_STATS_TRANSIENT(refs(this).unique() ||
+                                          ownee(this).can_mutate(e));
     }
 
     bool can_relax() const { return !embed_relaxed || relaxed(); }
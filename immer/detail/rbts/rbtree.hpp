@@ -14,6 +14,7 @@
 #include <immer/detail/rbts/position.hpp>
 #include <immer/detail/type_traits.hpp>
 
+#include <algorithm>
 #include <cassert>
 #include <memory>
 #include <numeric>
@@ -278,33 +279,7 @@ struct rbtree
         } else {
             auto new_tail = node_t::make_leaf_e(e, std::move(value));
             IMMER_TRY {
-                if (tail_off == size_t{branches<B>} << shift) {
-                    auto new_root = node_t::make_inner_e(e);
-                    IMMER_TRY {
-                        auto path = node_t::make_path_e(e, shift, tail);
-                        new_root->inner()[0] = root;
-                        new_root->inner()[1] = path;
-                        root                 = new_root;
-                        tail                 = new_tail;
-                        shift += B;
-                    }
-                    IMMER_CATCH (...) {
-                        node_t::delete_inner_e(new_root);
-                        IMMER_RETHROW;
-                    }
-                } else if (tail_off) {
-                    auto new_root =
-                        make_regular_sub_pos(root, shift, tail_off)
-                            .visit(push_tail_mut_visitor<node_t>{}, e, tail);
-                    root = new_root;
-                    tail = new_tail;
-                } else {
-                    auto new_root = node_t::make_path_e(e, shift, tail);
-                    assert(tail_off == 0);
-                    dec_empty_regular(root);
-                    root = new_root;
-                    tail = new_tail;
-                }
+                push_tail_mut(e, tail_off, new_tail);
             }
             IMMER_CATCH (...) {
                 node_t::delete_leaf(new_tail, 1);
@@ -314,8 +289,82 @@ struct rbtree
         ++size;
     }
 
+    /*!
+     * Appends `n` values, filling a leaf at a time.  `fill(first, count)`
+     * must construct `count` values starting at `first`, or throw without
+     * constructing any.
+     */
+    template <typename Fn>
+    void push_back_n_mut(edit_t e, size_t n, Fn&& fill)
+    {
+        while (n > 0) {
+            auto tail_off = tail_offset();
+            auto ts       = static_cast<count_t>(size - tail_off);
+            auto count    = count_t{};
+            if (ts < branches<BL>) {
+                count = static_cast<count_t>(std::min(
+                    n, static_cast<size_t>(branches<BL> - ts)));
+                ensure_mutable_tail(e, ts);
+                fill(tail->leaf() + ts, count);
+            } else {
+                count = static_cast<count_t>(
+                    std::min(n, static_cast<size_t>(branches<BL>)));
+                auto new_tail = node_t::make_leaf_e(e);
+                IMMER_TRY {
+                    fill(new_tail->leaf(), count);
+                }
+                IMMER_CATCH (...) {
+                    node_t::delete_leaf(new_tail, 0);
+                    IMMER_RETHROW;
+                }
+                IMMER_TRY {
+                    push_tail_mut(e, tail_off, new_tail);
+                }
+                IMMER_CATCH (...) {
+                    node_t::delete_leaf(new_tail, count);
+                    IMMER_RETHROW;
+                }
+            }
+            size += count;
+            n -= count;
+        }
+    }
+
+    // Moves the full tail into the tree, making `new_tail` the tail.
+    void push_tail_mut(edit_t e, size_t tail_off, node_t* new_tail)
+    {
+        if (tail_off == size_t{branches<B>} << shift) {
+            auto new_root = node_t::make_inner_e(e);
+            IMMER_TRY {
+                auto path            = node_t::make_path_e(e, shift, tail);
+                new_root->inner()[0] = root;
+                new_root->inner()[1] = path;
+                root                 = new_root;
+                tail                 = new_tail;
+                shift += B;
+            }
+            IMMER_CATCH (...) {
+                node_t::delete_inner_e(new_root);
+                IMMER_RETHROW;
+            }
+        } else if (tail_off) {
+            auto new_root =
+                make_regular_sub_pos(root, shift, tail_off)
+                    .visit(push_tail_mut_visitor<node_t>{}, e, tail);
+            root = new_root;
+            tail = new_tail;
+        } else {
+            auto new_root = node_t::make_path_e(e, shift, tail);
+            assert(tail_off == 0);
+            dec_empty_regular(root);
+            root = new_root;
+            tail = new_tail;
+        }
+    }
+
     rbtree push_back(T value) const
     {
+        IMMER_NODE_STATS_OPERATION();
         auto tail_off = tail_offset();
         auto ts       = size - tail_off;
         if (ts < branches<BL>) {
@@ -401,6 +450,7 @@ struct rbtree
     template <typename FnT>
     rbtree update(size_t idx, FnT&& fn) const
     {
+        IMMER_NODE_STATS_OPERATION();
         auto tail_off = tail_offset();
         if (idx >= tail_off) {
             auto tail_size = size - tail_off;
@@ -422,11 +472,13 @@ struct rbtree
 
     rbtree assoc(size_t idx, T value) const
     {
+        IMMER_NODE_STATS_OPERATION();
         return update(idx, [&](auto&&) { return std::move(value); });
     }
 
     rbtree take(size_t new_size) const
     {
+        IMMER_NODE_STATS_OPERATION();
         auto tail_off = tail_offset();
         if (new_size == 0) {
             return {};
@@ -498,6 +498,7 @@ struct rrbtree
 
     rrbtree push_back(T value) const
     {
+        IMMER_NODE_STATS_OPERATION();
         auto ts = tail_size();
         if (ts < branches<BL>) {
             auto new_tail =
@@ -578,6 +579,7 @@ struct rrbtree
     template <typename FnT>
     rrbtree update(size_t idx, FnT&& fn) const
     {
+        IMMER_NODE_STATS_OPERATION();
         auto tail_off = tail_offset();
         if (idx >= tail_off) {
             auto tail_size = size - tail_off;
@@ -599,6 +601,7 @@ struct rrbtree
 
     rrbtree assoc(size_t idx, T value) const
     {
+        IMMER_NODE_STATS_OPERATION();
         return update(idx, [&](auto&&) { return std::move(value); });
     }
 
@@ -645,6 +648,7 @@ struct rrbtree
 
     rrbtree take(size_t new_size) const
     {
+        IMMER_NODE_STATS_OPERATION();
         auto tail_off = tail_offset();
         if (new_size == 0) {
             return {};
@@ -709,6 +713,7 @@ struct rrbtree
 
     rrbtree drop(size_t elems) const
     {
+        IMMER_NODE_STATS_OPERATION();
         if (elems == 0) {
             return *this;
         } else if (elems >= size) {
@@ -733,6 +738,7 @@ struct rrbtree
 
     rrbtree concat(const rrbtree& r) const
     {
+        IMMER_NODE_STATS_OPERATION();
         assert(r.size + size <= max_size());
         using std::get;
         if (size == 0)
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cereal/cereal.hpp>
+#include <immer/algorithm.hpp>
+
+#include <cstddef>
+#include <type_traits>
+
+namespace cereal {
+namespace immer_detail {
+
+/*!
+ * Whether sequences of `T` can be written to `Archive` as a single blob of
+ * bytes per contiguous chunk.  Like for `std::vector`, this is only done for
+ * arithmetic types, so that the portable binary archive can still swap the
+ * bytes of each value.  The result is the same as when writing the values
+ * one by one.
+ */
+template <class Archive, class T>
+constexpr bool can_save_bulk_v =
+    traits::is_output_serializable<BinaryData<T>, Archive>::value &&
+    std::is_arithmetic<T>::value && !std::is_same<T, bool>::value;
+
+template <class Archive, class T>
+constexpr bool can_load_bulk_v =
+    traits::is_input_serializable<BinaryData<T>, Archive>::value &&
+    std::is_arithmetic<T>::value && !std::is_same<T, bool>::value;
+
+template <class Archive, class Range>
+std::enable_if_t<!can_save_bulk_v<Archive, typename Range::value_type>>
+save_values(Archive& ar, const Range& r)
+{
+    for (auto&& v : r)
+        ar(v);
+}
+
+template <class Archive, class Range>
+std::enable_if_t<can_save_bulk_v<Archive, typename Range::value_type>>
+save_values(Archive& ar, const Range& r)
+{
+    using value_t = typename Range::value_type;
+    immer::for_each_chunk(r, [&](auto first, auto last) {
+        if (first == last)
+            return;
+        ar(binary_data(first,
+                       static_cast<std::size_t>(last - first) *
+                           sizeof(value_t)));
+    });
+}
+
+} // namespace immer_detail
+} // namespace cereal
@@ -2,11 +2,14 @@
 
 #include <cereal/cereal.hpp>
 #include <immer/array.hpp>
+#include <immer/array_transient.hpp>
+#include <immer/extra/cereal/detail/bulk.hpp>
 
 namespace cereal {
 
 template <typename Archive, typename T, typename MemoryPolicy>
-void CEREAL_LOAD_FUNCTION_NAME(Archive& ar, immer::array<T, MemoryPolicy>& m)
+std::enable_if_t<!immer_detail::can_load_bulk_v<Archive, T>>
+CEREAL_LOAD_FUNCTION_NAME(Archive& ar, immer::array<T, MemoryPolicy>& m)
 {
     size_type size;
     ar(make_size_tag(size));
@@ -19,13 +22,24 @@ void CEREAL_LOAD_FUNCTION_NAME(Archive& ar, immer::array<T, MemoryPolicy>& m)
     }
 }
 
+template <typename Archive, typename T, typename MemoryPolicy>
+std::enable_if_t<immer_detail::can_load_bulk_v<Archive, T>>
+CEREAL_LOAD_FUNCTION_NAME(Archive& ar, immer::array<T, MemoryPolicy>& m)
+{
+    size_type size;
+    ar(make_size_tag(size));
+
+    auto t = immer::array<T, MemoryPolicy>(size).transient();
+    ar(binary_data(t.data_mut(), size * sizeof(T)));
+    m = std::move(t).persistent();
+}
+
 template <typename Archive, typename T, typename MemoryPolicy>
 void CEREAL_SAVE_FUNCTION_NAME(Archive& ar,
                                const immer::array<T, MemoryPolicy>& m)
 {
     ar(make_size_tag(static_cast<size_type>(m.size())));
-    for (auto&& v : m)
-        ar(v);
+    immer_detail::save_values(ar, m);
 }
 
 } // namespace cereal
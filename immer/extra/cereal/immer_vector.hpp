@@ -1,6 +1,8 @@
 #pragma once
 
 #include <cereal/cereal.hpp>
+#include <immer/extra/cereal/detail/bulk.hpp>
+#include <immer/flex_vector.hpp>
 #include <immer/vector.hpp>
 
 namespace cereal {
@@ -10,8 +12,8 @@ template <typename Archive,
           typename MemoryPolicy,
           immer::detail::rbts::bits_t B,
           immer::detail::rbts::bits_t BL>
-void CEREAL_LOAD_FUNCTION_NAME(Archive& ar,
-                               immer::vector<T, MemoryPolicy, B, BL>& m)
+std::enable_if_t<!immer_detail::can_load_bulk_v<Archive, T>>
+CEREAL_LOAD_FUNCTION_NAME(Archive& ar, immer::vector<T, MemoryPolicy, B, BL>& m)
 {
     size_type size;
     ar(make_size_tag(size));
@@ -24,6 +26,30 @@ void CEREAL_LOAD_FUNCTION_NAME(Archive& ar,
     }
 }
 
+/*!
+ * Reads the values straight into the leaves, a leaf at a time.
+ */
+template <typename Archive,
+          typename T,
+          typename MemoryPolicy,
+          immer::detail::rbts::bits_t B,
+          immer::detail::rbts::bits_t BL>
+std::enable_if_t<immer_detail::can_load_bulk_v<Archive, T>>
+CEREAL_LOAD_FUNCTION_NAME(Archive& ar, immer::vector<T, MemoryPolicy, B, BL>& m)
+{
+    using impl_t = immer::detail::rbts::rbtree<T, MemoryPolicy, B, BL>;
+
+    size_type size;
+    ar(make_size_tag(size));
+
+    auto impl  = impl_t{};
+    auto owner = typename impl_t::owner_t{};
+    impl.push_back_n_mut(owner, size, [&](T* first, std::size_t count) {
+        ar(binary_data(first, count * sizeof(T)));
+    });
+    m = immer::vector<T, MemoryPolicy, B, BL>{std::move(impl)};
+}
+
 template <typename Archive,
           typename T,
           typename MemoryPolicy,
@@ -33,8 +59,7 @@ void CEREAL_SAVE_FUNCTION_NAME(Archive& ar,
                                const immer::vector<T, MemoryPolicy, B, BL>& m)
 {
     ar(make_size_tag(static_cast<size_type>(m.size())));
-    for (auto&& v : m)
-        ar(v);
+    immer_detail::save_values(ar, m);
 }
 
 template <typename Archive,
@@ -42,8 +67,9 @@ template <typename Archive,
           typename MemoryPolicy,
           immer::detail::rbts::bits_t B,
           immer::detail::rbts::bits_t BL>
-void CEREAL_LOAD_FUNCTION_NAME(Archive& ar,
-                               immer::flex_vector<T, MemoryPolicy, B, BL>& m)
+std::enable_if_t<!immer_detail::can_load_bulk_v<Archive, T>>
+CEREAL_LOAD_FUNCTION_NAME(Archive& ar,
+                          immer::flex_vector<T, MemoryPolicy, B, BL>& m)
 {
     size_type size;
     ar(make_size_tag(size));
@@ -56,6 +82,22 @@ void CEREAL_LOAD_FUNCTION_NAME(Archive& ar,
     }
 }
 
+template <typename Archive,
+          typename T,
+          typename MemoryPolicy,
+          immer::detail::rbts::bits_t B,
+          immer::detail::rbts::bits_t BL>
+std::enable_if_t<immer_detail::can_load_bulk_v<Archive, T>>
+CEREAL_LOAD_FUNCTION_NAME(Archive& ar,
+                          immer::flex_vector<T, MemoryPolicy, B, BL>& m)
+{
+    // Load it as a regular vector, that can be turned into a flex vector
+    // without copying.
+    auto v = immer::vector<T, MemoryPolicy, B, BL>{};
+    CEREAL_LOAD_FUNCTION_NAME(ar, v);
+    m = std::move(v);
+}
+
 template <typename Archive,
           typename T,
           typename MemoryPolicy,
@@ -65,8 +107,7 @@ void CEREAL_SAVE_FUNCTION_NAME(
     Archive& ar, const immer::flex_vector<T, MemoryPolicy, B, BL>& m)
 {
     ar(make_size_tag(static_cast<size_type>(m.size())));
-    for (auto&& v : m)
-        ar(v);
+    immer_detail::save_values(ar, m);
 }
 
 } // namespace cereal
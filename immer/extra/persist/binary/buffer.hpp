@@ -0,0 +1,162 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstring>
+#include <istream>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#if __has_include(<sys/mman.h>)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#define IMMER_PERSIST_HAS_MMAP 1
+#else
+#define IMMER_PERSIST_HAS_MMAP 0
+#endif
+
+namespace immer::persist::binary {
+
+/**
+ * Owning, suitably aligned memory for reading a binary pool that is not
+ * memory mapped.
+ *
+ * @ingroup persist-binary
+ */
+class buffer
+{
+public:
+    buffer() = default;
+
+    explicit buffer(std::size_t size)
+        : data_{new std::max_align_t[(size + sizeof(std::max_align_t) - 1) /
+                                     sizeof(std::max_align_t)]}
+        , size_{size}
+    {
+    }
+
+    explicit buffer(std::string_view bytes)
+        : buffer{bytes.size()}
+    {
+        std::memcpy(data(), bytes.data(), bytes.size());
+    }
+
+    /**
+     * Reads the rest of the stream `is`.
+     */
+    static buffer read(std::istream& is)
+    {
+        auto bytes = std::string{std::istreambuf_iterator<char>{is},
+                                 std::istreambuf_iterator<char>{}};
+        return buffer{std::string_view{bytes}};
+    }
+
+    char* data() { return reinterpret_cast<char*>(data_.get()); }
+    const char* data() const
+    {
+        return reinterpret_cast<const char*>(data_.get());
+    }
+    std::size_t size() const { return size_; }
+
+    std::string_view bytes() const { return {data(), size_}; }
+
+private:
+    std::unique_ptr<std::max_align_t[]> data_;
+    std::size_t size_ = 0;
+};
+
+#if IMMER_PERSIST_HAS_MMAP
+
+/**
+ * How the pages of a `mapped_file` are going to be accessed.
+ *
+ * @ingroup persist-binary
+ */
+enum class access_pattern
+{
+    normal,
+    //! Only a few values are looked up, do not read ahead.
+    random,
+    //! Most of the pool is going to be loaded or traversed.
+    sequential,
+};
+
+/**
+ * Read-only memory mapping of a whole file, to access a binary pool in place.
+ * Only the pages that are actually accessed are read from disk, and the
+ * operating system is free to evict them when memory is needed, so a pool
+ * that is much bigger than the available memory can still be read.
+ *
+ * @ingroup persist-binary
+ */
+class mapped_file
+{
+public:
+    explicit mapped_file(const std::string& path,
+                         access_pattern pattern = access_pattern::normal)
+    {
+        auto fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0)
+            throw std::system_error{errno, std::generic_category(), path};
+        struct ::stat st;
+        if (::fstat(fd, &st) < 0) {
+            auto err = errno;
+            ::close(fd);
+            throw std::system_error{err, std::generic_category(), path};
+        }
+        size_ = static_cast<std::size_t>(st.st_size);
+        if (size_) {
+            auto p = ::mmap(nullptr, size_, PROT_READ, MAP_SHARED, fd, 0);
+            if (p == MAP_FAILED) {
+                auto err = errno;
+                ::close(fd);
+                throw std::system_error{err, std::generic_category(), path};
+            }
+            data_ = static_cast<const char*>(p);
+            // The advice is only a hint, so failing to apply it is ignored.
+            if (pattern == access_pattern::random)
+                ::madvise(p, size_, MADV_RANDOM);
+            else if (pattern == access_pattern::sequential)
+                ::madvise(p, size_, MADV_SEQUENTIAL);
+        }
+        ::close(fd);
+    }
+
+    mapped_file(mapped_file&& other)
+        : data_{std::exchange(other.data_, nullptr)}
+        , size_{std::exchange(other.size_, 0)}
+    {
+    }
+
+    mapped_file& operator=(mapped_file&& other)
+    {
+        std::swap(data_, other.data_);
+        std::swap(size_, other.size_);
+        return *this;
+    }
+
+    mapped_file(const mapped_file&)            = delete;
+    mapped_file& operator=(const mapped_file&) = delete;
+
+    ~mapped_file()
+    {
+        if (data_)
+            ::munmap(const_cast<char*>(data_), size_);
+    }
+
+    std::string_view bytes() const { return {data_, size_}; }
+
+private:
+    const char* data_  = nullptr;
+    std::size_t size_ = 0;
+};
+
+#endif // IMMER_PERSIST_HAS_MMAP
+
+} // namespace immer::persist::binary
@@ -0,0 +1,185 @@
+#pragma once
+
+#include <immer/extra/persist/errors.hpp>
+
+#include <cstdint>
+#include <type_traits>
+#include <utility>
+
+namespace immer::persist::binary {
+
+/**
+ * @defgroup persist-binary
+ */
+
+/**
+ * Position of a record in a binary pool, in bytes from the beginning of it.
+ * The records of a binary pool refer to each other with offsets, so that a
+ * pool can be read in place, without first building a table of node ids.
+ *
+ * @ingroup persist-binary
+ */
+using offset_t = std::uint64_t;
+
+inline constexpr std::uint32_t format_version  = 1;
+inline constexpr std::uint32_t byte_order_mark = 0x01020304u;
+
+inline constexpr char header_magic[8] = {
+    'I', 'M', 'M', 'E', 'R', 'B', 'I', 'N'};
+inline constexpr char footer_magic[8] = {
+    'I', 'M', 'M', 'E', 'R', 'E', 'N', 'D'};
+
+/**
+ * Every record starts at an offset that is a multiple of this.
+ */
+inline constexpr std::size_t record_alignment = 8;
+
+/**
+ * Whether values of type `T` can be stored in a binary pool by copying their
+ * object representation.  This is the case for types that can be copied and
+ * destroyed trivially, that have no padding bits, and that do not refer to
+ * other memory.  Padding is detected with
+ * `std::has_unique_object_representations`, which also rejects `float` and
+ * `double` because of their several representations of zero and NaN, so
+ * those two are accepted explicitly, as are pairs of serializable types
+ * without padding between them.
+ *
+ * Pointers are excluded, but since that can not be checked for aggregates,
+ * this trait can be specialized to `std::false_type` for types that contain
+ * pointers or handles.  It can also be specialized to `std::true_type` to opt
+ * in types that are safe to copy bitwise but are not detected as such, like
+ * aggregates containing floating point members.  When such a type has
+ * padding, whatever bytes are in the padding in memory are written to the
+ * pool too, so they should be zeroed, for example by value-initializing the
+ * objects, to avoid leaking memory contents and to keep the pools
+ * reproducible.
+ *
+ * @ingroup persist-binary
+ */
+template <class T>
+struct is_bitwise_serializable
+    : std::bool_constant<std::is_trivially_copy_constructible_v<T> &&
+                         std::is_trivially_destructible_v<T> &&
+                         !std::is_pointer_v<T> &&
+                         (std::has_unique_object_representations_v<T> ||
+                          std::is_same_v<T, float> ||
+                          std::is_same_v<T, double>)>
+{};
+
+template <class A, class B>
+struct is_bitwise_serializable<std::pair<A, B>>
+    : std::bool_constant<
+          std::is_trivially_copy_constructible_v<std::pair<A, B>> &&
+          std::is_trivially_destructible_v<std::pair<A, B>> &&
+          is_bitwise_serializable<A>::value &&
+          is_bitwise_serializable<B>::value &&
+          sizeof(std::pair<A, B>) == sizeof(A) + sizeof(B)>
+{};
+
+template <class T>
+inline constexpr bool is_bitwise_serializable_v =
+    is_bitwise_serializable<T>::value;
+
+/**
+ * Which kind of tree is stored in a pool.
+ */
+enum class structure_kind : std::uint32_t
+{
+    rbts  = 1, //!< `vector` or `flex_vector`
+    champ = 2, //!< `map`, `set` or `table`
+};
+
+enum class record_kind : std::uint32_t
+{
+    leaf        = 1,
+    inner       = 2,
+    relaxed     = 3,
+    champ_inner = 4,
+    collision   = 5,
+};
+
+/**
+ * First bytes of a binary pool.  It describes the values and the tree
+ * parameters, which must match those of the container type used to read it.
+ */
+struct file_header
+{
+    char magic[8];
+    std::uint32_t version;
+    std::uint32_t byte_order;
+    std::uint32_t structure;
+    std::uint32_t value_size;
+    std::uint32_t value_align;
+    std::uint32_t bits;
+    std::uint32_t bits_leaf;
+    std::uint32_t reserved;
+};
+
+/**
+ * Every node is stored as a record that starts with this header, followed
+ * by its payload:
+ *
+ * - `leaf`: `count` values, aligned to `alignof(T)`.
+ * - `inner`: `count` child offsets.
+ * - `relaxed`: `count` child offsets, followed by `count` cumulative sizes.
+ * - `champ_inner`: the nodemap and datamap as 64-bit integers, `count` child
+ *   offsets and `popcount(datamap)` values, aligned to `alignof(T)`.
+ * - `collision`: `count` values, aligned to `alignof(T)`.
+ *
+ * Children are always written before their parents, so a child offset is
+ * always smaller than the offset of the node referring to it.
+ */
+struct record_header
+{
+    std::uint32_t kind;
+    std::uint32_t count;
+};
+
+/**
+ * Entry of the table of containers.  For `champ` pools, only `root` and
+ * `size` are meaningful.
+ */
+struct container_entry
+{
+    offset_t root;
+    offset_t tail;
+    std::uint64_t size;
+    std::uint64_t shift;
+};
+
+/**
+ * Written every time that the containers added to a pool are committed, it
+ * points to the table with the entries of those containers, and to the
+ * previous footer, or `0` for the first one.  The last bytes of a pool are
+ * always a footer, and following the chain of footers gives the entries for
+ * all the containers that it contains.
+ */
+struct file_footer
+{
+    offset_t containers;
+    std::uint64_t count;
+    offset_t previous;
+    char magic[8];
+};
+
+static_assert(sizeof(file_header) == 40);
+static_assert(sizeof(record_header) == 8);
+static_assert(sizeof(container_entry) == 32);
+static_assert(sizeof(file_footer) == 32);
+
+/**
+ * Thrown when the bytes being read are not a valid binary pool for the
+ * requested container type.
+ *
+ * @ingroup persist-exceptions
+ */
+class invalid_binary_pool : public pool_exception
+{
+public:
+    explicit invalid_binary_pool(const std::string& what)
+        : pool_exception{fmt::format("Invalid binary pool: {}", what)}
+    {
+    }
+};
+
+} // namespace immer::persist::binary
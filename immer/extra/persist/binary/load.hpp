@@ -0,0 +1,292 @@
+#pragma once
+
+#include <immer/extra/persist/detail/binary/traits.hpp>
+#include <immer/extra/persist/types.hpp>
+
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <string_view>
+#include <vector>
+
+namespace immer::persist::binary {
+
+/**
+ * Read-only access to the containers stored in a binary pool, directly from
+ * its bytes, without loading any node.
+ *
+ * @rst
+ *
+ * The bytes are usually those of a memory mapped file, see
+ * :cpp:class:`immer::persist::binary::mapped_file`.  They must be aligned at
+ * least to ``alignof(T)`` and outlive the reader.  Opening a pool only checks
+ * its header, footer and table of containers.  The records are checked as
+ * they are accessed, so accessing a corrupt pool throws
+ * :cpp:class:`immer::persist::binary::invalid_binary_pool`.
+ *
+ * .. code-block:: c++
+ *
+ *    auto file   = immer::persist::binary::mapped_file{"numbers.bin"};
+ *    auto reader = immer::persist::binary::reader<immer::vector<int>>{
+ *        file.bytes()};
+ *    auto x      = reader.get(id1, 42);
+ *    auto sum    = 0;
+ *    reader.for_each_chunk(id2, [&](auto first, auto last) {
+ *        sum = std::accumulate(first, last, sum);
+ *    });
+ *
+ * @endrst
+ *
+ * @ingroup persist-binary
+ */
+template <class Container>
+class reader
+{
+    using structure_t = detail::structure_for<Container>;
+
+public:
+    using container_type = Container;
+    using value_type     = typename structure_t::value_t;
+
+    explicit reader(std::string_view bytes)
+        : impl_{detail::input_bytes{bytes}}
+    {
+        const auto& in = impl_.bytes;
+        auto alignment = std::max(alignof(value_type), record_alignment);
+        if (reinterpret_cast<std::uintptr_t>(in.data()) % alignment) {
+            throw invalid_binary_pool{"the bytes are not aligned"};
+        }
+        if (in.size() < sizeof(file_header) + sizeof(file_footer)) {
+            throw invalid_binary_pool{"too small"};
+        }
+
+        auto header   = in.template read<file_header>(0);
+        auto expected = detail::make_header<Container>();
+        if (!std::equal(std::begin(header.magic),
+                        std::end(header.magic),
+                        expected.magic))
+            throw invalid_binary_pool{"not a binary pool"};
+        if (header.version != expected.version)
+            throw invalid_binary_pool{
+                fmt::format("unsupported version {}", header.version)};
+        if (header.byte_order != expected.byte_order)
+            throw invalid_binary_pool{"different byte order"};
+        if (header.structure != expected.structure ||
+            header.value_size != expected.value_size ||
+            header.value_align != expected.value_align)
+            throw invalid_binary_pool{"different container or value type"};
+        if (header.bits != expected.bits ||
+            header.bits_leaf != expected.bits_leaf)
+            throw invalid_binary_pool{fmt::format(
+                "B and BL parameters must be the same, expected {} and {} "
+                "but the pool has {} and {}",
+                expected.bits,
+                expected.bits_leaf,
+                header.bits,
+                header.bits_leaf)};
+
+        // Follow the chain of footers, from the last commit to the first.
+        // Offsets must decrease, so that a corrupt chain can not loop.
+        footer_ = in.size() - sizeof(file_footer);
+        for (auto offset = footer_; offset;) {
+            auto footer = in.template read<file_footer>(offset);
+            if (!std::equal(std::begin(footer.magic),
+                            std::end(footer.magic),
+                            footer_magic))
+                throw invalid_binary_pool{fmt::format(
+                    "missing footer at offset {}, it was not committed",
+                    offset)};
+            if (footer.previous >= offset)
+                throw invalid_binary_pool{"wrong chain of footers"};
+            if (footer.count) {
+                segments_.push_back(
+                    {in.template array<container_entry>(footer.containers,
+                                                        footer.count),
+                     0,
+                     footer.count});
+            }
+            offset = footer.previous;
+        }
+        std::reverse(segments_.begin(), segments_.end());
+        for (auto& segment : segments_) {
+            segment.first = count_;
+            count_ += segment.count;
+        }
+    }
+
+    /**
+     * Number of containers in the pool.
+     */
+    std::size_t size() const { return count_; }
+
+    /**
+     * Number of elements of the container `id`.
+     */
+    std::size_t container_size(container_id id) const
+    {
+        return entry(id).size;
+    }
+
+    /**
+     * Returns the element at position `index` of the vector `id`, in place.
+     * It is only available for `vector` and `flex_vector`.
+     */
+    const value_type& get(container_id id, std::size_t index) const
+    {
+        static_assert(structure_t::kind == structure_kind::rbts,
+                      "get() is only available for vectors");
+        const auto& e = entry(id);
+        if (index >= e.size)
+            throw std::out_of_range{"index out of range"};
+        return impl_.get(e, index);
+    }
+
+    /**
+     * Returns the element of the champ `id` that is equal to `key`, in place,
+     * or `nullptr` when there is none.  For a `map`, that is the key-value
+     * pair with that key, for a `table`, the entry with that key.  It is only
+     * available for `map`, `set` and `table`.
+     *
+     * Only the records on the path of the hash of `key` are read, so looking
+     * up a few keys in a big pool that is memory mapped only touches a few
+     * pages of it.
+     */
+    template <class K>
+    const value_type* find(container_id id, const K& key) const
+    {
+        static_assert(structure_t::kind == structure_kind::champ,
+                      "find() is only available for map, set and table");
+        return structure_t::find(impl_, entry(id), key);
+    }
+
+    /**
+     * Calls `fn(first, last)` with each contiguous range of values of the
+     * container `id`, pointing directly into the pool.
+     */
+    template <class Fn>
+    void for_each_chunk(container_id id, Fn&& fn) const
+    {
+        impl_.for_each_chunk(entry(id), fn);
+    }
+
+    const container_entry& entry(container_id id) const
+    {
+        if (id.value >= count_)
+            throw invalid_container_id{id};
+        auto it = std::upper_bound(
+            segments_.begin(),
+            segments_.end(),
+            id.value,
+            [](auto index, const auto& s) { return index < s.first; });
+        const auto& segment = *std::prev(it);
+        return segment.entries[id.value - segment.first];
+    }
+
+    /**
+     * Offset of the footer of the last commit.
+     */
+    offset_t last_footer() const { return footer_; }
+
+    // Semi-private
+    const typename structure_t::reader_t& impl() const { return impl_; }
+
+private:
+    struct segment
+    {
+        const container_entry* entries;
+        std::size_t first;
+        std::size_t count;
+    };
+
+    typename structure_t::reader_t impl_;
+    std::vector<segment> segments_;
+    std::size_t count_ = 0;
+    offset_t footer_   = 0;
+};
+
+/**
+ * Turns the containers of a binary pool back into regular containers.
+ *
+ * @rst
+ *
+ * Every node is allocated with the memory policy of ``Container`` and the
+ * values of the leaves are copied from the pool in one go.  The nodes shared
+ * between containers of the pool are loaded once, so the loaded containers
+ * share them too.  The whole container is validated while loading it, so
+ * that a corrupt pool never results in a broken container.
+ *
+ * Big containers can be loaded by several threads, see ``set_threads()``.
+ * The records are first checked and sorted by height by the calling thread,
+ * then the nodes of each height are built in parallel, starting from the
+ * leaves.
+ *
+ * @endrst
+ *
+ * @ingroup persist-binary
+ */
+template <class Container>
+class loader
+{
+    using structure_t = detail::structure_for<Container>;
+
+public:
+    using container_type = Container;
+
+    explicit loader(std::string_view bytes)
+        : reader_{bytes}
+        , loader_{reader_.impl()}
+    {
+    }
+
+    /**
+     * Number of containers in the pool.
+     */
+    std::size_t size() const { return reader_.size(); }
+
+    /**
+     * Loads the container `id`.
+     */
+    Container load(container_id id)
+    {
+        return structure_t::load(loader_, reader_.entry(id));
+    }
+
+    /**
+     * Sets the number of threads used to build the nodes, counting the
+     * calling one.  By default only the calling thread is used.  The memory
+     * policy of ``Container`` must be thread safe, like the default one.
+     */
+    void set_threads(unsigned threads)
+    {
+        loader_.set_threads(std::max(threads, 1u));
+    }
+
+    /**
+     * Forgets the nodes loaded so far, to bound the memory used by a loader
+     * that is kept around to load many containers.  The containers that were
+     * already loaded keep their nodes, but they will not be shared with the
+     * containers that are loaded afterwards.
+     */
+    void clear_cache() { loader_.clear(); }
+
+    // Semi-private
+    const typename structure_t::loader_t& impl() const { return loader_; }
+
+private:
+    reader<Container> reader_;
+    typename structure_t::loader_t loader_;
+};
+
+/**
+ * Loads the container with identifier `0` from a binary pool.  The bytes do
+ * not need to outlive the result.
+ *
+ * @ingroup persist-binary
+ */
+template <class Container>
+Container load(std::string_view bytes)
+{
+    return loader<Container>{bytes}.load(container_id{});
+}
+
+} // namespace immer::persist::binary
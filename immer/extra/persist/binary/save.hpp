@@ -0,0 +1,243 @@
+#pragma once
+
+#include <immer/extra/persist/binary/load.hpp>
+#include <immer/extra/persist/detail/binary/traits.hpp>
+#include <immer/extra/persist/types.hpp>
+#include <immer/extra/persist/xxhash/xxhash.hpp>
+
+#include <algorithm>
+#include <optional>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+namespace immer::persist::binary {
+
+/**
+ * Writes containers of type `Container` into a binary pool.
+ *
+ * @rst
+ *
+ * A binary pool stores the nodes of the containers with the same layout they
+ * have in memory.  Nodes refer to their children by offset and the values in
+ * the leaves are aligned, so the pool can be memory mapped and read in place
+ * with a :cpp:class:`immer::persist::binary::reader`, or turned back into
+ * containers with a :cpp:class:`immer::persist::binary::loader` by copying
+ * each leaf in one go.  Like with the other pools, the nodes that are
+ * shared between the containers added to a writer are only written once.
+ *
+ * Only containers of values that are
+ * :cpp:class:`immer::persist::binary::is_bitwise_serializable` are
+ * supported, and the pool can only be read on a platform with the same
+ * endianness and layout of the values.
+ *
+ * The nodes are written to the stream as soon as each container is added.
+ * The containers become visible to readers after calling ``commit()``, which
+ * writes their entries and a footer.
+ *
+ * .. code-block:: c++
+ *
+ *    auto os     = std::ofstream{"numbers.bin", std::ios::binary};
+ *    auto writer = immer::persist::binary::writer<immer::vector<int>>{os};
+ *    auto id1    = writer.add(v1);
+ *    auto id2    = writer.add(v2);
+ *    writer.finish();
+ *
+ * A writer can also be used as an append-only log of the successive versions
+ * of a value, see ``resume()``.  Every commit only appends the nodes that
+ * were not written before, plus a few bytes per container.
+ *
+ * Nodes are recognized by their address, so equal nodes that are not
+ * shared in memory are written again, unless ``deduplicate_contents()`` is
+ * called.  Then, equal subtrees are stored only once, no matter how the
+ * containers were built, and even across different saves to the same pool.
+ *
+ * .. note:: The writer keeps every container that it writes or loads alive,
+ *    because nodes are recognized by their address.  To bound the memory
+ *    used by a long running log, start a new one from time to time.
+ *
+ * @endrst
+ *
+ * @ingroup persist-binary
+ */
+template <class Container>
+class writer
+{
+    using structure_t = detail::structure_for<Container>;
+
+public:
+    using container_type = Container;
+    using value_type     = typename structure_t::value_t;
+
+    static_assert(is_bitwise_serializable_v<value_type>,
+                  "the values of the container can not be stored in a binary "
+                  "pool, see immer::persist::binary::is_bitwise_serializable");
+
+    /**
+     * Starts a new pool at the current position of `os`.
+     */
+    explicit writer(std::ostream& os)
+        : out_{os}
+    {
+        out_.write(detail::make_header<Container>());
+    }
+
+    /**
+     * Continues the pool `bytes`, whose following bytes are going to be
+     * written to `os`, usually a file opened in append mode.  The `bytes`
+     * must outlive the writer.
+     */
+    static writer resume(std::ostream& os, std::string_view bytes)
+    {
+        return writer{os, bytes, reader<Container>{bytes}};
+    }
+
+    /**
+     * Loads the container `id` of the pool that is being continued.  Its
+     * nodes are not written again when adding containers that share them.
+     */
+    Container load(container_id id)
+    {
+        if (!loader_)
+            throw invalid_container_id{id};
+        auto result = loader_->load(id);
+        writer_.add_loaded(loader_->impl());
+        return result;
+    }
+
+    /**
+     * Sets the number of threads used to load the containers of the pool
+     * being continued, see ``loader::set_threads()``.  The containers that are
+     * added are always written by the calling thread.
+     */
+    void set_threads(unsigned threads)
+    {
+        if (loader_)
+            loader_->set_threads(threads);
+    }
+
+    /**
+     * Makes the writer recognize nodes by their contents too, so that equal
+     * nodes are written only once even when they are not shared in memory,
+     * like those of containers that were built independently of each other.
+     * When continuing a pool, the nodes of the containers that it already
+     * contains are indexed too, so new containers can refer to them.
+     *
+     * Records are found by the `hash` of their bytes, then compared byte by
+     * byte.  Using the default hash requires linking
+     * `immer/extra/persist/xxhash/xxhash_64.cpp` and `xxHash`.
+     */
+    template <class Hash = xx_hash<std::string_view>>
+    void deduplicate_contents(Hash hash = {})
+    {
+        if (index_)
+            return;
+        index_.emplace(std::move(hash));
+        if (!previous_.empty()) {
+            auto r = reader<Container>{previous_};
+            for (auto i = std::size_t{}; i < r.size(); ++i)
+                index_->add_pool(r.impl().bytes,
+                                 structure_t::kind,
+                                 r.entry(container_id{i}),
+                                 sizeof(value_type),
+                                 alignof(value_type));
+        }
+    }
+
+    /**
+     * Writes the nodes of `container` that have not been written yet and
+     * returns its identifier in the pool.
+     */
+    container_id add(const Container& container)
+    {
+        if (finished_)
+            throw std::logic_error{"the binary pool is already finished"};
+        auto batch =
+            detail::record_batch{out_, index_ ? &*index_ : nullptr};
+        pending_.push_back(writer_.write(batch, container.impl()));
+        batch.flush();
+        // Keep the container alive, so that the addresses of its nodes are
+        // not reused by nodes of other containers that are added later.
+        saved_.push_back(container);
+        return container_id{committed_ + pending_.size() - 1};
+    }
+
+    /**
+     * Number of containers added so far, including the ones of the pool that
+     * is being continued.
+     */
+    std::size_t size() const { return committed_ + pending_.size(); }
+
+    /**
+     * Writes the entries of the containers added since the last commit,
+     * making them visible to the readers of the pool.
+     */
+    void commit()
+    {
+        if (finished_)
+            throw std::logic_error{"the binary pool is already finished"};
+        if (pending_.empty() && last_footer_)
+            return;
+        out_.pad(record_alignment);
+        auto footer       = file_footer{};
+        footer.containers = out_.offset();
+        footer.count      = pending_.size();
+        footer.previous   = last_footer_;
+        std::copy(
+            std::begin(footer_magic), std::end(footer_magic), footer.magic);
+        out_.write(pending_.data(), pending_.size() * sizeof(container_entry));
+        last_footer_ = out_.offset();
+        out_.write(footer);
+        committed_ += pending_.size();
+        pending_.clear();
+    }
+
+    /**
+     * Commits the pending containers.  No more containers can be added
+     * afterwards.
+     */
+    void finish()
+    {
+        commit();
+        finished_ = true;
+    }
+
+private:
+    writer(std::ostream& os,
+           std::string_view bytes,
+           const reader<Container>& previous)
+        : out_{os, bytes.size()}
+        , previous_{bytes}
+        , loader_{std::in_place, bytes}
+        , committed_{previous.size()}
+        , last_footer_{previous.last_footer()}
+    {
+    }
+
+    detail::output_stream out_;
+    std::string_view previous_;
+    typename structure_t::writer_t writer_;
+    std::optional<detail::content_index> index_;
+    std::optional<loader<Container>> loader_;
+    std::vector<container_entry> pending_;
+    std::vector<Container> saved_;
+    std::size_t committed_ = 0;
+    offset_t last_footer_  = 0;
+    bool finished_         = false;
+};
+
+/**
+ * Writes a binary pool that contains just `container`, which gets the
+ * identifier `0`.
+ *
+ * @ingroup persist-binary
+ */
+template <class Container>
+void save(std::ostream& os, const Container& container)
+{
+    auto w = writer<Container>{os};
+    w.add(container);
+    w.finish();
+}
+
+} // namespace immer::persist::binary
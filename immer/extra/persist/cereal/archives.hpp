@@ -212,7 +212,8 @@ private:
     template <class Previous_, class Pools_, class WrapFn_, class PoolNameFn_>
     friend class output_pools_cereal_archive_wrapper;
 
-    // Recursively serializes the pools but not calling finalize
+    // Recursively serializes the pools but not calling finalize.  Streaming
+    // pools walk all their trees on every pass of this loop.
     void save_pools_impl()
     {
         const auto save_pool = [wrap = wrap](auto pools) {
@@ -0,0 +1,568 @@
+#pragma once
+
+#include <immer/extra/persist/detail/common/pool.hpp>
+#include <immer/extra/persist/errors.hpp>
+
+#include <immer/array.hpp>
+#include <immer/array_transient.hpp>
+
+#include <cereal/cereal.hpp>
+#include <cereal/external/base64.hpp>
+
+#include <cstdint>
+#include <functional>
+#include <limits>
+#include <string>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+namespace immer::persist {
+
+namespace detail {
+
+template <class T, class = void>
+struct leaf_word
+{
+    using type = void;
+};
+
+template <class T>
+struct leaf_word<
+    T,
+    std::enable_if_t<std::is_integral_v<T> && !std::is_same_v<T, bool>>>
+{
+    using type = std::make_unsigned_t<T>;
+};
+
+template <class T>
+struct leaf_word<T, std::enable_if_t<std::is_enum_v<T>>>
+{
+    using type = std::make_unsigned_t<std::underlying_type_t<T>>;
+};
+
+/**
+ * Unsigned type with the bits of the integer or enum `T`, or `void` when the
+ * integer codecs can not be used for `T`.
+ */
+template <class T>
+using leaf_word_t = typename leaf_word<T>::type;
+
+template <class T>
+constexpr bool is_signed_leaf_v = std::is_signed_v<
+    typename std::conditional_t<std::is_enum_v<T>,
+                                std::underlying_type<T>,
+                                std::enable_if<true, T>>::type>;
+
+template <class U>
+U to_zigzag(U x)
+{
+    constexpr auto bits = std::numeric_limits<U>::digits;
+    return static_cast<U>(static_cast<U>(x << 1) ^
+                          static_cast<U>(U{} - (x >> (bits - 1))));
+}
+
+template <class U>
+U from_zigzag(U x)
+{
+    return static_cast<U>((x >> 1) ^ static_cast<U>(U{} - (x & 1)));
+}
+
+/**
+ * Word for the value `x`, where negative values are zigzag encoded, so that
+ * values close to zero take few digits in either direction.
+ */
+template <class T>
+std::uint64_t to_leaf_word(T x)
+{
+    using word_t = leaf_word_t<T>;
+    auto w       = static_cast<word_t>(x);
+    if constexpr (is_signed_leaf_v<T>)
+        w = to_zigzag(w);
+    return w;
+}
+
+template <class T>
+T from_leaf_word(std::uint64_t w)
+{
+    using word_t = leaf_word_t<T>;
+    auto x       = static_cast<word_t>(w);
+    if constexpr (is_signed_leaf_v<T>)
+        x = from_zigzag(x);
+    return static_cast<T>(x);
+}
+
+/**
+ * Throws unless all the words fit in the bits of `T`.  The loop only combines
+ * the words, so that it can be vectorized.
+ */
+template <class T>
+void check_leaf_words(const std::uint64_t* words, std::size_t n)
+{
+    constexpr auto bits = std::numeric_limits<leaf_word_t<T>>::digits;
+    if constexpr (bits < 64) {
+        auto all = std::uint64_t{};
+        for (auto i = std::size_t{}; i < n; ++i)
+            all |= words[i];
+        if (all >> bits)
+            throw invalid_leaf_codec{"encoded value is out of range"};
+    }
+}
+
+/**
+ * The words of a leaf, saved as a list of numbers.
+ */
+struct leaf_words
+{
+    std::vector<std::uint64_t>& words;
+};
+
+template <class Archive>
+void save(Archive& ar, const leaf_words& m)
+{
+    ar(cereal::make_size_tag(static_cast<cereal::size_type>(m.words.size())));
+    for (auto w : m.words)
+        ar(w);
+}
+
+template <class Archive>
+void load(Archive& ar, leaf_words& m)
+{
+    auto size = cereal::size_type{};
+    ar(cereal::make_size_tag(size));
+    m.words.clear();
+    for (auto i = cereal::size_type{}; i < size; ++i) {
+        auto w = std::uint64_t{};
+        ar(w);
+        m.words.push_back(w);
+    }
+}
+
+/**
+ * Saves and loads each leaf as the list of words produced by the `encode`
+ * and `decode` functions of `Coder`.
+ */
+template <class Coder, class T>
+struct word_list_coder
+{
+    template <class Archive>
+    void save_leaf(Archive& ar, const T* first, const T* last) const
+    {
+        words_.clear();
+        self().encode(first, last, words_);
+        ar(leaf_words{words_});
+    }
+
+    template <class Archive>
+    immer::array<T> load_leaf(Archive& ar) const
+    {
+        auto words = leaf_words{words_};
+        ar(words);
+        return self().decode(words_.data(), words_.size());
+    }
+
+protected:
+    mutable std::vector<std::uint64_t> words_;
+
+private:
+    const Coder& self() const { return static_cast<const Coder&>(*this); }
+};
+
+template <class T>
+struct dictionary_save
+{
+    const std::vector<const T*>& values;
+};
+
+template <class T>
+struct dictionary_load
+{
+    std::vector<T>& values;
+};
+
+template <class Archive, class T>
+void save(Archive& ar, const dictionary_save<T>& dict)
+{
+    ar(cereal::make_size_tag(
+        static_cast<cereal::size_type>(dict.values.size())));
+    for (const auto* v : dict.values)
+        ar(*v);
+}
+
+template <class Archive, class T>
+void load(Archive& ar, dictionary_load<T>& dict)
+{
+    auto size = cereal::size_type{};
+    ar(cereal::make_size_tag(size));
+    dict.values.clear();
+    for (auto i = cereal::size_type{}; i < size; ++i) {
+        dict.values.emplace_back();
+        ar(dict.values.back());
+    }
+}
+
+/**
+ * Appends the words in LEB128, 7 bits per byte, with the highest bit set in
+ * all the bytes of a word but the last one.
+ */
+inline void write_varints(const std::vector<std::uint64_t>& words,
+                          std::string& bytes)
+{
+    for (auto w : words) {
+        while (w >= 0x80) {
+            bytes.push_back(static_cast<char>((w & 0x7f) | 0x80));
+            w >>= 7;
+        }
+        bytes.push_back(static_cast<char>(w));
+    }
+}
+
+inline void read_varints(const std::string& bytes,
+                         std::vector<std::uint64_t>& words)
+{
+    auto w     = std::uint64_t{};
+    auto shift = 0u;
+    for (auto c : bytes) {
+        auto byte = static_cast<std::uint64_t>(static_cast<unsigned char>(c));
+        if (shift == 63 && byte > 1)
+            throw invalid_leaf_codec{"varint is too long"};
+        w |= (byte & 0x7f) << shift;
+        if (byte & 0x80) {
+            shift += 7;
+        } else {
+            words.push_back(w);
+            w     = 0;
+            shift = 0;
+        }
+    }
+    if (shift)
+        throw invalid_leaf_codec{"varint is truncated"};
+}
+
+} // namespace detail
+
+/**
+ * @brief Leaf codec that saves the values of the leaves as they are, one by
+ * one.  This is what the pools use when the policy does not name a codec.
+ *
+ * A policy selects the codec of a pool with a `get_leaf_codec` function that
+ * takes the container type of the pool, like `get_pool_name`:
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    auto get_leaf_codec(const vector_of_ids&) const
+ *    {
+ *        return immer::persist::varint_leaf_codec<
+ *            immer::persist::delta_leaf_codec>{};
+ *    }
+ *
+ * @endrst
+ *
+ * The codecs change how the leaves of `vector` and `flex_vector` pools are
+ * written.  The other pools only support this one: naming another codec for
+ * a `map`, `set`, `table` or `box` pool fails to compile.  A pool must be
+ * loaded with the codec it was saved with, otherwise `invalid_leaf_codec` is
+ * thrown.
+ *
+ * @ingroup persist-policy
+ */
+struct plain_leaf_codec
+{};
+
+/**
+ * @brief Leaf codec for integers and enums that saves the first value of each
+ * leaf and then the difference of every value with the previous one.  It
+ * keeps the numbers small for sorted ids and timestamps.  Differences are
+ * zigzag encoded, so that small negative ones are small numbers too.
+ *
+ * @ingroup persist-policy
+ */
+struct delta_leaf_codec
+{
+    static std::string name() { return "delta"; }
+
+    template <class T>
+    struct coder : detail::word_list_coder<coder<T>, T>
+    {
+        static_assert(!std::is_void_v<detail::leaf_word_t<T>>,
+                      "delta_leaf_codec needs integer or enum values");
+
+        using word_t = detail::leaf_word_t<T>;
+
+        template <class Archive>
+        void save_header(Archive&, const std::vector<detail::values_save<T>>&)
+        {
+        }
+
+        template <class Archive>
+        void load_header(Archive&)
+        {
+        }
+
+        void encode(const T* first,
+                    const T* last,
+                    std::vector<std::uint64_t>& words) const
+        {
+            auto prev = word_t{};
+            for (; first != last; ++first) {
+                auto x = static_cast<word_t>(*first);
+                words.push_back(
+                    detail::to_zigzag(static_cast<word_t>(x - prev)));
+                prev = x;
+            }
+        }
+
+        immer::array<T> decode(const std::uint64_t* words,
+                               std::size_t n) const
+        {
+            detail::check_leaf_words<T>(words, n);
+            auto result = immer::array<T>(n).transient();
+            auto* out   = result.data_mut();
+            auto prev   = word_t{};
+            for (auto i = std::size_t{}; i < n; ++i) {
+                auto d = detail::from_zigzag(static_cast<word_t>(words[i]));
+                prev   = static_cast<word_t>(prev + d);
+                out[i] = static_cast<T>(prev);
+            }
+            return std::move(result).persistent();
+        }
+    };
+};
+
+/**
+ * @brief Leaf codec for integers and enums that saves the smallest value of
+ * each leaf and then the offset of every value from it.  It keeps the numbers
+ * small for values that are close to each other in any order.  Decoding is a
+ * single addition per value, that compilers can vectorize.
+ *
+ * @ingroup persist-policy
+ */
+struct frame_of_reference_leaf_codec
+{
+    static std::string name() { return "frame_of_reference"; }
+
+    template <class T>
+    struct coder : detail::word_list_coder<coder<T>, T>
+    {
+        static_assert(
+            !std::is_void_v<detail::leaf_word_t<T>>,
+            "frame_of_reference_leaf_codec needs integer or enum values");
+
+        using word_t = detail::leaf_word_t<T>;
+
+        template <class Archive>
+        void save_header(Archive&, const std::vector<detail::values_save<T>>&)
+        {
+        }
+
+        template <class Archive>
+        void load_header(Archive&)
+        {
+        }
+
+        void encode(const T* first,
+                    const T* last,
+                    std::vector<std::uint64_t>& words) const
+        {
+            if (first == last)
+                return;
+            auto base = *first;
+            for (auto p = first; p != last; ++p)
+                base = *p < base ? *p : base;
+            words.push_back(detail::to_leaf_word(base));
+            for (; first != last; ++first)
+                words.push_back(static_cast<word_t>(
+                    static_cast<word_t>(*first) - static_cast<word_t>(base)));
+        }
+
+        immer::array<T> decode(const std::uint64_t* words,
+                               std::size_t n) const
+        {
+            if (!n)
+                return {};
+            detail::check_leaf_words<T>(words, n);
+            auto base =
+                static_cast<word_t>(detail::from_leaf_word<T>(words[0]));
+            auto result = immer::array<T>(n - 1).transient();
+            auto* out   = result.data_mut();
+            for (auto i = std::size_t{1}; i < n; ++i)
+                out[i - 1] =
+                    static_cast<T>(static_cast<word_t>(base + words[i]));
+            return std::move(result).persistent();
+        }
+    };
+};
+
+/**
+ * @brief Leaf codec that saves every distinct value of the pool once, in a
+ * `dictionary` before the leaves, and then each value as its position in
+ * the dictionary.  It suits strings and other values that are repeated
+ * many times, and can be used for any type with a `std::hash`.
+ *
+ * @ingroup persist-policy
+ */
+struct dictionary_leaf_codec
+{
+    static std::string name() { return "dictionary"; }
+
+    template <class T>
+    struct coder : detail::word_list_coder<coder<T>, T>
+    {
+        template <class Archive>
+        void save_header(Archive& ar,
+                         const std::vector<detail::values_save<T>>& leaves)
+        {
+            for (const auto& leaf : leaves) {
+                for (auto p = leaf.begin; p != leaf.end; ++p) {
+                    if (index_.emplace(p, values_.size()).second)
+                        values_.push_back(p);
+                }
+            }
+            ar(cereal::make_nvp("dictionary",
+                                detail::dictionary_save<T>{values_}));
+        }
+
+        template <class Archive>
+        void load_header(Archive& ar)
+        {
+            ar(cereal::make_nvp("dictionary",
+                                detail::dictionary_load<T>{dictionary_}));
+        }
+
+        void encode(const T* first,
+                    const T* last,
+                    std::vector<std::uint64_t>& words) const
+        {
+            for (; first != last; ++first)
+                words.push_back(index_.find(first)->second);
+        }
+
+        immer::array<T> decode(const std::uint64_t* words,
+                               std::size_t n) const
+        {
+            auto result = immer::array<T>(n).transient();
+            auto* out   = result.data_mut();
+            for (auto i = std::size_t{}; i < n; ++i) {
+                if (words[i] >= dictionary_.size())
+                    throw invalid_leaf_codec{
+                        "value is not in the dictionary"};
+                out[i] = dictionary_[words[i]];
+            }
+            return std::move(result).persistent();
+        }
+
+    private:
+        struct value_hash
+        {
+            std::size_t operator()(const T* v) const
+            {
+                return std::hash<T>{}(*v);
+            }
+        };
+
+        struct value_equal
+        {
+            bool operator()(const T* a, const T* b) const { return *a == *b; }
+        };
+
+        // Saving: the values of the pool are alive while it is saved.
+        std::unordered_map<const T*, std::uint64_t, value_hash, value_equal>
+            index_;
+        std::vector<const T*> values_;
+        // Loading
+        std::vector<T> dictionary_;
+    };
+};
+
+/**
+ * @brief Leaf codec that writes the numbers produced by another codec with
+ * as few bytes as they need, 7 bits per byte, instead of as a list of
+ * numbers.  The bytes of each leaf are saved as one base64 string, which
+ * makes a leaf of small numbers several times smaller than with the other
+ * codec alone, both in text and binary archives.
+ *
+ * @rst
+ *
+ * .. code-block:: c++
+ *
+ *    // Sorted ids, or any other values that grow slowly.
+ *    varint_leaf_codec<delta_leaf_codec>{}
+ *    // Strings out of a small set.
+ *    varint_leaf_codec<dictionary_leaf_codec>{}
+ *
+ * @endrst
+ *
+ * @ingroup persist-policy
+ */
+template <class Codec = delta_leaf_codec>
+struct varint_leaf_codec
+{
+    static std::string name() { return "varint_" + Codec::name(); }
+
+    template <class T>
+    struct coder : Codec::template coder<T>
+    {
+        template <class Archive>
+        void save_leaf(Archive& ar, const T* first, const T* last) const
+        {
+            this->words_.clear();
+            this->encode(first, last, this->words_);
+            bytes_.clear();
+            detail::write_varints(this->words_, bytes_);
+            ar(cereal::base64::encode(
+                reinterpret_cast<const unsigned char*>(bytes_.data()),
+                bytes_.size()));
+        }
+
+        template <class Archive>
+        immer::array<T> load_leaf(Archive& ar) const
+        {
+            auto encoded = std::string{};
+            ar(encoded);
+            this->words_.clear();
+            detail::read_varints(cereal::base64::decode(encoded),
+                                 this->words_);
+            return this->decode(this->words_.data(), this->words_.size());
+        }
+
+    private:
+        mutable std::string bytes_;
+    };
+};
+
+namespace detail {
+
+template <class Fn, class Container>
+using get_leaf_codec_t = decltype(std::declval<const Fn&>().get_leaf_codec(
+    std::declval<const Container&>()));
+
+template <class Fn, class Container, class = void>
+struct has_get_leaf_codec : std::false_type
+{};
+
+template <class Fn, class Container>
+struct has_get_leaf_codec<Fn,
+                          Container,
+                          std::void_t<get_leaf_codec_t<Fn, Container>>>
+    : std::true_type
+{};
+
+/**
+ * The leaf codec that `fn` names for the pool of `Container`, or the plain
+ * one.
+ */
+template <class Fn, class Container>
+auto get_leaf_codec(const Fn& fn, const Container& container)
+{
+    if constexpr (has_get_leaf_codec<Fn, Container>::value) {
+        return fn.get_leaf_codec(container);
+    } else {
+        return plain_leaf_codec{};
+    }
+}
+
+} // namespace detail
+
+} // namespace immer::persist
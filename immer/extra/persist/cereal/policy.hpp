@@ -1,5 +1,6 @@
 #pragma once
 
+#include <immer/extra/persist/cereal/leaf_codecs.hpp>
 #include <immer/extra/persist/detail/cereal/wrap.hpp>
 #include <immer/extra/persist/detail/names.hpp>
 
@@ -60,6 +61,8 @@ struct value0_serialize_t
  *      - Types of `immer` containers that will be serialized using pools. One
  * pool contains nodes of only one `immer` container type.
  *      - Names for each per-type pool.
+ *      - Optionally, the codec for the leaves of each per-type pool, from a
+ * `get_leaf_codec` function.  See `plain_leaf_codec`.
  *
  * @ingroup persist-policy
  */
@@ -200,6 +203,12 @@ struct get_pool_name_fn_t
     {
         return Policy{}.get_pool_name(value);
     }
+
+    template <class T>
+    auto get_leaf_codec(const T& value) const
+    {
+        return detail::get_leaf_codec(Policy{}, value);
+    }
 };
 
 } // namespace immer::persist
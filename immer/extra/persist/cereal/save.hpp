@@ -10,6 +10,36 @@ namespace immer::persist {
  * @defgroup persist-api
  */
 
+namespace detail {
+
+template <class Archive,
+          class T,
+          class Policy,
+          class Types,
+          class Pools,
+          class... Args>
+void cereal_save_with_output_pools(std::ostream& os,
+                                   const T& value0,
+                                   const Policy& policy,
+                                   Types types,
+                                   Pools pools,
+                                   Args&&... args)
+{
+    const auto wrap = wrap_known_types(types, wrap_for_saving);
+    auto ar   = immer::persist::output_pools_cereal_archive_wrapper<
+        Archive,
+        Pools,
+        decltype(wrap),
+        get_pool_name_fn_t<Policy>>{
+        std::move(pools), wrap, os, std::forward<Args>(args)...};
+    policy.save(ar, value0);
+    // Calling finalize explicitly, as it might throw on saving the pools,
+    // for example if pool names are not unique.
+    ar.finalize();
+}
+
+} // namespace detail
+
 /**
  * @brief Serialize the provided value with pools using the provided policy
  * outputting into the provided stream. By default, `cereal::JSONOutputArchive`
@@ -28,19 +58,51 @@ void cereal_save_with_pools(std::ostream& os,
                             Args&&... args)
 {
     const auto types = boost::hana::to_set(policy.get_pool_types(value0));
-    auto pools       = detail::generate_output_pools(types);
-    const auto wrap  = detail::wrap_known_types(types, detail::wrap_for_saving);
-    using Pools      = std::decay_t<decltype(pools)>;
-    auto ar          = immer::persist::output_pools_cereal_archive_wrapper<
-        Archive,
-        Pools,
-        decltype(wrap),
-        get_pool_name_fn_t<Policy>>{
-        pools, wrap, os, std::forward<Args>(args)...};
-    policy.save(ar, value0);
-    // Calling finalize explicitly, as it might throw on saving the pools,
-    // for example if pool names are not unique.
-    ar.finalize();
+    detail::cereal_save_with_output_pools<Archive>(
+        os,
+        value0,
+        policy,
+        types,
+        detail::generate_output_pools(types),
+        std::forward<Args>(args)...);
+}
+
+/**
+ * @brief Like `cereal_save_with_pools`, but the vector and hash based pools
+ * only keep the containers that are added to them, and write their nodes
+ * while walking the containers once they are saved.  The output has the same
+ * format, with the nodes numbered in a different order, and is loaded with
+ * `cereal_load_with_pools`.  Instead of building the pools in memory, only
+ * the ids of the nodes that are shared, and thus may be reached more than
+ * once, are kept while saving.  With a memory policy that does not count
+ * references every node is taken to be shared.
+ *
+ * This trades time for memory: the pools are saved repeatedly until no new
+ * containers show up, and every pass walks all the trees of the streamed
+ * pools at least twice, once to number the nodes and then to write them.  A
+ * save thus walks every tree at least four times, more when the values nest
+ * containers.
+ *
+ * @see cereal_save_with_pools
+ * @ingroup persist-api
+ */
+template <class Archive = cereal::JSONOutputArchive,
+          class T,
+          class Policy = default_policy,
+          class... Args>
+void cereal_save_with_streamed_pools(std::ostream& os,
+                                     const T& value0,
+                                     const Policy& policy = Policy{},
+                                     Args&&... args)
+{
+    const auto types = boost::hana::to_set(policy.get_pool_types(value0));
+    detail::cereal_save_with_output_pools<Archive>(
+        os,
+        value0,
+        policy,
+        types,
+        detail::generate_output_pools<detail::streaming_output_pool_t>(types),
+        std::forward<Args>(args)...);
 }
 
 /**
@@ -2,6 +2,7 @@
 
 #include <immer/extra/cereal/immer_array.hpp>
 #include <immer/extra/cereal/immer_vector.hpp>
+#include <immer/extra/persist/detail/common/flat_map.hpp>
 #include <immer/extra/persist/detail/common/pool.hpp>
 #include <immer/extra/persist/detail/traits.hpp>
 #include <immer/extra/persist/errors.hpp>
@@ -13,9 +14,9 @@ namespace immer::persist::array {
 template <typename T, typename MemoryPolicy>
 struct output_pool
 {
-    immer::map<container_id, immer::array<T, MemoryPolicy>> arrays;
+    detail::flat_map<container_id, immer::array<T, MemoryPolicy>> arrays;
 
-    immer::map<const void*, container_id> ids;
+    detail::flat_map<const void*, container_id> ids;
 
     friend bool operator==(const output_pool& left, const output_pool& right)
     {
@@ -57,7 +58,7 @@ get_id(output_pool<T, MemoryPolicy> pool,
     }
 
     const auto id = container_id{pool.ids.size()};
-    pool.ids      = std::move(pool.ids).set(ptr_void, id);
+    pool.ids.insert(ptr_void, id);
     return {std::move(pool), id};
 }
 
@@ -74,7 +75,7 @@ add_to_pool(immer::array<T, MemoryPolicy> array,
         return {std::move(pool), id};
     }
 
-    pool.arrays = std::move(pool.arrays).set(id, std::move(array));
+    pool.arrays.insert(id, std::move(array));
     return {std::move(pool), id};
 }
 
@@ -0,0 +1,125 @@
+#pragma once
+
+#include <immer/extra/persist/detail/binary/content.hpp>
+#include <immer/extra/persist/detail/binary/stream.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace immer::persist::binary::detail {
+
+/**
+ * Lays out records before writing them, so that they are written to the
+ * stream in big chunks instead of a few bytes at a time.
+ *
+ * The offset of a record is decided when it is added, exactly like when
+ * writing the records one after the other.  The payload of the records is
+ * only referenced, so it must stay alive until they are flushed.  Records are
+ * flushed every now and then while they are added, to bound the memory used
+ * by the batch, and `flush()` must be called once all of them are added.
+ *
+ * When given a `content_index`, records with the same contents as one that
+ * was added before are not added again, and the offset of the existing one is
+ * returned instead.
+ */
+class record_batch
+{
+public:
+    explicit record_batch(output_stream& out, content_index* index = nullptr)
+        : out_{&out}
+        , index_{index}
+        , end_{out.offset()}
+    {
+    }
+
+    record_batch(const record_batch&)            = delete;
+    record_batch& operator=(const record_batch&) = delete;
+
+    /**
+     * Adds a record with the `words` written after its header, followed by
+     * `size` bytes from `values` aligned to `alignment`.  Returns its offset.
+     * The `context` is only used to tell apart records with the same
+     * contents, see `record_contents`.
+     */
+    offset_t add(record_kind kind,
+                 std::size_t count,
+                 std::vector<std::uint64_t> words,
+                 const void* values    = nullptr,
+                 std::size_t size      = 0,
+                 std::size_t alignment = 1,
+                 std::uint32_t context = 0)
+    {
+        auto offset = align_up(end_, record_alignment);
+        auto header = record_header{static_cast<std::uint32_t>(kind),
+                                    static_cast<std::uint32_t>(count)};
+        if (index_) {
+            auto existing = index_->emplace(
+                {header, words.data(), words.size(), values, size, context},
+                offset);
+            if (existing != offset)
+                return existing;
+        }
+        auto values_offset =
+            align_up(offset + sizeof(record_header) +
+                         words.size() * sizeof(std::uint64_t),
+                     alignment);
+        end_ = values_offset + size;
+        pending_bytes_ += end_ - offset;
+        records_.push_back({offset,
+                            header,
+                            std::move(words),
+                            values,
+                            size,
+                            values_offset});
+        if (records_.size() >= max_records || pending_bytes_ >= max_bytes)
+            flush();
+        return offset;
+    }
+
+    void flush()
+    {
+        if (records_.empty())
+            return;
+        auto begin = out_->offset();
+        auto bytes = std::unique_ptr<char[]>{new char[end_ - begin]()};
+        for (const auto& r : records_) {
+            auto* p = bytes.get() + (r.offset - begin);
+            std::memcpy(p, &r.header, sizeof(record_header));
+            if (!r.words.empty())
+                std::memcpy(p + sizeof(record_header),
+                            r.words.data(),
+                            r.words.size() * sizeof(std::uint64_t));
+            if (r.size)
+                std::memcpy(bytes.get() + (r.values_offset - begin),
+                            r.values,
+                            r.size);
+        }
+        out_->write(bytes.get(), end_ - begin);
+        records_.clear();
+        pending_bytes_ = 0;
+    }
+
+private:
+    static constexpr auto max_records = std::size_t{1} << 16;
+    static constexpr auto max_bytes   = std::size_t{64} << 20;
+
+    struct record
+    {
+        offset_t offset;
+        record_header header;
+        std::vector<std::uint64_t> words;
+        const void* values;
+        std::size_t size;
+        offset_t values_offset;
+    };
+
+    output_stream* out_;
+    content_index* index_;
+    offset_t end_;
+    std::size_t pending_bytes_ = 0;
+    std::vector<record> records_;
+};
+
+} // namespace immer::persist::binary::detail
@@ -0,0 +1,488 @@
+#pragma once
+
+#include <immer/extra/persist/detail/binary/batch.hpp>
+#include <immer/extra/persist/detail/binary/parallel.hpp>
+#include <immer/extra/persist/detail/node_ptr.hpp>
+
+#include <immer/detail/hamts/champ.hpp>
+
+#include <algorithm>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace immer::persist::binary::detail {
+
+template <typename T,
+          typename Hash,
+          typename Equal,
+          typename MemoryPolicy,
+          immer::detail::hamts::bits_t B>
+struct champ_writer
+{
+    using champ_t =
+        immer::detail::hamts::champ<T, Hash, Equal, MemoryPolicy, B>;
+    using node_t = typename champ_t::node_t;
+    using hash_t = typename node_t::hash_t;
+
+    std::unordered_map<const node_t*, offset_t> offsets;
+
+    container_entry write(record_batch& out, const champ_t& champ)
+    {
+        return {write_node(out, champ.root, 0), 0, champ.size, 0};
+    }
+
+    template <class Loader>
+    void add_loaded(const Loader& loader)
+    {
+        loader.for_each_node([&](auto* node, auto, auto offset) {
+            offsets.emplace(node, offset);
+        });
+    }
+
+    offset_t write_node(record_batch& out,
+                        const node_t* node,
+                        immer::detail::hamts::count_t depth)
+    {
+        if (auto it = offsets.find(node); it != offsets.end())
+            return it->second;
+
+        auto offset = offset_t{};
+        if (depth < immer::detail::hamts::max_depth<hash_t, B>) {
+            auto n     = node->children_count();
+            auto words = std::vector<std::uint64_t>{};
+            words.reserve(n + 2);
+            words.push_back(node->nodemap());
+            words.push_back(node->datamap());
+            for (auto i = decltype(n){}; i < n; ++i)
+                words.push_back(
+                    write_node(out, node->children()[i], depth + 1));
+
+            auto values = node->datamap() ? node->values() : nullptr;
+            offset      = out.add(record_kind::champ_inner,
+                             n,
+                             std::move(words),
+                             values,
+                             node->data_count() * sizeof(T),
+                             alignof(T),
+                             depth);
+        } else {
+            auto n = node->collision_count();
+            offset = out.add(record_kind::collision,
+                             n,
+                             {},
+                             node->collisions(),
+                             n * sizeof(T),
+                             alignof(T),
+                             depth);
+        }
+        offsets.emplace(node, offset);
+        return offset;
+    }
+};
+
+/**
+ * Access to the nodes of a champ stored in a binary pool, without loading
+ * them.
+ */
+template <typename T, immer::detail::hamts::bits_t B>
+struct champ_reader
+{
+    input_bytes bytes;
+
+    struct inner_record
+    {
+        std::uint64_t nodemap;
+        std::uint64_t datamap;
+        const offset_t* children;
+        std::size_t children_count;
+        const T* values;
+        std::size_t values_count;
+    };
+
+    inner_record inner(offset_t offset, const record_header& record) const
+    {
+        using immer::detail::hamts::popcount;
+
+        auto result           = inner_record{};
+        auto pos              = offset + sizeof(record_header);
+        result.nodemap        = bytes.read<std::uint64_t>(pos);
+        result.datamap        = bytes.read<std::uint64_t>(pos + 8);
+        result.children_count = record.count;
+        if (popcount(result.nodemap) != result.children_count ||
+            (result.nodemap & result.datamap) ||
+            ((result.nodemap | result.datamap) >>
+             (immer::detail::hamts::branches<B> - 1) >> 1)) {
+            throw invalid_binary_pool{
+                fmt::format("wrong bitmaps in node at offset {}", offset)};
+        }
+        result.children =
+            bytes.array<offset_t>(pos + 16, result.children_count);
+        for (auto i = std::size_t{}; i < result.children_count; ++i) {
+            if (result.children[i] >= offset)
+                throw pool_has_cycles{node_id{offset}};
+        }
+        result.values_count = popcount(result.datamap);
+        result.values       = bytes.array<T>(
+            align_up(pos + 16 + result.children_count * sizeof(offset_t),
+                     alignof(T)),
+            result.values_count);
+        return result;
+    }
+
+    const T* collision(offset_t offset, const record_header& record) const
+    {
+        return bytes.array<T>(
+            align_up(offset + sizeof(record_header), alignof(T)),
+            record.count);
+    }
+
+    static constexpr auto max_depth =
+        immer::detail::hamts::max_depth<std::size_t, B>;
+
+    /**
+     * Follows the path of the hash of `key`, reading only the records along
+     * it.  Returns the value that is equal to `key`, or `nullptr`.
+     */
+    template <class Hash, class Equal, class K>
+    const T* find(const container_entry& entry, const K& key) const
+    {
+        using immer::detail::hamts::popcount;
+
+        auto offset = entry.root;
+        auto hash   = std::size_t{Hash{}(key)};
+        for (auto depth = 0u; depth < max_depth; ++depth) {
+            auto record = bytes.record(offset);
+            if (static_cast<record_kind>(record.kind) !=
+                record_kind::champ_inner)
+                throw invalid_binary_pool{
+                    fmt::format("unexpected record at offset {}", offset)};
+            auto node = inner(offset, record);
+            auto bit  = std::uint64_t{1}
+                       << (hash & immer::detail::hamts::mask<std::size_t, B>);
+            if (node.nodemap & bit) {
+                offset = node.children[popcount(node.nodemap & (bit - 1))];
+                hash   = hash >> B;
+            } else if (node.datamap & bit) {
+                auto value = node.values + popcount(node.datamap & (bit - 1));
+                return Equal{}(*value, key) ? value : nullptr;
+            } else {
+                return nullptr;
+            }
+        }
+        auto record = bytes.record(offset);
+        if (static_cast<record_kind>(record.kind) != record_kind::collision)
+            throw invalid_binary_pool{
+                fmt::format("unexpected record at offset {}", offset)};
+        auto first = collision(offset, record);
+        for (auto it = first; it != first + record.count; ++it)
+            if (Equal{}(*it, key))
+                return it;
+        return nullptr;
+    }
+
+    template <class Fn>
+    void for_each_chunk(const container_entry& entry, Fn&& fn) const
+    {
+        for_each_chunk_node(entry.root, fn, 0);
+    }
+
+    template <class Fn>
+    void for_each_chunk_node(offset_t offset, Fn& fn, unsigned depth) const
+    {
+        if (depth > max_depth)
+            throw invalid_binary_pool{"tree is too deep"};
+        auto record = bytes.record(offset);
+        switch (static_cast<record_kind>(record.kind)) {
+        case record_kind::champ_inner: {
+            auto node = inner(offset, record);
+            if (node.values_count)
+                fn(node.values, node.values + node.values_count);
+            for (auto i = std::size_t{}; i < node.children_count; ++i)
+                for_each_chunk_node(node.children[i], fn, depth + 1);
+            break;
+        }
+        case record_kind::collision: {
+            auto first = collision(offset, record);
+            if (record.count)
+                fn(first, first + record.count);
+            break;
+        }
+        default:
+            throw invalid_binary_pool{
+                fmt::format("unexpected record at offset {}", offset)};
+        }
+    }
+};
+
+/**
+ * Materializes the champs of a binary pool into regular nodes.
+ *
+ * The position of every value in the tree is checked against its hash, so
+ * that loading a pool with a different hash function than the one used to
+ * write it fails, instead of producing a container where lookups are broken.
+ */
+template <typename T,
+          typename Hash,
+          typename Equal,
+          typename MemoryPolicy,
+          immer::detail::hamts::bits_t B>
+class champ_loader
+{
+public:
+    using champ_t =
+        immer::detail::hamts::champ<T, Hash, Equal, MemoryPolicy, B>;
+    using node_t   = typename champ_t::node_t;
+    using node_ptr = immer::persist::detail::node_ptr<node_t>;
+    using hash_t   = typename node_t::hash_t;
+    using count_t  = immer::detail::hamts::count_t;
+
+    static constexpr auto max_depth =
+        immer::detail::hamts::max_depth<hash_t, B>;
+
+    explicit champ_loader(champ_reader<T, B> reader)
+        : reader_{reader}
+    {
+    }
+
+    champ_t load(const container_entry& entry)
+    {
+        if (threads_ > 1)
+            load_parallel(entry);
+
+        const auto& root = load_node(entry.root, 0, 0);
+        if (root.size != entry.size) {
+            throw invalid_binary_pool{
+                fmt::format("wrong size {} for champ at offset {}",
+                            entry.size,
+                            entry.root)};
+        }
+        auto root_ptr = root.node;
+        return champ_t{std::move(root_ptr).release(), root.size};
+    }
+
+    template <class Fn>
+    void for_each_node(Fn&& fn) const
+    {
+        for (const auto& [offset, info] : nodes_)
+            fn(info.node.get(), info.size, offset);
+    }
+
+    void clear() { nodes_.clear(); }
+
+    void set_threads(unsigned threads) { threads_ = threads; }
+
+private:
+    struct node_info
+    {
+        node_ptr node;
+        std::size_t size;
+        count_t depth;
+        hash_t prefix;
+    };
+
+    // Bits of the hash that determine the path to a node at `depth`.
+    static hash_t prefix_mask(count_t depth)
+    {
+        auto bits = depth * B;
+        return bits >= sizeof(hash_t) * 8 ? ~hash_t{}
+                                          : (hash_t{1} << bits) - 1;
+    }
+
+    static invalid_binary_pool hash_mismatch(offset_t offset)
+    {
+        return invalid_binary_pool{
+            fmt::format("the hash of a value in node at offset {} does not "
+                        "match its position, the hash function is likely "
+                        "different than the one used to save it",
+                        offset)};
+    }
+
+    const node_info& load_node(offset_t offset, count_t depth, hash_t prefix)
+    {
+        if (auto it = nodes_.find(offset); it != nodes_.end()) {
+            if (it->second.depth != depth || it->second.prefix != prefix) {
+                throw invalid_binary_pool{fmt::format(
+                    "node at offset {} is used in different positions",
+                    offset)};
+            }
+            return it->second;
+        }
+
+        auto record = reader_.bytes.record(offset);
+        auto kind   = static_cast<record_kind>(record.kind);
+        auto info   = depth < max_depth && kind == record_kind::champ_inner
+                          ? load_inner(offset, record, depth, prefix)
+                      : depth == max_depth && kind == record_kind::collision
+                          ? load_collision(offset, record, depth, prefix)
+                          : throw invalid_binary_pool{fmt::format(
+                                "unexpected record at offset {}", offset)};
+        if (depth > 0 && info.size == 0) {
+            throw invalid_binary_pool{
+                fmt::format("empty node at offset {}", offset)};
+        }
+        return nodes_.emplace(offset, std::move(info)).first->second;
+    }
+
+    node_info load_collision(offset_t offset,
+                             const record_header& record,
+                             count_t depth,
+                             hash_t prefix)
+    {
+        auto n      = count_t{record.count};
+        auto values = reader_.collision(offset, record);
+        for (auto i = count_t{}; i < n; ++i) {
+            if (Hash{}(values[i]) != prefix)
+                throw hash_mismatch(offset);
+        }
+
+        auto node = node_ptr{node_t::make_collision_n(n),
+                             [](auto* ptr) { node_t::delete_collision(ptr); }};
+        std::uninitialized_copy_n(values, n, node.get()->collisions());
+        return {std::move(node), n, depth, prefix};
+    }
+
+    node_info load_inner(offset_t offset,
+                         const record_header& record,
+                         count_t depth,
+                         hash_t prefix)
+    {
+        using bitmap_t = typename node_t::bitmap_t;
+
+        auto info   = reader_.inner(offset, record);
+        auto nodes  = static_cast<count_t>(info.children_count);
+        auto values = static_cast<count_t>(info.values_count);
+        auto shift  = depth * B;
+
+        for (auto i = count_t{}; i < values; ++i) {
+            auto hash  = Hash{}(info.values[i]);
+            auto index =
+                (hash >> shift) & immer::detail::hamts::mask<hash_t, B>;
+            auto bit   = std::uint64_t{1} << index;
+            if ((hash & prefix_mask(depth)) != prefix ||
+                !(info.datamap & bit) ||
+                immer::detail::hamts::popcount(info.datamap & (bit - 1)) != i)
+                throw hash_mismatch(offset);
+        }
+
+        auto size     = std::size_t{values};
+        auto children = immer::vector<
+            immer::persist::detail::ptr_with_deleter<node_t>>{};
+        auto bitmap = info.nodemap;
+        for (auto i = count_t{}; i < nodes; ++i) {
+            auto index = static_cast<hash_t>(
+                immer::detail::hamts::popcount((bitmap & -bitmap) - 1));
+            bitmap &= bitmap - 1;
+            const auto& child =
+                load_node(info.children[i], depth + 1, prefix | index << shift);
+            size += child.size;
+            auto ptr = child.node;
+            children = std::move(children).push_back(
+                std::move(ptr).release_full());
+        }
+
+        const auto delete_children = [children] {
+            for (const auto& ptr : children)
+                ptr.dec();
+        };
+        auto inner = node_ptr{node_t::make_inner_n(nodes, values),
+                              [delete_children](auto* ptr) {
+                                  node_t::delete_inner(ptr);
+                                  delete_children();
+                              }};
+        inner.get()->impl.d.data.inner.nodemap =
+            static_cast<bitmap_t>(info.nodemap);
+        inner.get()->impl.d.data.inner.datamap =
+            static_cast<bitmap_t>(info.datamap);
+        if (values)
+            std::uninitialized_copy_n(
+                info.values, values, inner.get()->values());
+        for (auto i = count_t{}; i < nodes; ++i)
+            inner.get()->children()[i] = children[i].ptr;
+        return {std::move(inner), size, depth, prefix};
+    }
+
+    // See `rbts_loader::load_parallel()`.
+    void load_parallel(const container_entry& entry)
+    {
+        auto levels  = std::vector<std::vector<offset_t>>{};
+        auto heights = std::unordered_map<offset_t, std::size_t>{};
+        try {
+            prepare(entry.root, 0, 0, levels, heights);
+            for (const auto& level : levels) {
+                parallel_for(level.size(), threads_, [&](std::size_t i) {
+                    auto offset = level[i];
+                    auto& info  = nodes_.find(offset)->second;
+                    auto record = reader_.bytes.record(offset);
+                    auto depth  = info.depth;
+                    auto prefix = info.prefix;
+                    if (depth < max_depth)
+                        info = load_inner(offset, record, depth, prefix);
+                    else
+                        info = load_collision(offset, record, depth, prefix);
+                    if (info.depth > 0 && info.size == 0) {
+                        throw invalid_binary_pool{
+                            fmt::format("empty node at offset {}", offset)};
+                    }
+                });
+            }
+        } catch (...) {
+            for (const auto& [offset, height] : heights)
+                nodes_.erase(offset);
+            throw;
+        }
+    }
+
+    std::size_t prepare(offset_t offset,
+                        count_t depth,
+                        hash_t prefix,
+                        std::vector<std::vector<offset_t>>& levels,
+                        std::unordered_map<offset_t, std::size_t>& heights)
+    {
+        if (auto it = nodes_.find(offset); it != nodes_.end()) {
+            if (it->second.depth != depth || it->second.prefix != prefix) {
+                throw invalid_binary_pool{fmt::format(
+                    "node at offset {} is used in different positions",
+                    offset)};
+            }
+            auto h = heights.find(offset);
+            return h == heights.end() ? 0 : h->second;
+        }
+
+        auto record = reader_.bytes.record(offset);
+        auto kind   = static_cast<record_kind>(record.kind);
+        auto height = std::size_t{};
+        if (depth < max_depth && kind == record_kind::champ_inner) {
+            auto info   = reader_.inner(offset, record);
+            auto shift  = depth * B;
+            auto bitmap = info.nodemap;
+            for (auto i = std::size_t{}; i < info.children_count; ++i) {
+                auto index = static_cast<hash_t>(
+                    immer::detail::hamts::popcount((bitmap & -bitmap) - 1));
+                bitmap &= bitmap - 1;
+                auto child = prepare(info.children[i],
+                                     depth + 1,
+                                     prefix | index << shift,
+                                     levels,
+                                     heights);
+                height     = std::max(height, child + 1);
+            }
+        } else if (depth != max_depth || kind != record_kind::collision) {
+            throw invalid_binary_pool{
+                fmt::format("unexpected record at offset {}", offset)};
+        }
+
+        nodes_.emplace(offset, node_info{{}, 0, depth, prefix});
+        heights.emplace(offset, height);
+        if (levels.size() <= height)
+            levels.resize(height + 1);
+        levels[height].push_back(offset);
+        return height;
+    }
+
+    champ_reader<T, B> reader_;
+    std::unordered_map<offset_t, node_info> nodes_;
+    unsigned threads_ = 1;
+};
+
+} // namespace immer::persist::binary::detail
@@ -0,0 +1,202 @@
+#pragma once
+
+#include <immer/extra/persist/detail/binary/stream.hpp>
+
+#include <immer/detail/hamts/bits.hpp>
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+namespace immer::persist::binary::detail {
+
+/**
+ * Contents of a record, regardless of where it is stored.  The `context`
+ * distinguishes records with the same bytes that can not be used in place of
+ * each other, like champ nodes at different depths.
+ */
+struct record_contents
+{
+    record_header header;
+    const std::uint64_t* words;
+    std::size_t words_count;
+    const void* values;
+    std::size_t size;
+    std::uint32_t context;
+};
+
+/**
+ * Index of the records of a binary pool by their contents.
+ *
+ * Children are written before their parents, so once equal children are
+ * written only once, equal subtrees end up in records with the same bytes,
+ * and checking the contents of each record is enough to find equal subtrees
+ * of any size.  Records are found by a hash of their bytes, and then compared
+ * byte by byte, so a collision of the hash never merges different records.
+ */
+class content_index
+{
+public:
+    using hash_fn = std::function<std::uint64_t(std::string_view)>;
+
+    explicit content_index(hash_fn hash)
+        : hash_{std::move(hash)}
+    {
+    }
+
+    /**
+     * Returns the offset of a record with the same contents as `r`, or adds
+     * `r` at `offset` and returns `offset` when there is none.  The values of
+     * `r` are not copied, so they must outlive the index.
+     */
+    offset_t emplace(const record_contents& r, offset_t offset)
+    {
+        auto key           = hash(r);
+        auto [first, last] = entries_.equal_range(key);
+        for (auto it = first; it != last; ++it) {
+            if (it->second.equals(r))
+                return it->second.offset;
+        }
+        entries_.emplace(key,
+                         entry{r.header,
+                               {r.words, r.words + r.words_count},
+                               r.values,
+                               r.size,
+                               r.context,
+                               offset});
+        return offset;
+    }
+
+    /**
+     * Adds the records of the tree of `container` in the pool `bytes`, so
+     * that the records added later can refer to them.
+     */
+    void add_pool(const input_bytes& bytes,
+                  structure_kind kind,
+                  const container_entry& container,
+                  std::size_t value_size,
+                  std::size_t value_align)
+    {
+        add_pool_node(bytes, kind, container.root, 0, value_size, value_align);
+        if (kind == structure_kind::rbts)
+            add_pool_node(
+                bytes, kind, container.tail, 0, value_size, value_align);
+    }
+
+private:
+    struct entry
+    {
+        record_header header;
+        std::vector<std::uint64_t> words;
+        const void* values;
+        std::size_t size;
+        std::uint32_t context;
+        offset_t offset;
+
+        bool equals(const record_contents& r) const
+        {
+            return header.kind == r.header.kind &&
+                   header.count == r.header.count && context == r.context &&
+                   size == r.size && words.size() == r.words_count &&
+                   std::equal(words.begin(), words.end(), r.words) &&
+                   (!size || std::memcmp(values, r.values, size) == 0);
+        }
+    };
+
+    std::uint64_t hash(const record_contents& r) const
+    {
+        auto bytes = [](const void* data, std::size_t size) {
+            return std::string_view{static_cast<const char*>(data), size};
+        };
+        const std::uint64_t parts[] = {
+            std::uint64_t{r.header.kind} << 32 | r.header.count,
+            r.context,
+            hash_(bytes(r.words, r.words_count * sizeof(std::uint64_t))),
+            hash_(bytes(r.values, r.size)),
+        };
+        return hash_(bytes(parts, sizeof(parts)));
+    }
+
+    // Deepest tree that a pool can contain, for any parameters.
+    static constexpr auto max_level = 64u;
+
+    void add_pool_node(const input_bytes& bytes,
+                       structure_kind kind,
+                       offset_t offset,
+                       unsigned level,
+                       std::size_t value_size,
+                       std::size_t value_align)
+    {
+        if (level > max_level)
+            throw invalid_binary_pool{"tree is too deep"};
+        if (!visited_.insert(offset).second)
+            return;
+
+        auto record = bytes.record(offset);
+        auto n      = std::size_t{record.count};
+        auto words  = std::size_t{};
+        auto first  = std::size_t{};
+        auto values = std::size_t{};
+        switch (static_cast<record_kind>(record.kind)) {
+        case record_kind::leaf:
+        case record_kind::collision:
+            values = n;
+            break;
+        case record_kind::inner:
+            words = n;
+            break;
+        case record_kind::relaxed:
+            words = 2 * n;
+            break;
+        case record_kind::champ_inner: {
+            auto datamap = bytes.read<std::uint64_t>(
+                offset + sizeof(record_header) + sizeof(std::uint64_t));
+            words  = 2 + n;
+            first  = 2;
+            values = static_cast<std::size_t>(
+                immer::detail::hamts::popcount(datamap));
+            break;
+        }
+        default:
+            throw invalid_binary_pool{
+                fmt::format("unexpected record at offset {}", offset)};
+        }
+
+        auto data  = bytes.array<std::uint64_t>(
+            offset + sizeof(record_header), words);
+        auto begin = align_up(offset + sizeof(record_header) +
+                                  words * sizeof(std::uint64_t),
+                              value_align);
+        if (values > bytes.size() / value_size)
+            throw invalid_binary_pool{
+                fmt::format("array of {} values is too big", values)};
+        bytes.check_range(begin, values * value_size);
+
+        for (auto i = first; i < first + (words ? n : 0); ++i) {
+            if (data[i] >= offset)
+                throw pool_has_cycles{node_id{offset}};
+            add_pool_node(
+                bytes, kind, data[i], level + 1, value_size, value_align);
+        }
+
+        // Champ nodes are told apart by their depth, as the writer does.
+        auto context = kind == structure_kind::champ ? level : 0u;
+        emplace({record,
+                 data,
+                 words,
+                 bytes.data() + begin,
+                 values * value_size,
+                 static_cast<std::uint32_t>(context)},
+                offset);
+    }
+
+    hash_fn hash_;
+    std::unordered_multimap<std::uint64_t, entry> entries_;
+    std::unordered_set<offset_t> visited_;
+};
+
+} // namespace immer::persist::binary::detail
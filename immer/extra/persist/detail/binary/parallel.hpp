@@ -0,0 +1,72 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <exception>
+#include <mutex>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+namespace immer::persist::binary::detail {
+
+/**
+ * Calls `fn(i)` for every `i` in `[0, n)` using up to `threads` threads,
+ * counting the calling one.  Items are handed out in small batches, so that
+ * the work is balanced even when some items are more expensive than others.
+ * The first exception thrown by `fn` is rethrown once all threads are done.
+ */
+template <class Fn>
+void parallel_for(std::size_t n, unsigned threads, Fn&& fn)
+{
+    constexpr auto batch = std::size_t{64};
+
+    auto workers = static_cast<std::size_t>(threads);
+    workers      = std::min(workers, (n + batch - 1) / batch);
+    if (workers <= 1) {
+        for (auto i = std::size_t{}; i < n; ++i)
+            fn(i);
+        return;
+    }
+
+    auto next   = std::atomic<std::size_t>{0};
+    auto failed = std::atomic<bool>{false};
+    auto error  = std::exception_ptr{};
+    auto mutex  = std::mutex{};
+    auto work   = [&] {
+        try {
+            while (!failed.load(std::memory_order_relaxed)) {
+                auto first = next.fetch_add(batch);
+                if (first >= n)
+                    break;
+                auto last = std::min(first + batch, n);
+                for (auto i = first; i < last; ++i)
+                    fn(i);
+            }
+        } catch (...) {
+            auto lock = std::lock_guard<std::mutex>{mutex};
+            if (!error)
+                error = std::current_exception();
+            failed = true;
+        }
+    };
+
+    auto pool = std::vector<std::thread>{};
+    pool.reserve(workers - 1);
+    for (auto i = std::size_t{1}; i < workers; ++i) {
+        try {
+            pool.emplace_back(work);
+        } catch (const std::system_error&) {
+            // Go on with the threads that could be started.
+            break;
+        }
+    }
+    work();
+    for (auto& thread : pool)
+        thread.join();
+    if (error)
+        std::rethrow_exception(error);
+}
+
+} // namespace immer::persist::binary::detail
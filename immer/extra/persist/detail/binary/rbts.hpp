@@ -0,0 +1,605 @@
+#pragma once
+
+#include <immer/extra/persist/detail/binary/batch.hpp>
+#include <immer/extra/persist/detail/binary/parallel.hpp>
+#include <immer/extra/persist/detail/node_ptr.hpp>
+
+#include <immer/detail/rbts/rrbtree.hpp>
+#include <immer/detail/rbts/visitor.hpp>
+
+#include <algorithm>
+#include <cassert>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace immer::persist::binary::detail {
+
+template <typename T,
+          typename MemoryPolicy,
+          immer::detail::rbts::bits_t B,
+          immer::detail::rbts::bits_t BL>
+struct rbts_writer
+{
+    using node_t = immer::detail::rbts::node<T, MemoryPolicy, B, BL>;
+
+    struct written
+    {
+        offset_t offset;
+        std::size_t size;
+    };
+
+    // The same node may be seen with different sizes by different versions
+    // of a vector, when its tail is at different positions.
+    struct node_key
+    {
+        const node_t* node;
+        std::size_t size;
+
+        friend bool operator==(const node_key& a, const node_key& b)
+        {
+            return a.node == b.node && a.size == b.size;
+        }
+    };
+
+    struct node_key_hash
+    {
+        std::size_t operator()(const node_key& k) const
+        {
+            auto seed = std::hash<const void*>{}(k.node);
+            seed ^= k.size + 0x9e3779b9 + (seed << 6) + (seed >> 2);
+            return seed;
+        }
+    };
+
+    struct visitor
+    {
+        template <class Pos>
+        static void visit_regular(Pos&& pos,
+                                  rbts_writer& self,
+                                  record_batch& out,
+                                  std::vector<written>& parent)
+        {
+            self.write_inner(pos, out, parent, record_kind::inner);
+        }
+
+        template <class Pos>
+        static void visit_relaxed(Pos&& pos,
+                                  rbts_writer& self,
+                                  record_batch& out,
+                                  std::vector<written>& parent)
+        {
+            self.write_inner(pos, out, parent, record_kind::relaxed);
+        }
+
+        template <class Pos>
+        static void visit_leaf(Pos&& pos,
+                               rbts_writer& self,
+                               record_batch& out,
+                               std::vector<written>& parent)
+        {
+            self.write_leaf(pos, out, parent);
+        }
+    };
+
+    std::unordered_map<node_key, offset_t, node_key_hash> offsets;
+
+    template <class Tree>
+    container_entry write(record_batch& out, const Tree& tree)
+    {
+        auto written_nodes = std::vector<written>{};
+        tree.traverse(visitor{}, *this, out, written_nodes);
+        assert(written_nodes.size() == 2);
+        return {written_nodes[0].offset,
+                written_nodes[1].offset,
+                tree.size,
+                tree.shift};
+    }
+
+    /**
+     * Takes the nodes of a loader as already written, so that they are not
+     * written again when continuing the pool they were loaded from.
+     */
+    template <class Loader>
+    void add_loaded(const Loader& loader)
+    {
+        loader.for_each_node([&](auto* node, auto size, auto offset) {
+            offsets.emplace(node_key{node, size}, offset);
+        });
+    }
+
+    template <class Pos>
+    bool find_written(const Pos& pos, std::vector<written>& parent) const
+    {
+        auto it = offsets.find(node_key{pos.node(), pos.size()});
+        if (it == offsets.end())
+            return false;
+        parent.push_back({it->second, pos.size()});
+        return true;
+    }
+
+    template <class Pos>
+    void write_inner(Pos& pos,
+                     record_batch& out,
+                     std::vector<written>& parent,
+                     record_kind kind)
+    {
+        if (find_written(pos, parent))
+            return;
+
+        auto children = std::vector<written>{};
+        children.reserve(pos.count());
+        pos.each(visitor{}, *this, out, children);
+
+        auto words = std::vector<std::uint64_t>{};
+        words.reserve(children.size() * 2);
+        for (const auto& child : children)
+            words.push_back(child.offset);
+        if (kind == record_kind::relaxed) {
+            auto size = std::uint64_t{};
+            for (const auto& child : children)
+                words.push_back(size += child.size);
+        }
+        auto offset = out.add(kind, children.size(), std::move(words));
+        offsets.emplace(node_key{pos.node(), pos.size()}, offset);
+        parent.push_back({offset, pos.size()});
+    }
+
+    template <class Pos>
+    void write_leaf(Pos& pos, record_batch& out, std::vector<written>& parent)
+    {
+        if (find_written(pos, parent))
+            return;
+
+        auto n      = pos.count();
+        auto offset = out.add(record_kind::leaf,
+                              n,
+                              {},
+                              pos.node()->leaf(),
+                              n * sizeof(T),
+                              alignof(T));
+        offsets.emplace(node_key{pos.node(), pos.size()}, offset);
+        parent.push_back({offset, pos.size()});
+    }
+};
+
+/**
+ * Access to the nodes of a vector stored in a binary pool, without loading
+ * them.
+ */
+template <typename T,
+          immer::detail::rbts::bits_t B,
+          immer::detail::rbts::bits_t BL>
+struct rbts_reader
+{
+    input_bytes bytes;
+
+    const offset_t* children(offset_t offset, std::size_t n) const
+    {
+        auto result =
+            bytes.array<offset_t>(offset + sizeof(record_header), n);
+        for (auto i = std::size_t{}; i < n; ++i) {
+            if (result[i] >= offset)
+                throw pool_has_cycles{node_id{offset}};
+        }
+        return result;
+    }
+
+    const std::uint64_t* sizes(offset_t offset, std::size_t n) const
+    {
+        return bytes.array<std::uint64_t>(
+            offset + sizeof(record_header) + n * sizeof(offset_t), n);
+    }
+
+    const T* values(offset_t offset, std::size_t n) const
+    {
+        return bytes.array<T>(
+            align_up(offset + sizeof(record_header), alignof(T)), n);
+    }
+
+    const T& get(const container_entry& entry, std::size_t index) const
+    {
+        using immer::detail::rbts::mask;
+
+        auto tail      = bytes.record(entry.tail);
+        auto tail_size = std::size_t{tail.count};
+        if (static_cast<record_kind>(tail.kind) != record_kind::leaf ||
+            tail_size > entry.size) {
+            throw invalid_binary_pool{"wrong tail"};
+        }
+        auto tail_offset = entry.size - tail_size;
+        if (index >= tail_offset)
+            return values(entry.tail, tail_size)[index - tail_offset];
+
+        auto offset = entry.root;
+        auto shift  = entry.shift;
+        while (true) {
+            auto record = bytes.record(offset);
+            auto n      = std::size_t{record.count};
+            switch (static_cast<record_kind>(record.kind)) {
+            case record_kind::leaf: {
+                auto i = index & mask<BL>;
+                if (i >= n)
+                    throw invalid_binary_pool{"index out of leaf bounds"};
+                return values(offset, n)[i];
+            }
+            case record_kind::inner: {
+                auto i = shift < 64 ? (index >> shift) & mask<B> : 0;
+                if (i >= n)
+                    throw invalid_binary_pool{"index out of node bounds"};
+                offset = children(offset, n)[i];
+                break;
+            }
+            case record_kind::relaxed: {
+                auto s = sizes(offset, n);
+                auto i = std::size_t{};
+                while (i < n && s[i] <= index)
+                    ++i;
+                if (i == n)
+                    throw invalid_binary_pool{"index out of node bounds"};
+                index -= i ? s[i - 1] : 0;
+                offset = children(offset, n)[i];
+                break;
+            }
+            default:
+                throw invalid_binary_pool{
+                    fmt::format("unexpected record at offset {}", offset)};
+            }
+            shift -= B;
+        }
+    }
+
+    // Deepest tree that can be addressed with 64 bit indices.
+    static constexpr auto max_depth = (64u - BL) / B + 1u;
+
+    template <class Fn>
+    void for_each_chunk(const container_entry& entry, Fn&& fn) const
+    {
+        for_each_chunk_node(entry.root, fn, 0);
+        for_each_chunk_node(entry.tail, fn, 0);
+    }
+
+    template <class Fn>
+    void for_each_chunk_node(offset_t offset, Fn& fn, unsigned level) const
+    {
+        if (level > max_depth)
+            throw invalid_binary_pool{"tree is too deep"};
+        auto record = bytes.record(offset);
+        auto n      = std::size_t{record.count};
+        switch (static_cast<record_kind>(record.kind)) {
+        case record_kind::leaf: {
+            auto first = values(offset, n);
+            if (n)
+                fn(first, first + n);
+            break;
+        }
+        case record_kind::inner:
+        case record_kind::relaxed: {
+            auto first = children(offset, n);
+            for (auto it = first; it != first + n; ++it)
+                for_each_chunk_node(*it, fn, level + 1);
+            break;
+        }
+        default:
+            throw invalid_binary_pool{
+                fmt::format("unexpected record at offset {}", offset)};
+        }
+    }
+};
+
+/**
+ * Materializes the vectors of a binary pool into regular nodes.  Nodes that
+ * are shared between the vectors in the pool are loaded only once, and are
+ * shared by the loaded vectors too.
+ */
+template <typename T,
+          typename MemoryPolicy,
+          immer::detail::rbts::bits_t B,
+          immer::detail::rbts::bits_t BL>
+class rbts_loader
+{
+public:
+    using rbtree   = immer::detail::rbts::rbtree<T, MemoryPolicy, B, BL>;
+    using rrbtree  = immer::detail::rbts::rrbtree<T, MemoryPolicy, B, BL>;
+    using node_t   = typename rbtree::node_t;
+    using node_ptr = immer::persist::detail::node_ptr<node_t>;
+    using count_t  = immer::detail::rbts::count_t;
+
+    explicit rbts_loader(rbts_reader<T, B, BL> reader)
+        : reader_{reader}
+    {
+    }
+
+    template <class Tree>
+    Tree load(const container_entry& entry)
+    {
+        constexpr auto relaxed_allowed = std::is_same_v<Tree, rrbtree>;
+
+        if (threads_ > 1)
+            load_parallel(entry, relaxed_allowed);
+
+        const auto& root = load_node(entry.root, relaxed_allowed, 0);
+        const auto& tail = load_node(entry.tail, false, 0);
+        if (root.depth == 0 || tail.depth != 0) {
+            throw invalid_binary_pool{"wrong root or tail"};
+        }
+        if (entry.shift != BL + B * (root.depth - 1)) {
+            throw invalid_binary_pool{
+                fmt::format("wrong shift {} for a tree of depth {}",
+                            entry.shift,
+                            root.depth)};
+        }
+        if (entry.size != root.size + tail.size ||
+            (!root.relaxed &&
+             root.size != (entry.size ? (entry.size - 1) &
+                                            ~immer::detail::rbts::mask<BL>
+                                      : 0))) {
+            throw invalid_binary_pool{
+                fmt::format("wrong size {} for tree at offset {}",
+                            entry.size,
+                            entry.root)};
+        }
+
+        auto root_ptr = root.node;
+        auto tail_ptr = tail.node;
+        return Tree{entry.size,
+                    static_cast<immer::detail::rbts::shift_t>(entry.shift),
+                    std::move(root_ptr).release(),
+                    std::move(tail_ptr).release()};
+    }
+
+    /**
+     * Calls `fn(node, size, offset)` for every node loaded so far.
+     */
+    template <class Fn>
+    void for_each_node(Fn&& fn) const
+    {
+        for (const auto& [offset, info] : nodes_)
+            fn(info.node.get(), info.size, offset);
+    }
+
+    /**
+     * Forgets the nodes loaded so far.  They are freed once they are no
+     * longer used by the containers that were loaded.
+     */
+    void clear() { nodes_.clear(); }
+
+    void set_threads(unsigned threads) { threads_ = threads; }
+
+private:
+    struct node_info
+    {
+        node_ptr node;
+        std::size_t size;
+        count_t depth;
+        bool relaxed;
+    };
+
+    static std::size_t full_size(count_t depth)
+    {
+        return std::size_t{1} << (BL + B * depth);
+    }
+
+    const node_info&
+    load_node(offset_t offset, bool relaxed_allowed, unsigned level)
+    {
+        if (level > rbts_reader<T, B, BL>::max_depth)
+            throw invalid_binary_pool{"tree is too deep"};
+        if (auto it = nodes_.find(offset); it != nodes_.end()) {
+            if (it->second.relaxed && !relaxed_allowed)
+                throw invalid_binary_pool{
+                    fmt::format("unexpected relaxed node at offset {}",
+                                offset)};
+            return it->second;
+        }
+
+        auto record = reader_.bytes.record(offset);
+        auto n      = count_t{record.count};
+        auto info   = [&] {
+            switch (static_cast<record_kind>(record.kind)) {
+            case record_kind::leaf:
+                return load_leaf(offset, n);
+            case record_kind::inner:
+                return load_inner(offset, n, false, level);
+            case record_kind::relaxed:
+                if (!relaxed_allowed)
+                    throw invalid_binary_pool{fmt::format(
+                        "unexpected relaxed node at offset {}", offset)};
+                return load_inner(offset, n, n > 0, level);
+            default:
+                throw invalid_binary_pool{
+                    fmt::format("unexpected record at offset {}", offset)};
+            }
+        }();
+        return nodes_.emplace(offset, std::move(info)).first->second;
+    }
+
+    node_info load_leaf(offset_t offset, count_t n)
+    {
+        if (n > immer::detail::rbts::branches<BL>)
+            throw invalid_children_count{node_id{offset}};
+
+        auto values = reader_.values(offset, n);
+        auto leaf =
+            node_ptr{n ? node_t::make_leaf_n(n) : rbtree::empty_tail(),
+                     [n](auto* ptr) { node_t::delete_leaf(ptr, n); }};
+        std::uninitialized_copy_n(values, n, leaf.get()->leaf());
+        return {std::move(leaf), n, 0, false};
+    }
+
+    node_info
+    load_inner(offset_t offset, count_t n, bool is_relaxed, unsigned level)
+    {
+        if (n > immer::detail::rbts::branches<B>)
+            throw invalid_children_count{node_id{offset}};
+
+        auto ids = reader_.children(offset, n);
+
+        // Children must have the same depth, and the subtrees of regular
+        // nodes must be dense to the left, as otherwise they can not be
+        // traversed without a size table.
+        auto size     = std::size_t{};
+        auto depth    = count_t{};
+        auto children = immer::vector<
+            immer::persist::detail::ptr_with_deleter<node_t>>{};
+        auto sizes = std::vector<std::size_t>{};
+        for (auto i = count_t{}; i < n; ++i) {
+            const auto& child = load_node(ids[i], is_relaxed, level + 1);
+            if (i == 0) {
+                depth = child.depth;
+            } else if (child.depth != depth) {
+                throw invalid_binary_pool{fmt::format(
+                    "children of node at offset {} have different depths",
+                    offset)};
+            }
+            if (child.size == 0 ||
+                (!is_relaxed && i + 1 < n && child.size != full_size(depth))) {
+                throw invalid_binary_pool{fmt::format(
+                    "child {} of node at offset {} has wrong size {}",
+                    i,
+                    offset,
+                    child.size)};
+            }
+            size += child.size;
+            sizes.push_back(size);
+            auto ptr = child.node;
+            children = std::move(children).push_back(
+                std::move(ptr).release_full());
+        }
+
+        if (is_relaxed) {
+            auto stored = reader_.sizes(offset, n);
+            if (!std::equal(sizes.begin(), sizes.end(), stored)) {
+                throw invalid_binary_pool{fmt::format(
+                    "wrong size table in node at offset {}", offset)};
+            }
+        }
+
+        const auto delete_children = [children] {
+            for (const auto& ptr : children)
+                ptr.dec();
+        };
+        auto inner =
+            is_relaxed
+                ? node_ptr{node_t::make_inner_r_n(n),
+                           [n, delete_children](auto* ptr) {
+                               node_t::delete_inner_r(ptr, n);
+                               delete_children();
+                           }}
+                : node_ptr{n ? node_t::make_inner_n(n) : rbtree::empty_root(),
+                           [n, delete_children](auto* ptr) {
+                               node_t::delete_inner(ptr, n);
+                               delete_children();
+                           }};
+        for (auto i = count_t{}; i < n; ++i)
+            inner.get()->inner()[i] = children[i].ptr;
+        if (is_relaxed) {
+            inner.get()->relaxed()->d.count = n;
+            std::copy(
+                sizes.begin(), sizes.end(), inner.get()->relaxed()->d.sizes);
+        }
+        return {std::move(inner), size, depth + 1, is_relaxed};
+    }
+
+    // Loads the nodes of `entry` that are not loaded yet using several
+    // threads.  The records are first checked and grouped by height, and
+    // an empty entry is added for each of them, so that the map is not
+    // modified while the nodes of each height are built in parallel.
+    void load_parallel(const container_entry& entry, bool relaxed_allowed)
+    {
+        auto levels  = std::vector<std::vector<offset_t>>{};
+        auto heights = std::unordered_map<offset_t, std::size_t>{};
+        try {
+            prepare(entry.root, relaxed_allowed, 0, levels, heights);
+            prepare(entry.tail, false, 0, levels, heights);
+            for (const auto& level : levels) {
+                parallel_for(level.size(), threads_, [&](std::size_t i) {
+                    auto offset = level[i];
+                    auto& info  = nodes_.find(offset)->second;
+                    auto record = reader_.bytes.record(offset);
+                    auto n      = count_t{record.count};
+                    switch (static_cast<record_kind>(record.kind)) {
+                    case record_kind::leaf:
+                        info = load_leaf(offset, n);
+                        break;
+                    case record_kind::inner:
+                        info = load_inner(offset, n, false, 0);
+                        break;
+                    default:
+                        info = load_inner(offset, n, n > 0, 0);
+                        break;
+                    }
+                });
+            }
+        } catch (...) {
+            for (const auto& [offset, height] : heights)
+                nodes_.erase(offset);
+            throw;
+        }
+    }
+
+    // Returns the height of the node at `offset`, where leaves have height
+    // zero, after adding an empty entry for it and its children.
+    std::size_t prepare(offset_t offset,
+                        bool relaxed_allowed,
+                        unsigned level,
+                        std::vector<std::vector<offset_t>>& levels,
+                        std::unordered_map<offset_t, std::size_t>& heights)
+    {
+        if (level > rbts_reader<T, B, BL>::max_depth)
+            throw invalid_binary_pool{"tree is too deep"};
+        if (auto it = nodes_.find(offset); it != nodes_.end()) {
+            if (it->second.relaxed && !relaxed_allowed)
+                throw invalid_binary_pool{fmt::format(
+                    "unexpected relaxed node at offset {}", offset)};
+            // Nodes that are already loaded are not built again, so their
+            // parents can be built as soon as any other node.
+            auto h = heights.find(offset);
+            return h == heights.end() ? 0 : h->second;
+        }
+
+        auto record = reader_.bytes.record(offset);
+        auto n      = count_t{record.count};
+        auto kind   = static_cast<record_kind>(record.kind);
+        auto height = std::size_t{};
+        switch (kind) {
+        case record_kind::leaf:
+            break;
+        case record_kind::relaxed:
+            if (!relaxed_allowed)
+                throw invalid_binary_pool{fmt::format(
+                    "unexpected relaxed node at offset {}", offset)};
+            [[fallthrough]];
+        case record_kind::inner: {
+            if (n > immer::detail::rbts::branches<B>)
+                throw invalid_children_count{node_id{offset}};
+            auto is_relaxed = kind == record_kind::relaxed && n > 0;
+            auto ids        = reader_.children(offset, n);
+            for (auto i = count_t{}; i < n; ++i)
+                height = std::max(
+                    height,
+                    prepare(ids[i], is_relaxed, level + 1, levels, heights) +
+                        1);
+            break;
+        }
+        default:
+            throw invalid_binary_pool{
+                fmt::format("unexpected record at offset {}", offset)};
+        }
+
+        nodes_.emplace(
+            offset,
+            node_info{{}, 0, 0, kind == record_kind::relaxed && n > 0});
+        heights.emplace(offset, height);
+        if (levels.size() <= height)
+            levels.resize(height + 1);
+        levels[height].push_back(offset);
+        return height;
+    }
+
+    rbts_reader<T, B, BL> reader_;
+    std::unordered_map<offset_t, node_info> nodes_;
+    unsigned threads_ = 1;
+};
+
+} // namespace immer::persist::binary::detail
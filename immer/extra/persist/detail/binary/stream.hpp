@@ -0,0 +1,132 @@
+#pragma once
+
+#include <immer/extra/persist/binary/format.hpp>
+
+#include <cstdint>
+#include <cstring>
+#include <ios>
+#include <ostream>
+#include <string_view>
+
+namespace immer::persist::binary::detail {
+
+constexpr offset_t align_up(offset_t offset, std::size_t alignment)
+{
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+/**
+ * Writes bytes to a `std::ostream` while keeping track of the offset, so that
+ * records can refer to the ones that were written before them.
+ */
+class output_stream
+{
+public:
+    explicit output_stream(std::ostream& os, offset_t offset = 0)
+        : os_{&os}
+        , offset_{offset}
+    {
+    }
+
+    offset_t offset() const { return offset_; }
+
+    void write(const void* data, std::size_t size)
+    {
+        os_->write(static_cast<const char*>(data),
+                   static_cast<std::streamsize>(size));
+        if (!*os_) {
+            throw std::ios_base::failure{
+                fmt::format("Failed to write {} bytes", size)};
+        }
+        offset_ += size;
+    }
+
+    template <class T>
+    void write(const T& value)
+    {
+        write(&value, sizeof(T));
+    }
+
+    void pad(std::size_t alignment)
+    {
+        static constexpr char zeros[64] = {};
+        auto n = align_up(offset_, alignment) - offset_;
+        while (n) {
+            auto chunk = n < sizeof(zeros) ? n : sizeof(zeros);
+            write(zeros, chunk);
+            n -= chunk;
+        }
+    }
+
+private:
+    std::ostream* os_;
+    offset_t offset_;
+};
+
+/**
+ * Bounds checked access to the bytes of a binary pool.
+ */
+class input_bytes
+{
+public:
+    input_bytes() = default;
+
+    explicit input_bytes(std::string_view bytes)
+        : bytes_{bytes}
+    {
+    }
+
+    std::size_t size() const { return bytes_.size(); }
+    const char* data() const { return bytes_.data(); }
+
+    void check_range(offset_t offset, std::size_t size) const
+    {
+        if (offset > bytes_.size() || size > bytes_.size() - offset) {
+            throw invalid_binary_pool{
+                fmt::format("{} bytes at offset {} are out of bounds",
+                            size,
+                            offset)};
+        }
+    }
+
+    template <class T>
+    T read(offset_t offset) const
+    {
+        check_range(offset, sizeof(T));
+        auto result = T{};
+        std::memcpy(&result, bytes_.data() + offset, sizeof(T));
+        return result;
+    }
+
+    /**
+     * Returns a pointer to `n` objects of type `T` stored in place.
+     */
+    template <class T>
+    const T* array(offset_t offset, std::size_t n) const
+    {
+        if (n > bytes_.size() / sizeof(T)) {
+            throw invalid_binary_pool{
+                fmt::format("array of {} values is too big", n)};
+        }
+        check_range(offset, n * sizeof(T));
+        if (offset % alignof(T)) {
+            throw invalid_binary_pool{
+                fmt::format("misaligned array at offset {}", offset)};
+        }
+        return reinterpret_cast<const T*>(bytes_.data() + offset);
+    }
+
+    record_header record(offset_t offset) const
+    {
+        if (offset % record_alignment) {
+            throw invalid_binary_pool{
+                fmt::format("misaligned record at offset {}", offset)};
+        }
+        return read<record_header>(offset);
+    }
+
+private:
+    std::string_view bytes_;
+};
+
+} // namespace immer::persist::binary::detail
@@ -0,0 +1,111 @@
+#pragma once
+
+#include <immer/extra/persist/detail/binary/champ.hpp>
+#include <immer/extra/persist/detail/binary/rbts.hpp>
+
+namespace immer::persist::binary::detail {
+
+/**
+ * Describes how the tree `Impl` of a container is stored in a binary pool.
+ */
+template <class Impl>
+struct structure;
+
+template <typename T,
+          typename MemoryPolicy,
+          immer::detail::rbts::bits_t B,
+          immer::detail::rbts::bits_t BL>
+struct structure<immer::detail::rbts::rbtree<T, MemoryPolicy, B, BL>>
+{
+    using impl_t   = immer::detail::rbts::rbtree<T, MemoryPolicy, B, BL>;
+    using value_t  = T;
+    using writer_t = rbts_writer<T, MemoryPolicy, B, BL>;
+    using reader_t = rbts_reader<T, B, BL>;
+    using loader_t = rbts_loader<T, MemoryPolicy, B, BL>;
+
+    static constexpr auto kind      = structure_kind::rbts;
+    static constexpr auto bits      = B;
+    static constexpr auto bits_leaf = BL;
+
+    static impl_t load(loader_t& loader, const container_entry& entry)
+    {
+        return loader.template load<impl_t>(entry);
+    }
+};
+
+template <typename T,
+          typename MemoryPolicy,
+          immer::detail::rbts::bits_t B,
+          immer::detail::rbts::bits_t BL>
+struct structure<immer::detail::rbts::rrbtree<T, MemoryPolicy, B, BL>>
+{
+    using impl_t   = immer::detail::rbts::rrbtree<T, MemoryPolicy, B, BL>;
+    using value_t  = T;
+    using writer_t = rbts_writer<T, MemoryPolicy, B, BL>;
+    using reader_t = rbts_reader<T, B, BL>;
+    using loader_t = rbts_loader<T, MemoryPolicy, B, BL>;
+
+    static constexpr auto kind      = structure_kind::rbts;
+    static constexpr auto bits      = B;
+    static constexpr auto bits_leaf = BL;
+
+    static impl_t load(loader_t& loader, const container_entry& entry)
+    {
+        return loader.template load<impl_t>(entry);
+    }
+};
+
+template <typename T,
+          typename Hash,
+          typename Equal,
+          typename MemoryPolicy,
+          immer::detail::hamts::bits_t B>
+struct structure<immer::detail::hamts::champ<T, Hash, Equal, MemoryPolicy, B>>
+{
+    using impl_t =
+        immer::detail::hamts::champ<T, Hash, Equal, MemoryPolicy, B>;
+    using value_t  = T;
+    using writer_t = champ_writer<T, Hash, Equal, MemoryPolicy, B>;
+    using reader_t = champ_reader<T, B>;
+    using loader_t = champ_loader<T, Hash, Equal, MemoryPolicy, B>;
+
+    static constexpr auto kind      = structure_kind::champ;
+    static constexpr auto bits      = B;
+    static constexpr auto bits_leaf = immer::detail::hamts::bits_t{};
+
+    static impl_t load(loader_t& loader, const container_entry& entry)
+    {
+        return loader.load(entry);
+    }
+
+    template <class K>
+    static const T*
+    find(const reader_t& reader, const container_entry& entry, const K& key)
+    {
+        return reader.template find<Hash, Equal>(entry, key);
+    }
+};
+
+template <class Container>
+using structure_for = structure<
+    std::decay_t<decltype(std::declval<const Container&>().impl())>>;
+
+template <class Container>
+file_header make_header()
+{
+    using structure_t = structure_for<Container>;
+    using value_t     = typename structure_t::value_t;
+
+    auto header = file_header{};
+    std::copy(std::begin(header_magic), std::end(header_magic), header.magic);
+    header.version     = format_version;
+    header.byte_order  = byte_order_mark;
+    header.structure   = static_cast<std::uint32_t>(structure_t::kind);
+    header.value_size  = sizeof(value_t);
+    header.value_align = alignof(value_t);
+    header.bits        = structure_t::bits;
+    header.bits_leaf   = structure_t::bits_leaf;
+    return header;
+}
+
+} // namespace immer::persist::binary::detail
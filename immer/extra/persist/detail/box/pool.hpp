@@ -1,5 +1,6 @@
 #pragma once
 
+#include <immer/extra/persist/detail/common/flat_map.hpp>
 #include <immer/extra/persist/detail/common/pool.hpp>
 #include <immer/extra/persist/detail/traits.hpp>
 #include <immer/extra/persist/errors.hpp>
@@ -17,9 +18,9 @@ namespace immer::persist::box {
 template <typename T, typename MemoryPolicy>
 struct output_pool
 {
-    immer::map<container_id, immer::box<T, MemoryPolicy>> boxes;
+    detail::flat_map<container_id, immer::box<T, MemoryPolicy>> boxes;
 
-    immer::map<const void*, container_id> ids;
+    detail::flat_map<const void*, container_id> ids;
 
     friend bool operator==(const output_pool& left, const output_pool& right)
     {
@@ -60,7 +61,7 @@ get_box_id(output_pool<T, MemoryPolicy> pool,
     }
 
     const auto id = container_id{pool.ids.size()};
-    pool.ids      = std::move(pool.ids).set(ptr_void, id);
+    pool.ids.insert(ptr_void, id);
     return {std::move(pool), id};
 }
 
@@ -136,7 +137,7 @@ add_to_pool(immer::box<T, MemoryPolicy> box, output_pool<T, MemoryPolicy> pool)
         return {std::move(pool), id};
     }
 
-    pool.boxes = std::move(pool.boxes).set(id, std::move(box));
+    pool.boxes.insert(id, std::move(box));
     return {std::move(pool), id};
 }
 
@@ -1,9 +1,14 @@
 #pragma once
 
+#include <immer/extra/persist/detail/common/flat_map.hpp>
+
 #include <cereal/cereal.hpp>
 
 #include <immer/map.hpp>
 
+#include <algorithm>
+#include <vector>
+
 namespace immer::persist::detail {
 
 template <class K, class T>
@@ -25,6 +30,22 @@ compact_map<K, T> make_compact_map(immer::map<K, T>& map)
     return compact_map<K, T>{map};
 }
 
+/**
+ * Saves a `flat_map` like a `compact_map`, ordered by id so that the output
+ * does not depend on the order in which the nodes were visited.
+ */
+template <class K, class T>
+struct compact_flat_map
+{
+    const flat_map<K, T>& map;
+};
+
+template <class K, class T>
+compact_flat_map<K, T> make_compact_map(const flat_map<K, T>& map)
+{
+    return compact_flat_map<K, T>{map};
+}
+
 } // namespace immer::persist::detail
 
 namespace cereal {
@@ -81,4 +102,23 @@ void CEREAL_SAVE_FUNCTION_NAME(
     }
 }
 
+template <typename Archive, typename K, typename T>
+void CEREAL_SAVE_FUNCTION_NAME(
+    Archive& ar, const immer::persist::detail::compact_flat_map<K, T>& m)
+{
+    auto entries = std::vector<const std::pair<K, T>*>{};
+    entries.reserve(m.map.size());
+    for (const auto& v : m.map) {
+        entries.push_back(&v);
+    }
+    std::sort(entries.begin(), entries.end(), [](auto* a, auto* b) {
+        return a->first.value < b->first.value;
+    });
+
+    ar(make_size_tag(static_cast<size_type>(entries.size())));
+    for (const auto* v : entries) {
+        ar(immer::persist::detail::compact_pair<K, T>{v->first, v->second});
+    }
+}
+
 } // namespace cereal
@@ -0,0 +1,180 @@
+#pragma once
+
+#include <immer/extra/persist/cereal/leaf_codecs.hpp>
+#include <immer/extra/persist/detail/common/flat_map.hpp>
+#include <immer/extra/persist/detail/common/pool.hpp>
+
+#include <cereal/cereal.hpp>
+
+#include <immer/map.hpp>
+#include <immer/map_transient.hpp>
+
+#include <algorithm>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace immer::persist::detail {
+
+/**
+ * The leaves of a pool, ordered by id like in a `compact_flat_map`, and
+ * saved like it with `Coder` in place of the plain values.
+ */
+template <class T, class Coder>
+struct encoded_leaves_save
+{
+    std::vector<std::pair<node_id, values_save<T>>> leaves;
+    const Coder& coder;
+};
+
+template <class T, class Coder>
+struct encoded_leaves_load
+{
+    immer::map<node_id, values_load<T>>& leaves;
+    const Coder& coder;
+};
+
+template <class T>
+auto sorted_leaves(const flat_map<node_id, values_save<T>>& leaves)
+{
+    auto result = std::vector<std::pair<node_id, values_save<T>>>{
+        leaves.begin(), leaves.end()};
+    std::sort(result.begin(), result.end(), [](auto& a, auto& b) {
+        return a.first.value < b.first.value;
+    });
+    return result;
+}
+
+template <class T, class Coder>
+struct encoded_leaf_save
+{
+    node_id id;
+    values_save<T> values;
+    const Coder& coder;
+};
+
+template <class T, class Coder>
+struct encoded_leaf_load
+{
+    node_id id;
+    values_load<T> values;
+    const Coder& coder;
+};
+
+template <class Archive, class T, class Coder>
+void save(Archive& ar, const encoded_leaf_save<T, Coder>& m)
+{
+    ar(cereal::make_size_tag(static_cast<cereal::size_type>(2)));
+    ar(m.id);
+    m.coder.save_leaf(ar, m.values.begin, m.values.end);
+}
+
+template <class Archive, class T, class Coder>
+void load(Archive& ar, encoded_leaf_load<T, Coder>& m)
+{
+    auto size = cereal::size_type{};
+    ar(cereal::make_size_tag(size));
+    if (size != 2) {
+        throw cereal::Exception{"A pair must be a list of 2 elements"};
+    }
+    ar(m.id);
+    m.values = m.coder.load_leaf(ar);
+}
+
+template <class Archive, class T, class Coder>
+void save(Archive& ar, const encoded_leaves_save<T, Coder>& m)
+{
+    ar(cereal::make_size_tag(
+        static_cast<cereal::size_type>(m.leaves.size())));
+    for (const auto& [id, values] : m.leaves) {
+        ar(encoded_leaf_save<T, Coder>{id, values, m.coder});
+    }
+}
+
+template <class Archive, class T, class Coder>
+void load(Archive& ar, encoded_leaves_load<T, Coder>& m)
+{
+    auto size = cereal::size_type{};
+    ar(cereal::make_size_tag(size));
+    auto leaves = immer::map<node_id, values_load<T>>{}.transient();
+    for (auto i = cereal::size_type{}; i < size; ++i) {
+        auto leaf = encoded_leaf_load<T, Coder>{{}, {}, m.coder};
+        ar(leaf);
+        leaves.set(leaf.id, std::move(leaf.values));
+    }
+    if (size != leaves.size())
+        throw cereal::Exception{"duplicate ids?"};
+    m.leaves = std::move(leaves).persistent();
+}
+
+template <class Pool, class Archive, class Codec, class = void>
+struct can_save_with_leaf_codec : std::false_type
+{};
+
+template <class Pool, class Archive, class Codec>
+struct can_save_with_leaf_codec<
+    Pool,
+    Archive,
+    Codec,
+    std::void_t<decltype(std::declval<const Pool&>().save_with_leaf_codec(
+        std::declval<Archive&>(), std::declval<const Codec&>()))>>
+    : std::true_type
+{};
+
+template <class Pool, class Archive, class Codec, class = void>
+struct can_load_with_leaf_codec : std::false_type
+{};
+
+template <class Pool, class Archive, class Codec>
+struct can_load_with_leaf_codec<
+    Pool,
+    Archive,
+    Codec,
+    std::void_t<decltype(std::declval<Pool&>().load_with_leaf_codec(
+        std::declval<Archive&>(), std::declval<const Codec&>()))>>
+    : std::true_type
+{};
+
+/**
+ * Pool saved with the leaf codec that the policy names for it.  Only the
+ * pools of `vector` and `flex_vector` support leaf codecs.
+ */
+template <class Pool, class Codec>
+struct leaf_codec_output_pool
+{
+    const Pool& pool;
+    Codec codec;
+
+    template <class Archive>
+    void save(Archive& ar) const
+    {
+        if constexpr (can_save_with_leaf_codec<Pool, Archive, Codec>::value) {
+            pool.save_with_leaf_codec(ar, codec);
+        } else {
+            static_assert(can_save_with_leaf_codec<Pool, Archive, Codec>::value,
+                          "get_leaf_codec can only name a codec other than "
+                          "plain_leaf_codec for vector and flex_vector pools");
+        }
+    }
+};
+
+template <class Pool, class Codec>
+struct leaf_codec_input_pool
+{
+    Pool& pool;
+    Codec codec;
+
+    template <class Archive>
+    void load(Archive& ar)
+    {
+        if constexpr (can_load_with_leaf_codec<Pool, Archive, Codec>::value) {
+            pool.load_with_leaf_codec(ar, codec);
+        } else {
+            static_assert(can_load_with_leaf_codec<Pool, Archive, Codec>::value,
+                          "get_leaf_codec can only name a codec other than "
+                          "plain_leaf_codec for vector and flex_vector pools");
+        }
+    }
+};
+
+} // namespace immer::persist::detail
@@ -2,6 +2,8 @@
 
 #include <immer/extra/io.hpp>
 #include <immer/extra/persist/cereal/archives.hpp>
+#include <immer/extra/persist/cereal/leaf_codecs.hpp>
+#include <immer/extra/persist/detail/cereal/encoded_leaves.hpp>
 #include <immer/extra/persist/detail/names.hpp>
 #include <immer/extra/persist/detail/traits.hpp>
 #include <immer/extra/persist/errors.hpp>
@@ -84,7 +86,17 @@ struct output_pools
                 if (!inserted) {
                     throw duplicate_name_pool_detected{name};
                 }
-                ar(cereal::make_nvp(name, storage()[key]));
+                using Codec =
+                    decltype(get_leaf_codec(pool_name_fn{}, Container{}));
+                if constexpr (std::is_same_v<Codec, plain_leaf_codec>) {
+                    ar(cereal::make_nvp(name, storage()[key]));
+                } else {
+                    using Pool = std::decay_t<decltype(storage()[key])>;
+                    ar(cereal::make_nvp(
+                        name,
+                        leaf_codec_output_pool<Pool, Codec>{storage()[key],
+                                                            Codec{}}));
+                }
             }
         });
     }
@@ -291,7 +303,16 @@ public:
         hana::for_each(keys_t{}, [&](auto key) {
             using Container  = typename decltype(key)::type;
             const auto& name = pool_name_fn{}(Container{});
-            ar(cereal::make_nvp(name, storage()[key].pool));
+            using Codec =
+                decltype(get_leaf_codec(pool_name_fn{}, Container{}));
+            if constexpr (std::is_same_v<Codec, plain_leaf_codec>) {
+                ar(cereal::make_nvp(name, storage()[key].pool));
+            } else {
+                using Pool = std::decay_t<decltype(storage()[key].pool)>;
+                auto pool  = leaf_codec_input_pool<Pool, Codec>{
+                    storage()[key].pool, Codec{}};
+                ar(cereal::make_nvp(name, pool));
+            }
         });
     }
 
@@ -433,16 +454,16 @@ public:
     }
 };
 
-template <class T>
+/**
+ * `PoolT` selects the pool of each type, like `streaming_output_pool_t`.
+ */
+template <template <class> class PoolT = output_pool_t, class T>
 auto generate_output_pools(T types)
 {
     auto storage =
         hana::fold_left(types, hana::make_map(), [](auto map, auto type) {
             using Type = typename decltype(type)::type;
-            return hana::insert(
-                map,
-                hana::make_pair(
-                    type, typename container_traits<Type>::output_pool_t{}));
+            return hana::insert(map, hana::make_pair(type, PoolT<Type>{}));
         });
 
     using Storage = decltype(storage);
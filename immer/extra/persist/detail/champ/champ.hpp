@@ -164,10 +164,8 @@ template <class Container>
 std::pair<container_output_pool<Container>, node_id>
 add_to_pool(Container container, container_output_pool<Container> pool)
 {
-    const auto& impl = container.impl();
-    auto root_id     = node_id{};
-    std::tie(pool.nodes, root_id) =
-        get_node_id(std::move(pool.nodes), impl.root);
+    const auto& impl   = container.impl();
+    const auto root_id = get_node_id(pool.nodes, impl.root);
 
     if (pool.nodes.inners.count(root_id)) {
         // Already been saved
@@ -1,6 +1,7 @@
 #pragma once
 
 #include <immer/extra/persist/detail/champ/pool.hpp>
+#include <immer/extra/persist/detail/common/flat_map.hpp>
 #include <immer/extra/persist/detail/node_ptr.hpp>
 #include <immer/extra/persist/errors.hpp>
 
@@ -96,7 +97,7 @@ public:
         immer::detail::uninitialized_copy(
             values.begin(), values.end(), node.get()->collisions());
         auto result = std::make_pair(std::move(node), values_t{values});
-        collisions_ = std::move(collisions_).set(id, result);
+        collisions_.insert(id, result);
         return result;
     }
 
@@ -186,7 +187,7 @@ public:
             inner.get()->children()[index] = child_ptr.ptr;
         }
 
-        inners_ = std::move(inners_).set(id, std::make_pair(inner, values));
+        inners_.insert(id, std::make_pair(inner, values));
         return {std::move(inner), std::move(values)};
     }
 
@@ -243,8 +244,8 @@ private:
 private:
     const NodesLoad pool_;
     const TransformF transform_;
-    immer::map<node_id, std::pair<node_ptr, values_t>> collisions_;
-    immer::map<node_id, std::pair<node_ptr, values_t>> inners_;
+    detail::flat_map<node_id, std::pair<node_ptr, values_t>> collisions_;
+    detail::flat_map<node_id, std::pair<node_ptr, values_t>> inners_;
 };
 
 } // namespace immer::persist::champ
@@ -36,7 +36,7 @@ struct output_pool_builder
             }
         }
 
-        pool.inners = std::move(pool.inners).set(id, node_info);
+        pool.inners.insert(id, std::move(node_info));
     }
 
     template <class Node>
@@ -47,14 +47,13 @@ struct output_pool_builder
             return;
         }
 
-        pool.inners = std::move(pool.inners)
-                          .set(id,
-                               inner_node_save<T, B>{
-                                   .values     = {node->collisions(),
-                                                  node->collisions() +
-                                                      node->collision_count()},
-                                   .collisions = true,
-                               });
+        pool.inners.insert(
+            id,
+            inner_node_save<T, B>{
+                .values     = {node->collisions(),
+                               node->collisions() + node->collision_count()},
+                .collisions = true,
+            });
     }
 
     template <class Node>
@@ -73,10 +72,7 @@ struct output_pool_builder
     template <class Node>
     node_id get_node_id(Node* ptr)
     {
-        auto [pool2, id] =
-            immer::persist::champ::get_node_id(std::move(pool), ptr);
-        pool = std::move(pool2);
-        return id;
+        return immer::persist::champ::get_node_id(pool, ptr);
     }
 };
 
@@ -1,11 +1,13 @@
 #pragma once
 
+#include <immer/extra/persist/detail/common/flat_map.hpp>
 #include <immer/extra/persist/detail/common/pool.hpp>
 
 #include <immer/map.hpp>
 #include <immer/set.hpp>
 #include <immer/table.hpp>
 #include <immer/vector.hpp>
+#include <immer/vector_transient.hpp>
 
 #include <immer/extra/cereal/immer_vector.hpp>
 
@@ -85,9 +87,9 @@ template <class T, immer::detail::hamts::bits_t B>
 struct nodes_save
 {
     // Saving is simpler with a map
-    immer::map<node_id, inner_node_save<T, B>> inners;
+    detail::flat_map<node_id, inner_node_save<T, B>> inners;
 
-    immer::map<const void*, node_id> node_ptr_to_id;
+    detail::flat_map<const void*, node_id> node_ptr_to_id;
 
     friend bool operator==(const nodes_save& left, const nodes_save& right)
     {
@@ -100,19 +102,18 @@ template <typename T,
           typename Equal,
           typename MemoryPolicy,
           immer::detail::hamts::bits_t B>
-std::pair<nodes_save<T, B>, node_id> get_node_id(
-    nodes_save<T, B> nodes,
+node_id get_node_id(
+    nodes_save<T, B>& nodes,
     const immer::detail::hamts::node<T, Hash, Equal, MemoryPolicy, B>* ptr)
 {
     auto* ptr_void = static_cast<const void*>(ptr);
     if (auto* maybe_id = nodes.node_ptr_to_id.find(ptr_void)) {
-        auto id = *maybe_id;
-        return {std::move(nodes), id};
+        return *maybe_id;
     }
 
-    const auto id        = node_id{nodes.node_ptr_to_id.size()};
-    nodes.node_ptr_to_id = std::move(nodes.node_ptr_to_id).set(ptr_void, id);
-    return {std::move(nodes), id};
+    const auto id = node_id{nodes.node_ptr_to_id.size()};
+    nodes.node_ptr_to_id.insert(ptr_void, id);
+    return id;
 }
 
 template <class T, immer::detail::hamts::bits_t B>
@@ -122,22 +123,22 @@ template <template <class, immer::detail::hamts::bits_t> class InnerNodeType,
           class T,
           immer::detail::hamts::bits_t B>
 immer::vector<InnerNodeType<T, B>>
-linearize_map(const immer::map<node_id, inner_node_save<T, B>>& inners)
+linearize_map(const detail::flat_map<node_id, inner_node_save<T, B>>& inners)
 {
-    auto result = immer::vector<InnerNodeType<T, B>>{};
+    auto result = immer::vector<InnerNodeType<T, B>>{}.transient();
     for (auto index = std::size_t{}; index < inners.size(); ++index) {
         auto* p = inners.find(node_id{index});
         assert(p);
         const auto& inner = *p;
-        result            = std::move(result).push_back(InnerNodeType<T, B>{
-                       .values     = inner.values,
-                       .children   = inner.children,
-                       .nodemap    = inner.nodemap,
-                       .datamap    = inner.datamap,
-                       .collisions = inner.collisions,
+        result.push_back(InnerNodeType<T, B>{
+            .values     = inner.values,
+            .children   = inner.children,
+            .nodemap    = inner.nodemap,
+            .datamap    = inner.datamap,
+            .collisions = inner.collisions,
         });
     }
-    return result;
+    return std::move(result).persistent();
 }
 
 /**
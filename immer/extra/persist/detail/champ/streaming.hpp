@@ -0,0 +1,225 @@
+#pragma once
+
+#include <immer/extra/persist/detail/champ/pool.hpp>
+
+#include <cassert>
+#include <utility>
+#include <vector>
+
+namespace immer::persist::champ {
+
+/**
+ * Pool that only keeps the containers, and writes their nodes as it walks
+ * them when it is saved.  It produces the same format as
+ * `container_output_pool`, but the only thing it needs to remember while
+ * saving is the id of every node that is shared.
+ *
+ * The roots take the first ids, in the order of the containers, and the rest
+ * of the nodes are numbered in post-order, so that they can be written in the
+ * order of their ids while walking the trees.
+ */
+template <class Container>
+struct streaming_container_output_pool
+{
+    using champ_t = std::decay_t<decltype(std::declval<Container>().impl())>;
+    using node_t  = typename champ_t::node_t;
+    using T       = typename node_t::value_t;
+    using ids_t   = detail::flat_map<const void*, node_id>;
+
+    static constexpr auto B = champ_t::bits;
+
+    immer::vector<Container> containers;
+    // The ids of the roots.
+    ids_t ids;
+
+    friend bool operator==(const streaming_container_output_pool& left,
+                           const streaming_container_output_pool& right)
+    {
+        return left.ids == right.ids;
+    }
+
+    friend bool operator!=(const streaming_container_output_pool& left,
+                           const streaming_container_output_pool& right)
+    {
+        return !(left == right);
+    }
+
+    template <class Archive>
+    void save(Archive& ar) const
+    {
+        // Saving the values may add containers to this pool, so only a copy
+        // of it is used from now on.
+        const auto saved = containers;
+        const auto roots = ids;
+        auto numbers     = numbering{roots, {}, saved.size()};
+        auto children    = std::vector<node_id>{};
+        auto offsets     = std::vector<std::size_t>{0};
+        for (const auto& container : saved) {
+            walk_children(container.impl().root, 0, numbers, children);
+            offsets.push_back(children.size());
+        }
+
+        ar(cereal::make_size_tag(
+            static_cast<cereal::size_type>(numbers.next)));
+        for (auto i = std::size_t{}; i < saved.size(); ++i) {
+            ar(make_node(saved[i].impl().root,
+                         0,
+                         children.cbegin() + offsets[i],
+                         children.cbegin() + offsets[i + 1]));
+        }
+        auto emit  = emitter<Archive>{numbers, ar, saved.size()};
+        auto stack = std::vector<node_id>{};
+        for (const auto& container : saved) {
+            walk_children(container.impl().root, 0, emit, stack);
+            stack.clear();
+        }
+    }
+
+private:
+    /**
+     * Numbers the nodes in post-order, after the roots.  A node that nothing
+     * else refers to can only be reached through its parent, so it is walked
+     * once and just takes the next id.  Only the ids of the shared nodes,
+     * which may be reached again, are kept.  With a memory policy that does
+     * not count references, every node is taken to be shared.
+     */
+    struct numbering
+    {
+        const ids_t& roots;
+        ids_t shared;
+        std::size_t next;
+
+        const node_id* seen(const node_t* node) const
+        {
+            auto* id = roots.find(node);
+            return id ? id : shared.find(node);
+        }
+
+        template <class Iter>
+        node_id visit(const node_t* node,
+                      immer::detail::hamts::count_t,
+                      Iter,
+                      Iter)
+        {
+            const auto id = node_id{next++};
+            if (!node_t::refs(node).unique())
+                shared.insert(node, id);
+            return id;
+        }
+    };
+
+    /**
+     * Walks the nodes again, in the same order in which they were numbered,
+     * writing them.  A shared node has already been written when its id is
+     * lower than the one of the next node.
+     */
+    template <class Archive>
+    struct emitter
+    {
+        const numbering& numbers;
+        Archive& ar;
+        std::size_t next;
+
+        const node_id* seen(const node_t* node) const
+        {
+            auto* id = numbers.seen(node);
+            return id && id->value < next ? id : nullptr;
+        }
+
+        template <class Iter>
+        node_id visit(const node_t* node,
+                      immer::detail::hamts::count_t depth,
+                      Iter first,
+                      Iter last)
+        {
+            assert(!numbers.shared.count(node) ||
+                   numbers.shared.find(node)->value == next);
+            ar(make_node(node, depth, first, last));
+            return node_id{next++};
+        }
+    };
+
+    static bool is_collision(immer::detail::hamts::count_t depth)
+    {
+        using hash_t = typename node_t::hash_t;
+        return depth >= immer::detail::hamts::max_depth<hash_t, B>;
+    }
+
+    // Walks the children of `node` in post-order, leaving their ids in
+    // `ids`.  The ids of the children of the node being walked are kept on
+    // top of them until it is visited.
+    template <class Visitor>
+    static void walk_children(const node_t* node,
+                              immer::detail::hamts::count_t depth,
+                              Visitor& visitor,
+                              std::vector<node_id>& ids)
+    {
+        if (is_collision(depth) || !node->nodemap()) {
+            return;
+        }
+        auto fst = node->children();
+        auto lst = fst + node->children_count();
+        for (; fst != lst; ++fst) {
+            if (auto* id = visitor.seen(*fst)) {
+                ids.push_back(*id);
+                continue;
+            }
+            const auto first = ids.size();
+            walk_children(*fst, depth + 1, visitor, ids);
+            const auto id = visitor.visit(
+                *fst, depth + 1, ids.cbegin() + first, ids.cend());
+            ids.resize(first);
+            ids.push_back(id);
+        }
+    }
+
+    template <class Iter>
+    static inner_node_save<T, B> make_node(const node_t* node,
+                                           immer::detail::hamts::count_t depth,
+                                           Iter first,
+                                           Iter last)
+    {
+        if (is_collision(depth)) {
+            return {
+                .values     = {node->collisions(),
+                               node->collisions() + node->collision_count()},
+                .collisions = true,
+            };
+        }
+
+        auto result = inner_node_save<T, B>{
+            .nodemap = node->nodemap(),
+            .datamap = node->datamap(),
+        };
+        if (node->datamap()) {
+            result.values = {node->values(),
+                             node->values() + node->data_count()};
+        }
+        if (node->nodemap()) {
+            assert(static_cast<std::size_t>(last - first) ==
+                   node->children_count());
+            result.children = immer::vector<node_id>(first, last);
+        }
+        return result;
+    }
+};
+
+template <class Container>
+std::pair<streaming_container_output_pool<Container>, node_id>
+add_to_pool(Container container,
+            streaming_container_output_pool<Container> pool)
+{
+    const void* root = container.impl().root;
+    if (auto* p = pool.ids.find(root)) {
+        // Already been added
+        return {std::move(pool), *p};
+    }
+
+    const auto id = node_id{pool.ids.size()};
+    pool.ids.insert(root, id);
+    pool.containers =
+        std::move(pool.containers).push_back(std::move(container));
+    return {std::move(pool), id};
+}
+
+} // namespace immer::persist::champ
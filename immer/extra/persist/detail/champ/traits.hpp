@@ -2,6 +2,7 @@
 
 #include <immer/extra/persist/detail/champ/champ.hpp>
 #include <immer/extra/persist/detail/champ/pool.hpp>
+#include <immer/extra/persist/detail/champ/streaming.hpp>
 #include <immer/extra/persist/detail/traits.hpp>
 #include <immer/extra/persist/hash_container_conversion.hpp>
 
@@ -14,6 +15,8 @@ struct champ_traits
 {
     using output_pool_t =
         immer::persist::champ::container_output_pool<Container>;
+    using streaming_output_pool_t =
+        immer::persist::champ::streaming_container_output_pool<Container>;
     using input_pool_t = immer::persist::champ::container_input_pool<Container>;
     using container_id = immer::persist::node_id;
 
@@ -0,0 +1,273 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <iterator>
+#include <memory>
+#include <utility>
+#include <vector>
+
+namespace immer::persist::detail {
+
+/**
+ * Hash table used to build the pools and to keep track of the nodes that
+ * have been loaded from them.
+ *
+ * The entries are stored contiguously, in the order in which they were
+ * inserted, and are found through an open addressing index.  Unlike with an
+ * `immer::map`, inserting an entry does not allocate new nodes, which
+ * matters because the pools have an entry for every node of every container.
+ *
+ * The pools are values that are passed around and compared, and they are
+ * often built with `std::tie(pool, id) = add_to_pool(c, pool)`, where the
+ * old pool is alive while the new one grows.  So the table is split into
+ * levels, each one a small hash table of its own, that copies of a
+ * `flat_map` share.  Entries are only added to the newest level, and only
+ * when no other copy uses it, or else to a new level.  A level is merged
+ * into the previous one when it gets more than half its size, so there are
+ * at most a logarithmic number of them, and a table that is never copied
+ * has a single level that grows in place.  Comparing two copies that have
+ * not diverged does not look at the entries.
+ */
+template <class K, class V, class Hash = std::hash<K>>
+class flat_map
+{
+    struct level_t;
+    using levels_t = std::vector<std::shared_ptr<level_t>>;
+
+public:
+    using key_type    = K;
+    using mapped_type = V;
+    using value_type  = std::pair<K, V>;
+
+    /**
+     * Iterates the entries in the order in which they were inserted.
+     */
+    class const_iterator
+    {
+    public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = flat_map::value_type;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = const value_type*;
+        using reference         = const value_type&;
+
+        const_iterator() = default;
+
+        reference operator*() const
+        {
+            return (*levels_)[level_]->entries[index_];
+        }
+        pointer operator->() const { return &**this; }
+
+        const_iterator& operator++()
+        {
+            ++index_;
+            skip_empty();
+            return *this;
+        }
+
+        const_iterator operator++(int)
+        {
+            auto result = *this;
+            ++*this;
+            return result;
+        }
+
+        friend bool operator==(const const_iterator& left,
+                               const const_iterator& right)
+        {
+            return left.level_ == right.level_ && left.index_ == right.index_;
+        }
+
+        friend bool operator!=(const const_iterator& left,
+                               const const_iterator& right)
+        {
+            return !(left == right);
+        }
+
+    private:
+        friend class flat_map;
+
+        const_iterator(const levels_t* levels, std::size_t level)
+            : levels_{levels}
+            , level_{level}
+        {
+            skip_empty();
+        }
+
+        void skip_empty()
+        {
+            while (level_ < levels_->size() &&
+                   index_ == (*levels_)[level_]->entries.size()) {
+                index_ = 0;
+                ++level_;
+            }
+        }
+
+        const levels_t* levels_ = nullptr;
+        std::size_t level_      = 0;
+        std::size_t index_      = 0;
+    };
+
+    std::size_t size() const { return size_; }
+    bool empty() const { return size_ == 0; }
+
+    const_iterator begin() const { return {&levels_, 0}; }
+    const_iterator end() const { return {&levels_, levels_.size()}; }
+
+    const V* find(const K& key) const
+    {
+        for (auto it = levels_.rbegin(); it != levels_.rend(); ++it) {
+            const auto& level = **it;
+            if (auto index = level.find(key))
+                return &level.entries[index - 1].second;
+        }
+        return nullptr;
+    }
+
+    std::size_t count(const K& key) const { return find(key) ? 1 : 0; }
+
+    /**
+     * Makes room for `n` entries in total, without allocating again.
+     */
+    void reserve(std::size_t n)
+    {
+        auto& level = top_level();
+        auto rest   = n > size_ ? n - (size_ - level.entries.size()) : 0;
+        level.entries.reserve(rest);
+        level.rehash(rest);
+    }
+
+    /**
+     * Inserts `value` under `key`, unless the key is already present.
+     * Returns whether it was inserted.
+     */
+    bool insert(K key, V value)
+    {
+        if (find(key))
+            return false;
+        top_level().add(std::move(key), std::move(value));
+        ++size_;
+        merge_levels();
+        return true;
+    }
+
+    friend bool operator==(const flat_map& left, const flat_map& right)
+    {
+        if (left.levels_ == right.levels_)
+            return true;
+        if (left.size() != right.size())
+            return false;
+        for (const auto& [key, value] : left) {
+            auto* other = right.find(key);
+            if (!other || !(*other == value))
+                return false;
+        }
+        return true;
+    }
+
+    friend bool operator!=(const flat_map& left, const flat_map& right)
+    {
+        return !(left == right);
+    }
+
+private:
+    struct level_t
+    {
+        std::vector<value_type> entries;
+        // Position of the entry plus one, or zero for an empty slot.  The
+        // size is always a power of two.
+        std::vector<std::size_t> slots;
+
+        std::size_t slot_for(const K& key) const
+        {
+            // Fibonacci hashing, so that keys that only differ in their
+            // higher bits, like aligned pointers, are spread too.
+            auto hash = static_cast<std::uint64_t>(Hash{}(key)) *
+                        std::uint64_t{0x9e3779b97f4a7c15};
+            return static_cast<std::size_t>(hash >> 32) & (slots.size() - 1);
+        }
+
+        std::size_t find(const K& key) const
+        {
+            if (slots.empty())
+                return 0;
+            for (auto slot = slot_for(key);; slot = (slot + 1) & mask()) {
+                auto index = slots[slot];
+                if (!index || entries[index - 1].first == key)
+                    return index;
+            }
+        }
+
+        void add(K key, V value)
+        {
+            rehash(entries.size() + 1);
+            entries.emplace_back(std::move(key), std::move(value));
+            link(entries.size());
+        }
+
+        void link(std::size_t index)
+        {
+            auto slot = slot_for(entries[index - 1].first);
+            while (slots[slot])
+                slot = (slot + 1) & mask();
+            slots[slot] = index;
+        }
+
+        // Makes room in the index for `n` entries, keeping the load factor
+        // under 3/4.
+        void rehash(std::size_t n)
+        {
+            if (n * 4 < slots.size() * 3)
+                return;
+            auto capacity = std::size_t{16};
+            while (n * 4 >= capacity * 3)
+                capacity *= 2;
+            slots.assign(capacity, 0);
+            for (auto index = std::size_t{1}; index <= entries.size(); ++index)
+                link(index);
+        }
+
+        std::size_t mask() const { return slots.size() - 1; }
+    };
+
+    // The newest level, which is only written to when this is the only copy
+    // that uses it.
+    level_t& top_level()
+    {
+        if (levels_.empty() || levels_.back().use_count() > 1)
+            levels_.push_back(std::make_shared<level_t>());
+        return *levels_.back();
+    }
+
+    void merge_levels()
+    {
+        while (levels_.size() > 1 &&
+               levels_.back()->entries.size() * 2 >
+                   levels_[levels_.size() - 2]->entries.size()) {
+            auto last = std::move(levels_.back());
+            levels_.pop_back();
+            auto& prev = levels_.back();
+            if (prev.use_count() > 1)
+                prev = std::make_shared<level_t>(*prev);
+            prev->entries.reserve(prev->entries.size() + last->entries.size());
+            prev->rehash(prev->entries.size() + last->entries.size());
+            if (last.use_count() > 1) {
+                for (const auto& [key, value] : last->entries)
+                    prev->add(key, value);
+            } else {
+                for (auto& [key, value] : last->entries)
+                    prev->add(std::move(key), std::move(value));
+            }
+        }
+    }
+
+    // Oldest first, so that iterating them in order visits the entries in
+    // the order in which they were inserted.
+    levels_t levels_;
+    std::size_t size_ = 0;
+};
+
+} // namespace immer::persist::detail
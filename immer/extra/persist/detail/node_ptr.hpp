@@ -98,6 +98,7 @@ public:
     }
 
     Node* get() { return ptr.ptr; }
+    const Node* get() const { return ptr.ptr; }
 
     friend void swap(node_ptr& x, node_ptr& y)
     {
@@ -1,5 +1,6 @@
 #pragma once
 
+#include <immer/extra/persist/detail/common/flat_map.hpp>
 #include <immer/extra/persist/detail/node_ptr.hpp>
 #include <immer/extra/persist/detail/rbts/pool.hpp>
 #include <immer/extra/persist/detail/rbts/traverse.hpp>
@@ -201,8 +202,8 @@ private:
             immer::detail::uninitialized_copy(node_info->data.begin(),
                                               node_info->data.end(),
                                               leaf.get()->leaf());
-            leaves_        = std::move(leaves_).set(id, leaf);
-            loaded_leaves_ = std::move(loaded_leaves_).set(leaf.get(), id);
+            leaves_.insert(id, leaf);
+            loaded_leaves_.insert(leaf.get(), id);
             return leaf;
         } else {
             auto values = std::vector<T>{};
@@ -214,8 +215,8 @@ private:
                          [n](auto* ptr) { node_t::delete_leaf(ptr, n); }};
             immer::detail::uninitialized_copy(
                 values.begin(), values.end(), leaf.get()->leaf());
-            leaves_        = std::move(leaves_).set(id, leaf);
-            loaded_leaves_ = std::move(loaded_leaves_).set(leaf.get(), id);
+            leaves_.insert(id, leaf);
+            loaded_leaves_.insert(leaf.get(), id);
             return leaf;
         }
     }
@@ -316,8 +317,8 @@ private:
             }
         }
 
-        inners_        = std::move(inners_).set(id, inner);
-        loaded_inners_ = std::move(loaded_inners_).set(inner.get(), id);
+        inners_.insert(id, inner);
+        loaded_inners_.insert(inner.get(), id);
         return inner;
     }
 
@@ -369,7 +370,7 @@ private:
             }
             throw invalid_node_id{id};
         }();
-        sizes_ = std::move(sizes_).set(id, size);
+        sizes_.insert(id, size);
         return size;
     }
 
@@ -391,7 +392,7 @@ private:
             }
             throw invalid_node_id{id};
         }();
-        depths_ = std::move(depths_).set(id, depth);
+        depths_.insert(id, depth);
         return depth;
     }
 
@@ -515,12 +516,12 @@ private:
 private:
     const Pool pool_;
     const TransformF transform_;
-    immer::map<node_id, node_ptr> leaves_;
-    immer::map<node_id, node_ptr> inners_;
-    immer::map<node_t*, node_id> loaded_leaves_;
-    immer::map<node_t*, node_id> loaded_inners_;
-    immer::map<node_id, std::size_t> sizes_;
-    immer::map<node_id, immer::detail::rbts::count_t> depths_;
+    persist::detail::flat_map<node_id, node_ptr> leaves_;
+    persist::detail::flat_map<node_id, node_ptr> inners_;
+    persist::detail::flat_map<node_t*, node_id> loaded_leaves_;
+    persist::detail::flat_map<node_t*, node_id> loaded_inners_;
+    persist::detail::flat_map<node_id, std::size_t> sizes_;
+    persist::detail::flat_map<node_id, immer::detail::rbts::count_t> depths_;
 };
 
 template <typename T,
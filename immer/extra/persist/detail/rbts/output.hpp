@@ -10,19 +10,18 @@ template <typename T,
           typename MemoryPolicy,
           immer::detail::rbts::bits_t B,
           immer::detail::rbts::bits_t BL>
-std::pair<output_pool<T, MemoryPolicy, B, BL>, node_id>
-get_node_id(output_pool<T, MemoryPolicy, B, BL> pool,
+node_id
+get_node_id(output_pool<T, MemoryPolicy, B, BL>& pool,
             const immer::detail::rbts::node<T, MemoryPolicy, B, BL>* ptr)
 {
     auto* ptr_void = static_cast<const void*>(ptr);
     if (auto* maybe_id = pool.node_ptr_to_id.find(ptr_void)) {
-        auto id = *maybe_id;
-        return {std::move(pool), id};
+        return *maybe_id;
     }
 
-    const auto id       = node_id{pool.node_ptr_to_id.size()};
-    pool.node_ptr_to_id = std::move(pool.node_ptr_to_id).set(ptr_void, id);
-    return {std::move(pool), id};
+    const auto id = node_id{pool.node_ptr_to_id.size()};
+    pool.node_ptr_to_id.insert(ptr_void, id);
+    return id;
 }
 
 template <typename T,
@@ -51,7 +50,7 @@ struct pool_builder
                              .push_back(this->get_node_id(child_pos.node()));
                      visit(child_pos);
                  });
-        pool.inners = std::move(pool.inners).set(id, node_info);
+        pool.inners.insert(id, std::move(node_info));
     }
 
     template <class Pos, class VisitF>
@@ -75,7 +74,7 @@ struct pool_builder
 
         assert(node_info.children.size() == pos.node()->relaxed()->d.count);
 
-        pool.inners = std::move(pool.inners).set(id, node_info);
+        pool.inners.insert(id, std::move(node_info));
     }
 
     template <class Pos, class VisitF>
@@ -91,15 +90,12 @@ struct pool_builder
             .begin = first,
             .end   = first + pos.count(),
         };
-        pool.leaves = std::move(pool.leaves).set(id, std::move(info));
+        pool.leaves.insert(id, std::move(info));
     }
 
     node_id get_node_id(immer::detail::rbts::node<T, MemoryPolicy, B, BL>* ptr)
     {
-        auto [pool2, id] =
-            immer::persist::rbts::detail::get_node_id(std::move(pool), ptr);
-        pool = std::move(pool2);
-        return id;
+        return immer::persist::rbts::detail::get_node_id(pool, ptr);
     }
 };
 
@@ -143,14 +139,12 @@ std::pair<output_pool<T, MemoryPolicy, B, BL>, container_id>
 add_to_pool(immer::vector<T, MemoryPolicy, B, BL> vec,
             output_pool<T, MemoryPolicy, B, BL> pool)
 {
-    const auto& impl        = vec.impl();
-    auto root_id            = node_id{};
-    auto tail_id            = node_id{};
-    std::tie(pool, root_id) = detail::get_node_id(std::move(pool), impl.root);
-    std::tie(pool, tail_id) = detail::get_node_id(std::move(pool), impl.tail);
-    const auto tree_id      = rbts_info{
-             .root = root_id,
-             .tail = tail_id,
+    const auto& impl   = vec.impl();
+    const auto root_id = detail::get_node_id(pool, impl.root);
+    const auto tail_id = detail::get_node_id(pool, impl.tail);
+    const auto tree_id = rbts_info{
+        .root = root_id,
+        .tail = tail_id,
     };
 
     if (auto* p = pool.rbts_to_id.find(tree_id)) {
@@ -166,8 +160,8 @@ add_to_pool(immer::vector<T, MemoryPolicy, B, BL> vec,
 
     const auto vector_id = container_id{pool.vectors.size()};
 
-    pool.rbts_to_id = std::move(pool.rbts_to_id).set(tree_id, vector_id);
-    pool.vectors    = std::move(pool.vectors).push_back(tree_id);
+    pool.rbts_to_id.insert(tree_id, vector_id);
+    pool.vectors = std::move(pool.vectors).push_back(tree_id);
     pool.saved_vectors =
         std::move(pool.saved_vectors).push_back(std::move(vec));
 
@@ -182,14 +176,12 @@ std::pair<output_pool<T, MemoryPolicy, B, BL>, container_id>
 add_to_pool(immer::flex_vector<T, MemoryPolicy, B, BL> vec,
             output_pool<T, MemoryPolicy, B, BL> pool)
 {
-    const auto& impl        = vec.impl();
-    auto root_id            = node_id{};
-    auto tail_id            = node_id{};
-    std::tie(pool, root_id) = detail::get_node_id(std::move(pool), impl.root);
-    std::tie(pool, tail_id) = detail::get_node_id(std::move(pool), impl.tail);
-    const auto tree_id      = rbts_info{
-             .root = root_id,
-             .tail = tail_id,
+    const auto& impl   = vec.impl();
+    const auto root_id = detail::get_node_id(pool, impl.root);
+    const auto tail_id = detail::get_node_id(pool, impl.tail);
+    const auto tree_id = rbts_info{
+        .root = root_id,
+        .tail = tail_id,
     };
 
     if (auto* p = pool.rbts_to_id.find(tree_id)) {
@@ -205,8 +197,8 @@ add_to_pool(immer::flex_vector<T, MemoryPolicy, B, BL> vec,
 
     const auto vector_id = container_id{pool.vectors.size()};
 
-    pool.rbts_to_id = std::move(pool.rbts_to_id).set(tree_id, vector_id);
-    pool.vectors    = std::move(pool.vectors).push_back(tree_id);
+    pool.rbts_to_id.insert(tree_id, vector_id);
+    pool.vectors = std::move(pool.vectors).push_back(tree_id);
     pool.saved_flex_vectors =
         std::move(pool.saved_flex_vectors).push_back(std::move(vec));
 
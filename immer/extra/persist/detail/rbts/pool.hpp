@@ -4,11 +4,14 @@
 #include <immer/extra/cereal/immer_vector.hpp>
 #include <immer/extra/persist/detail/alias.hpp>
 #include <immer/extra/persist/detail/cereal/compact_map.hpp>
+#include <immer/extra/persist/detail/cereal/encoded_leaves.hpp>
+#include <immer/extra/persist/detail/common/flat_map.hpp>
 #include <immer/extra/persist/detail/common/pool.hpp>
 
 #include <immer/array.hpp>
 #include <immer/flex_vector.hpp>
 #include <immer/map.hpp>
+#include <immer/map_transient.hpp>
 #include <immer/vector.hpp>
 
 #include <cereal/cereal.hpp>
@@ -81,12 +84,12 @@ template <typename T,
           immer::detail::rbts::bits_t BL>
 struct output_pool
 {
-    immer::map<node_id, detail::values_save<T>> leaves;
-    immer::map<node_id, inner_node> inners;
+    detail::flat_map<node_id, detail::values_save<T>> leaves;
+    detail::flat_map<node_id, inner_node> inners;
     immer::vector<rbts_info> vectors;
 
-    immer::map<rbts_info, container_id> rbts_to_id;
-    immer::map<const void*, node_id> node_ptr_to_id;
+    detail::flat_map<rbts_info, container_id> rbts_to_id;
+    detail::flat_map<const void*, node_id> node_ptr_to_id;
 
     // Saving the persisted vectors, so that no mutations are allowed to happen.
     immer::vector<immer::vector<T, MemoryPolicy, B, BL>> saved_vectors;
@@ -108,12 +111,34 @@ struct output_pool
     template <class Archive>
     void save(Archive& ar) const
     {
-        auto leaves_copy = leaves;
-        auto inners_copy = inners;
         ar(CEREAL_NVP(B),
            CEREAL_NVP(BL),
-           cereal::make_nvp("leaves", detail::make_compact_map(leaves_copy)),
-           cereal::make_nvp("inners", detail::make_compact_map(inners_copy)),
+           cereal::make_nvp("leaves", detail::make_compact_map(leaves)),
+           cereal::make_nvp("inners", detail::make_compact_map(inners)),
+           CEREAL_NVP(vectors));
+    }
+
+    /**
+     * Saves the leaves with `Codec`, under `encoded_leaves`, so that they are
+     * not mistaken for plain ones by a policy without the codec.
+     */
+    template <class Archive, class Codec>
+    void save_with_leaf_codec(Archive& ar, const Codec&) const
+    {
+        auto coder      = typename Codec::template coder<T>{};
+        auto sorted     = detail::sorted_leaves(leaves);
+        auto values     = std::vector<detail::values_save<T>>{};
+        auto leaf_codec = Codec::name();
+        values.reserve(sorted.size());
+        for (const auto& leaf : sorted)
+            values.push_back(leaf.second);
+
+        ar(CEREAL_NVP(B), CEREAL_NVP(BL), CEREAL_NVP(leaf_codec));
+        coder.save_header(ar, values);
+        ar(cereal::make_nvp("encoded_leaves",
+                            detail::encoded_leaves_save<T, decltype(coder)>{
+                                std::move(sorted), coder}),
+           cereal::make_nvp("inners", detail::make_compact_map(inners)),
            CEREAL_NVP(vectors));
     }
 };
@@ -168,6 +193,28 @@ struct input_pool
            CEREAL_NVP(vectors));
     }
 
+    template <class Archive, class Codec>
+    void load_with_leaf_codec(Archive& ar, const Codec&)
+    {
+        auto coder      = typename Codec::template coder<T>{};
+        auto leaf_codec = std::string{};
+        auto& B         = bits;
+        auto& BL        = bits_leaf;
+        ar(CEREAL_NVP(B), CEREAL_NVP(BL), CEREAL_NVP(leaf_codec));
+        if (leaf_codec != Codec::name()) {
+            throw invalid_leaf_codec{
+                fmt::format("saved with {} but loaded with {}",
+                            leaf_codec,
+                            Codec::name())};
+        }
+        coder.load_header(ar);
+        auto encoded =
+            detail::encoded_leaves_load<T, decltype(coder)>{leaves, coder};
+        ar(cereal::make_nvp("encoded_leaves", encoded),
+           cereal::make_nvp("inners", detail::make_compact_map(inners)),
+           CEREAL_NVP(vectors));
+    }
+
     void merge_previous(const input_pool& other) {}
 };
 
@@ -179,16 +226,20 @@ template <typename T,
           immer::detail::rbts::bits_t BL>
 input_pool<T> to_input_pool(output_pool<T, MemoryPolicy, B, BL> ar)
 {
-    auto leaves = immer::map<node_id, detail::values_load<T>>{};
+    auto leaves = immer::map<node_id, detail::values_load<T>>{}.transient();
     for (const auto& item : ar.leaves) {
-        leaves = std::move(leaves).set(item.first, item.second);
+        leaves.set(item.first, item.second);
+    }
+    auto inners = immer::map<node_id, inner_node>{}.transient();
+    for (const auto& item : ar.inners) {
+        inners.set(item.first, item.second);
     }
 
     return {
         .bits      = B,
         .bits_leaf = BL,
-        .leaves    = std::move(leaves),
-        .inners    = std::move(ar.inners),
+        .leaves    = std::move(leaves).persistent(),
+        .inners    = std::move(inners).persistent(),
         .vectors   = std::move(ar.vectors),
     };
 }
@@ -0,0 +1,394 @@
+#pragma once
+
+#include <immer/extra/persist/detail/rbts/traverse.hpp>
+
+#include <immer/flex_vector.hpp>
+#include <immer/vector.hpp>
+
+#include <cassert>
+#include <functional>
+#include <utility>
+#include <vector>
+
+namespace immer::persist::rbts {
+
+namespace detail {
+
+struct tree_key
+{
+    const void* root;
+    const void* tail;
+
+    friend bool operator==(const tree_key& left, const tree_key& right)
+    {
+        return left.root == right.root && left.tail == right.tail;
+    }
+};
+
+struct tree_key_hash
+{
+    std::size_t operator()(const tree_key& key) const
+    {
+        const auto hash = std::hash<const void*>{};
+        return hash(key.root) ^ (hash(key.tail) << 1);
+    }
+};
+
+/**
+ * Walks the nodes of a tree in post-order, skipping the subtrees that the
+ * `Visitor` has already seen.  The visitor returns the id of every node it
+ * is given, and gets the ids of the children of the inner nodes, which are
+ * kept on a stack while their parent is walked.
+ */
+template <class Visitor>
+struct post_order_walker
+{
+    Visitor& visitor;
+    // Once a tree has been walked, the ids of its root and its tail.
+    std::vector<node_id> ids;
+
+    template <class Pos, class VisitF>
+    void operator()(regular_pos_tag, Pos& pos, VisitF&& visit)
+    {
+        visit_inner(pos, visit, false);
+    }
+
+    template <class Pos, class VisitF>
+    void operator()(relaxed_pos_tag, Pos& pos, VisitF&& visit)
+    {
+        visit_inner(pos, visit, true);
+    }
+
+    template <class Pos, class VisitF>
+    void operator()(leaf_pos_tag, Pos& pos, VisitF&&)
+    {
+        if (auto* id = visitor.seen(pos.node()))
+            ids.push_back(*id);
+        else
+            ids.push_back(visitor.leaf(pos));
+    }
+
+    template <class Pos, class VisitF>
+    void visit_inner(Pos& pos, VisitF& visit, bool relaxed)
+    {
+        if (auto* id = visitor.seen(pos.node())) {
+            ids.push_back(*id);
+            return;
+        }
+        const auto first = ids.size();
+        pos.each(visitor_helper{},
+                 [&visit](auto any_tag, auto& child_pos, auto&&) {
+                     visit(child_pos);
+                 });
+        const auto id =
+            visitor.inner(pos, relaxed, ids.cbegin() + first, ids.cend());
+        ids.resize(first);
+        ids.push_back(id);
+    }
+};
+
+/**
+ * Numbers the nodes in the order in which they are first walked.
+ *
+ * A node that nothing else refers to can only be reached through its parent,
+ * so it is walked once and just takes the next id.  Only the ids of the
+ * shared nodes, which may be reached again, are kept, together with the ids
+ * of the roots and tails of the trees.  With a memory policy that does not
+ * count references, every node is taken to be shared.
+ */
+struct node_numbering
+{
+    persist::detail::flat_map<const void*, node_id> shared;
+    std::vector<rbts_info> trees;
+    std::size_t leaves = 0;
+    std::size_t inners = 0;
+
+    const node_id* seen(const void* node) const { return shared.find(node); }
+
+    template <class Pos>
+    node_id leaf(Pos& pos)
+    {
+        ++leaves;
+        return number(pos.node());
+    }
+
+    template <class Pos, class Iter>
+    node_id inner(Pos& pos, bool, Iter, Iter)
+    {
+        ++inners;
+        return number(pos.node());
+    }
+
+    template <class Node>
+    node_id number(Node* node)
+    {
+        const auto id = node_id{leaves + inners - 1};
+        if (!Node::refs(node).unique())
+            shared.insert(node, id);
+        return id;
+    }
+};
+
+/**
+ * Walks the nodes again, in the same order in which they were numbered, so
+ * that every node gets the same id again and a shared node has already been
+ * walked when its id is lower than the one of the next node.
+ */
+template <class LeafF, class InnerF>
+struct numbered_walk
+{
+    const node_numbering& numbers;
+    LeafF on_leaf;
+    InnerF on_inner;
+    std::size_t next = 0;
+
+    const node_id* seen(const void* node) const
+    {
+        auto* id = numbers.shared.find(node);
+        return id && id->value < next ? id : nullptr;
+    }
+
+    template <class Pos>
+    node_id leaf(Pos& pos)
+    {
+        const auto id = take(pos.node());
+        on_leaf(id, pos);
+        return id;
+    }
+
+    template <class Pos, class Iter>
+    node_id inner(Pos& pos, bool relaxed, Iter first, Iter last)
+    {
+        const auto id = take(pos.node());
+        on_inner(id, pos, relaxed, first, last);
+        return id;
+    }
+
+    node_id take([[maybe_unused]] const void* node)
+    {
+        assert(!numbers.shared.count(node) ||
+               numbers.shared.find(node)->value == next);
+        return node_id{next++};
+    }
+};
+
+template <class LeafF, class InnerF>
+numbered_walk<LeafF, InnerF>
+make_numbered_walk(const node_numbering& numbers, LeafF leaf, InnerF inner)
+{
+    return {numbers, std::move(leaf), std::move(inner)};
+}
+
+} // namespace detail
+
+/**
+ * Pool that only keeps the containers, and writes their nodes as it walks
+ * them when it is saved.  It produces the same format as `output_pool`, but
+ * the only thing it needs to remember while saving is the id of every node
+ * that is shared.
+ */
+template <typename T,
+          typename MemoryPolicy,
+          immer::detail::rbts::bits_t B,
+          immer::detail::rbts::bits_t BL>
+struct streaming_output_pool
+{
+    using flex_vector_t = immer::flex_vector<T, MemoryPolicy, B, BL>;
+    using containers_t  = immer::vector<flex_vector_t>;
+
+    // In the order of their ids.  Vectors are stored as flex vectors, which
+    // share their nodes.
+    containers_t containers;
+    persist::detail::flat_map<detail::tree_key,
+                              container_id,
+                              detail::tree_key_hash>
+        ids;
+
+    friend bool operator==(const streaming_output_pool& left,
+                           const streaming_output_pool& right)
+    {
+        return left.ids == right.ids;
+    }
+
+    friend bool operator!=(const streaming_output_pool& left,
+                           const streaming_output_pool& right)
+    {
+        return !(left == right);
+    }
+
+    struct leaves_save
+    {
+        const containers_t& containers;
+        const detail::node_numbering& numbers;
+
+        template <class Archive>
+        void save(Archive& ar) const
+        {
+            using pair_t =
+                persist::detail::compact_pair<node_id,
+                                              persist::detail::values_save<T>>;
+            ar(cereal::make_size_tag(
+                static_cast<cereal::size_type>(numbers.leaves)));
+            walk(containers,
+                 detail::make_numbered_walk(
+                     numbers,
+                     [&](node_id id, auto& pos) {
+                         ar(pair_t{id, values_of(pos)});
+                     },
+                     [](node_id, auto&, bool, auto, auto) {}));
+        }
+    };
+
+    struct inners_save
+    {
+        const containers_t& containers;
+        const detail::node_numbering& numbers;
+
+        template <class Archive>
+        void save(Archive& ar) const
+        {
+            using pair_t = persist::detail::compact_pair<node_id, inner_node>;
+            ar(cereal::make_size_tag(
+                static_cast<cereal::size_type>(numbers.inners)));
+            walk(containers,
+                 detail::make_numbered_walk(
+                     numbers,
+                     [](node_id, auto&) {},
+                     [&](node_id id,
+                         auto&,
+                         bool relaxed,
+                         auto first,
+                         auto last) {
+                         ar(pair_t{id,
+                                   inner_node{
+                                       .children =
+                                           immer::vector<node_id>(first, last),
+                                       .relaxed  = relaxed,
+                                   }});
+                     }));
+        }
+    };
+
+    template <class Archive>
+    void save(Archive& ar) const
+    {
+        // Saving the values of the leaves may add containers to this pool,
+        // so only a copy of it is used from now on.
+        const auto saved   = containers;
+        const auto numbers = number_nodes(saved);
+        ar(CEREAL_NVP(B),
+           CEREAL_NVP(BL),
+           cereal::make_nvp("leaves", leaves_save{saved, numbers}),
+           cereal::make_nvp("inners", inners_save{saved, numbers}),
+           cereal::make_nvp("vectors", get_infos(numbers)));
+    }
+
+    /**
+     * Like `output_pool::save_with_leaf_codec`.  The header of the codec is
+     * made from all the leaves, so their ranges are kept in memory.
+     */
+    template <class Archive, class Codec>
+    void save_with_leaf_codec(Archive& ar, const Codec&) const
+    {
+        const auto saved   = containers;
+        const auto numbers = number_nodes(saved);
+        auto coder         = typename Codec::template coder<T>{};
+        auto leaf_codec    = Codec::name();
+        auto leaves =
+            std::vector<std::pair<node_id, persist::detail::values_save<T>>>{};
+        auto values = std::vector<persist::detail::values_save<T>>{};
+        leaves.reserve(numbers.leaves);
+        values.reserve(numbers.leaves);
+        walk(saved,
+             detail::make_numbered_walk(
+                 numbers,
+                 [&](node_id id, auto& pos) {
+                     leaves.emplace_back(id, values_of(pos));
+                     values.push_back(values_of(pos));
+                 },
+                 [](node_id, auto&, bool, auto, auto) {}));
+
+        ar(CEREAL_NVP(B), CEREAL_NVP(BL), CEREAL_NVP(leaf_codec));
+        coder.save_header(ar, values);
+        ar(cereal::make_nvp(
+               "encoded_leaves",
+               persist::detail::encoded_leaves_save<T, decltype(coder)>{
+                   std::move(leaves), coder}),
+           cereal::make_nvp("inners", inners_save{saved, numbers}),
+           cereal::make_nvp("vectors", get_infos(numbers)));
+    }
+
+private:
+    // Returns the ids of the root and the tail of every container.
+    template <class Visitor>
+    static std::vector<rbts_info> walk(const containers_t& containers,
+                                       Visitor&& visitor)
+    {
+        auto walker = detail::post_order_walker<std::decay_t<Visitor>>{visitor};
+        auto trees  = std::vector<rbts_info>{};
+        for (const auto& container : containers) {
+            container.impl().traverse(detail::visitor_helper{}, walker);
+            assert(walker.ids.size() == 2);
+            trees.push_back(rbts_info{
+                .root = walker.ids[0],
+                .tail = walker.ids[1],
+            });
+            walker.ids.clear();
+        }
+        return trees;
+    }
+
+    static detail::node_numbering number_nodes(const containers_t& containers)
+    {
+        auto numbers  = detail::node_numbering{};
+        numbers.trees = walk(containers, numbers);
+        return numbers;
+    }
+
+    static immer::vector<rbts_info>
+    get_infos(const detail::node_numbering& numbers)
+    {
+        return {numbers.trees.begin(), numbers.trees.end()};
+    }
+
+    template <class Pos>
+    static persist::detail::values_save<T> values_of(Pos& pos)
+    {
+        const T* first = pos.node()->leaf();
+        return {first, first + pos.count()};
+    }
+};
+
+template <typename T,
+          typename MemoryPolicy,
+          immer::detail::rbts::bits_t B,
+          immer::detail::rbts::bits_t BL>
+std::pair<streaming_output_pool<T, MemoryPolicy, B, BL>, container_id>
+add_to_pool(immer::flex_vector<T, MemoryPolicy, B, BL> vec,
+            streaming_output_pool<T, MemoryPolicy, B, BL> pool)
+{
+    const auto key = detail::tree_key{vec.impl().root, vec.impl().tail};
+    if (auto* p = pool.ids.find(key)) {
+        return {std::move(pool), *p};
+    }
+
+    const auto id = container_id{pool.containers.size()};
+    pool.ids.insert(key, id);
+    pool.containers = std::move(pool.containers).push_back(std::move(vec));
+    return {std::move(pool), id};
+}
+
+template <typename T,
+          typename MemoryPolicy,
+          immer::detail::rbts::bits_t B,
+          immer::detail::rbts::bits_t BL>
+std::pair<streaming_output_pool<T, MemoryPolicy, B, BL>, container_id>
+add_to_pool(immer::vector<T, MemoryPolicy, B, BL> vec,
+            streaming_output_pool<T, MemoryPolicy, B, BL> pool)
+{
+    return add_to_pool(
+        immer::flex_vector<T, MemoryPolicy, B, BL>{std::move(vec)},
+        std::move(pool));
+}
+
+} // namespace immer::persist::rbts
@@ -2,6 +2,7 @@
 
 #include <immer/extra/persist/detail/rbts/input.hpp>
 #include <immer/extra/persist/detail/rbts/output.hpp>
+#include <immer/extra/persist/detail/rbts/streaming.hpp>
 #include <immer/extra/persist/detail/traits.hpp>
 
 namespace immer::persist::detail {
@@ -13,8 +14,10 @@ template <typename T,
 struct container_traits<immer::vector<T, MemoryPolicy, B, BL>>
 {
     using output_pool_t = rbts::output_pool<T, MemoryPolicy, B, BL>;
-    using input_pool_t  = rbts::input_pool<T>;
-    using container_id  = immer::persist::container_id;
+    using streaming_output_pool_t =
+        rbts::streaming_output_pool<T, MemoryPolicy, B, BL>;
+    using input_pool_t = rbts::input_pool<T>;
+    using container_id = immer::persist::container_id;
 
     template <typename Pool       = input_pool_t,
               typename TransformF = boost::hana::id_t>
@@ -38,8 +41,10 @@ template <typename T,
 struct container_traits<immer::flex_vector<T, MemoryPolicy, B, BL>>
 {
     using output_pool_t = rbts::output_pool<T, MemoryPolicy, B, BL>;
-    using input_pool_t  = rbts::input_pool<T>;
-    using container_id  = immer::persist::container_id;
+    using streaming_output_pool_t =
+        rbts::streaming_output_pool<T, MemoryPolicy, B, BL>;
+    using input_pool_t = rbts::input_pool<T>;
+    using container_id = immer::persist::container_id;
 
     template <typename Pool       = input_pool_t,
               typename TransformF = boost::hana::id_t>
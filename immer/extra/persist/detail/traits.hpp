@@ -1,5 +1,7 @@
 #pragma once
 
+#include <type_traits>
+
 namespace immer::persist::detail {
 
 /**
@@ -10,4 +12,29 @@ template <class T>
 struct container_traits
 {};
 
+/**
+ * The pool used by `cereal_save_with_streamed_pools` for a type: its
+ * `streaming_output_pool_t` when the traits define one, or else its
+ * `output_pool_t`.
+ */
+template <class T, class = void>
+struct streaming_output_pool
+{
+    using type = typename container_traits<T>::output_pool_t;
+};
+
+template <class T>
+struct streaming_output_pool<
+    T,
+    std::void_t<typename container_traits<T>::streaming_output_pool_t>>
+{
+    using type = typename container_traits<T>::streaming_output_pool_t;
+};
+
+template <class T>
+using output_pool_t = typename container_traits<T>::output_pool_t;
+
+template <class T>
+using streaming_output_pool_t = typename streaming_output_pool<T>::type;
+
 } // namespace immer::persist::detail
@@ -1,6 +1,6 @@
 #pragma once
 
-#include <immer/extra/persist/detail/common/pool.hpp>
+#include <immer/extra/persist/types.hpp>
 
 #include <stdexcept>
 
@@ -95,4 +95,19 @@ public:
     }
 };
 
+/**
+ * Thrown when the leaves of a pool can not be decoded with the leaf codec
+ * that the policy names for it.
+ *
+ * @ingroup persist-exceptions
+ */
+class invalid_leaf_codec : public pool_exception
+{
+public:
+    explicit invalid_leaf_codec(const std::string& message)
+        : pool_exception{fmt::format("Invalid encoded leaves: {}", message)}
+    {
+    }
+};
+
 } // namespace immer::persist
@@ -1,6 +1,9 @@
 #pragma once
 
+#include <cstddef>
+#include <cstdint>
 #include <string>
+#include <string_view>
 
 namespace immer::persist {
 
@@ -18,6 +21,7 @@ struct xx_hash
 };
 
 std::uint64_t xx_hash_value_string(const std::string& str);
+std::uint64_t xx_hash_value_bytes(const void* data, std::size_t size);
 
 template <>
 struct xx_hash<std::string>
@@ -28,4 +32,13 @@ struct xx_hash<std::string>
     }
 };
 
+template <>
+struct xx_hash<std::string_view>
+{
+    std::uint64_t operator()(std::string_view val) const
+    {
+        return xx_hash_value_bytes(val.data(), val.size());
+    }
+};
+
 } // namespace immer::persist
@@ -9,4 +9,9 @@ std::uint64_t xx_hash_value_string(const std::string& str)
     return XXH3_64bits(str.c_str(), str.size());
 }
 
+std::uint64_t xx_hash_value_bytes(const void* data, std::size_t size)
+{
+    return XXH3_64bits(data, size);
+}
+
 } // namespace immer::persist
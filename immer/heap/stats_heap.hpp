@@ -0,0 +1,179 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace immer {
+
+/*!
+ * Snapshot of the counters of a @ref stats_heap.
+ */
+struct heap_stats
+{
+    /*!
+     * Number of size classes.  Allocations of `size` bytes are accounted in
+     * the class `i` such that `2^(i-1) < size <= 2^i`.  The last class
+     * accounts all the allocations that are bigger than that.
+     */
+    static constexpr std::size_t size_classes = 16;
+
+    struct size_class
+    {
+        std::size_t allocations   = {};
+        std::size_t deallocations = {};
+    };
+
+    std::size_t allocations       = {};
+    std::size_t deallocations     = {};
+    std::size_t bytes_allocated   = {};
+    std::size_t bytes_deallocated = {};
+
+    std::array<size_class, size_classes> by_size = {};
+
+    /*! Number of allocations that have not been released yet. */
+    std::size_t live() const { return allocations - deallocations; }
+
+    /*! Number of bytes that have not been released yet. */
+    std::size_t live_bytes() const
+    {
+        return bytes_allocated - bytes_deallocated;
+    }
+
+    static std::size_t size_class_of(std::size_t size)
+    {
+        auto i = std::size_t{};
+        while (i < size_classes - 1 && (std::size_t{1} << i) < size)
+            ++i;
+        return i;
+    }
+};
+
+/*!
+ * Adaptor that counts the allocations and deallocations that go through it,
+ * before forwarding them to the `Base` heap.
+ *
+ * @rst
+ *
+ * Every instantiation of the adaptor has its own global counters, that can be
+ * queried at runtime with ``stats()``.  They are updated with relaxed atomic
+ * operations, so it is safe to use from multiple threads, but a snapshot taken
+ * while other threads are allocating is only approximate.
+ *
+ * Putting the adaptor at different levels of a heap stack shows how the
+ * adaptors in between behave.  For example, the hit rate of a free list is
+ * obtained by comparing the allocations that reach it with those that it
+ * forwards to its parent:
+ *
+ * .. code-block:: c++
+ *
+ *    using inner_heap = immer::stats_heap<immer::malloc_heap>;
+ *    using outer_heap = immer::stats_heap<
+ *        immer::with_data<immer::free_list_node,
+ *                         immer::free_list_heap<64, 1024, inner_heap>>>;
+ *    // ... use outer_heap in a heap policy ...
+ *    auto total  = outer_heap::stats().allocations;
+ *    auto misses = inner_heap::stats().allocations;
+ *    auto hits   = total - misses;
+ *
+ * @endrst
+ *
+ * @tparam Base Type of the parent heap.
+ */
+template <typename Base>
+struct stats_heap : Base
+{
+    using base_t = Base;
+
+    template <typename... Tags>
+    static void* allocate(std::size_t size, Tags... tags)
+    {
+        auto p   = base_t::allocate(size, tags...);
+        auto& s  = storage();
+        auto cls = heap_stats::size_class_of(size);
+        s.allocations.fetch_add(1u, std::memory_order_relaxed);
+        s.bytes_allocated.fetch_add(size, std::memory_order_relaxed);
+        s.by_size[cls].allocations.fetch_add(1u, std::memory_order_relaxed);
+        return p;
+    }
+
+    template <typename... Tags>
+    static void deallocate(std::size_t size, void* data, Tags... tags)
+    {
+        auto& s  = storage();
+        auto cls = heap_stats::size_class_of(size);
+        s.deallocations.fetch_add(1u, std::memory_order_relaxed);
+        s.bytes_deallocated.fetch_add(size, std::memory_order_relaxed);
+        s.by_size[cls].deallocations.fetch_add(1u, std::memory_order_relaxed);
+        base_t::deallocate(size, data, tags...);
+    }
+
+    /*!
+     * Returns a snapshot of the counters of this heap.
+     */
+    static heap_stats stats()
+    {
+        auto& s           = storage();
+        auto r            = heap_stats{};
+        r.allocations     = s.allocations.load(std::memory_order_relaxed);
+        r.deallocations   = s.deallocations.load(std::memory_order_relaxed);
+        r.bytes_allocated = s.bytes_allocated.load(std::memory_order_relaxed);
+        r.bytes_deallocated =
+            s.bytes_deallocated.load(std::memory_order_relaxed);
+        for (auto i = std::size_t{}; i < heap_stats::size_classes; ++i) {
+            r.by_size[i].allocations =
+                s.by_size[i].allocations.load(std::memory_order_relaxed);
+            r.by_size[i].deallocations =
+                s.by_size[i].deallocations.load(std::memory_order_relaxed);
+        }
+        return r;
+    }
+
+    /*!
+     * Sets all the counters of this heap back to zero.
+     */
+    static void reset_stats()
+    {
+        auto& s = storage();
+        s.allocations.store(0u, std::memory_order_relaxed);
+        s.deallocations.store(0u, std::memory_order_relaxed);
+        s.bytes_allocated.store(0u, std::memory_order_relaxed);
+        s.bytes_deallocated.store(0u, std::memory_order_relaxed);
+        for (auto& c : s.by_size) {
+            c.allocations.store(0u, std::memory_order_relaxed);
+            c.deallocations.store(0u, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    struct size_class_t
+    {
+        std::atomic<std::size_t> allocations{0u};
+        std::atomic<std::size_t> deallocations{0u};
+    };
+
+    struct storage_t
+    {
+        std::atomic<std::size_t> allocations{0u};
+        std::atomic<std::size_t> deallocations{0u};
+        std::atomic<std::size_t> bytes_allocated{0u};
+        std::atomic<std::size_t> bytes_deallocated{0u};
+        size_class_t by_size[heap_stats::size_classes];
+    };
+
+    static storage_t& storage()
+    {
+        static storage_t storage_;
+        return storage_;
+    }
+};
+
+} // namespace immer
@@ -0,0 +1,656 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/flex_vector.hpp>
+#include <immer/map.hpp>
+#include <immer/refcount/no_refcount_policy.hpp>
+#include <immer/set.hpp>
+#include <immer/table.hpp>
+#include <immer/vector.hpp>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+namespace immer {
+namespace detail {
+namespace interning {
+
+inline std::size_t combine(std::size_t seed, std::size_t h)
+{
+    return seed ^ (h + 0x9e3779b9 + (seed << 6) + (seed >> 2));
+}
+
+/*!
+ * Hashes the whole element, unlike the hash of a map that only looks at
+ * the key, so that maps that only differ in their values do not pile up
+ * under the same hash.
+ */
+template <typename T>
+struct content_hash
+{
+    std::size_t operator()(const T& x) const { return std::hash<T>{}(x); }
+};
+
+template <typename K, typename T>
+struct content_hash<std::pair<K, T>>
+{
+    std::size_t operator()(const std::pair<K, T>& x) const
+    {
+        return combine(content_hash<std::decay_t<K>>{}(x.first),
+                       content_hash<T>{}(x.second));
+    }
+};
+
+/*!
+ * The canonical nodes, indexed by the hash of their contents.  Every entry
+ * holds a reference to its node, and the table is split in shards, each
+ * protected by its own lock, so that threads interning different nodes
+ * rarely wait for each other.
+ */
+template <typename Entry, typename Lock>
+class shards
+{
+public:
+    using node_t = typename Entry::node_t;
+
+    static constexpr std::size_t shard_count = 64;
+
+    /*!
+     * Returns the node of the entry with hash `h` for which `eq` holds,
+     * with a new reference, or inserts `e` and returns null.  The node of
+     * `e` must already carry the reference that the table keeps.
+     */
+    template <typename Eq>
+    node_t* find_or_insert(std::size_t h, const Entry& e, Eq&& eq)
+    {
+        auto& s = shards_[h % shard_count];
+        typename Lock::scoped_lock lock{s.lock};
+        auto r = s.entries.equal_range(h);
+        for (; r.first != r.second; ++r.first)
+            if (eq(r.first->second))
+                return r.first->second.node->inc();
+        s.entries.emplace(h, e);
+        size_.fetch_add(1, std::memory_order_relaxed);
+        return nullptr;
+    }
+
+    /*!
+     * Removes the entries whose node is only referenced by the table,
+     * releasing them with `release`.  Releasing a node drops the references
+     * to its children, which may then become collectable too, so it walks
+     * the table again until nothing else can be removed.
+     */
+    template <typename Release>
+    std::size_t collect(Release&& release)
+    {
+        auto total = std::size_t{};
+        for (auto removed = std::size_t{1}; removed; total += removed) {
+            removed = 0;
+            for (auto& s : shards_) {
+                typename Lock::scoped_lock lock{s.lock};
+                for (auto it = s.entries.begin(); it != s.entries.end();) {
+                    if (node_t::refs(it->second.node).unique()) {
+                        release(it->second);
+                        it = s.entries.erase(it);
+                        ++removed;
+                    } else
+                        ++it;
+                }
+            }
+        }
+        size_.fetch_sub(total, std::memory_order_relaxed);
+        return total;
+    }
+
+    template <typename Release>
+    void clear(Release&& release)
+    {
+        for (auto& s : shards_) {
+            typename Lock::scoped_lock lock{s.lock};
+            for (auto& e : s.entries)
+                release(e.second);
+            s.entries.clear();
+        }
+        size_.store(0, std::memory_order_relaxed);
+    }
+
+    std::size_t size() const { return size_.load(std::memory_order_relaxed); }
+
+private:
+    struct shard
+    {
+        Lock lock;
+        std::unordered_multimap<std::size_t, Entry> entries;
+    };
+
+    std::array<shard, shard_count> shards_;
+    std::atomic<std::size_t> size_{0};
+};
+
+template <typename Node>
+struct champ_entry
+{
+    using node_t = Node;
+
+    node_t* node;
+    hamts::count_t depth;
+};
+
+/*!
+ * Interns the nodes of the CHAMP tree of a `map`, `set` or `table`, from
+ * the bottom up.  A node whose children are all canonical already is made
+ * canonical itself when no equal one exists, otherwise a copy pointing to
+ * the canonical children is made, sharing the values of the original.
+ */
+template <typename Container, typename Hash>
+class champ_interner
+{
+public:
+    using impl_t = std::decay_t<decltype(std::declval<Container>().impl())>;
+    using node_t = typename impl_t::node_t;
+    using T      = typename node_t::value_t;
+    using hash_t = typename node_t::hash_t;
+
+    static constexpr auto B = impl_t::bits;
+
+    static_assert(
+        !std::is_same<typename node_t::refs_t, no_refcount_policy>::value,
+        "interning requires a reference counting memory policy");
+
+    ~champ_interner() { table_.clear(release_entry{}); }
+
+    Container intern(const Container& c)
+    {
+        return impl_t{intern(c.impl().root, 0), c.size()};
+    }
+
+    std::size_t collect() { return table_.collect(release_entry{}); }
+
+    std::size_t size() const { return table_.size(); }
+
+private:
+    using entry_t = champ_entry<node_t>;
+    using lock_t  = typename node_t::memory::lock;
+
+    struct release_entry
+    {
+        void operator()(const entry_t& e) const { release(e.node, e.depth); }
+    };
+
+    static void release(node_t* p, hamts::count_t depth)
+    {
+        if (p->dec())
+            node_t::delete_deep(p, depth);
+    }
+
+    node_t* intern(node_t* node, hamts::count_t depth)
+    {
+        return depth < hamts::max_depth<hash_t, B>
+                   ? intern_inner(node, depth)
+                   : intern_collision(node, depth);
+    }
+
+    node_t* intern_inner(node_t* node, hamts::count_t depth)
+    {
+        auto n  = node->children_count();
+        auto nv = node->data_count();
+        if (!n && !nv)
+            return node->inc();
+
+        node_t* children[hamts::branches<B>];
+        auto i = hamts::count_t{};
+        IMMER_TRY {
+            for (; i < n; ++i)
+                children[i] = intern(node->children()[i], depth + 1);
+        }
+        IMMER_CATCH (...) {
+            while (i--)
+                release(children[i], depth + 1);
+            IMMER_RETHROW;
+        }
+
+        auto h = combine(depth, node->datamap());
+        h      = combine(h, node->nodemap());
+        for (i = 0; i < n; ++i)
+            h = combine(h, std::hash<const void*>{}(children[i]));
+        for (i = 0; i < nv; ++i)
+            h = combine(h, Hash{}(node->values()[i]));
+
+        auto eq = [&](const entry_t& e) {
+            auto other = e.node;
+            return e.depth == depth && other->datamap() == node->datamap() &&
+                   other->nodemap() == node->nodemap() &&
+                   std::equal(children, children + n, other->children()) &&
+                   (!nv ||
+                    other->impl.d.data.inner.values ==
+                        node->impl.d.data.inner.values ||
+                    std::equal(other->values(),
+                               other->values() + nv,
+                               node->values()));
+        };
+
+        if (std::equal(children, children + n, node->children())) {
+            for (i = 0; i < n; ++i)
+                release(children[i], depth + 1);
+            return find_or_insert(h, node->inc(), depth, eq);
+        } else {
+            auto fresh = static_cast<node_t*>(nullptr);
+            IMMER_TRY {
+                fresh = node_t::make_inner_n(n, node->impl.d.data.inner.values);
+            }
+            IMMER_CATCH (...) {
+                for (i = 0; i < n; ++i)
+                    release(children[i], depth + 1);
+                IMMER_RETHROW;
+            }
+            fresh->impl.d.data.inner.datamap = node->datamap();
+            fresh->impl.d.data.inner.nodemap = node->nodemap();
+            std::copy(children, children + n, fresh->children());
+            return find_or_insert(h, fresh, depth, eq);
+        }
+    }
+
+    node_t* intern_collision(node_t* node, hamts::count_t depth)
+    {
+        auto n     = node->collision_count();
+        auto first = node->collisions();
+        auto last  = first + n;
+        auto sum   = std::size_t{};
+        for (auto it = first; it != last; ++it)
+            sum += Hash{}(*it);
+        auto h  = combine(combine(depth, n), sum);
+        auto eq = [&](const entry_t& e) {
+            return e.depth == depth && e.node->collision_count() == n &&
+                   std::is_permutation(first, last, e.node->collisions());
+        };
+        return find_or_insert(h, node->inc(), depth, eq);
+    }
+
+    /*!
+     * Makes `node`, which carries a reference for the table, canonical,
+     * unless there is an equal canonical node already, in which case that
+     * one is returned and `node` released.
+     */
+    template <typename Eq>
+    node_t* find_or_insert(std::size_t h,
+                           node_t* node,
+                           hamts::count_t depth,
+                           Eq&& eq)
+    {
+        auto found = table_.find_or_insert(h, entry_t{node, depth}, eq);
+        if (found) {
+            release(node, depth);
+            return found;
+        }
+        return node->inc();
+    }
+
+    shards<entry_t, lock_t> table_;
+};
+
+template <typename Node>
+struct rbts_entry
+{
+    using node_t = Node;
+
+    node_t* node;
+    rbts::shift_t shift; // zero for leaves
+    std::size_t size;
+};
+
+/*!
+ * Interns the nodes of the tree of a `vector` or `flex_vector`, from the
+ * bottom up, like @ref champ_interner.  A leaf is identified by its
+ * elements, and an inner node by its level and its children.
+ */
+template <typename Container, typename Hash>
+class rbts_interner
+{
+public:
+    using impl_t = std::decay_t<decltype(std::declval<Container>().impl())>;
+    using node_t = typename impl_t::node_t;
+    using T      = typename node_t::value_t;
+
+    static constexpr auto B = node_t::bits;
+
+    static_assert(
+        !std::is_same<typename node_t::refs_t, no_refcount_policy>::value,
+        "interning requires a reference counting memory policy");
+
+    ~rbts_interner() { table_.clear(release_entry{}); }
+
+    Container intern(const Container& c)
+    {
+        auto& impl = c.impl();
+        entry_t parts[2];
+        auto out = parts;
+        IMMER_TRY {
+            impl.traverse(visitor{}, *this, out);
+        }
+        IMMER_CATCH (...) {
+            while (out != parts)
+                release(*--out);
+            IMMER_RETHROW;
+        }
+        return impl_t{impl.size, impl.shift, parts[0].node, parts[1].node};
+    }
+
+    std::size_t collect() { return table_.collect(release_entry{}); }
+
+    std::size_t size() const { return table_.size(); }
+
+private:
+    using entry_t = rbts_entry<node_t>;
+    using lock_t  = typename node_t::memory::lock;
+
+    struct release_entry
+    {
+        void operator()(const entry_t& e) const { release(e); }
+    };
+
+    static void release(const entry_t& e)
+    {
+        if (!e.size)
+            e.node->dec();
+        else if (!e.shift)
+            rbts::dec_leaf(e.node, e.size);
+        else
+            rbts::dec_inner(e.node, e.shift, e.size);
+    }
+
+    struct visitor : rbts::visitor_base<visitor>
+    {
+        template <typename Pos>
+        static void visit_relaxed(Pos&& p, rbts_interner& self, entry_t*& out)
+        {
+            *out++ = self.intern_inner(p, true);
+        }
+
+        template <typename Pos>
+        static void visit_regular(Pos&& p, rbts_interner& self, entry_t*& out)
+        {
+            *out++ = self.intern_inner(p, false);
+        }
+
+        template <typename Pos>
+        static void visit_leaf(Pos&& p, rbts_interner& self, entry_t*& out)
+        {
+            *out++ = self.intern_leaf(p.node(), p.count());
+        }
+    };
+
+    entry_t intern_leaf(node_t* node, rbts::count_t n)
+    {
+        if (!n)
+            return {node->inc(), 0, 0};
+        auto h = combine(0, n);
+        for (auto i = rbts::count_t{}; i < n; ++i)
+            h = combine(h, Hash{}(node->leaf()[i]));
+        auto eq = [&](const entry_t& e) {
+            return !e.shift && e.size == n &&
+                   (e.node == node ||
+                    std::equal(node->leaf(), node->leaf() + n, e.node->leaf()));
+        };
+        return find_or_insert(h, {node->inc(), 0, n}, eq);
+    }
+
+    template <typename Pos>
+    entry_t intern_inner(Pos&& p, bool relaxed)
+    {
+        auto node  = p.node();
+        auto n     = p.count();
+        auto shift = p.shift();
+        if (!n)
+            return {node->inc(), 0, 0};
+
+        entry_t children[rbts::branches<B>];
+        auto out = children;
+        IMMER_TRY {
+            p.each(visitor{}, *this, out);
+        }
+        IMMER_CATCH (...) {
+            while (out != children)
+                release(*--out);
+            IMMER_RETHROW;
+        }
+
+        auto size = std::size_t{};
+        auto same = true;
+        auto h    = combine(combine(shift, relaxed), n);
+        for (auto i = rbts::count_t{}; i < n; ++i) {
+            size += children[i].size;
+            same = same && children[i].node == node->inner()[i];
+            h    = combine(h, std::hash<const void*>{}(children[i].node));
+        }
+
+        auto eq = [&](const entry_t& e) {
+            auto other = e.node;
+            return e.shift == shift && e.size == size &&
+                   (other->relaxed() != nullptr) == relaxed &&
+                   (!relaxed || other->relaxed()->d.count == n) &&
+                   std::equal(children,
+                              children + n,
+                              other->inner(),
+                              [](auto& c, auto o) { return c.node == o; });
+        };
+
+        if (same) {
+            for (auto i = rbts::count_t{}; i < n; ++i)
+                release(children[i]);
+            return find_or_insert(h, {node->inc(), shift, size}, eq);
+        } else {
+            auto fresh = static_cast<node_t*>(nullptr);
+            IMMER_TRY {
+                fresh = relaxed ? node_t::make_inner_r_n(n)
+                                : node_t::make_inner_n(n);
+            }
+            IMMER_CATCH (...) {
+                for (auto i = rbts::count_t{}; i < n; ++i)
+                    release(children[i]);
+                IMMER_RETHROW;
+            }
+            auto sum = std::size_t{};
+            for (auto i = rbts::count_t{}; i < n; ++i) {
+                fresh->inner()[i] = children[i].node;
+                if (relaxed)
+                    fresh->relaxed()->d.sizes[i] = sum += children[i].size;
+            }
+            if (relaxed)
+                fresh->relaxed()->d.count = n;
+            return find_or_insert(h, {fresh, shift, size}, eq);
+        }
+    }
+
+    /*!
+     * Makes the node of `e`, which carries a reference for the table,
+     * canonical, unless there is an equal canonical node already.
+     */
+    template <typename Eq>
+    entry_t find_or_insert(std::size_t h, const entry_t& e, Eq&& eq)
+    {
+        auto found = table_.find_or_insert(h, e, eq);
+        if (found) {
+            release(e);
+            return {found, e.shift, e.size};
+        }
+        return {e.node->inc(), e.shift, e.size};
+    }
+
+    shards<entry_t, lock_t> table_;
+};
+
+template <typename Container, typename Hash>
+struct interner;
+
+template <typename T,
+          typename MemoryPolicy,
+          rbts::bits_t B,
+          rbts::bits_t BL,
+          typename Hash>
+struct interner<vector<T, MemoryPolicy, B, BL>, Hash>
+{
+    using type = rbts_interner<vector<T, MemoryPolicy, B, BL>, Hash>;
+};
+
+template <typename T,
+          typename MemoryPolicy,
+          rbts::bits_t B,
+          rbts::bits_t BL,
+          typename Hash>
+struct interner<flex_vector<T, MemoryPolicy, B, BL>, Hash>
+{
+    using type = rbts_interner<flex_vector<T, MemoryPolicy, B, BL>, Hash>;
+};
+
+template <typename K,
+          typename T,
+          typename KHash,
+          typename Equal,
+          typename MemoryPolicy,
+          hamts::bits_t B,
+          typename Hash>
+struct interner<map<K, T, KHash, Equal, MemoryPolicy, B>, Hash>
+{
+    using type = champ_interner<map<K, T, KHash, Equal, MemoryPolicy, B>, Hash>;
+};
+
+template <typename T,
+          typename KHash,
+          typename Equal,
+          typename MemoryPolicy,
+          hamts::bits_t B,
+          typename Hash>
+struct interner<set<T, KHash, Equal, MemoryPolicy, B>, Hash>
+{
+    using type = champ_interner<set<T, KHash, Equal, MemoryPolicy, B>, Hash>;
+};
+
+template <typename T,
+          typename KeyFn,
+          typename KHash,
+          typename Equal,
+          typename MemoryPolicy,
+          hamts::bits_t B,
+          typename Hash>
+struct interner<table<T, KeyFn, KHash, Equal, MemoryPolicy, B>, Hash>
+{
+    using type =
+        champ_interner<table<T, KeyFn, KHash, Equal, MemoryPolicy, B>, Hash>;
+};
+
+} // namespace interning
+} // namespace detail
+
+/**
+ * @defgroup interning
+ * @{
+ */
+
+/*!
+ * A table of canonical nodes for containers of type `Container`, which may
+ * be a `vector`, `flex_vector`, `map`, `set` or `table` with a reference
+ * counting memory policy.  Interning a container through the table makes
+ * its nodes canonical: equal subtrees of all the containers interned in the
+ * same table become the same nodes in memory.
+ *
+ * @rst
+ *
+ * This is useful when many similar containers are built independently, for
+ * example, per user settings that are derived from common defaults but
+ * that are not updates of a common version, so they share nothing:
+ *
+ * .. code-block:: c++
+ *
+ *    auto table    = immer::intern_table<immer::map<std::string, int>>{};
+ *    auto settings = std::vector<immer::map<std::string, int>>{};
+ *    for (auto& user : users)
+ *        settings.push_back(table.intern(load_settings(user)));
+ *
+ * The interned containers are equal to the originals and can be used and
+ * updated normally.  Since equal subtrees are the same nodes, comparing two
+ * interned containers stops as soon as it finds the same node on both
+ * sides, so comparing equal ones takes constant time.
+ *
+ * Every node is hashed by its contents, using ``Hash`` on the elements, and
+ * the hashes of its children, which are canonical already.  By default, the
+ * elements are hashed with ``std::hash``, and the key and the value of the
+ * elements of a ``map`` are hashed together.  Interning a container takes
+ * time proportional to its size and can be done concurrently from several
+ * threads, when the memory policy of the container is thread safe.
+ *
+ * .. note:: The table holds a reference to every canonical node, so that
+ *    they remain canonical while they are not used.  The nodes that are only
+ *    referenced by the table anymore are released by :cpp:func:`collect`,
+ *    and all of them when the table is destroyed.  The interned containers
+ *    remain valid after that, they just stop being canonical.
+ *
+ * @endrst
+ */
+template <typename Container,
+          typename Hash = detail::interning::content_hash<
+              typename Container::value_type>>
+class intern_table
+{
+public:
+    intern_table()                               = default;
+    intern_table(const intern_table&)            = delete;
+    intern_table& operator=(const intern_table&) = delete;
+
+    /*!
+     * Returns a container equal to `c` made of canonical nodes.  The nodes
+     * of `c` that have no equal canonical node yet become canonical
+     * themselves.
+     */
+    Container intern(const Container& c) { return impl_.intern(c); }
+
+    /*!
+     * Releases the canonical nodes that no container uses anymore and
+     * returns how many were released.
+     *
+     * @rst
+     *
+     * .. warning:: The table holds a strong reference to every canonical
+     *    node, so the nodes of an interned container are never unique.
+     *    Updates through ``std::move`` or a transient can not reuse them in
+     *    place and always copy, like updates of a shared container.  Nodes
+     *    that the containers drop are not freed until this is called.
+     *
+     * @endrst
+     */
+    std::size_t collect() { return impl_.collect(); }
+
+    /*!
+     * Returns the number of canonical nodes in the table.
+     */
+    std::size_t size() const { return impl_.size(); }
+
+private:
+    typename detail::interning::interner<Container, Hash>::type impl_;
+};
+
+/*!
+ * Returns a container equal to `c` made of the canonical nodes of `table`.
+ * @see intern_table
+ */
+template <typename Container, typename Hash>
+Container intern(const Container& c, intern_table<Container, Hash>& table)
+{
+    return table.intern(c);
+}
+
+/** @} */ // group: interning
+
+} // namespace immer
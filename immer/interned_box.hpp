@@ -0,0 +1,309 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/detail/util.hpp>
+#include <immer/memory_policy.hpp>
+
+#include <array>
+#include <cstddef>
+#include <functional>
+#include <type_traits>
+#include <unordered_map>
+#include <utility>
+
+namespace immer {
+
+/*!
+ * Immutable box for a single value of type `T`, like `box`, that is
+ * *interned*: all the interned boxes of the same type holding equal values
+ * share the same object.
+ *
+ * @rst
+ *
+ * The boxes are deduplicated through a global table that is indexed by the
+ * hash of their values.  The hash is computed once, when the box is made,
+ * and stored next to the value.  Thus, comparing two interned boxes just
+ * compares two pointers, and hashing one just reads the stored hash, no
+ * matter how big their values are.  This makes them good keys for a
+ * ``map`` or elements of a ``set``, for example, for the symbols of an
+ * interpreter:
+ *
+ * .. code-block:: c++
+ *
+ *    using symbol = immer::interned_box<std::string>;
+ *
+ *    auto env = immer::map<symbol, int>{};
+ *    env = env.set(symbol{"answer"}, 42);
+ *    assert(env[symbol{"answer"}] == 42);
+ *
+ * Making a box takes a lookup in the table, which hashes the value and
+ * compares it with the values that have the same hash.  When the last
+ * box holding a value is destroyed, the value is removed from the table.
+ * The table is thread safe when the lock of the ``MemoryPolicy`` is.
+ *
+ * .. warning:: Since equal values are shared, the value of an interned
+ *    box can never be changed in place, and ``update()`` always makes a
+ *    new one.
+ *
+ * @endrst
+ */
+template <typename T,
+          typename MemoryPolicy = default_memory_policy,
+          typename Hash         = std::hash<T>,
+          typename Equal        = std::equal_to<T>>
+class interned_box
+{
+    using refs_t = typename MemoryPolicy::refcount;
+    using lock_t = typename MemoryPolicy::lock;
+    using heap   = typename MemoryPolicy::heap::type;
+
+    static_assert(!std::is_same<refs_t, no_refcount_policy>::value,
+                  "interned boxes require a reference counting memory policy");
+
+    struct holder : refs_t
+    {
+        std::size_t hash;
+        T value;
+
+        template <typename U>
+        holder(std::size_t h, U&& v)
+            : hash{h}
+            , value{std::forward<U>(v)}
+        {
+        }
+    };
+
+    /*!
+     * The boxes alive, indexed by the hash of their value, and split in
+     * shards protected by their own lock.  The table does not hold a
+     * reference to the boxes.  Instead, the last box that releases a value
+     * removes it from the table, and a lookup that finds a value whose
+     * count already dropped to zero ignores it.
+     */
+    class table
+    {
+    public:
+        static table& instance()
+        {
+            // never destroyed, so that boxes can outlive other statics
+            static auto& t = *new table;
+            return t;
+        }
+
+        template <typename U>
+        holder* intern(U&& value)
+        {
+            auto h  = Hash{}(value);
+            auto& s = shards_[h % shard_count];
+            {
+                typename lock_t::scoped_lock lock{s.lock};
+                if (auto p = find(s, h, value))
+                    return p;
+            }
+            auto p = detail::make<heap, holder>(h, std::forward<U>(value));
+            {
+                typename lock_t::scoped_lock lock{s.lock};
+                if (auto q = find(s, h, p->value)) {
+                    destroy(p);
+                    return q;
+                }
+                s.entries.emplace(h, p);
+            }
+            return p;
+        }
+
+        void release(holder* p)
+        {
+            auto& s = shards_[p->hash % shard_count];
+            {
+                typename lock_t::scoped_lock lock{s.lock};
+                auto r = s.entries.equal_range(p->hash);
+                for (; r.first != r.second; ++r.first)
+                    if (r.first->second == p) {
+                        s.entries.erase(r.first);
+                        break;
+                    }
+            }
+            destroy(p);
+        }
+
+    private:
+        static constexpr std::size_t shard_count = 64;
+
+        struct shard
+        {
+            lock_t lock;
+            std::unordered_multimap<std::size_t, holder*> entries;
+        };
+
+        template <typename U>
+        static holder* find(shard& s, std::size_t h, const U& value)
+        {
+            auto r = s.entries.equal_range(h);
+            for (; r.first != r.second; ++r.first) {
+                auto p = r.first->second;
+                if (Equal{}(p->value, value) && p->try_inc())
+                    return p;
+            }
+            return nullptr;
+        }
+
+        static void destroy(holder* p)
+        {
+            p->~holder();
+            heap::deallocate(sizeof(holder), p);
+        }
+
+        std::array<shard, shard_count> shards_;
+    };
+
+    holder* impl_ = nullptr;
+
+    interned_box(holder* impl)
+        : impl_{impl}
+    {
+    }
+
+public:
+    const holder* impl() const { return impl_; };
+
+    using value_type    = T;
+    using memory_policy = MemoryPolicy;
+
+    /*!
+     * Constructs a box holding `T{}`.
+     */
+    interned_box()
+        : impl_{table::instance().intern(T{})}
+    {
+    }
+
+    /*!
+     * Constructs a box holding `value`.  The value is only copied when no
+     * other box holds an equal one.
+     */
+    interned_box(const T& value)
+        : impl_{table::instance().intern(value)}
+    {
+    }
+
+    /*!
+     * Constructs a box holding `value`.  The value is only moved when no
+     * other box holds an equal one.
+     */
+    interned_box(T&& value)
+        : impl_{table::instance().intern(std::move(value))}
+    {
+    }
+
+    /*!
+     * Constructs a box holding `T{args...}`.
+     */
+    template <typename Arg,
+              typename... Args,
+              typename Enable = std::enable_if_t<
+                  !std::is_same<interned_box, std::decay_t<Arg>>::value &&
+                  !std::is_same<T, std::decay_t<Arg>>::value>>
+    interned_box(Arg&& arg, Args&&... args)
+        : interned_box{T{std::forward<Arg>(arg), std::forward<Args>(args)...}}
+    {
+    }
+
+    friend void swap(interned_box& a, interned_box& b)
+    {
+        using std::swap;
+        swap(a.impl_, b.impl_);
+    }
+
+    interned_box(interned_box&& other) { swap(*this, other); }
+    interned_box(const interned_box& other)
+        : impl_(other.impl_)
+    {
+        impl_->inc();
+    }
+    interned_box& operator=(interned_box&& other)
+    {
+        swap(*this, other);
+        return *this;
+    }
+    interned_box& operator=(const interned_box& other)
+    {
+        auto aux = other;
+        swap(*this, aux);
+        return *this;
+    }
+    ~interned_box()
+    {
+        if (impl_ && impl_->dec())
+            table::instance().release(impl_);
+    }
+
+    /*! Query the current value. */
+    IMMER_NODISCARD const T& get() const { return impl_->value; }
+
+    /*! Returns the hash of the value, computed when the box was made. */
+    IMMER_NODISCARD std::size_t hash() const { return impl_->hash; }
+
+    /*! Conversion to the boxed type. */
+    operator const T&() const { return get(); }
+
+    /*! Access via dereference */
+    const T& operator*() const { return get(); }
+
+    /*! Access via pointer member access */
+    const T* operator->() const { return &get(); }
+
+    /*!
+     * Returns a new box holding the result of applying `fn` to the
+     * underlying value.
+     */
+    template <typename Fn>
+    IMMER_NODISCARD interned_box update(Fn&& fn) const
+    {
+        return interned_box{std::forward<Fn>(fn)(get())};
+    }
+
+    /*!
+     * Two interned boxes are equal when they are the same box, which is
+     * the case whenever their values are equal.
+     */
+    IMMER_NODISCARD friend bool operator==(const interned_box& a,
+                                           const interned_box& b)
+    {
+        return a.impl_ == b.impl_;
+    }
+    IMMER_NODISCARD friend bool operator!=(const interned_box& a,
+                                           const interned_box& b)
+    {
+        return a.impl_ != b.impl_;
+    }
+
+    /*! Orders the boxes by their values. */
+    IMMER_NODISCARD friend bool operator<(const interned_box& a,
+                                          const interned_box& b)
+    {
+        return a.impl_ != b.impl_ && a.get() < b.get();
+    }
+};
+
+} // namespace immer
+
+namespace std {
+
+template <typename T, typename MP, typename H, typename E>
+struct hash<immer::interned_box<T, MP, H, E>>
+{
+    std::size_t operator()(const immer::interned_box<T, MP, H, E>& x) const
+    {
+        return x.hash();
+    }
+};
+
+} // namespace std
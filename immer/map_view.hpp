@@ -0,0 +1,174 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/map.hpp>
+
+namespace immer {
+
+/*!
+ * Non-owning, read-only view of a @ref map.
+ *
+ * @rst
+ *
+ * Copying a ``map`` increments the reference count of its root, which is an
+ * atomic operation on memory shared by every thread holding a copy of it.  A
+ * view instead just *borrows* the map, so it can be copied around, for
+ * example into the closures of many worker threads, without touching any
+ * reference count at all.  It provides the whole read API of the map, and an
+ * owning map can be obtained with ``get()`` when a copy needs to outlive the
+ * borrowed one.
+ *
+ * .. warning:: The view borrows the map object itself, not its data, so
+ *    it is only valid as long as that object is alive and it is not
+ *    assigned to nor moved from.  A view can not be created from a
+ *    temporary map.
+ *
+ * @endrst
+ */
+template <typename K,
+          typename T,
+          typename Hash           = std::hash<K>,
+          typename Equal          = std::equal_to<K>,
+          typename MemoryPolicy   = default_memory_policy,
+          detail::hamts::bits_t B = default_bits>
+class map_view
+{
+public:
+    using container_type = map<K, T, Hash, Equal, MemoryPolicy, B>;
+
+    using key_type           = typename container_type::key_type;
+    using mapped_type        = typename container_type::mapped_type;
+    using value_type         = typename container_type::value_type;
+    using size_type          = typename container_type::size_type;
+    using difference_type    = typename container_type::difference_type;
+    using hasher             = typename container_type::hasher;
+    using key_equal          = typename container_type::key_equal;
+    using reference          = typename container_type::reference;
+    using const_reference    = typename container_type::const_reference;
+    using iterator           = typename container_type::iterator;
+    using const_iterator     = typename container_type::const_iterator;
+    using memory_policy_type = MemoryPolicy;
+
+    /*!
+     * Creates a view borrowing the map `m`.  It does not allocate memory nor
+     * touch any reference count.
+     */
+    explicit map_view(const container_type& m)
+        : m_{&m}
+    {
+    }
+
+    map_view(container_type&&) = delete;
+
+    /*!
+     * Returns the borrowed map.  Copying it results in a map that owns its
+     * data again.
+     */
+    IMMER_NODISCARD const container_type& get() const { return *m_; }
+
+    /*! Conversion to the borrowed map. */
+    operator const container_type&() const { return get(); }
+
+    /*! @see map::begin */
+    IMMER_NODISCARD iterator begin() const { return m_->begin(); }
+
+    /*! @see map::end */
+    IMMER_NODISCARD iterator end() const { return m_->end(); }
+
+    /*! @see map::size */
+    IMMER_NODISCARD size_type size() const { return m_->size(); }
+
+    /*! @see map::empty */
+    IMMER_NODISCARD bool empty() const { return m_->empty(); }
+
+    /*! @see map::count */
+    template <typename Key,
+              typename U = Hash,
+              typename   = typename U::is_transparent>
+    IMMER_NODISCARD size_type count(const Key& k) const
+    {
+        return m_->count(k);
+    }
+    IMMER_NODISCARD size_type count(const K& k) const { return m_->count(k); }
+
+    /*! @see map::operator[] */
+    template <typename Key,
+              typename U = Hash,
+              typename   = typename U::is_transparent>
+    IMMER_NODISCARD const T& operator[](const Key& k) const
+    {
+        return (*m_)[k];
+    }
+    IMMER_NODISCARD const T& operator[](const K& k) const { return (*m_)[k]; }
+
+    /*! @see map::at */
+    template <typename Key,
+              typename U = Hash,
+              typename   = typename U::is_transparent>
+    const T& at(const Key& k) const
+    {
+        return m_->at(k);
+    }
+    const T& at(const K& k) const { return m_->at(k); }
+
+    /*! @see map::find */
+    template <typename Key,
+              typename U = Hash,
+              typename   = typename U::is_transparent>
+    IMMER_NODISCARD const T* find(const Key& k) const
+    {
+        return m_->find(k);
+    }
+    IMMER_NODISCARD const T* find(const K& k) const { return m_->find(k); }
+
+    /*! Returns whether the viewed maps are equal. */
+    IMMER_NODISCARD bool operator==(const map_view& other) const
+    {
+        return *m_ == *other.m_;
+    }
+    IMMER_NODISCARD bool operator!=(const map_view& other) const
+    {
+        return !(*this == other);
+    }
+
+    /*! @see map::identity */
+    void* identity() const { return m_->identity(); }
+
+    // Semi-private
+    const auto& impl() const { return m_->impl(); }
+
+private:
+    const container_type* m_;
+};
+
+/*!
+ * Returns a @ref map_view borrowing `m`.
+ */
+template <typename K,
+          typename T,
+          typename Hash,
+          typename Equal,
+          typename MemoryPolicy,
+          detail::hamts::bits_t B>
+map_view<K, T, Hash, Equal, MemoryPolicy, B>
+view(const map<K, T, Hash, Equal, MemoryPolicy, B>& m)
+{
+    return map_view<K, T, Hash, Equal, MemoryPolicy, B>{m};
+}
+
+template <typename K,
+          typename T,
+          typename Hash,
+          typename Equal,
+          typename MemoryPolicy,
+          detail::hamts::bits_t B>
+void view(map<K, T, Hash, Equal, MemoryPolicy, B>&&) = delete;
+
+} // namespace immer
@@ -0,0 +1,446 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/array.hpp>
+#include <immer/box.hpp>
+#include <immer/flex_vector.hpp>
+#include <immer/map.hpp>
+#include <immer/node_stats.hpp>
+#include <immer/set.hpp>
+#include <immer/table.hpp>
+#include <immer/vector.hpp>
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <iterator>
+#include <type_traits>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace immer {
+
+/**
+ * @defgroup memory-usage
+ * @{
+ */
+
+/*!
+ * Memory used by the nodes of a set of containers, as computed by
+ * `memory_usage()`.
+ *
+ * @rst
+ *
+ * Every node is accounted once, no matter how many containers, or how many
+ * places in the same container, refer to it.  The byte counts are the sizes
+ * that the containers request from their heap, which do not include the
+ * overhead of the heap itself, nor the memory owned by the elements, like
+ * the characters of a long ``std::string``.  The empty nodes that all the
+ * containers of a type share, and that are never freed, are not accounted
+ * either, so an empty container uses no bytes.
+ *
+ * @endrst
+ */
+struct memory_footprint
+{
+    struct kind_footprint
+    {
+        std::size_t nodes    = {};
+        std::size_t bytes    = {};
+        std::size_t headroom = {};
+    };
+
+    /*!
+     * Bytes that the containers would use if they shared no nodes, that is,
+     * the sum of the size of every container on its own.
+     */
+    std::size_t total_bytes = {};
+
+    /*!
+     * Bytes of the distinct nodes, that is, the memory that the containers
+     * actually use together.
+     */
+    std::size_t unique_bytes = {};
+
+    /*!
+     * Part of the `unique_bytes` in nodes that are used by more than one of
+     * the containers.
+     */
+    std::size_t shared_bytes = {};
+
+    /*!
+     * Part of the `unique_bytes` that is allocated but unused.  Vectors and
+     * flex vectors with reference counting allocate their nodes with room
+     * for all their branches, so that transients can fill them in place.
+     */
+    std::size_t headroom_bytes = {};
+
+    /*! Distinct nodes and their bytes, indexed by @ref node_kind. */
+    std::array<kind_footprint, node_kind_count> kinds = {};
+
+    /*!
+     * For every container, in the order given, the bytes of the nodes that
+     * only it uses.  This is the memory that is freed when that container
+     * alone is released.
+     */
+    std::vector<std::size_t> exclusive_bytes;
+
+    /*! Number of distinct nodes. */
+    std::size_t nodes() const
+    {
+        auto r = std::size_t{};
+        for (auto& k : kinds)
+            r += k.nodes;
+        return r;
+    }
+
+    const kind_footprint& operator[](node_kind k) const
+    {
+        return kinds[static_cast<std::size_t>(k)];
+    }
+};
+
+namespace detail {
+namespace footprint {
+
+/*!
+ * Walks the nodes of several containers, one after the other.  A node is
+ * only entered the first time it is found.  When a container finds a node
+ * that an earlier one owns, that node and everything under it becomes
+ * shared, and it is walked again once to mark it so.  Thus, every node is
+ * entered at most twice, no matter how many containers share it.
+ */
+class walker
+{
+public:
+    memory_footprint result;
+
+    void next_container()
+    {
+        current_ = result.exclusive_bytes.size();
+        result.exclusive_bytes.push_back(0u);
+        sum_ = 0;
+    }
+
+    void end_container() { result.total_bytes += sum_; }
+
+    /*!
+     * Makes the walk ignore the node `p`, which is allocated once and never
+     * freed, like the empty nodes of a container type.
+     */
+    void skip(const void* p) { skipped_.insert(p); }
+
+    /*!
+     * Accounts the node `p` of `bytes` bytes, of which `headroom` are not
+     * used, calling `children()` to walk the nodes it refers to.
+     */
+    template <typename Fn>
+    void node(const void* p,
+              node_kind kind,
+              std::size_t bytes,
+              std::size_t headroom,
+              Fn&& children)
+    {
+        if (skipped_.count(p))
+            return;
+        auto r = index_.emplace(p, infos_.size());
+        if (r.second) {
+            assert(!marking_);
+            infos_.push_back({bytes, 0u, current_, false});
+            auto& k = result.kinds[static_cast<std::size_t>(kind)];
+            k.nodes += 1;
+            k.bytes += bytes;
+            k.headroom += headroom;
+            result.unique_bytes += bytes;
+            result.headroom_bytes += headroom;
+            result.exclusive_bytes[current_] += bytes;
+            auto outer = sum_;
+            sum_       = 0;
+            children();
+            auto subtree                  = bytes + sum_;
+            infos_[r.first->second].total = subtree;
+            sum_                          = outer + subtree;
+        } else {
+            auto idx = r.first->second;
+            if (!infos_[idx].shared &&
+                (marking_ || infos_[idx].owner != current_)) {
+                infos_[idx].shared = true;
+                result.shared_bytes += infos_[idx].bytes;
+                result.exclusive_bytes[infos_[idx].owner] -= infos_[idx].bytes;
+                auto outer   = sum_;
+                auto marking = marking_;
+                marking_     = true;
+                children();
+                marking_ = marking;
+                sum_     = outer;
+            }
+            sum_ += infos_[idx].total;
+        }
+    }
+
+private:
+    struct info
+    {
+        std::size_t bytes;
+        std::size_t total;
+        std::size_t owner;
+        bool shared;
+    };
+
+    std::unordered_map<const void*, std::size_t> index_;
+    std::unordered_set<const void*> skipped_;
+    std::vector<info> infos_;
+    std::size_t current_ = 0;
+    std::size_t sum_     = 0;
+    bool marking_        = false;
+};
+
+struct rbts_visitor : rbts::visitor_base<rbts_visitor>
+{
+    template <typename Pos>
+    static void visit_relaxed(Pos&& p, walker& w)
+    {
+        using node_t = rbts::node_type<Pos>;
+        auto n       = p.count();
+        auto bytes   = node_t::sizeof_inner_r_n(n);
+        auto packed  = node_t::sizeof_packed_inner_r_n(n);
+        if (!node_t::embed_relaxed) {
+            bytes += node_t::sizeof_relaxed_n(n);
+            packed += node_t::sizeof_packed_relaxed_n(n);
+        }
+        w.node(p.node(), node_kind::relaxed, bytes, bytes - packed, [&] {
+            p.each(rbts_visitor{}, w);
+        });
+    }
+
+    template <typename Pos>
+    static void visit_regular(Pos&& p, walker& w)
+    {
+        using node_t = rbts::node_type<Pos>;
+        auto n       = p.count();
+        auto bytes   = node_t::sizeof_inner_n(n);
+        auto packed  = node_t::sizeof_packed_inner_n(n);
+        w.node(p.node(), node_kind::inner, bytes, bytes - packed, [&] {
+            p.each(rbts_visitor{}, w);
+        });
+    }
+
+    template <typename Pos>
+    static void visit_leaf(Pos&& p, walker& w)
+    {
+        using node_t = rbts::node_type<Pos>;
+        auto n       = p.count();
+        auto bytes   = node_t::sizeof_leaf_n(n);
+        auto packed  = node_t::sizeof_packed_leaf_n(n);
+        w.node(p.node(), node_kind::leaf, bytes, bytes - packed, [] {});
+    }
+};
+
+/*!
+ * Returns the empty node `n` of a container type, giving back the reference
+ * that was taken to get it.
+ */
+template <typename Node>
+const void* shared_empty(Node* n)
+{
+    n->dec();
+    return n;
+}
+
+template <typename Impl>
+void skip_rbts_empty(walker& w)
+{
+    w.skip(shared_empty(Impl::empty_root()));
+    w.skip(shared_empty(Impl::empty_tail()));
+}
+
+template <typename Impl>
+void skip_champ_empty(walker& w)
+{
+    w.skip(shared_empty(Impl::empty()));
+}
+
+template <hamts::bits_t B, typename Node>
+void walk_champ(walker& w, const Node* node, hamts::count_t depth)
+{
+    using hash_t = typename Node::hash_t;
+    if (depth < hamts::max_depth<hash_t, B>) {
+        auto nc = node->children_count();
+        w.node(node,
+               node_kind::champ_inner,
+               Node::sizeof_inner_n(nc),
+               0u,
+               [&] {
+                   if (auto values = node->impl.d.data.inner.values)
+                       w.node(values,
+                              node_kind::champ_values,
+                              Node::sizeof_values_n(node->data_count()),
+                              0u,
+                              [] {});
+                   auto children = node->children();
+                   for (auto i = hamts::count_t{}; i < nc; ++i)
+                       walk_champ<B>(w, children[i], depth + 1);
+               });
+    } else {
+        w.node(node,
+               node_kind::collision,
+               Node::sizeof_collision_n(node->collision_count()),
+               0u,
+               [] {});
+    }
+}
+
+template <typename T, typename MP, rbts::bits_t B, rbts::bits_t BL>
+void walk(walker& w, const vector<T, MP, B, BL>& v)
+{
+    skip_rbts_empty<std::decay_t<decltype(v.impl())>>(w);
+    v.impl().traverse(rbts_visitor{}, w);
+}
+
+template <typename T, typename MP, rbts::bits_t B, rbts::bits_t BL>
+void walk(walker& w, const flex_vector<T, MP, B, BL>& v)
+{
+    skip_rbts_empty<std::decay_t<decltype(v.impl())>>(w);
+    v.impl().traverse(rbts_visitor{}, w);
+}
+
+template <typename T, typename MP>
+void walk(walker& w, const array<T, MP>& a)
+{
+    using impl_t = std::decay_t<decltype(a.impl())>;
+    using node_t = typename impl_t::node_t;
+    w.skip(impl_t::empty().ptr);
+    w.node(a.impl().ptr,
+           node_kind::array,
+           node_t::sizeof_n(a.impl().size),
+           0u,
+           [] {});
+}
+
+template <typename K,
+          typename T,
+          typename Hash,
+          typename Equal,
+          typename MP,
+          hamts::bits_t B>
+void walk(walker& w, const map<K, T, Hash, Equal, MP, B>& m)
+{
+    skip_champ_empty<std::decay_t<decltype(m.impl())>>(w);
+    walk_champ<B>(w, m.impl().root, 0);
+}
+
+template <typename T,
+          typename Hash,
+          typename Equal,
+          typename MP,
+          hamts::bits_t B>
+void walk(walker& w, const set<T, Hash, Equal, MP, B>& s)
+{
+    skip_champ_empty<std::decay_t<decltype(s.impl())>>(w);
+    walk_champ<B>(w, s.impl().root, 0);
+}
+
+template <typename T,
+          typename KeyFn,
+          typename Hash,
+          typename Equal,
+          typename MP,
+          hamts::bits_t B>
+void walk(walker& w, const table<T, KeyFn, Hash, Equal, MP, B>& t)
+{
+    skip_champ_empty<std::decay_t<decltype(t.impl())>>(w);
+    walk_champ<B>(w, t.impl().root, 0);
+}
+
+template <typename T, typename MP>
+void walk(walker& w, const box<T, MP>& b)
+{
+    w.node(b.impl(), node_kind::box, sizeof(*b.impl()), 0u, [] {});
+}
+
+template <typename T, typename = void>
+struct is_walkable : std::false_type
+{};
+
+template <typename T>
+struct is_walkable<T,
+                   decltype(walk(std::declval<walker&>(),
+                                 std::declval<const T&>()))> : std::true_type
+{};
+
+} // namespace footprint
+} // namespace detail
+
+/*!
+ * Returns the memory used by the containers in `[first, last)`, which may be
+ * `vector`, `flex_vector`, `array`, `map`, `set`, `table` or `box`, all of
+ * the same type.  The nodes that several of them share are only accounted
+ * once.
+ *
+ * @rst
+ *
+ * This is useful to decide which versions of a history are worth keeping.
+ * The ``exclusive_bytes`` of a version is the memory that releasing it
+ * would free, and it is usually much smaller than its own size:
+ *
+ * .. code-block:: c++
+ *
+ *    auto history = std::vector<immer::map<std::string, int>>{...};
+ *    auto usage   = immer::memory_usage(history);
+ *    for (auto i = 0u; i < history.size(); ++i)
+ *        std::cout << i << ": " << usage.exclusive_bytes[i] << "\n";
+ *
+ * @endrst
+ *
+ * Walking the containers takes time proportional to the number of distinct
+ * nodes, and memory to keep track of them.
+ */
+template <typename Iter>
+memory_footprint memory_usage(Iter first, Iter last)
+{
+    auto w = detail::footprint::walker{};
+    for (; first != last; ++first) {
+        w.next_container();
+        walk(w, *first);
+        w.end_container();
+    }
+    return std::move(w.result);
+}
+
+/*!
+ * Returns the memory used by the container `c`.  @see memory_footprint
+ */
+template <typename Container>
+std::enable_if_t<detail::footprint::is_walkable<Container>::value,
+                 memory_footprint>
+memory_usage(const Container& c)
+{
+    return memory_usage(&c, &c + 1);
+}
+
+/*!
+ * Returns the memory used by the containers in the range `r`, like
+ * `memory_usage(std::begin(r), std::end(r))`.
+ */
+template <typename Range>
+std::enable_if_t<!detail::footprint::is_walkable<Range>::value,
+                 memory_footprint>
+memory_usage(const Range& r)
+{
+    using std::begin;
+    using std::end;
+    return memory_usage(begin(r), end(r));
+}
+
+/** @} */ // group: memory-usage
+
+} // namespace immer
@@ -0,0 +1,274 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/config.hpp>
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+
+namespace immer {
+
+/**
+ * @defgroup node-stats
+ * @{
+ */
+
+/*!
+ * Whether the node level instrumentation has been compiled in.  It is
+ * controlled by the `IMMER_ENABLE_NODE_STATS` macro, and it is disabled by
+ * default.
+ */
+constexpr bool node_stats_enabled = IMMER_ENABLE_NODE_STATS;
+
+/*!
+ * The kinds of nodes that are accounted separately in @ref node_stats and
+ * @ref memory_footprint.
+ */
+enum class node_kind
+{
+    inner,        //!< Inner node of a vector (regular).
+    relaxed,      //!< Inner node of a flex_vector with a size table.
+    leaf,         //!< Leaf node of a vector or flex_vector.
+    champ_inner,  //!< Inner node of a map, set or table.
+    champ_values, //!< Values array of an inner node of a map, set or table.
+    collision,    //!< Hash collision node of a map, set or table.
+    array,        //!< Buffer of an array.
+    box,          //!< Holder of a box, only accounted by `memory_usage()`.
+};
+
+constexpr std::size_t node_kind_count = 8;
+
+/*!
+ * Snapshot of the node level counters.
+ */
+struct node_stats
+{
+    /*!
+     * Size of the `path_copies` histogram.  Operations that allocate
+     * `path_copy_buckets - 1` nodes or more are all accounted in its last
+     * bucket.
+     */
+    static constexpr std::size_t path_copy_buckets = 32;
+
+    struct kind_stats
+    {
+        std::size_t allocated = {};
+        std::size_t freed     = {};
+
+        std::size_t live() const { return allocated - freed; }
+    };
+
+    /*! Allocations and frees, indexed by @ref node_kind. */
+    std::array<kind_stats, node_kind_count> kinds = {};
+
+    /*!
+     * Number of persistent updates performed on vectors, flex_vectors, maps,
+     * sets and tables, that is, operations on l-values that return a new
+     * version of the container.
+     */
+    std::size_t operations = {};
+
+    /*!
+     * Histogram of the number of nodes allocated by each of the persistent
+     * updates.  This is the length of the path that has been copied.
+     */
+    std::array<std::size_t, path_copy_buckets> path_copies = {};
+
+    /*!
+     * Number of times that a transient, or an r-value update, could write on
+     * a node in place, because it was already owned by it.
+     */
+    std::size_t transient_owned = {};
+
+    /*!
+     * Number of times that a transient, or an r-value update, had to copy a
+     * node because it was shared.
+     */
+    std::size_t transient_shared = {};
+
+    const kind_stats& operator[](node_kind k) const
+    {
+        return kinds[static_cast<std::size_t>(k)];
+    }
+};
+
+namespace detail {
+namespace stats {
+
+struct storage_t
+{
+    struct kind_t
+    {
+        std::atomic<std::size_t> allocated{0u};
+        std::atomic<std::size_t> freed{0u};
+    };
+
+    kind_t kinds[node_kind_count];
+    std::atomic<std::size_t> operations{0u};
+    std::atomic<std::size_t> path_copies[immer::node_stats::path_copy_buckets];
+    std::atomic<std::size_t> transient_owned{0u};
+    std::atomic<std::size_t> transient_shared{0u};
+
+    storage_t()
+    {
+        for (auto& c : path_copies)
+            c.store(0u, std::memory_order_relaxed);
+    }
+};
+
+inline storage_t& storage()
+{
+    static storage_t storage_;
+    return storage_;
+}
+
+struct operation_t
+{
+    unsigned depth    = 0;
+    std::size_t nodes = 0;
+};
+
+inline operation_t& current_operation()
+{
+    thread_local operation_t op;
+    return op;
+}
+
+inline void allocated(node_kind k)
+{
+    storage()
+        .kinds[static_cast<std::size_t>(k)]
+        .allocated.fetch_add(1u, std::memory_order_relaxed);
+    ++current_operation().nodes;
+}
+
+inline void freed(node_kind k)
+{
+    storage()
+        .kinds[static_cast<std::size_t>(k)]
+        .freed.fetch_add(1u, std::memory_order_relaxed);
+}
+
+inline bool transient(bool owned)
+{
+    auto& s = storage();
+    (owned ? s.transient_owned : s.transient_shared)
+        .fetch_add(1u, std::memory_order_relaxed);
+    return owned;
+}
+
+// Accounts the nodes allocated during its lifetime as the path copy of a
+// single operation.  Operations implemented in terms of other operations
+// only count once.
+struct operation_scope
+{
+    operation_scope()
+    {
+        auto& op = current_operation();
+        if (op.depth++ == 0)
+            op.nodes = 0;
+    }
+
+    ~operation_scope()
+    {
+        auto& op = current_operation();
+        if (--op.depth == 0) {
+            auto& s     = storage();
+            auto bucket = op.nodes < immer::node_stats::path_copy_buckets
+                              ? op.nodes
+                              : immer::node_stats::path_copy_buckets - 1;
+            s.operations.fetch_add(1u, std::memory_order_relaxed);
+            s.path_copies[bucket].fetch_add(1u, std::memory_order_relaxed);
+        }
+    }
+
+    operation_scope(const operation_scope&)            = delete;
+    operation_scope& operator=(const operation_scope&) = delete;
+};
+
+} // namespace stats
+} // namespace detail
+
+/*!
+ * Returns a snapshot of the node level counters, accumulated over all threads.
+ * When `IMMER_ENABLE_NODE_STATS` is not set, all of them are zero.
+ *
+ * @rst
+ *
+ * The instrumentation is compiled in by defining ``IMMER_ENABLE_NODE_STATS``
+ * to ``1``.  Otherwise the hooks expand to nothing and have no cost at all.
+ * Like other configuration macros, it must have the same value in every
+ * translation unit of a program.
+ *
+ * .. code-block:: c++
+ *
+ *    immer::reset_node_stats();
+ *    auto v = immer::vector<int>{};
+ *    for (auto i = 0; i < 1000; ++i)
+ *        v = v.push_back(i);
+ *    auto s = immer::get_node_stats();
+ *    auto leaves = s[immer::node_kind::leaf].allocated;
+ *
+ * @endrst
+ */
+inline node_stats get_node_stats()
+{
+    auto& s = detail::stats::storage();
+    auto r  = node_stats{};
+    for (auto i = std::size_t{}; i < node_kind_count; ++i) {
+        r.kinds[i].allocated =
+            s.kinds[i].allocated.load(std::memory_order_relaxed);
+        r.kinds[i].freed = s.kinds[i].freed.load(std::memory_order_relaxed);
+    }
+    r.operations = s.operations.load(std::memory_order_relaxed);
+    for (auto i = std::size_t{}; i < node_stats::path_copy_buckets; ++i)
+        r.path_copies[i] = s.path_copies[i].load(std::memory_order_relaxed);
+    r.transient_owned  = s.transient_owned.load(std::memory_order_relaxed);
+    r.transient_shared = s.transient_shared.load(std::memory_order_relaxed);
+    return r;
+}
+
+/*!
+ * Sets all the node level counters back to zero.
+ */
+inline void reset_node_stats()
+{
+    auto& s = detail::stats::storage();
+    for (auto& k : s.kinds) {
+        k.allocated.store(0u, std::memory_order_relaxed);
+        k.freed.store(0u, std::memory_order_relaxed);
+    }
+    s.operations.store(0u, std::memory_order_relaxed);
+    for (auto& c : s.path_copies)
+        c.store(0u, std::memory_order_relaxed);
+    s.transient_owned.store(0u, std::memory_order_relaxed);
+    s.transient_shared.store(0u, std::memory_order_relaxed);
+}
+
+/** @} */ // group: node-stats
+
+} // namespace immer
+
+#if IMMER_ENABLE_NODE_STATS
+#define IMMER_NODE_STATS_ALLOCATED(kind_)                                      \
+    ::immer::detail::stats::allocated(::immer::node_kind::kind_)
+#define IMMER_NODE_STATS_FREED(kind_)                                          \
+    ::immer::detail::stats::freed(::immer::node_kind::kind_)
+#define IMMER_NODE_STATS_TRANSIENT(...)                                        \
+    ::immer::detail::stats::transient(__VA_ARGS__)
+#define IMMER_NODE_STATS_OPERATION()                                           \
+    ::immer::detail::stats::operation_scope immer_node_stats_op_
+#else
+#define IMMER_NODE_STATS_ALLOCATED(kind_)
+#define IMMER_NODE_STATS_FREED(kind_)
+#define IMMER_NODE_STATS_TRANSIENT(...) (__VA_ARGS__)
+#define IMMER_NODE_STATS_OPERATION()
+#endif
@@ -0,0 +1,114 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <type_traits>
+#include <utility>
+
+namespace immer {
+
+/**
+ * @defgroup pinning
+ * @{
+ */
+
+template <typename Container>
+class pinned;
+
+template <typename Container>
+pinned<std::decay_t<Container>> pin(Container&& c);
+
+template <typename Container>
+void unpin(pinned<Container> p);
+
+/*!
+ * A handle to a container, or a `box`, that was pinned with `pin()`.
+ * Copying or destroying a handle never touches any reference count, and the
+ * container it refers to stays alive until the handle is passed to
+ * `unpin()`.
+ *
+ * @rst
+ *
+ * The handle only gives ``const`` access to the container.  Reading through
+ * it is free, while taking a copy of the container out of it, or deriving a
+ * new version from it, counts references as usual.  Those copies and
+ * versions are independent of the pin and can outlive it.
+ *
+ * @endrst
+ */
+template <typename Container>
+class pinned
+{
+public:
+    using container_type = Container;
+
+    const container_type& get() const { return *ptr_; }
+    const container_type& operator*() const { return *ptr_; }
+    const container_type* operator->() const { return ptr_; }
+
+private:
+    explicit pinned(const container_type* ptr)
+        : ptr_{ptr}
+    {
+    }
+
+    template <typename C>
+    friend pinned<std::decay_t<C>> pin(C&& c);
+
+    template <typename C>
+    friend void unpin(pinned<C> p);
+
+    const container_type* ptr_;
+};
+
+/*!
+ * Pins the container `c`, returning a `pinned` handle to it that can be
+ * copied without touching its reference counts.  It works with any container
+ * and `box`.
+ *
+ * @rst
+ *
+ * This is useful for snapshots that live for the whole duration of the
+ * program, or until some explicit *epoch* ends, and that are passed around a
+ * lot, for example, between many threads.  In a read-mostly workload, most
+ * of the reference counting traffic happens on the root nodes of the
+ * containers, which all the readers of a snapshot write to.  Readers that
+ * take a copy of the handle instead do not write to memory shared with the
+ * others at all.
+ *
+ * The pin holds one reference to the container, which is released by
+ * ``unpin()``.  A container can be pinned many times, and each pin is
+ * released independently.
+ *
+ * .. warning:: The copies of a handle are not counted.  All of them must be
+ *    gone, or at least not used anymore, before the pin is released.
+ *
+ * @endrst
+ */
+template <typename Container>
+pinned<std::decay_t<Container>> pin(Container&& c)
+{
+    using container_t = std::decay_t<Container>;
+    return pinned<container_t>{new container_t(std::forward<Container>(c))};
+}
+
+/*!
+ * Releases the pin behind the handle `p` and its copies, which must not be
+ * used anymore.  The memory of the container is reclaimed normally once no
+ * other copy of it, or version sharing its nodes, is alive.
+ */
+template <typename Container>
+void unpin(pinned<Container> p)
+{
+    delete p.ptr_;
+}
+
+/** @} */ // group: pinning
+
+} // namespace immer
@@ -33,6 +33,21 @@ struct refcount_policy
 
     void inc() { refcount.fetch_add(1, std::memory_order_relaxed); }
 
+    /*!
+     * Increments the count unless it already dropped to zero, in which case
+     * the object is being destroyed and it returns false.
+     */
+    bool try_inc()
+    {
+        auto c = refcount.load(std::memory_order_relaxed);
+        do {
+            if (c == 0)
+                return false;
+        } while (!refcount.compare_exchange_weak(
+            c, c + 1, std::memory_order_relaxed));
+        return true;
+    }
+
     bool dec() { return 1 == refcount.fetch_sub(1, std::memory_order_acq_rel); }
 
     bool unique() { return refcount == 1; }
@@ -31,6 +31,13 @@ struct unsafe_refcount_policy
     }
 
     void inc() { ++refcount; }
+    bool try_inc()
+    {
+        if (refcount == 0)
+            return false;
+        inc();
+        return true;
+    }
     bool dec() { return --refcount == 0; }
     bool unique() { return refcount == 1; }
 };
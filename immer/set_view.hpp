@@ -0,0 +1,155 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/set.hpp>
+
+namespace immer {
+
+/*!
+ * Non-owning, read-only view of a @ref set.
+ *
+ * @rst
+ *
+ * Copying a ``set`` increments the reference count of its root, which is an
+ * atomic operation on memory shared by every thread holding a copy of it.  A
+ * view instead just *borrows* the set, so it can be copied around, for
+ * example into the closures of many worker threads, without touching any
+ * reference count at all.  It provides the whole read API of the set, and an
+ * owning set can be obtained with ``get()`` when a copy needs to outlive the
+ * borrowed one.
+ *
+ * .. warning:: The view borrows the set object itself, not its data, so
+ *    it is only valid as long as that object is alive and it is not
+ *    assigned to nor moved from.  A view can not be created from a
+ *    temporary set.
+ *
+ * @endrst
+ */
+template <typename T,
+          typename Hash           = std::hash<T>,
+          typename Equal          = std::equal_to<T>,
+          typename MemoryPolicy   = default_memory_policy,
+          detail::hamts::bits_t B = default_bits>
+class set_view
+{
+public:
+    using container_type = set<T, Hash, Equal, MemoryPolicy, B>;
+
+    using value_type         = typename container_type::value_type;
+    using size_type          = typename container_type::size_type;
+    using difference_type    = typename container_type::difference_type;
+    using hasher             = typename container_type::hasher;
+    using key_equal          = typename container_type::key_equal;
+    using reference          = typename container_type::reference;
+    using const_reference    = typename container_type::const_reference;
+    using iterator           = typename container_type::iterator;
+    using const_iterator     = typename container_type::const_iterator;
+    using memory_policy_type = MemoryPolicy;
+
+    /*!
+     * Creates a view borrowing the set `s`.  It does not allocate memory nor
+     * touch any reference count.
+     */
+    explicit set_view(const container_type& s)
+        : s_{&s}
+    {
+    }
+
+    set_view(container_type&&) = delete;
+
+    /*!
+     * Returns the borrowed set.  Copying it results in a set that owns its
+     * data again.
+     */
+    IMMER_NODISCARD const container_type& get() const { return *s_; }
+
+    /*! Conversion to the borrowed set. */
+    operator const container_type&() const { return get(); }
+
+    /*! @see set::begin */
+    IMMER_NODISCARD iterator begin() const { return s_->begin(); }
+
+    /*! @see set::end */
+    IMMER_NODISCARD iterator end() const { return s_->end(); }
+
+    /*! @see set::size */
+    IMMER_NODISCARD size_type size() const { return s_->size(); }
+
+    /*! @see set::empty */
+    IMMER_NODISCARD bool empty() const { return s_->empty(); }
+
+    /*! @see set::count */
+    template <typename K,
+              typename U = Hash,
+              typename   = typename U::is_transparent>
+    IMMER_NODISCARD size_type count(const K& value) const
+    {
+        return s_->count(value);
+    }
+    IMMER_NODISCARD size_type count(const T& value) const
+    {
+        return s_->count(value);
+    }
+
+    /*! @see set::find */
+    template <typename K,
+              typename U = Hash,
+              typename   = typename U::is_transparent>
+    IMMER_NODISCARD const T* find(const K& value) const
+    {
+        return s_->find(value);
+    }
+    IMMER_NODISCARD const T* find(const T& value) const
+    {
+        return s_->find(value);
+    }
+
+    /*! Returns whether the viewed sets are equal. */
+    IMMER_NODISCARD bool operator==(const set_view& other) const
+    {
+        return *s_ == *other.s_;
+    }
+    IMMER_NODISCARD bool operator!=(const set_view& other) const
+    {
+        return !(*this == other);
+    }
+
+    /*! @see set::identity */
+    void* identity() const { return s_->identity(); }
+
+    // Semi-private
+    const auto& impl() const { return s_->impl(); }
+
+private:
+    const container_type* s_;
+};
+
+/*!
+ * Returns a @ref set_view borrowing `s`.
+ */
+template <typename T,
+          typename Hash,
+          typename Equal,
+          typename MemoryPolicy,
+          detail::hamts::bits_t B>
+set_view<T, Hash, Equal, MemoryPolicy, B>
+view(const set<T, Hash, Equal, MemoryPolicy, B>& s)
+{
+    return set_view<T, Hash, Equal, MemoryPolicy, B>{s};
+}
+
+template <typename T,
+          typename Hash,
+          typename Equal,
+          typename MemoryPolicy,
+          detail::hamts::bits_t B>
+void view(set<T, Hash, Equal, MemoryPolicy, B>&&) = delete;
+
+} // namespace immer
@@ -0,0 +1,147 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#pragma once
+
+#include <immer/vector.hpp>
+
+namespace immer {
+
+/*!
+ * Non-owning, read-only view of a @ref vector.
+ *
+ * @rst
+ *
+ * Copying a ``vector`` increments the reference count of its root and tail,
+ * which is an atomic operation on memory shared by every thread holding a
+ * copy of it.  A view instead just *borrows* the vector, so it can be copied
+ * around, for example into the closures of many worker threads, without
+ * touching any reference count at all.  It provides the whole read API of
+ * the vector, and an owning vector can be obtained with ``get()`` when a
+ * copy needs to outlive the borrowed one.
+ *
+ * .. warning:: The view borrows the vector object itself, not its data, so
+ *    it is only valid as long as that object is alive and it is not
+ *    assigned to nor moved from.  A view can not be created from a
+ *    temporary vector.
+ *
+ * @endrst
+ */
+template <typename T,
+          typename MemoryPolicy  = default_memory_policy,
+          detail::rbts::bits_t B = default_bits,
+          detail::rbts::bits_t BL =
+              detail::rbts::derive_bits_leaf<T, MemoryPolicy, B>>
+class vector_view
+{
+public:
+    using container_type = vector<T, MemoryPolicy, B, BL>;
+
+    using memory_policy    = MemoryPolicy;
+    using value_type       = typename container_type::value_type;
+    using reference        = typename container_type::reference;
+    using size_type        = typename container_type::size_type;
+    using difference_type  = typename container_type::difference_type;
+    using const_reference  = typename container_type::const_reference;
+    using iterator         = typename container_type::iterator;
+    using const_iterator   = typename container_type::const_iterator;
+    using reverse_iterator = typename container_type::reverse_iterator;
+
+    /*!
+     * Creates a view borrowing the vector `v`.  It does not allocate memory
+     * nor touch any reference count.
+     */
+    explicit vector_view(const container_type& v)
+        : v_{&v}
+    {
+    }
+
+    vector_view(container_type&&) = delete;
+
+    /*!
+     * Returns the borrowed vector.  Copying it results in a vector that
+     * owns its data again.
+     */
+    IMMER_NODISCARD const container_type& get() const { return *v_; }
+
+    /*! Conversion to the borrowed vector. */
+    operator const container_type&() const { return get(); }
+
+    /*! @see vector::begin */
+    IMMER_NODISCARD iterator begin() const { return v_->begin(); }
+
+    /*! @see vector::end */
+    IMMER_NODISCARD iterator end() const { return v_->end(); }
+
+    /*! @see vector::rbegin */
+    IMMER_NODISCARD reverse_iterator rbegin() const { return v_->rbegin(); }
+
+    /*! @see vector::rend */
+    IMMER_NODISCARD reverse_iterator rend() const { return v_->rend(); }
+
+    /*! @see vector::size */
+    IMMER_NODISCARD size_type size() const { return v_->size(); }
+
+    /*! @see vector::empty */
+    IMMER_NODISCARD bool empty() const { return v_->empty(); }
+
+    /*! @see vector::back */
+    IMMER_NODISCARD const T& back() const { return v_->back(); }
+
+    /*! @see vector::front */
+    IMMER_NODISCARD const T& front() const { return v_->front(); }
+
+    /*! @see vector::operator[] */
+    IMMER_NODISCARD reference operator[](size_type index) const
+    {
+        return (*v_)[index];
+    }
+
+    /*! @see vector::at */
+    reference at(size_type index) const { return v_->at(index); }
+
+    /*! Returns whether the viewed vectors are equal. */
+    IMMER_NODISCARD bool operator==(const vector_view& other) const
+    {
+        return *v_ == *other.v_;
+    }
+    IMMER_NODISCARD bool operator!=(const vector_view& other) const
+    {
+        return !(*this == other);
+    }
+
+    /*! @see vector::identity */
+    std::pair<void*, void*> identity() const { return v_->identity(); }
+
+    // Semi-private
+    const auto& impl() const { return v_->impl(); }
+
+private:
+    const container_type* v_;
+};
+
+/*!
+ * Returns a @ref vector_view borrowing `v`.
+ */
+template <typename T,
+          typename MemoryPolicy,
+          detail::rbts::bits_t B,
+          detail::rbts::bits_t BL>
+vector_view<T, MemoryPolicy, B, BL>
+view(const vector<T, MemoryPolicy, B, BL>& v)
+{
+    return vector_view<T, MemoryPolicy, B, BL>{v};
+}
+
+template <typename T,
+          typename MemoryPolicy,
+          detail::rbts::bits_t B,
+          detail::rbts::bits_t BL>
+void view(vector<T, MemoryPolicy, B, BL>&&) = delete;
+
+} // namespace immer
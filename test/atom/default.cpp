@@ -8,5 +8,10 @@
 
 #include <immer/atom.hpp>
 
+template <typename T>
+using combining_atom_t =
+    immer::atom<T, immer::default_memory_policy, immer::flat_combining_policy>;
+
 #define ATOM_T ::immer::atom
+#define COMBINING_ATOM_T combining_atom_t
 #include "generic.ipp"
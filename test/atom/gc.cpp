@@ -17,5 +17,11 @@ using gc_memory = immer::memory_policy<immer::heap_policy<immer::gc_heap>,
 template <typename T>
 using test_atom_t = immer::atom<T, gc_memory>;
 
+template <typename T>
+using test_combining_atom_t =
+    immer::atom<T, gc_memory, immer::flat_combining_policy>;
+
 #define ATOM_T test_atom_t
+#define COMBINING_ATOM_T test_combining_atom_t
+#define ATOM_CONCURRENT_TESTS 0
 #include "generic.ipp"
@@ -10,8 +10,16 @@
 #error "define the box template to use in ATOM_T"
 #endif
 
+#ifndef COMBINING_ATOM_T
+#error "define the combining atom template to use in COMBINING_ATOM_T"
+#endif
+
 #include <catch2/catch_test_macros.hpp>
 
+#include <atomic>
+#include <thread>
+#include <vector>
+
 template <typename T>
 using BOX_T = typename ATOM_T<T>::box_type;
 
@@ -51,3 +59,95 @@ TEST_CASE("update")
     x.update([](auto x) { return x + 2; });
     CHECK(x.load() == 44);
 }
+
+// The concurrent tests need a thread safe memory policy, and threads that
+// the heap knows about, so the GC instantiation disables them: its threads
+// would not be registered with the collector.
+#ifndef ATOM_CONCURRENT_TESTS
+#define ATOM_CONCURRENT_TESTS !IMMER_NO_THREAD_SAFETY
+#endif
+
+#if ATOM_CONCURRENT_TESTS
+
+TEST_CASE("concurrent load and update")
+{
+    constexpr auto num_threads = 4;
+    constexpr auto num_ops     = 1000;
+
+    // Every thread must see the value grow, and its own updates must land
+    // on top of what it loaded before.
+    ATOM_T<int> x{0};
+    std::atomic<int> unordered{0};
+    auto threads = std::vector<std::thread>{};
+    for (auto i = 0; i < num_threads; ++i) {
+        threads.emplace_back([&] {
+            for (auto j = 0; j < num_ops; ++j) {
+                auto v = x.load();
+                auto w = x.update([](auto x) { return x + 1; });
+                if (*w <= *v)
+                    ++unordered;
+            }
+        });
+    }
+    threads.emplace_back([&] {
+        auto last = 0;
+        for (auto j = 0; j < num_ops; ++j) {
+            auto v = x.load();
+            if (*v < last)
+                ++unordered;
+            last = *v;
+        }
+    });
+    for (auto& t : threads)
+        t.join();
+    CHECK(unordered == 0);
+    CHECK(x.load() == num_threads * num_ops);
+}
+
+#endif // ATOM_CONCURRENT_TESTS
+
+TEST_CASE("update combining")
+{
+    COMBINING_ATOM_T<int> x{42};
+    auto r = x.update_combining([](auto x) { return x + 2; });
+    CHECK(r == 44);
+    CHECK(x.load() == 44);
+}
+
+TEST_CASE("update combining exception")
+{
+    COMBINING_ATOM_T<int> x{42};
+    CHECK_THROWS_AS(x.update_combining([](int) -> int { throw 12; }), int);
+    CHECK(x.load() == 42);
+}
+
+#if ATOM_CONCURRENT_TESTS
+
+TEST_CASE("concurrent update combining")
+{
+    constexpr auto num_threads = 4;
+    constexpr auto num_ops     = 1000;
+
+    COMBINING_ATOM_T<int> x{0};
+    std::atomic<int> unordered{0};
+    auto threads = std::vector<std::thread>{};
+    for (auto i = 0; i < num_threads; ++i) {
+        threads.emplace_back([&] {
+            auto last = 0;
+            for (auto j = 0; j < num_ops; ++j) {
+                auto v = x.update_combining([](auto x) { return x + 1; });
+                if (*v <= last)
+                    ++unordered;
+                last = *v;
+                if (j % 10 == 0)
+                    x.update([](auto x) { return x + 1; });
+            }
+        });
+    }
+    for (auto& t : threads)
+        t.join();
+    CHECK(unordered == 0);
+    CHECK(x.load() == num_threads * (num_ops + num_ops / 10));
+}
+
+#endif // ATOM_CONCURRENT_TESTS
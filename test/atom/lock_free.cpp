@@ -0,0 +1,66 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#define IMMER_LOCK_FREE_ATOM 1
+
+#include <immer/atom.hpp>
+#include <immer/heap/heap_policy.hpp>
+#include <immer/heap/malloc_heap.hpp>
+#include <immer/heap/stats_heap.hpp>
+
+// The boxes are allocated in a heap that counts them, so the tests can check
+// that every holder that went through the atom is freed.
+using counted_heap   = immer::stats_heap<immer::malloc_heap>;
+using counted_memory = immer::memory_policy<immer::heap_policy<counted_heap>,
+                                            immer::refcount_policy,
+                                            immer::default_lock_policy>;
+
+template <typename T>
+using test_atom_t = immer::atom<T, counted_memory>;
+
+template <typename T>
+using test_combining_atom_t =
+    immer::atom<T, counted_memory, immer::flat_combining_policy>;
+
+#define ATOM_T test_atom_t
+#define COMBINING_ATOM_T test_combining_atom_t
+#include "generic.ipp"
+
+TEST_CASE("concurrent load and update free every holder")
+{
+    constexpr auto num_threads = 4;
+    constexpr auto num_ops     = 1000;
+
+    auto live = counted_heap::stats().live();
+    {
+        test_atom_t<int> x{0};
+        std::atomic<int> unordered{0};
+        auto threads = std::vector<std::thread>{};
+        for (auto i = 0; i < num_threads; ++i) {
+            threads.emplace_back([&] {
+                for (auto j = 0; j < num_ops; ++j) {
+                    auto v = x.load();
+                    auto w = x.update([](auto x) { return x + 1; });
+                    if (*w <= *v)
+                        ++unordered;
+                }
+            });
+        }
+        for (auto& t : threads)
+            t.join();
+        CHECK(unordered == 0);
+        CHECK(x.load() == num_threads * num_ops);
+        CHECK(counted_heap::stats().live() == live + 1);
+
+        x.store(0);
+        auto old = x.exchange(1);
+        CHECK(*old == 0);
+        CHECK(counted_heap::stats().live() == live + 2);
+    }
+    CHECK(counted_heap::stats().live() == live);
+}
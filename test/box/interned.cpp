@@ -0,0 +1,137 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/interned_box.hpp>
+#include <immer/map.hpp>
+#include <immer/set.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+struct counted
+{
+    static int alive;
+
+    int value;
+
+    counted(int v)
+        : value{v}
+    {
+        ++alive;
+    }
+    counted(const counted& other)
+        : value{other.value}
+    {
+        ++alive;
+    }
+    ~counted() { --alive; }
+
+    bool operator==(const counted& other) const
+    {
+        return value == other.value;
+    }
+};
+
+int counted::alive = 0;
+
+struct counted_hash
+{
+    std::size_t operator()(const counted& x) const { return x.value % 3; }
+};
+
+} // namespace
+
+TEST_CASE("equal values share the box")
+{
+    using box_t = immer::interned_box<std::string>;
+    auto x      = box_t{"foo"};
+    auto y      = box_t{std::string{"foo"}};
+    auto z      = box_t{"bar"};
+    CHECK(x == y);
+    CHECK(x != z);
+    CHECK(&x.get() == &y.get());
+    CHECK(x.get() == "foo");
+    CHECK(x.hash() == std::hash<std::string>{}("foo"));
+    CHECK(std::hash<box_t>{}(x) == x.hash());
+    CHECK(z < x);
+    CHECK(!(x < y));
+    CHECK(box_t{} == box_t{std::string{}});
+}
+
+TEST_CASE("update makes an interned box")
+{
+    using box_t = immer::interned_box<std::string>;
+    auto x      = box_t{"foo"};
+    auto y      = x.update([](auto s) { return s + "bar"; });
+    CHECK(x.get() == "foo");
+    CHECK(y == box_t{"foobar"});
+}
+
+TEST_CASE("values are released with the last box")
+{
+    using box_t = immer::interned_box<counted,
+                                      immer::default_memory_policy,
+                                      counted_hash>;
+    {
+        auto x = box_t{1};
+        auto y = box_t{4};
+        auto z = box_t{1};
+        CHECK(counted::alive == 2);
+        CHECK(x == z);
+        CHECK(x != y);
+        x = y;
+        CHECK(counted::alive == 2);
+        z = y;
+        CHECK(counted::alive == 1);
+        auto w = box_t{1};
+        CHECK(counted::alive == 2);
+        CHECK(w.get().value == 1);
+    }
+    CHECK(counted::alive == 0);
+}
+
+TEST_CASE("interned boxes as keys")
+{
+    using box_t = immer::interned_box<std::string>;
+    auto m      = immer::map<box_t, int>{};
+    auto s      = immer::set<box_t>{};
+    for (auto i = 0; i < 100; ++i) {
+        m = m.set(box_t{std::to_string(i)}, i);
+        s = s.insert(box_t{std::to_string(i % 10)});
+    }
+    CHECK(m.size() == 100);
+    CHECK(m[box_t{"42"}] == 42);
+    CHECK(s.size() == 10);
+    CHECK(s.count(box_t{"7"}) == 1);
+    CHECK(s.count(box_t{"77"}) == 0);
+}
+
+TEST_CASE("interning from several threads")
+{
+    using box_t  = immer::interned_box<std::string>;
+    auto threads = std::vector<std::thread>{};
+    auto results = std::vector<std::vector<box_t>>(4);
+    for (auto t = 0u; t < results.size(); ++t)
+        threads.emplace_back([&results, t] {
+            for (auto i = 0; i < 1000; ++i) {
+                auto b = box_t{std::to_string(i % 50)};
+                if (i % 3 == 0)
+                    results[t].push_back(b);
+            }
+        });
+    for (auto& t : threads)
+        t.join();
+    for (auto& r : results)
+        for (auto i = 0u; i < r.size(); ++i)
+            CHECK(r[i] == results[0][i]);
+}
@@ -0,0 +1,671 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include <immer/extra/persist/binary/buffer.hpp>
+#include <immer/extra/persist/binary/load.hpp>
+#include <immer/extra/persist/binary/save.hpp>
+
+#include <immer/flex_vector.hpp>
+#include <immer/map.hpp>
+#include <immer/set.hpp>
+#include <immer/table.hpp>
+#include <immer/vector.hpp>
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <numeric>
+#include <sstream>
+
+namespace {
+
+namespace binary = immer::persist::binary;
+using immer::persist::container_id;
+
+template <class T>
+auto gen(T init, int count)
+{
+    for (int i = 0; i < count; ++i) {
+        init = std::move(init).push_back(i);
+    }
+    return init;
+}
+
+template <class Container>
+binary::buffer save_all(const std::vector<Container>& containers)
+{
+    auto os = std::ostringstream{};
+    auto w  = binary::writer<Container>{os};
+    for (const auto& c : containers)
+        w.add(c);
+    w.finish();
+    return binary::buffer{std::string_view{os.str()}};
+}
+
+template <class Container>
+std::string save_bytes(const std::vector<Container>& containers)
+{
+    auto os = std::ostringstream{};
+    auto w  = binary::writer<Container>{os};
+    for (const auto& c : containers)
+        w.add(c);
+    w.finish();
+    return os.str();
+}
+
+template <class Container>
+binary::buffer save_one(const Container& container)
+{
+    auto os = std::ostringstream{};
+    binary::save(os, container);
+    return binary::buffer{std::string_view{os.str()}};
+}
+
+struct entry_t
+{
+    std::int64_t id;
+    double value;
+
+    int table_key() const { return id; }
+
+    friend bool operator==(const entry_t& a, const entry_t& b)
+    {
+        return a.id == b.id && a.value == b.value;
+    }
+};
+
+struct constant_hash
+{
+    std::uint64_t operator()(std::string_view) const { return 42; }
+};
+
+struct broken_hash
+{
+    std::size_t operator()(int x) const { return x / 2; }
+};
+
+struct other_hash
+{
+    std::size_t operator()(std::int64_t x) const
+    {
+        return std::hash<std::int64_t>{}(x) + 1;
+    }
+};
+
+struct padded_t
+{
+    char tag;
+    int value;
+};
+
+struct opted_in_t
+{
+    char tag;
+    int value;
+
+    friend bool operator==(const opted_in_t& a, const opted_in_t& b)
+    {
+        return a.tag == b.tag && a.value == b.value;
+    }
+};
+
+} // namespace
+
+// Aggregates with floating point members, or with padding, are only stored
+// when they opt in.
+namespace immer::persist::binary {
+
+template <>
+struct is_bitwise_serializable<entry_t> : std::true_type
+{};
+
+template <>
+struct is_bitwise_serializable<opted_in_t> : std::true_type
+{};
+
+} // namespace immer::persist::binary
+
+TEST_CASE("Save and load vectors")
+{
+    using vector_t = immer::vector<int>;
+    const auto vectors =
+        std::vector<vector_t>{vector_t{},
+                              gen(vector_t{}, 1),
+                              gen(vector_t{}, 33),
+                              gen(vector_t{}, 1000),
+                              gen(vector_t{}, 20000)};
+    const auto buf = save_all(vectors);
+
+    SECTION("loaded")
+    {
+        auto loader = binary::loader<vector_t>{buf.bytes()};
+        REQUIRE(loader.size() == vectors.size());
+        for (auto i = std::size_t{}; i < vectors.size(); ++i) {
+            CHECK(loader.load(container_id{i}) == vectors[i]);
+        }
+        CHECK_THROWS_AS(loader.load(container_id{vectors.size()}),
+                        immer::persist::invalid_container_id);
+    }
+
+    SECTION("in place")
+    {
+        auto reader = binary::reader<vector_t>{buf.bytes()};
+        for (auto i = std::size_t{}; i < vectors.size(); ++i) {
+            const auto& v = vectors[i];
+            REQUIRE(reader.container_size(container_id{i}) == v.size());
+            for (auto j = std::size_t{}; j < v.size(); ++j) {
+                CHECK(reader.get(container_id{i}, j) == v[j]);
+            }
+            auto values = std::vector<int>{};
+            reader.for_each_chunk(container_id{i}, [&](auto first, auto last) {
+                values.insert(values.end(), first, last);
+            });
+            CHECK(values == std::vector<int>(v.begin(), v.end()));
+        }
+        CHECK_THROWS_AS(reader.get(container_id{1}, 1), std::out_of_range);
+    }
+}
+
+TEST_CASE("Nodes are shared")
+{
+    using vector_t = immer::vector<int>;
+    const auto v1  = gen(vector_t{}, 10000);
+    const auto v2  = v1.push_back(42);
+    const auto v3  = v1.set(0, 42);
+
+    const auto alone = save_one(v1);
+    const auto all   = save_all(std::vector<vector_t>{v1, v2, v3});
+    CHECK(all.size() < alone.size() * 3 / 2);
+
+    auto loader  = binary::loader<vector_t>{all.bytes()};
+    auto loaded1 = loader.load(container_id{0});
+    auto loaded2 = loader.load(container_id{1});
+    auto loaded3 = loader.load(container_id{2});
+    CHECK(loaded1 == v1);
+    CHECK(loaded2 == v2);
+    CHECK(loaded3 == v3);
+    CHECK(loaded1.impl().root == loaded2.impl().root);
+    CHECK(loaded1.impl().root != loaded3.impl().root);
+    CHECK(loaded1.impl().root->inner()[1] == loaded3.impl().root->inner()[1]);
+
+    SECTION("clear the cache")
+    {
+        loader.clear_cache();
+        auto reloaded = loader.load(container_id{1});
+        CHECK(reloaded == v2);
+        CHECK(reloaded.impl().root != loaded2.impl().root);
+    }
+}
+
+TEST_CASE("Save and load flex vectors")
+{
+    using vector_t = immer::flex_vector<int>;
+    const auto v1  = gen(vector_t{}, 1000);
+    const auto v2  = v1.drop(7) + v1 + v1.take(100).drop(3);
+    const auto v3  = v2.insert(500, 42).erase(10);
+    const auto buf = save_all(std::vector<vector_t>{v1, v2, v3, vector_t{}});
+
+    auto loader = binary::loader<vector_t>{buf.bytes()};
+    auto reader = binary::reader<vector_t>{buf.bytes()};
+    for (auto v : {0, 1, 2, 3}) {
+        const auto id     = container_id{static_cast<std::size_t>(v)};
+        const auto loaded = loader.load(id);
+        const auto& expected =
+            v == 0 ? v1 : v == 1 ? v2 : v == 2 ? v3 : vector_t{};
+        CHECK(loaded == expected);
+        for (auto i = std::size_t{}; i < expected.size(); ++i) {
+            CHECK(reader.get(id, i) == expected[i]);
+        }
+    }
+
+    SECTION("relaxed nodes can not be loaded into a vector")
+    {
+        using strict_t = immer::vector<int>;
+        auto strict    = binary::loader<strict_t>{buf.bytes()};
+        CHECK(strict.load(container_id{0}) == strict_t{v1.begin(), v1.end()});
+        CHECK_THROWS_AS(strict.load(container_id{1}),
+                        binary::invalid_binary_pool);
+    }
+}
+
+TEST_CASE("Save and load champs")
+{
+    SECTION("map")
+    {
+        using map_t  = immer::map<std::int64_t, double>;
+        auto m1      = map_t{};
+        for (auto i = 0; i < 1000; ++i)
+            m1 = std::move(m1).set(i, i / 2.0);
+        const auto m2  = m1.erase(10).set(2000, 1);
+        const auto buf = save_all(std::vector<map_t>{m1, m2, map_t{}});
+
+        auto loader = binary::loader<map_t>{buf.bytes()};
+        CHECK(loader.load(container_id{0}) == m1);
+        CHECK(loader.load(container_id{1}) == m2);
+        CHECK(loader.load(container_id{2}) == map_t{});
+
+        auto reader = binary::reader<map_t>{buf.bytes()};
+        auto count  = std::size_t{};
+        reader.for_each_chunk(container_id{0}, [&](auto first, auto last) {
+            for (; first != last; ++first) {
+                CHECK(m1[first->first] == first->second);
+                ++count;
+            }
+        });
+        CHECK(count == m1.size());
+
+        for (auto i = 0; i < 1000; ++i) {
+            auto found = reader.find(container_id{1}, i);
+            REQUIRE((found != nullptr) == (i != 10));
+            if (found)
+                CHECK(found->second == i / 2.0);
+        }
+        CHECK(reader.find(container_id{1}, 2000)->second == 1);
+        CHECK(reader.find(container_id{1}, 1000) == nullptr);
+        CHECK(reader.find(container_id{2}, 0) == nullptr);
+    }
+
+    SECTION("set with collisions")
+    {
+        using set_t = immer::set<int, broken_hash>;
+        auto s      = set_t{};
+        for (auto i = 0; i < 100; ++i)
+            s = std::move(s).insert(i);
+        const auto buf = save_one(s);
+        CHECK(binary::load<set_t>(buf.bytes()) == s);
+
+        auto reader = binary::reader<set_t>{buf.bytes()};
+        for (auto i = 0; i < 100; ++i)
+            CHECK(*reader.find(container_id{}, i) == i);
+        CHECK(reader.find(container_id{}, 100) == nullptr);
+    }
+
+    SECTION("table")
+    {
+        using table_t = immer::table<entry_t>;
+        auto t        = table_t{};
+        for (auto i = 0; i < 100; ++i)
+            t = std::move(t).insert(entry_t{i, i * 1.5});
+        const auto buf = save_one(t);
+        CHECK(binary::load<table_t>(buf.bytes()) == t);
+
+        auto reader = binary::reader<table_t>{buf.bytes()};
+        CHECK(reader.find(container_id{}, 42)->value == 42 * 1.5);
+        CHECK(reader.find(container_id{}, -1) == nullptr);
+    }
+
+    SECTION("different hash")
+    {
+        auto s = immer::set<int>{};
+        for (auto i = 0; i < 100; ++i)
+            s = std::move(s).insert(i);
+        const auto buf = save_one(s);
+        CHECK_THROWS_AS(
+            (binary::load<immer::set<int, other_hash>>(buf.bytes())),
+            binary::invalid_binary_pool);
+    }
+}
+
+TEST_CASE("Values with padding")
+{
+    static_assert(!binary::is_bitwise_serializable_v<padded_t>);
+    static_assert(!binary::is_bitwise_serializable_v<std::pair<int, double>>);
+    static_assert(!binary::is_bitwise_serializable_v<long double>);
+    static_assert(binary::is_bitwise_serializable_v<double>);
+    static_assert(
+        binary::is_bitwise_serializable_v<std::pair<std::int64_t, double>>);
+    static_assert(binary::is_bitwise_serializable_v<opted_in_t>);
+
+    using vector_t = immer::vector<opted_in_t>;
+    auto v         = vector_t{};
+    for (auto i = 0; i < 100; ++i)
+        v = std::move(v).push_back(opted_in_t{static_cast<char>(i), i});
+    const auto buf = save_one(v);
+    CHECK(binary::load<vector_t>(buf.bytes()) == v);
+}
+
+TEST_CASE("Append versions to a binary pool")
+{
+    using vector_t = immer::vector<int>;
+    auto versions  = std::vector<vector_t>{gen(vector_t{}, 10000)};
+    auto os        = std::ostringstream{};
+    auto w         = binary::writer<vector_t>{os};
+
+    SECTION("every commit is readable")
+    {
+        w.add(versions.back());
+        w.commit();
+        for (auto i = 1; i < 5; ++i) {
+            versions.push_back(versions.back().push_back(i));
+            w.add(versions.back());
+            auto before = os.str().size();
+            w.commit();
+            auto buf    = binary::buffer{std::string_view{os.str()}};
+            auto loader = binary::loader<vector_t>{buf.bytes()};
+            REQUIRE(loader.size() == versions.size());
+            CHECK(loader.load(container_id{std::size_t(i)}) == versions[i]);
+            // Only the tail, the new entry and the footer are appended.
+            CHECK(os.str().size() - before < 512);
+        }
+
+        SECTION("the bytes up to the last commit are readable")
+        {
+            auto committed = os.str().size();
+            w.add(versions.back().push_back(42));
+            CHECK(w.size() == versions.size() + 1);
+            auto buf = binary::buffer{
+                std::string_view{os.str()}.substr(0, committed)};
+            CHECK(binary::reader<vector_t>{buf.bytes()}.size() ==
+                  versions.size());
+        }
+    }
+
+    SECTION("resume")
+    {
+        w.add(versions.back());
+        w.finish();
+        CHECK_THROWS_AS(w.add(versions.back()), std::logic_error);
+        auto first = os.str();
+
+        auto buf   = binary::buffer{std::string_view{first}};
+        auto more  = std::ostringstream{};
+        auto w2    = binary::writer<vector_t>::resume(more, buf.bytes());
+        auto saved = w2.load(container_id{0});
+        CHECK(saved == versions.back());
+        CHECK(w2.size() == 1);
+        CHECK(w2.add(saved.set(0, 42)) == container_id{1});
+        CHECK(w2.add(saved.push_back(42)) == container_id{2});
+        w2.commit();
+        CHECK(more.str().size() < first.size() / 10);
+
+        auto all    = binary::buffer{std::string_view{first + more.str()}};
+        auto loader = binary::loader<vector_t>{all.bytes()};
+        REQUIRE(loader.size() == 3);
+        auto v0 = loader.load(container_id{0});
+        auto v1 = loader.load(container_id{1});
+        auto v2 = loader.load(container_id{2});
+        CHECK(v0 == versions.back());
+        CHECK(v1 == versions.back().set(0, 42));
+        CHECK(v2 == versions.back().push_back(42));
+        CHECK(v0.impl().root->inner()[1] == v1.impl().root->inner()[1]);
+    }
+}
+
+TEST_CASE("Resume a champ binary pool")
+{
+    using map_t = immer::map<std::int64_t, double>;
+    auto m      = map_t{};
+    for (auto i = 0; i < 1000; ++i)
+        m = std::move(m).set(i, i / 2.0);
+    const auto first = save_one(m);
+
+    auto os     = std::ostringstream{};
+    auto w      = binary::writer<map_t>::resume(os, first.bytes());
+    auto loaded = w.load(container_id{0});
+    w.add(loaded.set(5000, 1));
+    w.finish();
+    CHECK(os.str().size() < first.size() / 4);
+
+    auto all = binary::buffer{std::string{first.bytes()} + os.str()};
+    auto loader = binary::loader<map_t>{all.bytes()};
+    CHECK(loader.load(container_id{0}) == m);
+    CHECK(loader.load(container_id{1}) == m.set(5000, 1));
+}
+
+TEST_CASE("Deduplicate nodes by their contents")
+{
+    SECTION("independently built vectors")
+    {
+        using vector_t = immer::flex_vector<int>;
+        const auto v1  = gen(vector_t{}, 10000);
+        const auto v2  = gen(vector_t{}, 10000);
+        const auto v3  = gen(vector_t{}, 5000) + gen(vector_t{}, 5000);
+        REQUIRE(v1.impl().root != v2.impl().root);
+
+        const auto one = save_one(v1);
+        auto os        = std::ostringstream{};
+        auto w         = binary::writer<vector_t>{os};
+        w.deduplicate_contents();
+        w.add(v1);
+        w.add(v2);
+        w.add(v3);
+        w.finish();
+        // The second vector only adds an entry to the table of containers,
+        // the third one shares the leaves of the first half.
+        CHECK(os.str().size() < one.size() * 8 / 5);
+
+        auto buf    = binary::buffer{std::string_view{os.str()}};
+        auto loader = binary::loader<vector_t>{buf.bytes()};
+        auto l1     = loader.load(container_id{0});
+        auto l2     = loader.load(container_id{1});
+        CHECK(l1 == v1);
+        CHECK(l2 == v2);
+        CHECK(loader.load(container_id{2}) == v3);
+        CHECK(l1.impl().root == l2.impl().root);
+    }
+
+    SECTION("independently built maps")
+    {
+        // Values without padding, so that equal values have the same bytes.
+        using map_t = immer::map<int, int>;
+        auto m1     = map_t{};
+        auto m2     = map_t{};
+        for (auto i = 0; i < 1000; ++i) {
+            m1 = std::move(m1).set(i, i * 2);
+            m2 = std::move(m2).set(999 - i, (999 - i) * 2);
+        }
+        const auto one = save_one(m1);
+
+        auto os = std::ostringstream{};
+        auto w  = binary::writer<map_t>{os};
+        w.deduplicate_contents();
+        w.add(m1);
+        w.add(m2);
+        w.add(m2.set(0, 42));
+        w.finish();
+        CHECK(os.str().size() < one.size() * 5 / 4);
+
+        auto buf    = binary::buffer{std::string_view{os.str()}};
+        auto loader = binary::loader<map_t>{buf.bytes()};
+        CHECK(loader.load(container_id{0}) == m1);
+        CHECK(loader.load(container_id{1}) == m2);
+        CHECK(loader.load(container_id{2}) == m2.set(0, 42));
+    }
+
+    SECTION("across saves")
+    {
+        using vector_t = immer::vector<int>;
+        const auto v   = gen(vector_t{}, 10000);
+        const auto first = save_one(v);
+
+        auto os = std::ostringstream{};
+        auto w  = binary::writer<vector_t>::resume(os, first.bytes());
+        w.deduplicate_contents();
+        w.add(gen(vector_t{}, 10000));
+        w.add(gen(vector_t{}, 10001));
+        w.finish();
+        CHECK(os.str().size() < 1024);
+
+        auto all    = binary::buffer{std::string{first.bytes()} + os.str()};
+        auto loader = binary::loader<vector_t>{all.bytes()};
+        CHECK(loader.load(container_id{1}) == v);
+        CHECK(loader.load(container_id{2}) == v.push_back(10000));
+    }
+
+    SECTION("hash collisions do not merge different nodes")
+    {
+        using vector_t = immer::vector<int>;
+        const auto v1  = gen(vector_t{}, 1000);
+        const auto v2  = gen(vector_t{}, 1000).set(500, -1);
+
+        auto os = std::ostringstream{};
+        auto w  = binary::writer<vector_t>{os};
+        w.deduplicate_contents(constant_hash{});
+        w.add(v1);
+        w.add(v2);
+        w.finish();
+
+        auto buf    = binary::buffer{std::string_view{os.str()}};
+        auto loader = binary::loader<vector_t>{buf.bytes()};
+        CHECK(loader.load(container_id{0}) == v1);
+        CHECK(loader.load(container_id{1}) == v2);
+    }
+}
+
+TEST_CASE("Load with several threads")
+{
+    SECTION("flex vector")
+    {
+        using vector_t = immer::flex_vector<int>;
+        const auto v1  = gen(vector_t{}, 100000);
+        const auto v2  = v1.drop(7) + v1.take(50000) + v1;
+        const auto all = std::vector<vector_t>{v1, v2};
+        const auto bytes = save_bytes(all);
+
+        auto buf    = binary::buffer{std::string_view{bytes}};
+        auto loader = binary::loader<vector_t>{buf.bytes()};
+        loader.set_threads(4);
+        CHECK(loader.load(container_id{0}) == v1);
+        CHECK(loader.load(container_id{1}) == v2);
+
+        using strict_t = immer::vector<int>;
+        auto strict    = binary::loader<strict_t>{buf.bytes()};
+        strict.set_threads(4);
+        CHECK_THROWS_AS(strict.load(container_id{1}),
+                        binary::invalid_binary_pool);
+        CHECK(strict.load(container_id{0}) == strict_t{v1.begin(), v1.end()});
+    }
+
+    SECTION("map")
+    {
+        using map_t = immer::map<std::int64_t, double>;
+        auto m1     = map_t{};
+        for (auto i = 0; i < 100000; ++i)
+            m1 = std::move(m1).set(i, i / 2.0);
+        const auto m2    = m1.erase(10).set(200000, 1);
+        const auto all   = std::vector<map_t>{m1, m2};
+        const auto bytes = save_bytes(all);
+
+        auto buf    = binary::buffer{std::string_view{bytes}};
+        auto loader = binary::loader<map_t>{buf.bytes()};
+        loader.set_threads(4);
+        CHECK(loader.load(container_id{0}) == m1);
+        CHECK(loader.load(container_id{1}) == m2);
+
+        auto other = binary::loader<immer::map<int, double, other_hash>>{
+            buf.bytes()};
+        other.set_threads(4);
+        CHECK_THROWS_AS(other.load(container_id{0}),
+                        binary::invalid_binary_pool);
+    }
+
+    SECTION("corrupt pool")
+    {
+        using vector_t = immer::vector<int>;
+        const auto v   = gen(vector_t{}, 100000);
+        const auto bytes = save_bytes(std::vector<vector_t>{v});
+        auto buf         = binary::buffer{std::string_view{bytes}};
+        const auto entry =
+            binary::reader<vector_t>{buf.bytes()}.entry(container_id{});
+        auto root = entry.root;
+        auto tail = entry.tail;
+        // Point the last child of the root to the tail.
+        auto n    = std::uint32_t{};
+        std::memcpy(&n, buf.data() + root + 4, sizeof(n));
+        std::memcpy(buf.data() + root + sizeof(binary::record_header) +
+                        (n - 1) * sizeof(binary::offset_t),
+                    &tail,
+                    sizeof(tail));
+        auto loader = binary::loader<vector_t>{buf.bytes()};
+        loader.set_threads(4);
+        CHECK_THROWS_AS(loader.load(container_id{}),
+                        immer::persist::pool_exception);
+    }
+}
+
+TEST_CASE("Invalid binary pools")
+{
+    using vector_t = immer::vector<int>;
+    const auto v   = gen(vector_t{}, 1000);
+    auto os        = std::ostringstream{};
+    binary::save(os, v);
+    const auto bytes = os.str();
+
+    SECTION("truncated")
+    {
+        auto buf = binary::buffer{std::string_view{bytes}.substr(0, 100)};
+        CHECK_THROWS_AS(binary::load<vector_t>(buf.bytes()),
+                        binary::invalid_binary_pool);
+    }
+
+    SECTION("unfinished")
+    {
+        auto unfinished = std::ostringstream{};
+        auto w          = binary::writer<vector_t>{unfinished};
+        w.add(v);
+        auto buf = binary::buffer{std::string_view{unfinished.str()}};
+        CHECK_THROWS_AS(binary::load<vector_t>(buf.bytes()),
+                        binary::invalid_binary_pool);
+    }
+
+    SECTION("different parameters")
+    {
+        auto buf = binary::buffer{std::string_view{bytes}};
+        CHECK_THROWS_AS(
+            binary::load<immer::vector<long long>>(buf.bytes()),
+            binary::invalid_binary_pool);
+        CHECK_THROWS_AS(
+            (binary::load<immer::vector<int, immer::default_memory_policy, 4>>(
+                buf.bytes())),
+            binary::invalid_binary_pool);
+        CHECK_THROWS_AS(binary::load<immer::set<int>>(buf.bytes()),
+                        binary::invalid_binary_pool);
+    }
+
+    SECTION("misaligned")
+    {
+        auto buf = binary::buffer{bytes.size() + 1};
+        std::memcpy(buf.data() + 1, bytes.data(), bytes.size());
+        CHECK_THROWS_AS(binary::load<vector_t>(buf.bytes().substr(1)),
+                        binary::invalid_binary_pool);
+    }
+
+    SECTION("cycles")
+    {
+        auto buf    = binary::buffer{std::string_view{bytes}};
+        auto reader = binary::reader<vector_t>{buf.bytes()};
+        auto root   = reader.entry(container_id{}).root;
+        // Point the first child of the root to the root itself.
+        auto self = root;
+        std::memcpy(buf.data() + root + sizeof(binary::record_header),
+                    &self,
+                    sizeof(self));
+        CHECK_THROWS_AS(binary::load<vector_t>(buf.bytes()),
+                        immer::persist::pool_has_cycles);
+    }
+}
+
+#if IMMER_PERSIST_HAS_MMAP
+TEST_CASE("Memory mapped binary pool")
+{
+    using vector_t  = immer::flex_vector<int>;
+    const auto v    = gen(vector_t{}, 5000);
+    const auto path = std::string{"test_binary_pool.bin"};
+    {
+        auto os = std::ofstream{path, std::ios::binary};
+        binary::save(os, v + v);
+    }
+    {
+        auto file =
+            binary::mapped_file{path, binary::access_pattern::random};
+        auto reader = binary::reader<vector_t>{file.bytes()};
+        CHECK(reader.get(container_id{}, 7000) == 2000);
+        auto sum = 0ll;
+        reader.for_each_chunk(container_id{}, [&](auto first, auto last) {
+            sum = std::accumulate(first, last, sum);
+        });
+        CHECK(sum == 2ll * 4999 * 5000 / 2);
+        CHECK(binary::load<vector_t>(file.bytes()) == v + v);
+    }
+    std::remove(path.c_str());
+}
+#endif
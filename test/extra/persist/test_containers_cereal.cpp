@@ -8,7 +8,10 @@
 #include <immer/extra/cereal/immer_vector.hpp>
 #include <immer/extra/persist/detail/cereal/compact_map.hpp>
 
+#include <cereal/archives/binary.hpp>
 #include <cereal/archives/json.hpp>
+#include <cereal/archives/portable_binary.hpp>
+#include <cereal/types/vector.hpp>
 
 #include <nlohmann/json.hpp>
 
@@ -215,3 +218,73 @@ TEST_CASE("Test loading struct with non-empty containers")
     }();
     REQUIRE(value == loaded_value);
 }
+
+namespace {
+
+template <class OutputArchive, class T>
+std::string to_bytes(const T& value)
+{
+    auto os = std::ostringstream{};
+    {
+        auto ar = OutputArchive{os};
+        ar(value);
+    }
+    return os.str();
+}
+
+template <class InputArchive, class T>
+T from_bytes(const std::string& bytes)
+{
+    auto is = std::istringstream{bytes};
+    auto ar = InputArchive{is};
+    auto r  = T{};
+    ar(r);
+    return r;
+}
+
+template <class OutputArchive, class InputArchive>
+void check_binary_sequences()
+{
+    auto expected = std::vector<double>{};
+    for (auto i = 0; i < 5000; ++i)
+        expected.push_back(i * 0.5);
+    const auto bytes = to_bytes<OutputArchive>(expected);
+
+    const auto vec  = immer::vector<double>{expected.begin(), expected.end()};
+    const auto flex = immer::flex_vector<double>{vec};
+    const auto cat  = flex.drop(100) + flex.take(100);
+    const auto arr  = immer::array<double>{expected.begin(), expected.end()};
+
+    // The values are written in bulk, with the same result as writing them
+    // one by one, which is also what a std::vector is written as.
+    REQUIRE(to_bytes<OutputArchive>(vec) == bytes);
+    REQUIRE(to_bytes<OutputArchive>(arr) == bytes);
+    REQUIRE(from_bytes<InputArchive, immer::vector<double>>(bytes) == vec);
+    REQUIRE(from_bytes<InputArchive, immer::array<double>>(bytes) == arr);
+    REQUIRE(to_bytes<OutputArchive>(flex) == bytes);
+    REQUIRE(from_bytes<InputArchive, immer::flex_vector<double>>(
+                to_bytes<OutputArchive>(cat)) == cat);
+
+    const auto small = std::vector<double>{1, 2, 3};
+    REQUIRE(from_bytes<InputArchive, immer::vector<double>>(
+                to_bytes<OutputArchive>(small)) ==
+            immer::vector<double>{1, 2, 3});
+    REQUIRE(from_bytes<InputArchive, immer::vector<double>>(
+                to_bytes<OutputArchive>(std::vector<double>{})) ==
+            immer::vector<double>{});
+
+    auto truncated = bytes.substr(0, bytes.size() / 2);
+    REQUIRE_THROWS_AS(
+        (from_bytes<InputArchive, immer::vector<double>>(truncated)),
+        cereal::Exception);
+}
+
+} // namespace
+
+TEST_CASE("Test binary archives of arithmetic sequences")
+{
+    check_binary_sequences<cereal::BinaryOutputArchive,
+                           cereal::BinaryInputArchive>();
+    check_binary_sequences<cereal::PortableBinaryOutputArchive,
+                           cereal::PortableBinaryInputArchive>();
+}
@@ -0,0 +1,231 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "utils.hpp"
+
+#include <nlohmann/json.hpp>
+
+#include <cstdint>
+
+using namespace test;
+using json_t = nlohmann::json;
+
+namespace {
+
+enum class color : std::int8_t
+{
+    red  = -1,
+    blue = 7,
+};
+
+using ints_t    = vector_one<std::int64_t>;
+using flex_t    = flex_vector_one<std::uint16_t>;
+using colors_t  = vector_one<color>;
+using strings_t = vector_one<std::string>;
+
+struct document
+{
+    ints_t ints;
+    ints_t ints2;
+    flex_t flex;
+    colors_t colors;
+    strings_t strings;
+
+    auto tie() const { return std::tie(ints, ints2, flex, colors, strings); }
+
+    friend bool operator==(const document& left, const document& right)
+    {
+        return left.tie() == right.tie();
+    }
+
+    template <class Archive>
+    void serialize(Archive& ar)
+    {
+        ar(CEREAL_NVP(ints),
+           CEREAL_NVP(ints2),
+           CEREAL_NVP(flex),
+           CEREAL_NVP(colors),
+           CEREAL_NVP(strings));
+    }
+};
+
+template <class IntCodec, class StringCodec>
+struct codec_policy : immer::persist::value0_serialize_t
+{
+    template <class T>
+    auto get_pool_types(const T&) const
+    {
+        return boost::hana::tuple_t<ints_t, flex_t, colors_t, strings_t>;
+    }
+
+    auto get_pool_name(const ints_t&) const { return "ints"; }
+    auto get_pool_name(const flex_t&) const { return "flex"; }
+    auto get_pool_name(const colors_t&) const { return "colors"; }
+    auto get_pool_name(const strings_t&) const { return "strings"; }
+
+    template <class T>
+    auto get_leaf_codec(const vector_one<T>&) const
+    {
+        return IntCodec{};
+    }
+    auto get_leaf_codec(const flex_t&) const { return IntCodec{}; }
+    auto get_leaf_codec(const strings_t&) const { return StringCodec{}; }
+};
+
+using plain_policy = codec_policy<immer::persist::plain_leaf_codec,
+                                  immer::persist::plain_leaf_codec>;
+
+document make_document()
+{
+    const auto ints = ints_t{1700000000000, 1700000000250, 1700000000260};
+    const auto flex = flex_t{3, 60000, 5} + flex_t{7, 8} + flex_t{9};
+    return document{
+        .ints    = ints,
+        .ints2   = ints.push_back(-5).push_back(1700000000300),
+        .flex    = flex,
+        .colors  = {color::red, color::blue, color::red},
+        .strings = {"open", "close", "open", "open", "close"},
+    };
+}
+
+template <class Policy>
+void check_roundtrip(const document& value)
+{
+    const auto str = immer::persist::cereal_save_with_pools(value, Policy{});
+    const auto loaded =
+        immer::persist::cereal_load_with_pools<document>(str, Policy{});
+    REQUIRE(loaded == value);
+}
+
+} // namespace
+
+TEST_CASE("Save and load leaves with codecs")
+{
+    const auto value = make_document();
+
+    SECTION("plain")
+    {
+        const auto str =
+            immer::persist::cereal_save_with_pools(value, plain_policy{});
+        const auto json = json_t::parse(str);
+        REQUIRE(json["pools"]["ints"].contains("leaves"));
+        REQUIRE(!json["pools"]["ints"].contains("leaf_codec"));
+        check_roundtrip<plain_policy>(value);
+    }
+
+    SECTION("delta")
+    {
+        check_roundtrip<
+            codec_policy<immer::persist::delta_leaf_codec,
+                         immer::persist::dictionary_leaf_codec>>(value);
+    }
+
+    SECTION("frame of reference")
+    {
+        check_roundtrip<
+            codec_policy<immer::persist::frame_of_reference_leaf_codec,
+                         immer::persist::dictionary_leaf_codec>>(value);
+    }
+
+    SECTION("varint")
+    {
+        using policy = codec_policy<
+            immer::persist::varint_leaf_codec<>,
+            immer::persist::varint_leaf_codec<
+                immer::persist::dictionary_leaf_codec>>;
+        check_roundtrip<policy>(value);
+        check_roundtrip<
+            codec_policy<immer::persist::varint_leaf_codec<
+                             immer::persist::frame_of_reference_leaf_codec>,
+                         immer::persist::plain_leaf_codec>>(value);
+
+        const auto plain =
+            immer::persist::cereal_save_with_pools(value, plain_policy{});
+        const auto encoded =
+            immer::persist::cereal_save_with_pools(value, policy{});
+        REQUIRE(encoded.size() < plain.size());
+    }
+
+    SECTION("empty")
+    {
+        check_roundtrip<codec_policy<immer::persist::varint_leaf_codec<>,
+                                     immer::persist::dictionary_leaf_codec>>(
+            document{});
+    }
+}
+
+TEST_CASE("Leaves encoded with codecs in JSON")
+{
+    using policy = codec_policy<immer::persist::delta_leaf_codec,
+                                immer::persist::dictionary_leaf_codec>;
+
+    const auto v1    = ints_t{1, 2, 3};
+    const auto v2    = v1.push_back(4).push_back(5).push_back(6);
+    const auto value = document{
+        .ints    = v1,
+        .ints2   = v2,
+        .strings = {"one", "two", "one"},
+    };
+    const auto str = immer::persist::cereal_save_with_pools(value, policy{});
+
+    const auto expected_ints = json_t::parse(R"(
+{
+  "B": 5,
+  "BL": 1,
+  "leaf_codec": "delta",
+  "encoded_leaves": [[1, [6]], [2, [2, 2]], [4, [10, 2]], [5, [6, 2]]],
+  "inners": [
+    [0, {"children": [2], "relaxed": false}],
+    [3, {"children": [2, 5], "relaxed": false}]
+  ],
+  "vectors": [{"root": 0, "tail": 1}, {"root": 3, "tail": 4}]
+}
+    )");
+    const auto json = json_t::parse(str);
+    REQUIRE(json["pools"]["ints"] == expected_ints);
+    REQUIRE(json["pools"]["strings"]["leaf_codec"] == "dictionary");
+    REQUIRE(json["pools"]["strings"]["dictionary"] ==
+            json_t::parse(R"(["one", "two"])"));
+    REQUIRE(json["pools"]["strings"]["encoded_leaves"] ==
+            json_t::parse(R"([[1, [0]], [2, [0, 1]]])"));
+
+    const auto loaded =
+        immer::persist::cereal_load_with_pools<document>(str, policy{});
+    REQUIRE(loaded == value);
+}
+
+TEST_CASE("Load leaves with the wrong codec")
+{
+    using delta_policy = codec_policy<immer::persist::delta_leaf_codec,
+                                      immer::persist::dictionary_leaf_codec>;
+    using for_policy =
+        codec_policy<immer::persist::frame_of_reference_leaf_codec,
+                     immer::persist::dictionary_leaf_codec>;
+
+    const auto value = make_document();
+    const auto str =
+        immer::persist::cereal_save_with_pools(value, delta_policy{});
+
+    REQUIRE_THROWS_AS(
+        immer::persist::cereal_load_with_pools<document>(str, for_policy{}),
+        immer::persist::invalid_leaf_codec);
+    REQUIRE_THROWS(
+        immer::persist::cereal_load_with_pools<document>(str, plain_policy{}));
+
+    SECTION("value out of the dictionary")
+    {
+        auto json = json_t::parse(str);
+        json["pools"]["strings"]["dictionary"] = json_t::parse(R"(["open"])");
+        REQUIRE_THROWS_AS(immer::persist::cereal_load_with_pools<document>(
+                              json.dump(), delta_policy{}),
+                          immer::persist::invalid_leaf_codec);
+    }
+
+    SECTION("value out of range")
+    {
+        auto json = json_t::parse(str);
+        json["pools"]["colors"]["encoded_leaves"][0][1][0] = 1000;
+        REQUIRE_THROWS_AS(immer::persist::cereal_load_with_pools<document>(
+                              json.dump(), delta_policy{}),
+                          immer::persist::invalid_leaf_codec);
+    }
+}
@@ -0,0 +1,188 @@
+#include <catch2/catch_test_macros.hpp>
+
+#include "utils.hpp"
+
+#include <immer/box.hpp>
+#include <immer/set.hpp>
+
+#include <nlohmann/json.hpp>
+
+using namespace test;
+using json_t = nlohmann::json;
+
+namespace {
+
+using hash_t    = immer::persist::xx_hash<std::string>;
+using ints_t    = vector_one<int>;
+using flex_t    = flex_vector_one<int>;
+using strings_t = immer::set<std::string, hash_t>;
+using boxes_t   = vector_one<immer::box<std::string>>;
+using groups_t  = immer::map<std::string, ints_t, hash_t>;
+
+struct document
+{
+    ints_t ints;
+    ints_t ints2;
+    flex_t flex;
+    strings_t strings;
+    boxes_t boxes;
+    groups_t groups;
+    groups_t groups2;
+
+    auto tie() const
+    {
+        return std::tie(ints, ints2, flex, strings, boxes, groups, groups2);
+    }
+
+    friend bool operator==(const document& left, const document& right)
+    {
+        return left.tie() == right.tie();
+    }
+
+    template <class Archive>
+    void serialize(Archive& ar)
+    {
+        ar(CEREAL_NVP(ints),
+           CEREAL_NVP(ints2),
+           CEREAL_NVP(flex),
+           CEREAL_NVP(strings),
+           CEREAL_NVP(boxes),
+           CEREAL_NVP(groups),
+           CEREAL_NVP(groups2));
+    }
+};
+
+template <class IntCodec = immer::persist::plain_leaf_codec>
+struct streaming_policy : immer::persist::value0_serialize_t
+{
+    template <class T>
+    auto get_pool_types(const T&) const
+    {
+        return boost::hana::tuple_t<ints_t,
+                                    flex_t,
+                                    strings_t,
+                                    boxes_t,
+                                    immer::box<std::string>,
+                                    groups_t>;
+    }
+
+    auto get_pool_name(const ints_t&) const { return "ints"; }
+    auto get_pool_name(const flex_t&) const { return "flex"; }
+    auto get_pool_name(const strings_t&) const { return "strings"; }
+    auto get_pool_name(const boxes_t&) const { return "boxes"; }
+    auto get_pool_name(const immer::box<std::string>&) const { return "box"; }
+    auto get_pool_name(const groups_t&) const { return "groups"; }
+
+    auto get_leaf_codec(const ints_t&) const { return IntCodec{}; }
+};
+
+document make_document()
+{
+    const auto ints   = gen(ints_t{}, 100);
+    const auto flex   = flex_t{ints} + gen(flex_t{}, 40) + flex_t{ints};
+    const auto groups = groups_t{{"small", ints_t{1, 2, 3}}, {"all", ints}};
+    auto strings      = strings_t{};
+    for (auto i = 0; i < 200; ++i) {
+        strings = std::move(strings).insert(std::to_string(i));
+    }
+    return document{
+        .ints    = ints,
+        .ints2   = ints.set(50, -1).push_back(7),
+        .flex    = flex.drop(3),
+        .strings = strings,
+        .boxes   = {std::string{"one"}, std::string{"two"}},
+        .groups  = groups,
+        .groups2 = groups.set("more", ints.take(10)),
+    };
+}
+
+template <class Policy>
+std::string save_streamed(const document& value)
+{
+    auto os = std::ostringstream{};
+    immer::persist::cereal_save_with_streamed_pools(os, value, Policy{});
+    return os.str();
+}
+
+template <class Policy>
+void check_streamed(const document& value)
+{
+    const auto streamed = save_streamed<Policy>(value);
+    const auto loaded =
+        immer::persist::cereal_load_with_pools<document>(streamed, Policy{});
+    REQUIRE(loaded == value);
+
+    // The nodes are numbered differently, but there are as many of them.
+    const auto pools =
+        json_t::parse(immer::persist::cereal_save_with_pools(value, Policy{}))
+            ["pools"];
+    const auto streamed_pools = json_t::parse(streamed)["pools"];
+    for (const auto& [name, pool] : pools.items()) {
+        if (pool.is_object()) {
+            for (const auto& [key, nodes] : pool.items()) {
+                REQUIRE(streamed_pools[name][key].size() == nodes.size());
+            }
+        } else {
+            REQUIRE(streamed_pools[name].size() == pool.size());
+        }
+    }
+}
+
+} // namespace
+
+TEST_CASE("Save with streamed pools")
+{
+    SECTION("plain") { check_streamed<streaming_policy<>>(make_document()); }
+
+    SECTION("leaf codec")
+    {
+        check_streamed<streaming_policy<immer::persist::delta_leaf_codec>>(
+            make_document());
+    }
+
+    SECTION("empty") { check_streamed<streaming_policy<>>(document{}); }
+}
+
+TEST_CASE("Streamed pools in JSON")
+{
+    const auto v1    = ints_t{1, 2, 3};
+    const auto v2    = v1.push_back(4).push_back(5).push_back(6);
+    const auto value = document{.ints = v1, .ints2 = v2};
+    const auto json  = json_t::parse(save_streamed<streaming_policy<>>(value));
+
+    // Children are written before their parents.
+    const auto expected_ints = json_t::parse(R"(
+{
+  "B": 5,
+  "BL": 1,
+  "leaves": [[0, [1, 2]], [2, [3]], [3, [3, 4]], [5, [5, 6]]],
+  "inners": [
+    [1, {"children": [0], "relaxed": false}],
+    [4, {"children": [0, 3], "relaxed": false}]
+  ],
+  "vectors": [{"root": 1, "tail": 2}, {"root": 4, "tail": 5}]
+}
+    )");
+    REQUIRE(json["pools"]["ints"] == expected_ints);
+}
+
+TEST_CASE("Streamed pools only remember the shared nodes")
+{
+    using walker_t = immer::persist::rbts::detail::post_order_walker<
+        immer::persist::rbts::detail::node_numbering>;
+
+    const auto v1 = gen(ints_t{}, 2000);
+    const auto v2 = v1.push_back(7);
+
+    auto numbers = immer::persist::rbts::detail::node_numbering{};
+    auto walker  = walker_t{numbers};
+    v1.impl().traverse(immer::persist::rbts::detail::visitor_helper{}, walker);
+    const auto nodes = numbers.leaves + numbers.inners;
+    walker.ids.clear();
+    v2.impl().traverse(immer::persist::rbts::detail::visitor_helper{}, walker);
+
+    // The nodes of v1 are numbered once, and only the ones that v2 refers to
+    // directly are remembered.
+    REQUIRE(numbers.leaves + numbers.inners > nodes);
+    REQUIRE(numbers.shared.size() < nodes / 10);
+}
@@ -20,6 +20,8 @@
 
 #include <nlohmann/json.hpp>
 
+#include <algorithm>
+
 namespace {
 
 using namespace test;
@@ -784,6 +786,49 @@ TEST_CASE("Test modifying vector nodes")
     }
 }
 
+TEST_CASE("Load a pool with its nodes out of order")
+{
+    // Pools used to be saved with their nodes in the order of an immer::map,
+    // and now they are saved ordered by id.  The old ones must still load.
+    json_t data;
+    data["value0"]["B"]      = 5;
+    data["value0"]["BL"]     = 1;
+    data["value0"]["leaves"] = {
+        {4, {4, 5}},
+        {1, {6}},
+        {3, {2, 3}},
+        {2, {0, 1}},
+    };
+    data["value0"]["inners"] = {
+        {
+            0,
+            {
+                {"children", {2, 3, 4}},
+                {"relaxed", false},
+            },
+        },
+    };
+    data["value0"]["vectors"] = {
+        {
+            {"root", 0},
+            {"tail", 1},
+        },
+    };
+    data["value0"]["flex_vectors"] = json_t::array();
+
+    const auto vec = load_vec(data.dump(), 0);
+    REQUIRE(vec == example_vector{0, 1, 2, 3, 4, 5, 6});
+
+    const auto [pool, id] = add_to_pool(vec, example_output_pool{});
+    const auto saved      = json_t::parse(to_json(pool));
+    auto ids              = std::vector<int>{};
+    for (const auto& leaf : saved["value0"]["leaves"]) {
+        ids.push_back(leaf[0]);
+    }
+    REQUIRE(ids.size() == 4);
+    REQUIRE(std::is_sorted(ids.begin(), ids.end()));
+}
+
 TEST_CASE("Test modifying flex vector nodes")
 {
     json_t data;
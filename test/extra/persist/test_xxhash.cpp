@@ -28,6 +28,8 @@ TEST_CASE("Test hash strings")
     REQUIRE(immer::persist::xx_hash<std::string>{}(str) ==
             10760762337991515389UL);
     REQUIRE(XXH3_64bits(str.c_str(), str.size()) == 10760762337991515389UL);
+    REQUIRE(immer::persist::xx_hash<std::string_view>{}(str) ==
+            10760762337991515389UL);
 }
 
 TEST_CASE("Test loading a big map saved on macOS with std::hash", "[.macos]")
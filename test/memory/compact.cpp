@@ -0,0 +1,200 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/compact.hpp>
+#include <immer/heap/malloc_heap.hpp>
+#include <immer/heap/stats_heap.hpp>
+#include <immer/memory_usage.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+
+using heap_t   = immer::stats_heap<immer::cpp_heap>;
+using memory_t = immer::memory_policy<immer::heap_policy<heap_t>,
+                                      immer::refcount_policy,
+                                      immer::default_lock_policy>;
+
+// Remembers the size of every allocation, and never frees them, like a
+// garbage collector that never runs.
+struct sized_heap
+{
+    static std::unordered_map<void*, std::size_t>& sizes()
+    {
+        static auto s = new std::unordered_map<void*, std::size_t>{};
+        return *s;
+    }
+
+    template <typename... Tags>
+    static void* allocate(std::size_t size, Tags...)
+    {
+        auto p     = immer::malloc_heap::allocate(size);
+        sizes()[p] = size;
+        return p;
+    }
+
+    template <typename... Tags>
+    static void deallocate(std::size_t, void*, Tags...)
+    {}
+};
+
+using gc_memory_t = immer::memory_policy<immer::heap_policy<sized_heap>,
+                                         immer::no_refcount_policy,
+                                         immer::default_lock_policy>;
+
+struct bad_hash
+{
+    std::size_t operator()(int x) const { return x % 3; }
+};
+
+struct entry
+{
+    int id;
+    int value;
+
+    bool operator==(const entry& other) const
+    {
+        return id == other.id && value == other.value;
+    }
+};
+
+template <typename Container>
+void check_unshared(const Container& a, const Container& b)
+{
+    auto versions = std::vector<Container>{a, b};
+    CHECK(immer::memory_usage(versions).shared_bytes == 0);
+}
+
+} // namespace
+
+TEST_CASE("compact vector")
+{
+    auto v = immer::vector<int, memory_t>{};
+    for (auto i = 0; i < 1000; ++i)
+        v = v.push_back(i);
+    auto c = immer::compact(v);
+    CHECK(c == v);
+    check_unshared(v, c);
+    CHECK(immer::memory_usage(c).unique_bytes ==
+          immer::memory_usage(v).unique_bytes);
+}
+
+TEST_CASE("compact flex vector removes relaxed nodes")
+{
+    auto v = immer::flex_vector<int, memory_t>{};
+    for (auto i = 0; i < 2000; ++i)
+        v = v.insert(i / 2, i);
+    auto before = immer::memory_usage(v);
+    auto c      = immer::compact(v);
+    auto after  = immer::memory_usage(c);
+    CHECK(c == v);
+    check_unshared(v, c);
+    CHECK(before[immer::node_kind::relaxed].nodes > 0);
+    CHECK(after[immer::node_kind::relaxed].nodes == 0);
+    CHECK(after.unique_bytes < before.unique_bytes);
+}
+
+TEST_CASE("compact vector without reference counting packs its nodes")
+{
+    auto v = immer::vector<int, gc_memory_t, 2, 2>{};
+    for (auto i = 0; i < 30; ++i)
+        v = std::move(v).push_back(i);
+    auto c = immer::compact(v);
+    CHECK(c == v);
+
+    // With 4 elements per leaf and 4 children per inner node: 7 full leaves
+    // under a root with 2 children, the second of which has 3, and a tail
+    // with 2 elements.
+    using node_t    = std::decay_t<decltype(*c.impl().root)>;
+    auto& sizes     = sized_heap::sizes();
+    const auto root = c.impl().root;
+    REQUIRE(c.impl().tail_offset() == 28);
+    CHECK(sizes[root] == node_t::sizeof_packed_inner_n(2));
+    CHECK(sizes[root->inner()[0]] == node_t::max_sizeof_inner);
+    CHECK(sizes[root->inner()[1]] == node_t::sizeof_packed_inner_n(3));
+    CHECK(sizes[root->inner()[1]->inner()[2]] == node_t::max_sizeof_leaf);
+    CHECK(sizes[c.impl().tail] == node_t::sizeof_packed_leaf_n(2));
+
+    auto f = immer::compact(immer::flex_vector<int, gc_memory_t, 2, 2>{v});
+    CHECK(f == v);
+    CHECK(sizes[f.impl().tail] == node_t::sizeof_packed_leaf_n(2));
+}
+
+TEST_CASE("compact hash containers")
+{
+    SECTION("map")
+    {
+        auto m = immer::map<std::string, int, std::hash<std::string>,
+                            std::equal_to<std::string>, memory_t>{};
+        for (auto i = 0; i < 1000; ++i)
+            m = m.set(std::to_string(i), i);
+        auto c = immer::compact(m);
+        CHECK(c == m);
+        check_unshared(m, c);
+        CHECK(immer::memory_usage(c).unique_bytes ==
+              immer::memory_usage(m).unique_bytes);
+    }
+
+    SECTION("set with collisions")
+    {
+        auto s = immer::set<int, bad_hash>{};
+        for (auto i = 0; i < 100; ++i)
+            s = s.insert(i);
+        auto c = immer::compact(s);
+        CHECK(c == s);
+        CHECK(immer::memory_usage(c)[immer::node_kind::collision].nodes == 3);
+    }
+
+    SECTION("table")
+    {
+        auto t = immer::table<entry>{};
+        for (auto i = 0; i < 100; ++i)
+            t = t.insert({i, i * 2});
+        CHECK(immer::compact(t) == t);
+    }
+
+    SECTION("empty")
+    {
+        CHECK(immer::compact(immer::map<int, int>{}).empty());
+        CHECK(immer::compact(immer::set<int>{}).empty());
+    }
+}
+
+TEST_CASE("compact does not leak")
+{
+    heap_t::reset_stats();
+    {
+        auto v = immer::flex_vector<int, memory_t>{};
+        auto m = immer::map<int, int, std::hash<int>, std::equal_to<int>,
+                            memory_t>{};
+        for (auto i = 0; i < 500; ++i) {
+            v = v.insert(i / 2, i);
+            m = m.set(i, i);
+        }
+        auto cv = immer::compact(v);
+        auto cm = immer::compact(m);
+        CHECK(cv.size() == 500);
+        CHECK(cm.size() == 500);
+    }
+    CHECK(heap_t::stats().live_bytes() == 0);
+}
+
+TEST_CASE("compact single node containers")
+{
+    auto a = immer::array<int>{1, 2, 3};
+    CHECK(immer::compact(a) == a);
+    CHECK(immer::compact(a).data() != a.data());
+
+    auto b = immer::box<std::string>{"foo"};
+    CHECK(immer::compact(b) == b);
+    CHECK(&immer::compact(b).get() != &b.get());
+}
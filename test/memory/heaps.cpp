@@ -10,7 +10,9 @@
 #include <immer/heap/free_list_heap.hpp>
 #include <immer/heap/gc_heap.hpp>
 #include <immer/heap/malloc_heap.hpp>
+#include <immer/heap/stats_heap.hpp>
 #include <immer/heap/thread_local_free_list_heap.hpp>
+#include <immer/heap/with_data.hpp>
 
 #include <catch2/catch_test_macros.hpp>
 #include <numeric>
@@ -99,3 +101,58 @@ TEST_CASE("unsafe free_list")
     test_free_list_heap<
         immer::unsafe_free_list_heap<42u, 2, immer::malloc_heap>>();
 }
+
+TEST_CASE("stats")
+{
+    using heap = immer::stats_heap<immer::malloc_heap>;
+    heap::reset_stats();
+
+    SECTION("basic")
+    {
+        auto p = heap::allocate(42u);
+        do_stuff_to(p, 42u);
+        auto s = heap::stats();
+        CHECK(s.allocations == 1);
+        CHECK(s.bytes_allocated == 42);
+        CHECK(s.live() == 1);
+        CHECK(s.by_size[6].allocations == 1);
+
+        heap::deallocate(42, p);
+        s = heap::stats();
+        CHECK(s.deallocations == 1);
+        CHECK(s.live() == 0);
+        CHECK(s.live_bytes() == 0);
+        CHECK(s.by_size[6].deallocations == 1);
+    }
+
+    SECTION("size classes")
+    {
+        CHECK(immer::heap_stats::size_class_of(1) == 0);
+        CHECK(immer::heap_stats::size_class_of(2) == 1);
+        CHECK(immer::heap_stats::size_class_of(3) == 2);
+        CHECK(immer::heap_stats::size_class_of(64) == 6);
+        CHECK(immer::heap_stats::size_class_of(65) == 7);
+        CHECK(immer::heap_stats::size_class_of(std::size_t{1} << 20) ==
+              immer::heap_stats::size_classes - 1);
+    }
+
+    SECTION("free list hits")
+    {
+        using inner_heap = immer::stats_heap<immer::cpp_heap>;
+        using outer_heap = immer::stats_heap<immer::with_data<
+            immer::free_list_node,
+            immer::unsafe_free_list_heap<42u, 2, inner_heap>>>;
+        inner_heap::reset_stats();
+        outer_heap::reset_stats();
+
+        auto p = outer_heap::allocate(42u);
+        outer_heap::deallocate(42u, p);
+        p = outer_heap::allocate(42u);
+        outer_heap::deallocate(42u, p);
+
+        auto total  = outer_heap::stats().allocations;
+        auto misses = inner_heap::stats().allocations;
+        CHECK(total == 2);
+        CHECK(misses == 1);
+    }
+}
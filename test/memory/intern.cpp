@@ -0,0 +1,192 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/heap/stats_heap.hpp>
+#include <immer/intern.hpp>
+#include <immer/memory_usage.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+
+using heap_t   = immer::stats_heap<immer::cpp_heap>;
+using memory_t = immer::memory_policy<immer::heap_policy<heap_t>,
+                                      immer::refcount_policy,
+                                      immer::default_lock_policy>;
+
+using map_t = immer::map<std::string,
+                         int,
+                         std::hash<std::string>,
+                         std::equal_to<std::string>,
+                         memory_t>;
+
+struct bad_hash
+{
+    std::size_t operator()(int x) const { return x % 3; }
+};
+
+map_t make_settings(int skip, int value)
+{
+    auto m = map_t{};
+    for (auto i = 0; i < 1000; ++i)
+        if (i != skip)
+            m = m.set(std::to_string(i), i == 0 ? value : i);
+    return m;
+}
+
+} // namespace
+
+TEST_CASE("intern map")
+{
+    immer::intern_table<map_t> table;
+    auto originals = std::vector<map_t>{};
+    auto interned  = std::vector<map_t>{};
+    for (auto i = 0; i < 10; ++i)
+        originals.push_back(make_settings(i + 1, i % 2));
+    for (auto& m : originals)
+        interned.push_back(table.intern(m));
+
+    SECTION("equal to the originals")
+    {
+        for (auto i = 0u; i < originals.size(); ++i)
+            CHECK(interned[i] == originals[i]);
+    }
+
+    SECTION("equal subtrees are shared")
+    {
+        auto before = immer::memory_usage(originals);
+        auto after  = immer::memory_usage(interned);
+        CHECK(before.shared_bytes == 0);
+        CHECK(after.unique_bytes * 4 < before.unique_bytes);
+    }
+
+    SECTION("equal maps get the same root")
+    {
+        auto again = table.intern(make_settings(3, 0));
+        CHECK(again.impl().root == interned[2].impl().root);
+        CHECK(again.impl().root != interned[1].impl().root);
+    }
+
+    SECTION("interned maps can be updated")
+    {
+        auto updated = interned[0].set("0", 42).erase("5");
+        CHECK(interned[0] == originals[0]);
+        CHECK(updated["0"] == 42);
+        CHECK(updated.count("5") == 0);
+        auto moved = std::move(interned[1]).set("1", 42);
+        CHECK(interned[2] == originals[2]);
+        CHECK(moved["1"] == 42);
+    }
+}
+
+TEST_CASE("intern set with collisions")
+{
+    using set_t = immer::set<int, bad_hash>;
+    immer::intern_table<set_t> table;
+    auto a = set_t{};
+    auto b = set_t{};
+    for (auto i = 0; i < 100; ++i) {
+        a = a.insert(i);
+        b = b.insert(99 - i);
+    }
+    auto ia = table.intern(a);
+    auto ib = table.intern(b);
+    CHECK(ia == a);
+    CHECK(ia.impl().root == ib.impl().root);
+}
+
+TEST_CASE("intern vectors")
+{
+    SECTION("vector")
+    {
+        using vector_t = immer::vector<int, memory_t>;
+        immer::intern_table<vector_t> table;
+        auto v = vector_t{};
+        for (auto i = 0; i < 3000; ++i)
+            v = v.push_back(i % 64);
+        auto iv = table.intern(v);
+        CHECK(iv == v);
+        CHECK(immer::memory_usage(iv).unique_bytes * 5 <
+              immer::memory_usage(v).unique_bytes);
+    }
+
+    SECTION("flex vector")
+    {
+        using vector_t = immer::flex_vector<int, memory_t>;
+        immer::intern_table<vector_t> table;
+        auto v = vector_t{};
+        for (auto i = 0; i < 5000; ++i)
+            v = v.push_back(i);
+        auto relaxed = v.drop(7) + v.take(300);
+        auto a       = table.intern(relaxed);
+        auto b       = table.intern(v.drop(7) + v.take(300));
+        CHECK(a == relaxed);
+        CHECK(a.impl().root == b.impl().root);
+        CHECK(a.impl().tail == b.impl().tail);
+        auto c = a.push_back(1).set(3, 42);
+        CHECK(a == relaxed);
+        CHECK(c[3] == 42);
+    }
+}
+
+TEST_CASE("intern from several threads")
+{
+    immer::intern_table<map_t> table;
+    auto threads = std::vector<std::thread>{};
+    auto results = std::vector<std::vector<map_t>>(4);
+    for (auto t = 0u; t < results.size(); ++t)
+        threads.emplace_back([&table, &results, t] {
+            for (auto i = 0; i < 8; ++i)
+                results[t].push_back(table.intern(make_settings(i, t % 2)));
+        });
+    for (auto& t : threads)
+        t.join();
+
+    // threads with the same parity interned equal maps
+    auto all = std::vector<map_t>{};
+    for (auto t = 0u; t < results.size(); ++t)
+        for (auto i = 0u; i < results[t].size(); ++i) {
+            auto& m = results[t][i];
+            CHECK(m == make_settings(i, t % 2));
+            CHECK(m.impl().root == results[t % 2][i].impl().root);
+            all.push_back(m);
+        }
+    auto u = immer::memory_usage(all);
+    CHECK(u.unique_bytes * 8 < u.total_bytes);
+}
+
+TEST_CASE("intern collect")
+{
+    heap_t::reset_stats();
+    {
+        immer::intern_table<map_t> table;
+        auto interned = std::vector<map_t>{};
+        for (auto i = 0; i < 5; ++i)
+            interned.push_back(table.intern(make_settings(i, 0)));
+        CHECK(table.collect() == 0);
+        auto size = table.size();
+        CHECK(size > 0);
+
+        interned.pop_back();
+        auto released = table.collect();
+        CHECK(released > 0);
+        CHECK(table.size() == size - released);
+
+        interned.clear();
+        table.collect();
+        CHECK(table.size() == 0);
+        CHECK(heap_t::stats().live_bytes() == 0);
+
+        interned.push_back(table.intern(make_settings(0, 0)));
+    }
+    CHECK(heap_t::stats().live_bytes() == 0);
+}
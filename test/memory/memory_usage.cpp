@@ -0,0 +1,206 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/heap/stats_heap.hpp>
+#include <immer/memory_usage.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <string>
+#include <tuple>
+#include <vector>
+
+namespace {
+
+using heap_t   = immer::stats_heap<immer::cpp_heap>;
+using memory_t = immer::memory_policy<immer::heap_policy<heap_t>,
+                                      immer::refcount_policy,
+                                      immer::default_lock_policy>;
+
+struct bad_hash
+{
+    std::size_t operator()(int) const { return 42; }
+};
+
+void check_consistent(const immer::memory_footprint& u)
+{
+    auto exclusive = std::size_t{};
+    for (auto b : u.exclusive_bytes)
+        exclusive += b;
+    CHECK(exclusive + u.shared_bytes == u.unique_bytes);
+    CHECK(u.unique_bytes <= u.total_bytes);
+    CHECK(u.headroom_bytes <= u.unique_bytes);
+}
+
+} // namespace
+
+TEST_CASE("memory usage of one container")
+{
+    auto v = immer::vector<int>{};
+    for (auto i = 0; i < 10000; ++i)
+        v = v.push_back(i);
+
+    auto u = immer::memory_usage(v);
+    check_consistent(u);
+    CHECK(u.total_bytes == u.unique_bytes);
+    CHECK(u.shared_bytes == 0);
+    CHECK(u.exclusive_bytes.size() == 1);
+    CHECK(u.exclusive_bytes[0] == u.unique_bytes);
+    CHECK(u[immer::node_kind::leaf].nodes > 0);
+    CHECK(u[immer::node_kind::inner].nodes > 0);
+    CHECK(u[immer::node_kind::champ_inner].nodes == 0);
+}
+
+TEST_CASE("memory usage matches the heap")
+{
+    using vector_t = immer::vector<int, memory_t>;
+    using flex_t   = immer::flex_vector<int, memory_t>;
+    using map_t    = immer::
+        map<int, int, std::hash<int>, std::equal_to<int>, memory_t>;
+    using set_t = immer::set<int, bad_hash, std::equal_to<int>, memory_t>;
+
+    // the empty nodes are allocated once and shared by all containers
+    auto empty = std::make_tuple(vector_t{}, flex_t{}, map_t{}, set_t{});
+    auto base  = heap_t::stats().live_bytes();
+    {
+        auto v = vector_t{};
+        for (auto i = 0; i < 10000; ++i)
+            v = v.push_back(i);
+        auto f = flex_t{};
+        for (auto i = 0; i < 1000; ++i)
+            f = f.push_front(i);
+        auto m = map_t{};
+        for (auto i = 0; i < 1000; ++i)
+            m = m.set(i, i);
+        auto s = set_t{};
+        for (auto i = 0; i < 10; ++i)
+            s = s.insert(i);
+
+        auto live = heap_t::stats().live_bytes() - base;
+        CHECK(live == immer::memory_usage(v).unique_bytes +
+                          immer::memory_usage(f).unique_bytes +
+                          immer::memory_usage(m).unique_bytes +
+                          immer::memory_usage(s).unique_bytes);
+        CHECK(immer::memory_usage(f)[immer::node_kind::relaxed].nodes > 0);
+        CHECK(immer::memory_usage(s)[immer::node_kind::collision].nodes == 1);
+    }
+}
+
+TEST_CASE("memory usage of versions")
+{
+    auto v = immer::vector<int>{};
+    for (auto i = 0; i < 10000; ++i)
+        v = v.push_back(i);
+    auto own = immer::memory_usage(v).unique_bytes;
+
+    SECTION("copies share everything")
+    {
+        auto u = immer::memory_usage(std::vector<immer::vector<int>>{v, v});
+        check_consistent(u);
+        CHECK(u.total_bytes == 2 * own);
+        CHECK(u.unique_bytes == own);
+        CHECK(u.shared_bytes == own);
+        CHECK(u.exclusive_bytes[0] == 0);
+        CHECK(u.exclusive_bytes[1] == 0);
+    }
+
+    SECTION("updates only add their path")
+    {
+        auto history = std::vector<immer::vector<int>>{v};
+        for (auto i = 0; i < 10; ++i)
+            history.push_back(history.back().set(i * 1000, 0));
+        auto u = immer::memory_usage(history);
+        check_consistent(u);
+        CHECK(u.total_bytes == 11 * own);
+        CHECK(u.unique_bytes < 2 * own);
+        CHECK(u.exclusive_bytes.size() == 11);
+        for (auto b : u.exclusive_bytes)
+            CHECK(b < own / 10);
+    }
+
+    SECTION("iterators")
+    {
+        auto vs = std::vector<immer::vector<int>>{v, v.push_back(42)};
+        auto u  = immer::memory_usage(vs.begin(), vs.end());
+        check_consistent(u);
+        CHECK(u.exclusive_bytes.size() == 2);
+        CHECK(u.exclusive_bytes[1] > 0);
+    }
+}
+
+TEST_CASE("memory usage of concatenated flex_vector")
+{
+    auto v = immer::flex_vector<int>{};
+    for (auto i = 0; i < 10000; ++i)
+        v = v.push_back(i);
+    auto own = immer::memory_usage(v).unique_bytes;
+    auto u   = immer::memory_usage(v + v);
+    check_consistent(u);
+    // the leaves of both halves are the same
+    CHECK(u.unique_bytes < u.total_bytes);
+    CHECK(u.unique_bytes < 2 * own);
+}
+
+TEST_CASE("memory usage of maps")
+{
+    auto m = immer::map<std::string, int>{};
+    for (auto i = 0; i < 1000; ++i)
+        m = m.set(std::to_string(i), i);
+    auto u = immer::memory_usage(std::vector<immer::map<std::string, int>>{
+        m, m.set("x", 1), m.erase("5")});
+    check_consistent(u);
+    CHECK(u.shared_bytes > 0);
+    CHECK(u[immer::node_kind::champ_inner].nodes > 0);
+    CHECK(u[immer::node_kind::champ_values].nodes > 0);
+    CHECK(u.headroom_bytes == 0);
+}
+
+TEST_CASE("memory usage skips the shared empty nodes")
+{
+    CHECK(immer::memory_usage(immer::vector<int>{}).unique_bytes == 0);
+    CHECK(immer::memory_usage(immer::flex_vector<int>{}).unique_bytes == 0);
+    CHECK(immer::memory_usage(immer::array<int>{}).unique_bytes == 0);
+    CHECK(immer::memory_usage(immer::map<int, int>{}).unique_bytes == 0);
+    CHECK(immer::memory_usage(immer::set<int>{}).unique_bytes == 0);
+
+    // the elements fit in the tail, so the root is still the empty one
+    auto v = immer::vector<int>{1, 2, 3};
+    auto u = immer::memory_usage(v);
+    CHECK(u[immer::node_kind::inner].nodes == 0);
+    CHECK(u[immer::node_kind::leaf].nodes == 1);
+}
+
+TEST_CASE("memory usage of arrays and boxes")
+{
+    auto a = immer::array<int>{1, 2, 3};
+    auto u = immer::memory_usage(a);
+    CHECK(u[immer::node_kind::array].nodes == 1);
+    CHECK(u.unique_bytes >= 3 * sizeof(int));
+
+    auto b  = immer::box<std::string>{"hello"};
+    auto ub = immer::memory_usage(std::vector<immer::box<std::string>>{
+        b, b, immer::box<std::string>{"hello"}});
+    CHECK(ub[immer::node_kind::box].nodes == 2);
+    CHECK(ub.exclusive_bytes[0] == 0);
+    CHECK(ub.exclusive_bytes[2] == ub.unique_bytes - ub.shared_bytes);
+}
+
+TEST_CASE("memory usage of tables")
+{
+    struct entry
+    {
+        int id;
+        int value;
+    };
+    auto t = immer::table<entry>{};
+    for (auto i = 0; i < 100; ++i)
+        t = t.insert({i, i});
+    auto u = immer::memory_usage(t);
+    CHECK(u[immer::node_kind::champ_values].nodes > 0);
+    CHECK(u.exclusive_bytes[0] == u.unique_bytes);
+}
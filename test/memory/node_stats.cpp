@@ -0,0 +1,160 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#define IMMER_ENABLE_NODE_STATS 1
+
+#include <immer/array.hpp>
+#include <immer/flex_vector.hpp>
+#include <immer/map.hpp>
+#include <immer/node_stats.hpp>
+#include <immer/vector.hpp>
+#include <immer/vector_transient.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <numeric>
+
+namespace {
+
+struct bad_hash
+{
+    std::size_t operator()(int) const { return 42; }
+};
+
+std::size_t total_path_copies(const immer::node_stats& s)
+{
+    return std::accumulate(s.path_copies.begin(), s.path_copies.end(), 0u);
+}
+
+void check_balanced(const immer::node_stats& s)
+{
+    for (auto k : s.kinds)
+        CHECK(k.allocated == k.freed);
+}
+
+} // namespace
+
+TEST_CASE("node stats are enabled") { CHECK(immer::node_stats_enabled); }
+
+TEST_CASE("reset node stats")
+{
+    {
+        auto v = immer::vector<int>{}.push_back(1);
+    }
+    immer::reset_node_stats();
+    auto s = immer::get_node_stats();
+    CHECK(s[immer::node_kind::leaf].allocated == 0);
+    CHECK(s.operations == 0);
+    CHECK(total_path_copies(s) == 0);
+}
+
+TEST_CASE("vector node stats")
+{
+    immer::reset_node_stats();
+    {
+        auto v = immer::vector<int>{};
+        for (auto i = 0; i < 1000; ++i)
+            v = v.push_back(i);
+
+        auto s = immer::get_node_stats();
+        CHECK(s.operations == 1000);
+        CHECK(total_path_copies(s) == 1000);
+        CHECK(s[immer::node_kind::leaf].allocated >= 1000);
+        CHECK(s[immer::node_kind::inner].allocated > 0);
+        CHECK(s[immer::node_kind::relaxed].allocated == 0);
+        CHECK(s[immer::node_kind::champ_inner].allocated == 0);
+    }
+    check_balanced(immer::get_node_stats());
+}
+
+TEST_CASE("vector path copies")
+{
+    auto v = immer::vector<int>{};
+    for (auto i = 0; i < 20000; ++i)
+        v = v.push_back(i);
+
+    immer::reset_node_stats();
+    auto v2 = v.set(10, 42);
+    auto s  = immer::get_node_stats();
+    CHECK(s.operations == 1);
+    // the root, at least one inner node and a leaf are copied
+    auto inner = s[immer::node_kind::inner].allocated;
+    CHECK(inner >= 2);
+    CHECK(s[immer::node_kind::leaf].allocated == 1);
+    CHECK(s.path_copies[inner + 1] == 1);
+}
+
+TEST_CASE("transient node stats")
+{
+    immer::reset_node_stats();
+    {
+        auto t = immer::vector_transient<int>{};
+        for (auto i = 0; i < 1000; ++i)
+            t.push_back(i);
+        auto s = immer::get_node_stats();
+        CHECK(s.operations == 0);
+        CHECK(s.transient_owned > 0);
+
+        auto v = t.persistent();
+        immer::reset_node_stats();
+        auto t2 = v.transient();
+        t2.set(0, 42);
+        t2.set(1, 42);
+        s = immer::get_node_stats();
+        CHECK(s.transient_shared > 0);
+        CHECK(s.transient_owned > 0);
+    }
+}
+
+TEST_CASE("flex_vector node stats")
+{
+    immer::reset_node_stats();
+    {
+        auto v = immer::flex_vector<int>{};
+        for (auto i = 0; i < 1000; ++i)
+            v = v.push_back(i);
+        auto r = v.drop(1) + v;
+        CHECK(r.size() == 1999);
+        auto s = immer::get_node_stats();
+        CHECK(s[immer::node_kind::relaxed].allocated > 0);
+    }
+    check_balanced(immer::get_node_stats());
+}
+
+TEST_CASE("map node stats")
+{
+    immer::reset_node_stats();
+    {
+        auto m = immer::map<int, int>{};
+        for (auto i = 0; i < 100; ++i)
+            m = m.set(i, i);
+        auto s = immer::get_node_stats();
+        CHECK(s.operations == 100);
+        CHECK(s[immer::node_kind::champ_inner].allocated > 0);
+        CHECK(s[immer::node_kind::champ_values].allocated > 0);
+        CHECK(s[immer::node_kind::collision].allocated == 0);
+
+        auto c = immer::map<int, int, bad_hash>{}.set(1, 1).set(2, 2);
+        s      = immer::get_node_stats();
+        CHECK(s[immer::node_kind::collision].allocated > 0);
+    }
+    check_balanced(immer::get_node_stats());
+}
+
+TEST_CASE("array node stats")
+{
+    // the empty array is allocated once and never freed
+    auto empty = immer::array<int>{};
+    immer::reset_node_stats();
+    {
+        auto a = empty.push_back(1).push_back(2);
+        auto s = immer::get_node_stats();
+        CHECK(s[immer::node_kind::array].allocated > 0);
+    }
+    check_balanced(immer::get_node_stats());
+}
@@ -0,0 +1,188 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/array.hpp>
+#include <immer/box.hpp>
+#include <immer/flex_vector.hpp>
+#include <immer/map.hpp>
+#include <immer/pin.hpp>
+#include <immer/set.hpp>
+#include <immer/table.hpp>
+#include <immer/vector.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct item
+{
+    int id;
+    std::string value;
+
+    bool operator==(const item& other) const
+    {
+        return id == other.id && value == other.value;
+    }
+};
+
+template <typename Container, typename Fn>
+void check_pinned_copies(const Container& c, Fn&& refcounts)
+{
+    auto before = refcounts(c);
+    auto p      = immer::pin(c);
+    CHECK(refcounts(c) != before);
+    auto pinned = refcounts(c);
+    {
+        auto copies = std::vector<immer::pinned<Container>>(10, p);
+        auto more   = copies;
+        CHECK(*copies.back() == c);
+        CHECK(refcounts(c) == pinned);
+    }
+    immer::unpin(p);
+    CHECK(refcounts(c) == before);
+}
+
+} // namespace
+
+TEST_CASE("pin vector")
+{
+    auto v = immer::vector<std::string>{};
+    for (auto i = 0; i < 100; ++i)
+        v = std::move(v).push_back(std::to_string(i));
+    using node_t = std::decay_t<decltype(*v.impl().root)>;
+
+    check_pinned_copies(v, [](auto& v) {
+        return std::make_pair(int(node_t::refs(v.impl().root).refcount),
+                              int(node_t::refs(v.impl().tail).refcount));
+    });
+
+    SECTION("updates still work")
+    {
+        auto p  = immer::pin(v);
+        auto v2 = p->push_back("foo").set(0, "bar");
+        CHECK(v2.size() == 101);
+        CHECK(v2[0] == "bar");
+        CHECK((*p)[0] == "0");
+        immer::unpin(p);
+    }
+}
+
+TEST_CASE("pin flex_vector")
+{
+    auto v = immer::flex_vector<std::string>{};
+    for (auto i = 0; i < 100; ++i)
+        v = std::move(v).push_front(std::to_string(i));
+    using node_t = std::decay_t<decltype(*v.impl().root)>;
+
+    check_pinned_copies(v, [](auto& v) {
+        return std::make_pair(int(node_t::refs(v.impl().root).refcount),
+                              int(node_t::refs(v.impl().tail).refcount));
+    });
+}
+
+TEST_CASE("pin array")
+{
+    auto v = immer::array<std::string>(10, "foo");
+    check_pinned_copies(
+        v, [](auto& v) { return int(v.impl().ptr->refs().refcount); });
+}
+
+TEST_CASE("pin map")
+{
+    auto m = immer::map<std::string, int>{};
+    for (auto i = 0; i < 100; ++i)
+        m = std::move(m).set(std::to_string(i), i);
+    using node_t = std::decay_t<decltype(*m.impl().root)>;
+
+    check_pinned_copies(
+        m, [](auto& m) { return int(node_t::refs(m.impl().root).refcount); });
+
+    SECTION("updates still work")
+    {
+        auto p  = immer::pin(m);
+        auto m2 = p->set("foo", 42).erase("0");
+        CHECK(m2.size() == 100);
+        CHECK(m2["foo"] == 42);
+        CHECK(p->count("0") == 1);
+        immer::unpin(p);
+    }
+}
+
+TEST_CASE("pin set")
+{
+    auto s = immer::set<int>{};
+    for (auto i = 0; i < 100; ++i)
+        s = std::move(s).insert(i);
+    using node_t = std::decay_t<decltype(*s.impl().root)>;
+
+    check_pinned_copies(
+        s, [](auto& s) { return int(node_t::refs(s.impl().root).refcount); });
+}
+
+TEST_CASE("pin table")
+{
+    auto t = immer::table<item>{};
+    for (auto i = 0; i < 100; ++i)
+        t = std::move(t).insert({i, std::to_string(i)});
+    using node_t = std::decay_t<decltype(*t.impl().root)>;
+
+    check_pinned_copies(
+        t, [](auto& t) { return int(node_t::refs(t.impl().root).refcount); });
+}
+
+TEST_CASE("pin box")
+{
+    auto b = immer::box<std::string>{"foo"};
+    check_pinned_copies(b, [](auto& b) { return int(b.impl()->refcount); });
+}
+
+TEST_CASE("pinned containers outlive the original")
+{
+    auto p = immer::pin(immer::map<int, std::string>{}.set(1, "foo"));
+    CHECK(p->at(1) == "foo");
+    immer::unpin(p);
+}
+
+TEST_CASE("versions derived while pinned outlive the pin")
+{
+    // The nodes shared with the pinned version are counted as usual, so
+    // they survive both the pin and the original container.
+    auto v = std::make_unique<immer::vector<int>>();
+    for (auto i = 0; i < 32; ++i)
+        *v = std::move(*v).push_back(i);
+
+    auto p = immer::pin(*v);
+    auto w = p->push_back(99);
+    immer::unpin(p);
+    v.reset();
+
+    auto e = immer::vector<int>{};
+    CHECK(e.size() == 0);
+    CHECK(w.size() == 33);
+    for (auto i = 0; i < 32; ++i)
+        CHECK(w[i] == i);
+    CHECK(w[32] == 99);
+}
+
+TEST_CASE("unpinned memory is reclaimed")
+{
+    auto m = immer::map<int, std::string>{};
+    for (auto i = 0; i < 100; ++i)
+        m = std::move(m).set(i, std::to_string(i));
+    using node_t = std::decay_t<decltype(*m.impl().root)>;
+
+    auto p    = immer::pin(m);
+    auto copy = p;
+    CHECK(!node_t::refs(m.impl().root).unique());
+    immer::unpin(copy);
+    CHECK(node_t::refs(m.impl().root).unique());
+}
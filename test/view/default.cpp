@@ -0,0 +1,135 @@
+//
+// immer: immutable data structures for C++
+// Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+//
+// This software is distributed under the Boost Software License, Version 1.0.
+// See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+//
+
+#include <immer/algorithm.hpp>
+#include <immer/map_view.hpp>
+#include <immer/set_view.hpp>
+#include <immer/vector_view.hpp>
+
+#include <catch2/catch_test_macros.hpp>
+
+#include <numeric>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+TEST_CASE("vector view")
+{
+    auto v = immer::vector<int>{};
+    for (auto i = 0; i < 100; ++i)
+        v = std::move(v).push_back(i);
+
+    auto w = immer::view(v);
+    static_assert(std::is_trivially_copyable<decltype(w)>::value, "");
+    static_assert(!std::is_convertible<immer::vector<int>,
+                                       immer::vector_view<int>>::value,
+                  "");
+    static_assert(!std::is_constructible<immer::vector_view<int>,
+                                         immer::vector<int>>::value,
+                  "");
+
+    SECTION("read api")
+    {
+        CHECK(w.size() == 100);
+        CHECK(!w.empty());
+        CHECK(w[42] == 42);
+        CHECK(w.at(42) == 42);
+        CHECK_THROWS_AS(w.at(100), std::out_of_range);
+        CHECK(w.front() == 0);
+        CHECK(w.back() == 99);
+        CHECK(std::accumulate(w.begin(), w.end(), 0) == 4950);
+        CHECK(*w.rbegin() == 99);
+        CHECK(w.identity() == v.identity());
+        CHECK(w == immer::view(v));
+    }
+
+    SECTION("algorithms")
+    {
+        CHECK(immer::accumulate(w, 0) == 4950);
+    }
+
+    SECTION("owning copy")
+    {
+        auto c = immer::vector<int>{w};
+        CHECK(c == v);
+        CHECK(c.identity() == v.identity());
+    }
+}
+
+TEST_CASE("map view")
+{
+    auto m = immer::map<std::string, int>{};
+    for (auto i = 0; i < 100; ++i)
+        m = std::move(m).set(std::to_string(i), i);
+
+    auto w = immer::view(m);
+    static_assert(std::is_trivially_copyable<decltype(w)>::value, "");
+
+    CHECK(w.size() == 100);
+    CHECK(!w.empty());
+    CHECK(w.count("42") == 1);
+    CHECK(w.count("100") == 0);
+    CHECK(w["42"] == 42);
+    CHECK(w["100"] == 0);
+    CHECK(w.at("42") == 42);
+    CHECK_THROWS_AS(w.at("100"), std::out_of_range);
+    CHECK(*w.find("42") == 42);
+    CHECK(w.find("100") == nullptr);
+    CHECK(std::distance(w.begin(), w.end()) == 100);
+    CHECK(w.identity() == m.identity());
+    CHECK(w.get() == m);
+}
+
+TEST_CASE("set view")
+{
+    auto s = immer::set<int>{};
+    for (auto i = 0; i < 100; ++i)
+        s = std::move(s).insert(i);
+
+    auto w = immer::view(s);
+    static_assert(std::is_trivially_copyable<decltype(w)>::value, "");
+
+    CHECK(w.size() == 100);
+    CHECK(!w.empty());
+    CHECK(w.count(42) == 1);
+    CHECK(w.count(100) == 0);
+    CHECK(*w.find(42) == 42);
+    CHECK(w.find(100) == nullptr);
+    CHECK(std::accumulate(w.begin(), w.end(), 0) == 4950);
+    CHECK(w.get() == s);
+}
+
+#if !IMMER_NO_THREAD_SAFETY
+
+TEST_CASE("views do not touch the refcount")
+{
+    auto v = immer::vector<int>{};
+    for (auto i = 0; i < 100; ++i)
+        v = std::move(v).push_back(i);
+
+    using node_t  = std::decay_t<decltype(*v.impl().root)>;
+    auto refcount = [&] {
+        return node_t::refs(v.impl().root).refcount.load();
+    };
+    auto before  = refcount();
+    auto w       = immer::view(v);
+    auto threads = std::vector<std::thread>{};
+    auto sums    = std::vector<int>(8);
+    for (auto i = 0; i < 8; ++i)
+        threads.emplace_back([w, &sums, i] {
+            sums[i] = std::accumulate(w.begin(), w.end(), 0);
+        });
+    for (auto& t : threads)
+        t.join();
+    CHECK(refcount() == before);
+    for (auto s : sums)
+        CHECK(s == 4950);
+}
+
+#endif // !IMMER_NO_THREAD_SAFETY
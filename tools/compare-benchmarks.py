@@ -0,0 +1,172 @@
+#!/usr/bin/env python3
+#
+# immer: immutable data structures for C++
+# Copyright (C) 2016, 2017, 2018 Juan Pedro Bolivar Puente
+#
+# This software is distributed under the Boost Software License, Version 1.0.
+# See accompanying file LICENSE or copy at http://boost.org/LICENSE_1_0.txt
+#
+
+"""
+Compares two runs of the standalone, latency, contention, replay or persist
+benchmarks.
+
+Each run is a set of files, or directories of `*.json` files, as written by
+the `json` reporter of `benchmark/standalone`, `benchmark/latency`,
+`benchmark/contention` and `benchmark/replay`, or by the `persist-json`
+reporter of `benchmark/extra/persist`, with one JSON object per line.  A
+benchmark regresses when its mean time grows by more than the threshold and
+the confidence intervals of both runs do not overlap.  The script exits with
+status 1 when any benchmark regressed, so that it can be used as a gate:
+
+    tools/compare-benchmarks.py --threshold 5 old-reports/ new-reports/
+
+The latency benchmarks report percentiles, which can be compared instead of
+the mean with `--metric p999_s`.  They have no confidence intervals, so
+only the threshold applies to them.  Rates like `ops_per_s`, and the
+`efficiency` of the contention benchmarks, regress when they drop instead.
+Benchmarks whose base value is zero can not be compared relatively and are
+reported as `zero`.
+
+Benchmarks of the base run that are missing from the new run also make the
+script fail, since a benchmark that crashed or was renamed would otherwise
+go unnoticed.  Pass `--allow-missing` when comparing partial runs.
+"""
+
+import argparse
+import json
+import os
+import sys
+
+
+def read_files(path):
+    if os.path.isdir(path):
+        for name in sorted(os.listdir(path)):
+            if name.endswith(".json"):
+                yield os.path.join(path, name)
+    else:
+        yield path
+
+
+def read_run(paths):
+    results = {}
+    for path in paths:
+        for fname in read_files(path):
+            with open(fname) as f:
+                for line in f:
+                    line = line.strip()
+                    if not line.startswith("{"):
+                        continue
+                    entry = json.loads(line)
+                    params = ",".join(
+                        "{}={}".format(k, v)
+                        for k, v in sorted(entry["params"].items())
+                    )
+                    key = (entry["suite"], entry["benchmark"], params)
+                    results[key] = entry
+    return results
+
+
+def format_time(seconds):
+    for unit, scale in (("s", 1), ("ms", 1e3), ("us", 1e6)):
+        if seconds * scale >= 1:
+            return "{:.3f} {}".format(seconds * scale, unit)
+    return "{:.3f} ns".format(seconds * 1e9)
+
+
+def higher_is_better(metric):
+    return metric.endswith("_per_s") or metric == "efficiency"
+
+
+def format_value(metric, value):
+    if metric.endswith("_s") and not higher_is_better(metric):
+        return format_time(value)
+    return "{:.4g}".format(value)
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n")[0])
+    parser.add_argument("old", help="report file or directory of the base run")
+    parser.add_argument("new", help="report file or directory of the new run")
+    parser.add_argument(
+        "--threshold",
+        type=float,
+        default=5.0,
+        help="change in percent above which a benchmark regresses",
+    )
+    parser.add_argument(
+        "--metric",
+        default="mean_s",
+        help="the field to compare, for example p99_s for the latencies",
+    )
+    parser.add_argument(
+        "--all", action="store_true", help="print unchanged benchmarks too"
+    )
+    parser.add_argument(
+        "--allow-missing",
+        action="store_true",
+        help="do not fail when benchmarks of the base run are missing",
+    )
+    args = parser.parse_args()
+
+    old = read_run([args.old])
+    new = read_run([args.new])
+
+    regressions = 0
+    missing = 0
+    for key in sorted(set(old) | set(new)):
+        name = "{}/{} [{}]".format(*key)
+        if key not in old:
+            print("new       {}".format(name))
+            continue
+        if key not in new:
+            status = "missing" if args.allow_missing else "MISSING"
+            print("{:<9} {}".format(status, name))
+            missing += 1
+            continue
+        a, b = old[key], new[key]
+        if args.metric not in a or args.metric not in b:
+            continue
+        if a[args.metric] == 0:
+            print("zero      {}".format(name))
+            continue
+        change = (b[args.metric] - a[args.metric]) / a[args.metric] * 100
+        worse = -change if higher_is_better(args.metric) else change
+        overlap = (
+            args.metric == "mean_s"
+            and "mean_low_s" in a
+            and "mean_low_s" in b
+            and b["mean_low_s"] <= a["mean_high_s"]
+            and a["mean_low_s"] <= b["mean_high_s"]
+        )
+        if worse > args.threshold and not overlap:
+            status = "REGRESSED"
+            regressions += 1
+        elif worse < -args.threshold and not overlap:
+            status = "improved"
+        elif args.all:
+            status = "same"
+        else:
+            continue
+        print(
+            "{:<9} {} {} -> {} ({:+.1f}%)".format(
+                status,
+                name,
+                format_value(args.metric, a[args.metric]),
+                format_value(args.metric, b[args.metric]),
+                change,
+            )
+        )
+
+    failed = False
+    if regressions:
+        print("{} benchmarks regressed".format(regressions), file=sys.stderr)
+        failed = True
+    if missing and not args.allow_missing:
+        print("{} benchmarks are missing".format(missing), file=sys.stderr)
+        failed = True
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())